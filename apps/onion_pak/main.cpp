@@ -0,0 +1,134 @@
+#include <onion/core/pack_archive/pack_archive.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// OnionPak pack <archive.onionpak> <directory> [--prefix name] [--no-compress] [--align bytes]
+//   Packs every file under <directory>. Entries are named <prefix>/<path relative to directory>,
+//   the prefix defaults to the directory name: "OnionPak pack assets.onionpak assets" keeps the
+//   "assets/..." paths the engine loads.
+// OnionPak list <archive.onionpak>
+namespace {
+
+	int PrintUsage() {
+		std::cout << "Usage:\n"
+			<< "  OnionPak pack <archive.onionpak> <directory> [--prefix name] [--no-compress] [--align bytes]\n"
+			<< "  OnionPak list <archive.onionpak>" << std::endl;
+		return 1;
+	}
+
+	bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& contents) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) {
+			return false;
+		}
+		contents.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		return contents.empty() || file.read(reinterpret_cast<char*>(contents.data()), static_cast<std::streamsize>(contents.size())).good();
+	}
+
+	int Pack(int argc, char** argv) {
+		if (argc < 4) {
+			return PrintUsage();
+		}
+
+		const std::string archivePath = argv[2];
+		const std::filesystem::path directory = argv[3];
+		std::filesystem::path normalized = std::filesystem::absolute(directory).lexically_normal();
+		if (!normalized.has_filename()) {
+			normalized = normalized.parent_path(); // Trailing separator
+		}
+		std::string prefix = normalized.filename().string();
+
+		Onion::Core::PackWriter::Settings settings;
+		for (int i = 4; i < argc; i++) {
+			if (std::strcmp(argv[i], "--prefix") == 0 && i + 1 < argc) {
+				prefix = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--no-compress") == 0) {
+				settings.Compress = false;
+			}
+			else if (std::strcmp(argv[i], "--align") == 0 && i + 1 < argc) {
+				settings.Alignment = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+			else {
+				return PrintUsage();
+			}
+		}
+
+		// Sorted, the same directory always gives the same archive
+		std::vector<std::filesystem::path> files;
+		for (const auto& item : std::filesystem::recursive_directory_iterator(directory)) {
+			if (item.is_regular_file()) {
+				files.push_back(item.path());
+			}
+		}
+		std::sort(files.begin(), files.end());
+
+		Onion::Core::PackWriter writer;
+		writer.SetSettings(settings);
+		std::vector<uint8_t> contents;
+		for (const std::filesystem::path& file : files) {
+			if (!ReadFile(file, contents)) {
+				std::cout << "[ONIONPAK] [ERROR] : Failed to read " << file.string() << std::endl;
+				return 1;
+			}
+			const std::string relative = std::filesystem::relative(file, directory).generic_string();
+			writer.Add(prefix.empty() ? relative : prefix + "/" + relative, contents.data(), contents.size());
+		}
+		writer.Write(archivePath);
+
+		const Onion::Core::PackWriter::Stats& stats = writer.GetStats();
+		std::cout << "[ONIONPAK] " << archivePath << ": " << stats.EntryCount << " files ("
+			<< stats.CompressedCount << " compressed), " << stats.Bytes / 1024 << " KB -> "
+			<< stats.StoredBytes / 1024 << " KB" << std::endl;
+		return 0;
+	}
+
+	int List(int argc, char** argv) {
+		if (argc < 3) {
+			return PrintUsage();
+		}
+
+		Onion::Core::PackArchive archive;
+		archive.Open(argv[2]);
+		for (uint32_t i = 0; i < archive.GetEntryCount(); i++) {
+			const Onion::Core::PackEntry& entry = archive.GetEntry(i);
+			std::cout << archive.GetName(entry) << "  " << entry.Size << " bytes";
+			if (Onion::Core::PackArchive::IsCompressed(entry)) {
+				std::cout << " (" << entry.StoredSize << " compressed)";
+			}
+			std::cout << std::endl;
+		}
+		return 0;
+	}
+}
+
+int main(int argc, char** argv) {
+
+	if (argc < 2) {
+		return PrintUsage();
+	}
+
+	try {
+		if (std::strcmp(argv[1], "pack") == 0) {
+			return Pack(argc, argv);
+		}
+		if (std::strcmp(argv[1], "list") == 0) {
+			return List(argc, argv);
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << "[ONIONPAK] [ERROR] : " << e.what() << std::endl;
+		return 1;
+	}
+
+	return PrintUsage();
+}
@@ -1,10 +1,79 @@
 #include <onion/onion.hpp>
 
-int main() {
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+// OnionSandbox [--headless] [--frames N] [--size W H] [--backend auto|egl|osmesa] [--capture file.png]
+//              [--record file.onionrec] [--replay file.onionrec] [--world directory] [--pak file.onionpak | --loose]
+//              [--startup-trace file.json]
+int main(int argc, char** argv) {
 
 	Onion::Engine engine;
 
+	// Packed next to the binary by the build, the loose assets/ directory is the fallback
+	const char* archivePath = "assets.onionpak";
+
+	Onion::Rendering::Renderer::HeadlessSettings headless;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--headless") == 0) {
+			headless.Enabled = true;
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			headless.MaxFrames = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--size") == 0 && i + 2 < argc) {
+			headless.Width = std::atoi(argv[++i]);
+			headless.Height = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+			Onion::Rendering::ParseOffscreenBackend(argv[++i], headless.Backend);
+		}
+		else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+			headless.CapturePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			// Not worth stopping the session for: it runs without recording
+			try {
+				engine.SetInputRecording(argv[++i]);
+			}
+			catch (const std::runtime_error& e) {
+				std::cout << "[INPUT RECORDING] [ERROR] : " << e.what() << ", running without recording." << std::endl;
+			}
+		}
+		else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			// Without its recording the replay run is meaningless
+			try {
+				engine.SetInputReplay(argv[++i]);
+			}
+			catch (const std::runtime_error& e) {
+				std::cout << "[INPUT REPLAY] [ERROR] : " << e.what() << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (std::strcmp(argv[i], "--pak") == 0 && i + 1 < argc) {
+			archivePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--loose") == 0) {
+			archivePath = nullptr;
+		}
+		else if (std::strcmp(argv[i], "--world") == 0 && i + 1 < argc) {
+			Onion::Rendering::WorldStreamer::Settings world;
+			world.Directory = argv[++i];
+			engine.SetWorldStreaming(world);
+		}
+		else if (std::strcmp(argv[i], "--startup-trace") == 0 && i + 1 < argc) {
+			engine.SetStartupTrace(argv[++i]);
+		}
+	}
+	engine.SetHeadless(headless);
+	if (archivePath && std::filesystem::exists(archivePath)) {
+		engine.MountAssetArchive(archivePath);
+	}
+
 	engine.Run();
 
 	return 0;
-}
\ No newline at end of file
+}
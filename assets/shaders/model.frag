@@ -2,13 +2,30 @@
 
 in vec2 vUV;
 in vec3 vNormal;
+in vec4 vTangent;
 in vec3 vWorldPos;
+in float vViewDepth;
 
 out vec4 FragColor;
 
+// Material textures, fixed units (see MaterialSlot)
 uniform sampler2D uAlbedo;
+uniform sampler2D uNormal;
 uniform sampler2D uRoughness;
 
+// Bits of uTextureMask, a slot without its bit has no texture
+const uint ALBEDO_TEXTURE = 1u;
+const uint NORMAL_TEXTURE = 2u;
+const uint ROUGHNESS_TEXTURE = 4u;
+
+// Material parameters, one block per material in a shared buffer (see MaterialTable)
+layout(std140) uniform MaterialBlock {
+    vec4 uBaseColor;
+    float uRoughnessFactor;
+    float uNormalStrength;
+    uint uTextureMask;
+};
+
 // Lighting
 uniform vec3 uLightDir;
 uniform vec3 uLightColor;
@@ -20,12 +37,71 @@ uniform vec3 uCameraPos;
 // Specular strength (still useful)
 uniform float uSpecularStrength;
 
+// Cascaded shadow maps
+const int MAX_CASCADES = 4;
+uniform sampler2DArrayShadow uShadowMap;
+uniform mat4 uCascadeViewProj[MAX_CASCADES];
+uniform float uCascadeSplits[MAX_CASCADES];
+uniform int uCascadeCount;
+uniform float uShadowTexelSize;
+
+// Returns 1.0 when fully lit, 0.0 when fully in shadow
+float ComputeShadow()
+{
+    int cascade = -1;
+    for (int i = 0; i < uCascadeCount; i++) {
+        if (vViewDepth < uCascadeSplits[i]) {
+            cascade = i;
+            break;
+        }
+    }
+    if (cascade < 0)
+        return 1.0;
+
+    vec4 lightSpace = uCascadeViewProj[cascade] * vec4(vWorldPos, 1.0);
+    vec3 coords = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if (coords.z > 1.0)
+        return 1.0;
+
+    // 3x3 PCF on top of the hardware comparison
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            vec2 offset = vec2(x, y) * uShadowTexelSize;
+            lit += texture(uShadowMap, vec4(coords.xy + offset, float(cascade), coords.z));
+        }
+    }
+    return lit / 9.0;
+}
+
+// Tangent frame from the vertex tangents (Assimp's, see Vertex::Tangent), made orthogonal to the
+// interpolated normal. The normal map follows the OpenGL convention (green up).
+vec3 ApplyNormalMap(vec3 N)
+{
+    vec3 T = vTangent.xyz - N * dot(N, vTangent.xyz);
+
+    // No UVs, or degenerate ones: keep the mesh normal
+    float lengthSquared = dot(T, T);
+    if (lengthSquared < 1e-12)
+        return N;
+    T *= inversesqrt(lengthSquared);
+    vec3 B = cross(N, T) * (vTangent.w < 0.0 ? -1.0 : 1.0);
+
+    vec3 tangentNormal = texture(uNormal, vUV).xyz * 2.0 - 1.0;
+    tangentNormal.xy *= uNormalStrength;
+    return normalize(mat3(T, B, N) * tangentNormal);
+}
+
 void main()
 {
-    vec3 albedo = texture(uAlbedo, vUV).rgb;
+    vec3 albedo = uBaseColor.rgb;
+    if ((uTextureMask & ALBEDO_TEXTURE) != 0u)
+        albedo *= texture(uAlbedo, vUV).rgb;
 
     // --- Normalized vectors ---
     vec3 N = normalize(vNormal);
+    if ((uTextureMask & NORMAL_TEXTURE) != 0u)
+        N = ApplyNormalMap(N);
     vec3 L = normalize(-uLightDir);
     vec3 V = normalize(uCameraPos - vWorldPos);
 
@@ -34,7 +110,9 @@ void main()
     vec3 diffuse = albedo * uLightColor * NdotL;
 
     // --- Roughness -> Shininess ---
-    float roughness = texture(uRoughness, vUV).r;
+    float roughness = uRoughnessFactor;
+    if ((uTextureMask & ROUGHNESS_TEXTURE) != 0u)
+        roughness *= texture(uRoughness, vUV).r;
 
     // Map roughness [0..1] -> shininess [128..4]
     float shininess = mix(128.0, 4.0, roughness);
@@ -49,6 +127,8 @@ void main()
     // --- Ambient ---
     vec3 ambient = albedo * uAmbient;
 
-    vec3 color = ambient + diffuse + specular;
+    float shadow = ComputeShadow();
+
+    vec3 color = ambient + (diffuse + specular) * shadow;
     FragColor = vec4(color, 1.0);
 }
@@ -3,13 +3,17 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aUV;
+layout (location = 3) in vec4 aTangent;
 
 uniform mat4 uViewProj;
+uniform mat4 uView;
 uniform mat4 uModel;
 
 out vec2 vUV;
 out vec3 vNormal;
+out vec4 vTangent;
 out vec3 vWorldPos;
+out float vViewDepth;
 
 void main()
 {
@@ -17,10 +21,13 @@ void main()
 
     vec4 worldPos = uModel * vec4(aPos, 1.0);
     vWorldPos = worldPos.xyz;
+    vViewDepth = -(uView * worldPos).z;
 
     // Correct normal transform
     mat3 normalMatrix = transpose(inverse(mat3(uModel)));
     vNormal = normalize(normalMatrix * aNormal);
+    // Tangents follow the surface: transformed by the model matrix itself, normalized in the fragment shader
+    vTangent = vec4(mat3(uModel) * aTangent.xyz, aTangent.w);
 
     gl_Position = uViewProj * worldPos;
 }
@@ -1,12 +1,50 @@
 #include "Engine.hpp"
 
+#include <chrono>
 #include <iostream>
 
+#include "profiler/profiler.hpp"
+#include "allocation_tracker/allocation_tracker.hpp"
+#include "virtual_file_system/virtual_file_system.hpp"
+
 using namespace Onion;
 
-Engine::Engine()
+namespace {
+	// FNV-1a over the simulated state a replay must reproduce exactly
+	uint64_t HashSimulationState(const FrameSnapshot& snapshot) {
+		uint64_t hash = 0xcbf29ce484222325ull;
+		auto mix = [&hash](const void* data, size_t size) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; i++) {
+				hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+			}
+			};
+
+		const SceneSettings& settings = snapshot.Settings;
+		mix(&snapshot.FrameIndex, sizeof(snapshot.FrameIndex));
+		mix(&settings.CameraPosition, sizeof(settings.CameraPosition));
+		mix(&settings.CameraYaw, sizeof(settings.CameraYaw));
+		mix(&settings.CameraPitch, sizeof(settings.CameraPitch));
+		mix(&settings.CameraFovY, sizeof(settings.CameraFovY));
+		mix(&settings.AppleTransform.Position, sizeof(settings.AppleTransform.Position));
+		mix(&settings.AppleTransform.Rotation, sizeof(settings.AppleTransform.Rotation));
+		mix(&settings.AppleTransform.Scale, sizeof(settings.AppleTransform.Scale));
+		mix(&snapshot.MouseCaptureEnabled, sizeof(snapshot.MouseCaptureEnabled));
+		return hash;
+	}
+}
+
+Engine::Engine() : m_FileIO(m_JobSystem), m_WorldStreamer(m_JobSystem), m_Renderer(m_JobSystem, m_FileIO), m_Simulation(m_JobSystem)
 {
-	std::cout << "Engine initialized." << std::endl;
+	// Inputs are registered before the render thread starts polling them
+	m_Simulation.RegisterInputs(m_Renderer.GetInputsManager());
+	m_Simulation.SetAppleModel(m_Renderer.GetAppleModel());
+
+	// Idle until SetWorldStreaming gives it a directory
+	m_Renderer.SetWorldStreamer(&m_WorldStreamer);
+	m_Simulation.SetWorldStreamer(&m_WorldStreamer);
+
+	std::cout << "Engine initialized (" << m_JobSystem.GetWorkerCount() << " job workers)." << std::endl;
 }
 
 Engine::~Engine()
@@ -20,7 +58,138 @@ void Engine::Run()
 
 	m_Renderer.Start();
 
-	// Wait for user input to stop the engine
-	std::cout << "Press Enter to stop the engine..." << std::endl;
-	std::cin.get();
+	// Runs until the window is closed
+	RunSimulation();
+
+	m_Renderer.Stop();
+
+	if (m_InputRecorder.IsOpen()) {
+		std::cout << "[INPUT RECORDING] " << m_InputRecorder.GetFrameCount() << " frames recorded." << std::endl;
+		m_InputRecorder.Close();
+	}
+}
+
+void Engine::SetSimulationSettings(const Onion::Core::FixedTimestep::Settings& settings)
+{
+	m_Timestep.SetSettings(settings);
+}
+
+void Engine::SetHeadless(const Renderer::HeadlessSettings& settings)
+{
+	m_Renderer.SetHeadless(settings);
+}
+
+bool Engine::MountAssetArchive(const std::string& path)
+{
+	return Onion::Core::VirtualFileSystem::Mount(path);
+}
+
+void Engine::SetWorldStreaming(const WorldStreamer::Settings& settings)
+{
+	m_WorldStreamer.SetSettings(settings);
+}
+
+void Engine::SetStartupTrace(const std::string& path)
+{
+	m_Renderer.SetStartupTraceOutput(path);
+}
+
+void Engine::SetInputRecording(const std::string& path)
+{
+	m_InputRecorder.Open(path);
+}
+
+void Engine::SetInputReplay(const std::string& path)
+{
+	m_InputPlayer.Open(path);
+}
+
+void Engine::RunSimulation()
+{
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point lastUpdate = Clock::now();
+
+	ONION_PROFILE_THREAD("Simulation");
+
+	while (m_Renderer.IsRunning()) {
+		// Blocks until the render thread picked up the previous frame
+		FrameSnapshot* snapshot = nullptr;
+		{
+			ONION_PROFILE_SCOPE("WaitForRenderer");
+			snapshot = m_Renderer.BeginSnapshot();
+		}
+		if (!snapshot) {
+			break;
+		}
+
+		ONION_PROFILE_SCOPE("SimulationFrame");
+		const uint64_t allocationsStart = Onion::Core::AllocationTracker::GetThreadCount();
+
+		const Clock::time_point now = Clock::now();
+		double frameTime = std::chrono::duration<double>(now - lastUpdate).count();
+		lastUpdate = now;
+
+		Onion::Controls::RecordedFrame frame;
+		bool replaying = false;
+		if (m_InputPlayer.IsOpen()) {
+			replaying = m_InputPlayer.Read(frame);
+			if (!replaying) {
+				std::cout << "[INPUT REPLAY] Finished: " << m_InputPlayer.GetFrameCount() << " frames, "
+					<< m_ReplayDivergences << " diverged." << std::endl;
+				m_InputPlayer.Close();
+				m_Renderer.RequestClose();
+			}
+		}
+
+		if (replaying) {
+			frameTime = frame.DeltaTime;
+		}
+		else {
+			frame.DeltaTime = frameTime;
+			frame.Inputs = m_Renderer.GetInputsSnapshot();
+		}
+
+		// Debug panel edits, ignored during a replay: they are not part of the recording
+		if (m_Renderer.TakeSceneSettingsEdits(m_SceneEdits) && !replaying) {
+			for (const SceneSettingsEdit& edit : m_SceneEdits) {
+				m_Simulation.ApplySettings(edit.Before, edit.After);
+			}
+		}
+
+		m_Simulation.SampleInputs(frame.Inputs);
+
+		// Fixed rate updates, however fast the frames go
+		const int ticks = m_Timestep.Advance(frameTime);
+		const Clock::time_point ticksStart = Clock::now();
+		for (int i = 0; i < ticks; i++) {
+			ONION_PROFILE_SCOPE("Simulation::Tick");
+			m_Simulation.Tick(m_Timestep.GetTickDuration());
+		}
+		if (ticks > 0) {
+			m_TickCpuMs = std::chrono::duration<double, std::milli>(Clock::now() - ticksStart).count() / ticks;
+		}
+
+		m_Simulation.BuildSnapshot(*snapshot, m_Timestep.GetAlpha());
+
+		SimulationStats& stats = snapshot->Stats;
+		stats.TickRate = m_Timestep.GetSettings().TickRate;
+		stats.TicksThisFrame = ticks;
+		stats.TickCpuMs = m_TickCpuMs;
+		stats.DroppedTime = m_Timestep.GetDroppedTime();
+		stats.HeapAllocations = Onion::Core::AllocationTracker::GetThreadCount() - allocationsStart;
+
+		if (replaying || m_InputRecorder.IsOpen()) {
+			const uint64_t stateHash = HashSimulationState(*snapshot);
+			if (replaying && stateHash != frame.StateHash) {
+				if (m_ReplayDivergences == 0) {
+					std::cout << "[INPUT REPLAY] [WARNING] : Simulation diverged from the recording at frame " << m_InputPlayer.GetFrameCount() << "." << std::endl;
+				}
+				m_ReplayDivergences++;
+			}
+			frame.StateHash = stateHash;
+			m_InputRecorder.Write(frame);
+		}
+
+		m_Renderer.PublishSnapshot();
+	}
 }
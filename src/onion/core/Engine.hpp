@@ -1,9 +1,18 @@
 #pragma once
 
 #include <cstdio>
+#include <string>
 #include <thread>
 
+#include <vector>
+
+#include "async_file_io/async_file_io.hpp"
+#include "fixed_timestep/fixed_timestep.hpp"
+#include "job_system/job_system.hpp"
+#include "simulation/simulation.hpp"
 #include "../renderer/renderer.hpp"
+#include "../renderer/input_recording/input_recording.hpp"
+#include "../renderer/world_streamer/world_streamer.hpp"
 
 using namespace Onion::Rendering;
 
@@ -16,7 +25,47 @@ namespace Onion
 
 		void Run();
 
+		// Simulation tick rate and spiral-of-death limits, can be changed before Run
+		void SetSimulationSettings(const Onion::Core::FixedTimestep::Settings& settings);
+
+		// Offscreen rendering without a window, ImGui or inputs (servers, CI). Call before Run.
+		void SetHeadless(const Renderer::HeadlessSettings& settings);
+
+		// Writes the inputs and frame times of the session to a file, for SetInputReplay. Call before Run.
+		void SetInputRecording(const std::string& path);
+		// Feeds a recording to the simulation instead of the live inputs and clock, then closes the window
+		// when it ends. The simulation goes through the recorded states, divergences are reported. Call before Run.
+		void SetInputReplay(const std::string& path);
+
+		// Assets are read from this .onionpak before the loose files. Call before Run.
+		bool MountAssetArchive(const std::string& path);
+
+		// Streams the cells of a world directory around the camera (see WorldStreamer). Call before Run.
+		void SetWorldStreaming(const WorldStreamer::Settings& settings);
+
+		// Writes when each startup task ran as a Chrome trace, with the critical path. Call before Run.
+		void SetStartupTrace(const std::string& path);
+
+	private:
+		// Simulation loop, runs on the calling thread until the window is closed
+		void RunSimulation();
+
 	private:
+		// Declared first: subsystems hold a reference to it, so it must outlive them
+		Onion::Core::JobSystem m_JobSystem;
+		// Completions run as jobs, stopped before the job system
+		Onion::Core::AsyncFileIO m_FileIO;
+		// Before the renderer: its render thread uses it until Stop
+		WorldStreamer m_WorldStreamer;
 		Renderer m_Renderer;
+		Onion::Core::Simulation m_Simulation;
+		Onion::Core::FixedTimestep m_Timestep;
+		double m_TickCpuMs = 0.0;
+
+		Onion::Controls::InputRecorder m_InputRecorder;
+		Onion::Controls::InputPlayer m_InputPlayer;
+		uint64_t m_ReplayDivergences = 0;
+
+		std::vector<SceneSettingsEdit> m_SceneEdits;
 	};
 }
\ No newline at end of file
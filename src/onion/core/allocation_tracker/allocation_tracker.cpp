@@ -0,0 +1,85 @@
+#include "allocation_tracker.hpp"
+
+#include <cstdlib>
+#include <new>
+
+using namespace Onion::Core;
+
+namespace {
+	thread_local uint64_t t_Allocations = 0;
+}
+
+uint64_t AllocationTracker::GetThreadCount()
+{
+	return t_Allocations;
+}
+
+#if ONION_TRACK_ALLOCATIONS
+
+// ------------ GLOBAL OPERATOR NEW ------------
+// The array, nothrow and sized forms are forwarded to these by the standard library.
+
+namespace {
+	void* Allocate(std::size_t size) {
+		t_Allocations++;
+		return std::malloc(size == 0 ? 1 : size);
+	}
+
+	void* AllocateAligned(std::size_t size, std::align_val_t alignment) {
+		t_Allocations++;
+		const std::size_t align = static_cast<std::size_t>(alignment);
+#if defined(_MSC_VER)
+		return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+		// aligned_alloc wants a non-zero size multiple of the alignment, a zero size may return nullptr
+		const std::size_t rounded = size == 0 ? align : (size + align - 1) / align * align;
+		return std::aligned_alloc(align, rounded);
+#endif
+	}
+
+	void FreeAligned(void* pointer) {
+#if defined(_MSC_VER)
+		_aligned_free(pointer);
+#else
+		std::free(pointer);
+#endif
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	if (void* pointer = Allocate(size)) {
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	if (void* pointer = AllocateAligned(size, alignment)) {
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+	FreeAligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(pointer);
+}
+
+#endif
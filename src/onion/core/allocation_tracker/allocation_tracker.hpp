@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// Set by CMake (ONION_TRACK_ALLOCATIONS option, on with the tests or the linux-profile preset). When 0
+// the global operator new is not replaced and every count stays at zero.
+#ifndef ONION_TRACK_ALLOCATIONS
+#define ONION_TRACK_ALLOCATIONS 0
+#endif
+
+namespace Onion::Core {
+
+	// Counts heap allocations made through operator new, per thread.
+	// Meant for budgets such as "no allocation per frame in steady state": take the count at the start
+	// and at the end of the frame on the same thread. malloc calls made by C libraries are not seen.
+	class AllocationTracker {
+	public:
+		static constexpr bool IsEnabled() {
+			return ONION_TRACK_ALLOCATIONS != 0;
+		}
+
+		// Allocations made by the calling thread since it started
+		static uint64_t GetThreadCount();
+	};
+
+} // namespace Onion::Core
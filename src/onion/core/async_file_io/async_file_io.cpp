@@ -0,0 +1,708 @@
+#include "async_file_io.hpp"
+
+#include "../profiler/profiler.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ONION_IO_URING 1
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#else
+#define ONION_IO_URING 0
+#endif
+
+using namespace Onion::Core;
+
+namespace {
+	constexpr int PRIORITY_COUNT = 3;
+
+	// ------------ PLATFORM FILES ------------
+
+#if defined(_WIN32)
+	int ToErrno(DWORD error) {
+		switch (error) {
+		case ERROR_FILE_NOT_FOUND:
+		case ERROR_PATH_NOT_FOUND:
+			return ENOENT;
+		case ERROR_ACCESS_DENIED:
+			return EACCES;
+		default:
+			return EIO;
+		}
+	}
+
+	intptr_t OpenFile(const std::string& path, uint64_t& size, int& error) {
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			error = ToErrno(GetLastError());
+			return -1;
+		}
+		LARGE_INTEGER fileSize{};
+		GetFileSizeEx(file, &fileSize);
+		size = static_cast<uint64_t>(fileSize.QuadPart);
+		return reinterpret_cast<intptr_t>(file);
+	}
+
+	void CloseFile(intptr_t file) {
+		CloseHandle(reinterpret_cast<HANDLE>(file));
+	}
+
+	// pread: bytes read, 0 at the end of the file, -1 and 'error' set on failure
+	int64_t ReadAt(intptr_t file, uint8_t* destination, size_t size, uint64_t offset, int& error) {
+		OVERLAPPED overlapped{};
+		overlapped.Offset = static_cast<DWORD>(offset);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD read = 0;
+		const DWORD toRead = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+		if (!::ReadFile(reinterpret_cast<HANDLE>(file), destination, toRead, &read, &overlapped)) {
+			const DWORD lastError = GetLastError();
+			if (lastError == ERROR_HANDLE_EOF) {
+				return 0;
+			}
+			error = ToErrno(lastError);
+			return -1;
+		}
+		return static_cast<int64_t>(read);
+	}
+#else
+	intptr_t OpenFile(const std::string& path, uint64_t& size, int& error) {
+		const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0) {
+			error = errno;
+			return -1;
+		}
+		struct stat status {};
+		if (::fstat(file, &status) != 0) {
+			error = errno;
+			::close(file);
+			return -1;
+		}
+		size = static_cast<uint64_t>(status.st_size);
+		return file;
+	}
+
+	void CloseFile(intptr_t file) {
+		::close(static_cast<int>(file));
+	}
+
+	int64_t ReadAt(intptr_t file, uint8_t* destination, size_t size, uint64_t offset, int& error) {
+		const ssize_t read = ::pread(static_cast<int>(file), destination, size, static_cast<off_t>(offset));
+		if (read < 0) {
+			error = errno;
+			return -1;
+		}
+		return static_cast<int64_t>(read);
+	}
+#endif
+}
+
+// ------------ IO_URING RING ------------
+
+#if ONION_IO_URING
+struct AsyncFileIO::UringState {
+	static constexpr uint64_t WAKE_TAG = ~0ull;
+
+	// A read in the kernel. Short reads are resubmitted for the rest.
+	struct Chunk {
+		PendingRequest* Request = nullptr;
+		uint64_t FileOffset = 0;
+		iovec Vector{};
+	};
+
+	int Ring = -1;
+	int WakeEvent = -1;
+
+	void* SqMap = MAP_FAILED;
+	size_t SqMapSize = 0;
+	void* CqMap = MAP_FAILED;
+	size_t CqMapSize = 0;
+	io_uring_sqe* Sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	size_t SqesSize = 0;
+
+	uint32_t* SqHead = nullptr;
+	uint32_t* SqTail = nullptr;
+	uint32_t SqMask = 0;
+	uint32_t* SqArray = nullptr;
+	uint32_t* CqHead = nullptr;
+	uint32_t* CqTail = nullptr;
+	uint32_t CqMask = 0;
+	io_uring_cqe* Cqes = nullptr;
+
+	uint32_t Tail = 0;		// Only written by the I/O thread
+	uint32_t Unsubmitted = 0;
+
+	// One submission entry is kept for the wake-up poll, the others for reads
+	std::vector<Chunk> Chunks;
+	std::vector<uint32_t> FreeChunks;
+
+	~UringState() {
+		if (Sqes != MAP_FAILED) {
+			::munmap(Sqes, SqesSize);
+		}
+		if (CqMap != MAP_FAILED && CqMap != SqMap) {
+			::munmap(CqMap, CqMapSize);
+		}
+		if (SqMap != MAP_FAILED) {
+			::munmap(SqMap, SqMapSize);
+		}
+		if (Ring >= 0) {
+			::close(Ring);
+		}
+		if (WakeEvent >= 0) {
+			::close(WakeEvent);
+		}
+	}
+
+	// 0, or the errno of the failing call
+	int Setup(uint32_t queueDepth) {
+		io_uring_params params{};
+		Ring = static_cast<int>(::syscall(__NR_io_uring_setup, std::max(queueDepth, 2u), &params));
+		if (Ring < 0) {
+			return errno;
+		}
+
+		SqMapSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+		CqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (singleMap) {
+			SqMapSize = CqMapSize = std::max(SqMapSize, CqMapSize);
+		}
+
+		SqMap = ::mmap(nullptr, SqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQ_RING);
+		if (SqMap == MAP_FAILED) {
+			return errno;
+		}
+		CqMap = singleMap ? SqMap : ::mmap(nullptr, CqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_CQ_RING);
+		if (CqMap == MAP_FAILED) {
+			return errno;
+		}
+		SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		Sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQES));
+		if (Sqes == MAP_FAILED) {
+			return errno;
+		}
+
+		uint8_t* sq = static_cast<uint8_t*>(SqMap);
+		SqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+		SqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+		SqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+		SqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+		Tail = *SqTail;
+
+		uint8_t* cq = static_cast<uint8_t*>(CqMap);
+		CqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+		CqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+		CqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+		Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		WakeEvent = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (WakeEvent < 0) {
+			return errno;
+		}
+
+		Chunks.resize(params.sq_entries - 1);
+		for (uint32_t i = static_cast<uint32_t>(Chunks.size()); i > 0; i--) {
+			FreeChunks.push_back(i - 1);
+		}
+		return 0;
+	}
+
+	io_uring_sqe& NextEntry() {
+		const uint32_t index = Tail & SqMask;
+		io_uring_sqe& entry = Sqes[index];
+		std::memset(&entry, 0, sizeof(entry));
+		SqArray[index] = index;
+		return entry;
+	}
+
+	// Publishes the entry filled by NextEntry to the kernel
+	void Push() {
+		Tail++;
+		std::atomic_ref<uint32_t>(*SqTail).store(Tail, std::memory_order_release);
+		Unsubmitted++;
+	}
+
+	void PushRead(uint32_t chunkIndex, int file) {
+		const Chunk& chunk = Chunks[chunkIndex];
+		io_uring_sqe& entry = NextEntry();
+		entry.opcode = IORING_OP_READV;
+		entry.fd = file;
+		entry.off = chunk.FileOffset;
+		entry.addr = reinterpret_cast<uint64_t>(&chunk.Vector);
+		entry.len = 1;
+		entry.user_data = chunkIndex;
+		Push();
+	}
+
+	void PushWakePoll() {
+		io_uring_sqe& entry = NextEntry();
+		entry.opcode = IORING_OP_POLL_ADD;
+		entry.fd = WakeEvent;
+		entry.poll_events = POLLIN;
+		entry.user_data = WAKE_TAG;
+		Push();
+	}
+
+	bool HasReadsInFlight() const {
+		return FreeChunks.size() != Chunks.size();
+	}
+};
+#else
+struct AsyncFileIO::UringState {};
+#endif
+
+// ------------ CONSTRUCTOR & DESTRUCTOR ------------
+
+AsyncFileIO::AsyncFileIO(JobSystem& jobSystem)
+	: m_JobSystem(jobSystem)
+{
+}
+
+AsyncFileIO::~AsyncFileIO()
+{
+	Stop();
+}
+
+void AsyncFileIO::SetSettings(const Settings& settings)
+{
+	std::lock_guard<std::mutex> lock(m_MutexStart);
+	if (m_Started) {
+		std::cout << "[ASYNC IO] [WARNING] : Settings changed after the first request, ignored." << std::endl;
+		return;
+	}
+	m_Settings = settings;
+	m_Settings.ChunkSize = std::max(m_Settings.ChunkSize, 4096u);
+	m_Settings.ThreadCount = std::max(m_Settings.ThreadCount, 1u);
+}
+
+void AsyncFileIO::Start()
+{
+	std::lock_guard<std::mutex> lock(m_MutexStart);
+	if (m_Started) {
+		return;
+	}
+	m_Started = true;
+
+	if (m_Settings.UseIoUring && StartIoUring()) {
+		m_Backend = Backend::IoUring;
+		return;
+	}
+
+	m_Backend = Backend::ThreadPool;
+	for (uint32_t i = 0; i < m_Settings.ThreadCount; i++) {
+		m_Threads.emplace_back([this]() { PoolThreadFunction(); });
+	}
+}
+
+void AsyncFileIO::Stop()
+{
+	std::vector<std::unique_ptr<PendingRequest>> cancelled;
+	{
+		std::lock_guard<std::mutex> lock(m_MutexQueue);
+		m_Stopping = true;
+		for (auto& queue : m_Queues) {
+			for (auto& pending : queue) {
+				cancelled.push_back(std::move(pending));
+			}
+			queue.clear();
+		}
+	}
+	m_QueueCondition.notify_all();
+
+	for (auto& pending : cancelled) {
+		pending->Error = ECANCELED;
+		Finish(std::move(pending));
+	}
+
+#if ONION_IO_URING
+	if (m_Uring) {
+		const uint64_t one = 1;
+		[[maybe_unused]] const ssize_t written = ::write(m_Uring->WakeEvent, &one, sizeof(one));
+	}
+#endif
+
+	for (std::thread& thread : m_Threads) {
+		thread.join();
+	}
+	m_Threads.clear();
+	m_Uring.reset();
+}
+
+// ------------ SUBMISSION ------------
+
+void AsyncFileIO::Submit(IoRequest request, JobCounter& counter)
+{
+	std::vector<IoRequest> requests;
+	requests.push_back(std::move(request));
+	Submit(std::move(requests), counter);
+}
+
+void AsyncFileIO::Submit(std::vector<IoRequest> requests, JobCounter& counter)
+{
+	if (requests.empty()) {
+		return;
+	}
+
+	Start();
+
+	m_Requests.fetch_add(requests.size(), std::memory_order_relaxed);
+	m_JobSystem.BeginExternal(counter, static_cast<int>(requests.size()));
+
+	std::vector<std::unique_ptr<PendingRequest>> cancelled;
+	{
+		std::lock_guard<std::mutex> lock(m_MutexQueue);
+		for (IoRequest& request : requests) {
+			auto pending = std::make_unique<PendingRequest>();
+			pending->Request = std::move(request);
+			pending->Counter = &counter;
+			if (m_Stopping) {
+				cancelled.push_back(std::move(pending));
+				continue;
+			}
+			m_Queues[static_cast<int>(pending->Request.Priority)].push_back(std::move(pending));
+		}
+	}
+
+	for (auto& pending : cancelled) {
+		pending->Error = ECANCELED;
+		Finish(std::move(pending));
+	}
+
+#if ONION_IO_URING
+	if (m_Backend == Backend::IoUring) {
+		// One wake-up for the whole batch
+		const uint64_t one = 1;
+		[[maybe_unused]] const ssize_t written = ::write(m_Uring->WakeEvent, &one, sizeof(one));
+		return;
+	}
+#endif
+	m_QueueCondition.notify_all();
+}
+
+std::unique_ptr<AsyncFileIO::PendingRequest> AsyncFileIO::PopQueued(int below)
+{
+	std::lock_guard<std::mutex> lock(m_MutexQueue);
+	for (int priority = 0; priority < std::min(below, PRIORITY_COUNT); priority++) {
+		auto& queue = m_Queues[priority];
+		if (!queue.empty()) {
+			std::unique_ptr<PendingRequest> pending = std::move(queue.front());
+			queue.pop_front();
+			return pending;
+		}
+	}
+	return nullptr;
+}
+
+AsyncFileIO::Backend AsyncFileIO::GetBackend()
+{
+	Start();
+	return m_Backend;
+}
+
+AsyncFileIO::Stats AsyncFileIO::GetStats() const
+{
+	Stats stats;
+	stats.Requests = m_Requests.load(std::memory_order_relaxed);
+	stats.Failed = m_Failed.load(std::memory_order_relaxed);
+	stats.BytesRead = m_BytesRead.load(std::memory_order_relaxed);
+	stats.Reads = m_Reads.load(std::memory_order_relaxed);
+	return stats;
+}
+
+// ------------ REQUESTS ------------
+
+bool AsyncFileIO::BeginRead(PendingRequest& pending)
+{
+	const IoRequest& request = pending.Request;
+
+	uint64_t fileSize = 0;
+	pending.File = OpenFile(request.Path, fileSize, pending.Error);
+	if (pending.File == -1) {
+		return false;
+	}
+
+	const size_t available = request.Offset < fileSize ? static_cast<size_t>(fileSize - request.Offset) : 0;
+	if (request.Buffer) {
+		pending.Destination = static_cast<uint8_t*>(request.Buffer);
+		pending.Size = std::min(request.Size, available);
+	}
+	else if (request.WholeFile) {
+		request.WholeFile->resize(available);
+		pending.Destination = request.WholeFile->data();
+		pending.Size = available;
+	}
+	else {
+		pending.Error = EINVAL;
+		return false;
+	}
+
+	return pending.Size > 0;
+}
+
+void AsyncFileIO::Finish(std::unique_ptr<PendingRequest> pending)
+{
+	if (pending->File != -1) {
+		CloseFile(pending->File);
+		pending->File = -1;
+	}
+
+	IoRequest& request = pending->Request;
+	if (!request.Buffer && request.WholeFile && request.WholeFile->size() != pending->BytesRead) {
+		request.WholeFile->resize(pending->BytesRead);
+	}
+
+	IoResult result;
+	result.BytesRead = pending->BytesRead;
+	result.Error = pending->Error;
+
+	m_BytesRead.fetch_add(result.BytesRead, std::memory_order_relaxed);
+	if (!result.Succeeded()) {
+		m_Failed.fetch_add(1, std::memory_order_relaxed);
+		if (result.Error != ECANCELED) {
+			std::cout << "[ASYNC IO] [ERROR] : Failed to read " << request.Path << ": " << std::strerror(result.Error) << std::endl;
+		}
+	}
+
+	if (request.Result) {
+		*request.Result = result;
+	}
+
+	// The completion is counted before the read, the counter never reaches zero in between
+	JobCounter& counter = *pending->Counter;
+	if (request.OnComplete) {
+		m_JobSystem.Run([onComplete = std::move(request.OnComplete), result]() { onComplete(result); }, &counter);
+	}
+	pending.reset();
+	m_JobSystem.EndExternal(counter);
+}
+
+// ------------ THREAD POOL BACKEND ------------
+
+void AsyncFileIO::PoolThreadFunction()
+{
+	ONION_PROFILE_THREAD("File IO");
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_MutexQueue);
+			m_QueueCondition.wait(lock, [this]() {
+				return m_Stopping || std::any_of(std::begin(m_Queues), std::end(m_Queues), [](const auto& queue) { return !queue.empty(); });
+				});
+			if (m_Stopping) {
+				return;
+			}
+		}
+
+		std::unique_ptr<PendingRequest> pending = PopQueued();
+		if (!pending) {
+			continue; // Taken by another thread
+		}
+
+		ONION_PROFILE_SCOPE("AsyncFileIO::Read");
+		if (BeginRead(*pending)) {
+			while (pending->BytesRead < pending->Size) {
+				const size_t size = std::min<size_t>(pending->Size - pending->BytesRead, m_Settings.ChunkSize);
+				const int64_t read = ReadAt(pending->File, pending->Destination + pending->BytesRead, size,
+					pending->Request.Offset + pending->BytesRead, pending->Error);
+				m_Reads.fetch_add(1, std::memory_order_relaxed);
+				if (read < 0 && pending->Error == EINTR) {
+					pending->Error = 0;
+					continue;
+				}
+				if (read <= 0) {
+					break;
+				}
+				pending->BytesRead += static_cast<size_t>(read);
+			}
+		}
+		Finish(std::move(pending));
+	}
+}
+
+// ------------ IO_URING BACKEND ------------
+
+bool AsyncFileIO::StartIoUring()
+{
+#if ONION_IO_URING
+	auto uring = std::make_unique<UringState>();
+	if (const int error = uring->Setup(m_Settings.QueueDepth)) {
+		std::cout << "[ASYNC IO] [WARNING] : io_uring unavailable (" << std::strerror(error) << "), using the thread pool." << std::endl;
+		return false;
+	}
+	m_Uring = std::move(uring);
+	m_Threads.emplace_back([this]() { IoUringThreadFunction(); });
+	return true;
+#else
+	return false;
+#endif
+}
+
+void AsyncFileIO::IoUringThreadFunction()
+{
+#if ONION_IO_URING
+	ONION_PROFILE_THREAD("File IO");
+
+	UringState& ring = *m_Uring;
+
+	// Started requests with chunks left to submit, by priority then start order
+	std::vector<PendingRequest*> submitting;
+
+	auto isSubmitted = [](const PendingRequest& pending) {
+		return pending.NextOffset >= pending.Size || pending.Error != 0 || pending.Ended;
+		};
+
+	ring.PushWakePoll();
+
+	while (true) {
+		bool stopping = false;
+		{
+			std::lock_guard<std::mutex> lock(m_MutexQueue);
+			stopping = m_Stopping;
+		}
+
+		// Requests done submitting: an error, the end of the file or shutting down stops their remaining chunks
+		for (auto it = submitting.begin(); it != submitting.end();) {
+			PendingRequest* pending = *it;
+			if (stopping && pending->Error == 0) {
+				pending->Error = ECANCELED;
+			}
+			if (!isSubmitted(*pending)) {
+				++it;
+				continue;
+			}
+			it = submitting.erase(it);
+			pending->Submitting = false;
+			if (pending->InFlight == 0) {
+				Finish(std::unique_ptr<PendingRequest>(pending));
+			}
+		}
+
+		if (stopping && !ring.HasReadsInFlight()) {
+			break;
+		}
+
+		// Fill the free slots, a newly queued request of higher priority goes before the current one
+		while (!stopping && !ring.FreeChunks.empty()) {
+			const int current = submitting.empty() ? PRIORITY_COUNT : static_cast<int>(submitting.front()->Request.Priority);
+			if (std::unique_ptr<PendingRequest> pending = PopQueued(current)) {
+				if (!BeginRead(*pending)) {
+					Finish(std::move(pending));
+					continue;
+				}
+				pending->Submitting = true;
+				const auto position = std::upper_bound(submitting.begin(), submitting.end(), pending->Request.Priority,
+					[](IoPriority priority, const PendingRequest* other) { return priority < other->Request.Priority; });
+				submitting.insert(position, pending.release());
+				continue;
+			}
+			if (submitting.empty()) {
+				break;
+			}
+
+			PendingRequest* pending = submitting.front();
+			const size_t size = std::min<size_t>(pending->Size - pending->NextOffset, m_Settings.ChunkSize);
+
+			const uint32_t chunkIndex = ring.FreeChunks.back();
+			ring.FreeChunks.pop_back();
+			UringState::Chunk& chunk = ring.Chunks[chunkIndex];
+			chunk.Request = pending;
+			chunk.FileOffset = pending->Request.Offset + pending->NextOffset;
+			chunk.Vector.iov_base = pending->Destination + pending->NextOffset;
+			chunk.Vector.iov_len = size;
+			ring.PushRead(chunkIndex, static_cast<int>(pending->File));
+			m_Reads.fetch_add(1, std::memory_order_relaxed);
+
+			pending->NextOffset += size;
+			pending->InFlight++;
+			if (pending->NextOffset >= pending->Size) {
+				submitting.erase(submitting.begin());
+				pending->Submitting = false;
+			}
+		}
+
+		// Submits and sleeps until at least one read or a wake-up completes
+		const long entered = ::syscall(__NR_io_uring_enter, ring.Ring, ring.Unsubmitted, 1u, IORING_ENTER_GETEVENTS, nullptr, 0);
+		if (entered < 0) {
+			if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+				std::cout << "[ASYNC IO] [ERROR] : io_uring_enter failed: " << std::strerror(errno) << std::endl;
+			}
+		}
+		else {
+			ring.Unsubmitted -= static_cast<uint32_t>(entered);
+		}
+
+		ONION_PROFILE_SCOPE("AsyncFileIO::Completions");
+		uint32_t head = *ring.CqHead;
+		const uint32_t tail = std::atomic_ref<uint32_t>(*ring.CqTail).load(std::memory_order_acquire);
+		for (; head != tail; head++) {
+			const io_uring_cqe& completion = ring.Cqes[head & ring.CqMask];
+
+			if (completion.user_data == UringState::WAKE_TAG) {
+				uint64_t value = 0;
+				[[maybe_unused]] const ssize_t read = ::read(ring.WakeEvent, &value, sizeof(value));
+				ring.PushWakePoll();
+				continue;
+			}
+
+			const uint32_t chunkIndex = static_cast<uint32_t>(completion.user_data);
+			UringState::Chunk& chunk = ring.Chunks[chunkIndex];
+			PendingRequest* pending = chunk.Request;
+
+			bool resubmit = false;
+			if (completion.res == -EAGAIN || completion.res == -EINTR) {
+				resubmit = true;
+			}
+			else if (completion.res < 0) {
+				pending->Error = -completion.res;
+			}
+			else if (completion.res == 0) {
+				pending->Ended = true;
+			}
+			else {
+				// Short read: the rest of the chunk goes back to the kernel
+				const size_t read = static_cast<size_t>(completion.res);
+				pending->BytesRead += read;
+				chunk.FileOffset += read;
+				chunk.Vector.iov_base = static_cast<uint8_t*>(chunk.Vector.iov_base) + read;
+				chunk.Vector.iov_len -= read;
+				resubmit = chunk.Vector.iov_len > 0 && !stopping;
+			}
+
+			if (resubmit) {
+				ring.PushRead(chunkIndex, static_cast<int>(pending->File));
+				m_Reads.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+
+			chunk.Request = nullptr;
+			ring.FreeChunks.push_back(chunkIndex);
+			pending->InFlight--;
+			if (chunk.Vector.iov_len > 0 && pending->Error == 0 && !pending->Ended) {
+				pending->Error = ECANCELED; // Shutting down in the middle of the chunk
+			}
+			if (pending->InFlight == 0 && !pending->Submitting) {
+				Finish(std::unique_ptr<PendingRequest>(pending));
+			}
+		}
+		std::atomic_ref<uint32_t>(*ring.CqHead).store(head, std::memory_order_release);
+	}
+#endif
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../job_system/job_system.hpp"
+
+namespace Onion::Core {
+
+	enum class IoPriority : uint8_t {
+		High = 0,	// Needed for the next frame
+		Normal = 1,
+		Low = 2,	// Prefetching
+	};
+
+	struct IoResult {
+		size_t BytesRead = 0;	// Less than requested when the file ends first
+		int Error = 0;			// errno, ECANCELED when the service shut down before the read
+
+		bool Succeeded() const {
+			return Error == 0;
+		}
+	};
+
+	struct IoRequest {
+		std::string Path;
+		uint64_t Offset = 0;
+
+		// Destination, read in place: a caller-owned buffer of Size bytes (a GPU staging buffer for instance),
+		// or, when Buffer is null, WholeFile resized to the rest of the file from Offset.
+		// Either must stay untouched until the request completed.
+		void* Buffer = nullptr;
+		size_t Size = 0;
+		std::vector<uint8_t>* WholeFile = nullptr;
+
+		IoPriority Priority = IoPriority::Normal;
+
+		// Both optional. Result is written before OnComplete runs, as a job of the JobSystem.
+		IoResult* Result = nullptr;
+		std::function<void(const IoResult&)> OnComplete;
+	};
+
+	// Asynchronous file reads, so loaders can issue all their reads at once and decode while the rest lands.
+	// On Linux the reads go through io_uring: one I/O thread keeps up to QueueDepth chunks in flight in the kernel.
+	// Elsewhere, or when io_uring is not available (old kernel, seccomp), a small pool of threads calls pread.
+	// Requests are started by priority then in submission order, large ones are split in ChunkSize reads.
+	class AsyncFileIO {
+	public:
+		enum class Backend {
+			IoUring,
+			ThreadPool
+		};
+
+		struct Settings {
+			bool UseIoUring = true;
+			uint32_t QueueDepth = 64;			// io_uring reads in flight
+			uint32_t ChunkSize = 1u << 20;		// Largest single read
+			uint32_t ThreadCount = 4;			// Thread pool backend
+		};
+
+		struct Stats {
+			uint64_t Requests = 0;
+			uint64_t Failed = 0;		// Cancelled included
+			uint64_t BytesRead = 0;
+			uint64_t Reads = 0;			// Read calls or io_uring submissions, chunks and retries included
+		};
+
+		explicit AsyncFileIO(JobSystem& jobSystem);
+		// Cancels the requests not started yet and waits for the reads in flight
+		~AsyncFileIO();
+
+		AsyncFileIO(const AsyncFileIO&) = delete;
+		AsyncFileIO& operator=(const AsyncFileIO&) = delete;
+
+		// Before the first Submit
+		void SetSettings(const Settings& settings);
+
+		// Queues every request in one go. 'counter' covers each read and its OnComplete,
+		// JobSystem::Wait on it helps running the completions while the reads are in flight.
+		void Submit(std::vector<IoRequest> requests, JobCounter& counter);
+		void Submit(IoRequest request, JobCounter& counter);
+
+		// Starts the backend on the first Submit
+		Backend GetBackend();
+		Stats GetStats() const;
+
+		JobSystem& GetJobSystem() {
+			return m_JobSystem;
+		}
+
+	private:
+		struct PendingRequest {
+			IoRequest Request;
+			JobCounter* Counter = nullptr;
+
+			// Set when the read starts
+			intptr_t File = -1;		// File descriptor, or HANDLE on Windows
+			uint8_t* Destination = nullptr;
+			size_t Size = 0;
+			size_t NextOffset = 0;		// io_uring: next chunk to submit, relative to Destination
+			uint32_t InFlight = 0;		// io_uring: chunks in the kernel
+			size_t BytesRead = 0;
+			int Error = 0;
+			bool Ended = false;			// The file was shorter than expected
+			bool Submitting = false;	// io_uring: chunks left to submit, owned by the submission list
+		};
+
+		struct UringState;
+
+		void Start();
+		void Stop();
+
+		// Opens the file and sizes the destination. False when the request is already complete (error, empty read).
+		bool BeginRead(PendingRequest& pending);
+		void Finish(std::unique_ptr<PendingRequest> pending);
+		// First queued request of a priority above 'below', by priority then submission order
+		std::unique_ptr<PendingRequest> PopQueued(int below = 3);
+
+		void PoolThreadFunction();
+
+		bool StartIoUring();
+		void IoUringThreadFunction();
+
+	private:
+		JobSystem& m_JobSystem;
+		Settings m_Settings;
+
+		std::mutex m_MutexStart;
+		bool m_Started = false;
+		Backend m_Backend = Backend::ThreadPool;
+
+		// One queue per IoPriority
+		std::mutex m_MutexQueue;
+		std::condition_variable m_QueueCondition;
+		std::deque<std::unique_ptr<PendingRequest>> m_Queues[3];
+		bool m_Stopping = false;
+
+		std::vector<std::thread> m_Threads;
+		std::unique_ptr<UringState> m_Uring;
+
+		std::atomic<uint64_t> m_Requests{ 0 };
+		std::atomic<uint64_t> m_Failed{ 0 };
+		std::atomic<uint64_t> m_BytesRead{ 0 };
+		std::atomic<uint64_t> m_Reads{ 0 };
+	};
+
+} // namespace Onion::Core
@@ -0,0 +1,190 @@
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace Onion::Core;
+
+namespace {
+	// LZ4 block format constraints
+	constexpr size_t MIN_MATCH = 4;
+	constexpr size_t LAST_LITERALS = 5;		// The block always ends with at least 5 literals
+	constexpr size_t MATCH_START_LIMIT = 12;	// and no match starts within its last 12 bytes
+	constexpr size_t MAX_OFFSET = 65535;
+	constexpr uint32_t RUN_MASK = 15;
+
+	constexpr int HASH_BITS = 16;
+
+	uint32_t Read32(const uint8_t* pointer) {
+		uint32_t value;
+		std::memcpy(&value, pointer, sizeof(value));
+		return value;
+	}
+
+	uint32_t Hash(uint32_t sequence) {
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// Length bytes following a token nibble of 15
+	uint8_t* WriteLength(uint8_t* out, size_t length) {
+		length -= RUN_MASK;
+		for (; length >= 255; length -= 255) {
+			*out++ = 255;
+		}
+		*out++ = static_cast<uint8_t>(length);
+		return out;
+	}
+
+	bool ReadLength(const uint8_t*& in, const uint8_t* end, size_t& length) {
+		uint8_t byte = 0;
+		do {
+			if (in >= end) {
+				return false;
+			}
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	uint8_t* WriteSequence(uint8_t* out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength) {
+		uint8_t* token = out++;
+		*token = static_cast<uint8_t>(std::min<size_t>(literalCount, RUN_MASK) << 4);
+		if (literalCount >= RUN_MASK) {
+			out = WriteLength(out, literalCount);
+		}
+		if (literalCount > 0) {
+			std::memcpy(out, literals, literalCount);
+			out += literalCount;
+		}
+
+		// The last sequence has literals only
+		if (matchLength == 0) {
+			return out;
+		}
+
+		*out++ = static_cast<uint8_t>(offset & 0xFF);
+		*out++ = static_cast<uint8_t>(offset >> 8);
+		const size_t length = matchLength - MIN_MATCH;
+		*token |= static_cast<uint8_t>(std::min<size_t>(length, RUN_MASK));
+		if (length >= RUN_MASK) {
+			out = WriteLength(out, length);
+		}
+		return out;
+	}
+}
+
+size_t BlockCompression::GetMaxCompressedSize(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+uint64_t BlockCompression::GetMaxDecompressedSize(uint64_t compressedSize)
+{
+	return compressedSize * 255;
+}
+
+size_t BlockCompression::Compress(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity)
+{
+	if (capacity < GetMaxCompressedSize(size)) {
+		return 0;
+	}
+
+	uint8_t* out = destination;
+	size_t anchor = 0;
+
+	if (size > MATCH_START_LIMIT) {
+		// Last position seen for each hashed sequence
+		std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+		const size_t startLimit = size - MATCH_START_LIMIT;
+		const size_t endLimit = size - LAST_LITERALS;
+
+		size_t position = 0;
+		while (position <= startLimit) {
+			const uint32_t sequence = Read32(source + position);
+			uint32_t& slot = table[Hash(sequence)];
+			const size_t candidate = slot;
+			slot = static_cast<uint32_t>(position);
+
+			if (candidate >= position || position - candidate > MAX_OFFSET || Read32(source + candidate) != sequence) {
+				// Skips faster and faster through data that does not compress
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			size_t length = MIN_MATCH;
+			while (position + length < endLimit && source[candidate + length] == source[position + length]) {
+				length++;
+			}
+
+			out = WriteSequence(out, source + anchor, position - anchor, position - candidate, length);
+			position += length;
+			anchor = position;
+		}
+	}
+
+	out = WriteSequence(out, source + anchor, size - anchor, 0, 0);
+	return static_cast<size_t>(out - destination);
+}
+
+bool BlockCompression::Decompress(const uint8_t* source, size_t compressedSize, uint8_t* destination, size_t size)
+{
+	const uint8_t* in = source;
+	const uint8_t* const inEnd = source + compressedSize;
+	uint8_t* out = destination;
+	uint8_t* const outEnd = destination + size;
+
+	while (in < inEnd) {
+		const uint8_t token = *in++;
+
+		size_t literals = token >> 4;
+		if (literals == RUN_MASK && !ReadLength(in, inEnd, literals)) {
+			return false;
+		}
+		if (literals > static_cast<size_t>(inEnd - in) || literals > static_cast<size_t>(outEnd - out)) {
+			return false;
+		}
+		if (literals > 0) {
+			std::memcpy(out, in, literals);
+			in += literals;
+			out += literals;
+		}
+
+		if (in == inEnd) {
+			break;
+		}
+
+		if (inEnd - in < 2) {
+			return false;
+		}
+		const size_t offset = static_cast<size_t>(in[0]) | (static_cast<size_t>(in[1]) << 8);
+		in += 2;
+		if (offset == 0 || offset > static_cast<size_t>(out - destination)) {
+			return false;
+		}
+
+		size_t length = token & RUN_MASK;
+		if (length == RUN_MASK && !ReadLength(in, inEnd, length)) {
+			return false;
+		}
+		length += MIN_MATCH;
+		if (length > static_cast<size_t>(outEnd - out)) {
+			return false;
+		}
+
+		const uint8_t* match = out - offset;
+		if (offset >= length) {
+			std::memcpy(out, match, length);
+		}
+		else {
+			// Overlapping: repeats the last 'offset' bytes, each copy reads what the previous one wrote
+			for (size_t copied = 0; copied < length; copied += offset) {
+				std::memcpy(out + copied, match + copied, std::min(offset, length - copied));
+			}
+		}
+		out += length;
+	}
+
+	return out == outEnd;
+}
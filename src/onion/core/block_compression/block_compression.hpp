@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Onion::Core {
+
+	// Byte-oriented LZ77 compression in the LZ4 block format: a greedy match finder over a hash of
+	// 4-byte sequences, and a decoder that is only bounded by memory bandwidth. Blocks are compatible
+	// with LZ4_decompress_safe, without the frame header (the sizes are stored by the caller).
+	class BlockCompression {
+	public:
+		// Output size in the worst case (incompressible input)
+		static size_t GetMaxCompressedSize(size_t size);
+		// Largest size a block can decode to, each length byte adding at most 255 bytes.
+		// Bounds a decompressed size read from a file before allocating it.
+		static uint64_t GetMaxDecompressedSize(uint64_t compressedSize);
+
+		// Returns the compressed size, or 0 if 'capacity' is below GetMaxCompressedSize(size)
+		static size_t Compress(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity);
+
+		// 'size' is the exact decompressed size. Returns false on a corrupt block, never reads or
+		// writes out of bounds.
+		static bool Decompress(const uint8_t* source, size_t compressedSize, uint8_t* destination, size_t size);
+	};
+
+} // namespace Onion::Core
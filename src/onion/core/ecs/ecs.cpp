@@ -0,0 +1,298 @@
+#include "ecs.hpp"
+
+#include "../profiler/profiler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+using namespace Onion::Core;
+
+namespace {
+	// Chunks and the arrays inside them start on a cache line
+	constexpr size_t CHUNK_ALIGNMENT = 64;
+
+	size_t AlignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	struct Registry {
+		std::mutex Mutex;
+		std::array<ComponentInfo, ECS_MAX_COMPONENT_TYPES> Infos{};
+		uint32_t Count = 0;
+	};
+
+	Registry& GetRegistry() {
+		static Registry registry;
+		return registry;
+	}
+}
+
+// ------------ COMPONENT TYPES ------------
+
+uint32_t ComponentRegistry::Register(size_t size, size_t alignment)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	if (registry.Count >= ECS_MAX_COMPONENT_TYPES) {
+		throw std::runtime_error("Too many component types (max " + std::to_string(ECS_MAX_COMPONENT_TYPES) + ")");
+	}
+	if (alignment > CHUNK_ALIGNMENT) {
+		throw std::runtime_error("Component alignment above " + std::to_string(CHUNK_ALIGNMENT) + " bytes");
+	}
+
+	registry.Infos[registry.Count] = ComponentInfo{ size, alignment };
+	return registry.Count++;
+}
+
+const ComponentInfo& ComponentRegistry::GetInfo(uint32_t id)
+{
+	// Entries never change once registered
+	return GetRegistry().Infos[id];
+}
+
+// ------------ ARCHETYPE ------------
+
+Archetype::Archetype(ComponentMask mask) : m_Mask(mask)
+{
+	size_t bytesPerEntity = sizeof(Entity);
+	for (ComponentMask bits = mask; bits != 0; bits &= bits - 1) {
+		const uint32_t id = static_cast<uint32_t>(std::countr_zero(bits));
+		m_ComponentIds.push_back(id);
+		m_Sizes[id] = static_cast<uint32_t>(ComponentRegistry::GetInfo(id).Size);
+		bytesPerEntity += m_Sizes[id];
+	}
+
+	// As many entities as fit once every array is padded to a cache line
+	size_t capacity = ECS_CHUNK_SIZE / bytesPerEntity;
+	for (; capacity > 0; capacity--) {
+		size_t offset = AlignUp(sizeof(Entity) * capacity, CHUNK_ALIGNMENT);
+		for (uint32_t id : m_ComponentIds) {
+			m_Offsets[id] = static_cast<uint32_t>(offset);
+			offset = AlignUp(offset + m_Sizes[id] * capacity, CHUNK_ALIGNMENT);
+		}
+		if (offset <= ECS_CHUNK_SIZE) {
+			break;
+		}
+	}
+
+	if (capacity == 0) {
+		throw std::runtime_error("Components too large for a " + std::to_string(ECS_CHUNK_SIZE) + " bytes chunk");
+	}
+	m_Capacity = static_cast<uint32_t>(capacity);
+}
+
+Archetype::~Archetype()
+{
+	for (Chunk& chunk : m_Chunks) {
+		::operator delete(chunk.Data, std::align_val_t(CHUNK_ALIGNMENT));
+	}
+}
+
+void Archetype::AddRow(Entity entity, uint32_t& chunk, uint32_t& row)
+{
+	if (m_Chunks.empty() || m_Chunks.back().Count == m_Capacity) {
+		Chunk newChunk;
+		newChunk.Data = static_cast<std::byte*>(::operator new(ECS_CHUNK_SIZE, std::align_val_t(CHUNK_ALIGNMENT)));
+		m_Chunks.push_back(newChunk);
+	}
+
+	Chunk& last = m_Chunks.back();
+	chunk = static_cast<uint32_t>(m_Chunks.size() - 1);
+	row = last.Count++;
+	reinterpret_cast<Entity*>(last.Data)[row] = entity;
+	m_EntityCount++;
+}
+
+Entity Archetype::RemoveRow(uint32_t chunk, uint32_t row)
+{
+	Chunk& last = m_Chunks.back();
+	const uint32_t lastChunk = static_cast<uint32_t>(m_Chunks.size() - 1);
+	const uint32_t lastRow = last.Count - 1;
+
+	Entity moved;
+	if (chunk != lastChunk || row != lastRow) {
+		for (uint32_t id : m_ComponentIds) {
+			std::memcpy(GetComponent(id, chunk, row), GetComponent(id, lastChunk, lastRow), m_Sizes[id]);
+		}
+		Entity* entities = reinterpret_cast<Entity*>(m_Chunks[chunk].Data);
+		moved = reinterpret_cast<Entity*>(last.Data)[lastRow];
+		entities[row] = moved;
+	}
+
+	last.Count--;
+	m_EntityCount--;
+	if (last.Count == 0) {
+		::operator delete(last.Data, std::align_val_t(CHUNK_ALIGNMENT));
+		m_Chunks.pop_back();
+	}
+
+	return moved;
+}
+
+// ------------ WORLD ------------
+
+Archetype& World::GetArchetype(ComponentMask mask)
+{
+	const auto it = m_ArchetypesByMask.find(mask);
+	if (it != m_ArchetypesByMask.end()) {
+		return *it->second;
+	}
+
+	m_Archetypes.push_back(std::make_unique<Archetype>(mask));
+	Archetype* archetype = m_Archetypes.back().get();
+	m_ArchetypesByMask.emplace(mask, archetype);
+	return *archetype;
+}
+
+Entity World::CreateInArchetype(Archetype& archetype)
+{
+	Entity entity;
+	if (!m_FreeIndices.empty()) {
+		entity.Index = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+	}
+	else {
+		entity.Index = static_cast<uint32_t>(m_Records.size());
+		m_Records.emplace_back();
+	}
+
+	EntityRecord& record = m_Records[entity.Index];
+	entity.Generation = record.Generation;
+	record.Owner = &archetype;
+	archetype.AddRow(entity, record.Chunk, record.Row);
+	m_EntityCount++;
+	m_StructureVersion++;
+
+	return entity;
+}
+
+void World::Destroy(Entity entity)
+{
+	if (!FindRecord(entity)) {
+		return;
+	}
+
+	EntityRecord& record = m_Records[entity.Index];
+	const Entity moved = record.Owner->RemoveRow(record.Chunk, record.Row);
+	if (moved.IsValid()) {
+		m_Records[moved.Index].Chunk = record.Chunk;
+		m_Records[moved.Index].Row = record.Row;
+	}
+
+	record.Owner = nullptr;
+	record.Generation++;
+	m_FreeIndices.push_back(entity.Index);
+	m_EntityCount--;
+	m_StructureVersion++;
+}
+
+bool World::IsAlive(Entity entity) const
+{
+	return FindRecord(entity) != nullptr;
+}
+
+void World::MoveEntity(Entity entity, Archetype& target)
+{
+	EntityRecord& record = m_Records[entity.Index];
+	Archetype& source = *record.Owner;
+
+	uint32_t chunk = 0;
+	uint32_t row = 0;
+	target.AddRow(entity, chunk, row);
+	for (uint32_t id : source.m_ComponentIds) {
+		if (target.Has(id)) {
+			std::memcpy(target.GetComponent(id, chunk, row), source.GetComponent(id, record.Chunk, record.Row), source.m_Sizes[id]);
+		}
+	}
+
+	const Entity moved = source.RemoveRow(record.Chunk, record.Row);
+	if (moved.IsValid()) {
+		m_Records[moved.Index].Chunk = record.Chunk;
+		m_Records[moved.Index].Row = record.Row;
+	}
+
+	record.Owner = &target;
+	record.Chunk = chunk;
+	record.Row = row;
+	m_StructureVersion++;
+}
+
+const World::EntityRecord* World::FindRecord(Entity entity) const
+{
+	if (entity.Index >= m_Records.size()) {
+		return nullptr;
+	}
+
+	const EntityRecord& record = m_Records[entity.Index];
+	return record.Owner && record.Generation == entity.Generation ? &record : nullptr;
+}
+
+// ------------ SYSTEMS ------------
+
+void SystemScheduler::Add(const char* name, ComponentMask reads, ComponentMask writes, SystemFunction function)
+{
+	System system;
+	system.Name = name;
+	system.Reads = reads;
+	system.Writes = writes;
+	system.Function = std::move(function);
+
+	for (const System& other : m_Systems) {
+		const bool conflict = (writes & (other.Reads | other.Writes)) != 0 || (reads & other.Writes) != 0;
+		if (conflict) {
+			system.Stage = std::max(system.Stage, other.Stage + 1);
+		}
+	}
+
+	m_StageCount = std::max(m_StageCount, system.Stage + 1);
+	m_Systems.push_back(std::move(system));
+}
+
+void SystemScheduler::Clear()
+{
+	m_Systems.clear();
+	m_StageCount = 0;
+}
+
+void SystemScheduler::Run(World& world, JobSystem& jobSystem)
+{
+	for (uint32_t stage = 0; stage < m_StageCount; stage++) {
+		const System* inlineSystem = nullptr;
+		JobCounter counter;
+
+		for (const System& system : m_Systems) {
+			if (system.Stage != stage) {
+				continue;
+			}
+
+			// The calling thread takes the first system of the stage, the others go to the workers
+			if (!inlineSystem) {
+				inlineSystem = &system;
+				continue;
+			}
+
+			const System* job = &system;
+			jobSystem.Run([job, &world, &jobSystem]() {
+				ONION_PROFILE_SCOPE(job->Name);
+				job->Function(world, jobSystem);
+				}, &counter);
+		}
+
+		if (inlineSystem) {
+			ONION_PROFILE_SCOPE(inlineSystem->Name);
+			try {
+				inlineSystem->Function(world, jobSystem);
+			}
+			catch (...) {
+				// The queued systems hold the counter and the world: they finish before unwinding
+				jobSystem.Wait(counter);
+				throw;
+			}
+		}
+		jobSystem.Wait(counter);
+	}
+}
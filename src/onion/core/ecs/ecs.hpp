@@ -0,0 +1,399 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "../job_system/job_system.hpp"
+
+namespace Onion::Core {
+
+	// Archetype based entity component system.
+	// Entities with the same set of components share an archetype, whose components are stored in 16 KB chunks:
+	// one contiguous array per component type, so a query walks plain arrays chunk after chunk.
+	// Components must be trivially copyable, chunks move them around with memcpy.
+
+	constexpr size_t ECS_CHUNK_SIZE = 16 * 1024;
+	constexpr size_t ECS_MAX_COMPONENT_TYPES = 64;
+
+	// One bit per component type
+	using ComponentMask = uint64_t;
+
+	struct Entity {
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+		uint32_t Index = INVALID_INDEX;
+		uint32_t Generation = 0; // Index slots are reused, the generation tells stale handles apart
+
+		bool IsValid() const {
+			return Index != INVALID_INDEX;
+		}
+		bool operator==(const Entity& other) const = default;
+	};
+
+	// ------------ COMPONENT TYPES ------------
+
+	struct ComponentInfo {
+		size_t Size = 0;
+		size_t Alignment = 0;
+	};
+
+	// Component types are numbered on first use, process wide
+	class ComponentRegistry {
+	public:
+		// T and const T share an id
+		template<typename T>
+		static uint32_t GetId() {
+			return GetComponentId<std::remove_cv_t<T>>();
+		}
+
+		template<typename... Ts>
+		static ComponentMask GetMask() {
+			return (ComponentMask{ 0 } | ... | (ComponentMask{ 1 } << GetId<Ts>()));
+		}
+
+		static const ComponentInfo& GetInfo(uint32_t id);
+
+	private:
+		template<typename T>
+		static uint32_t GetComponentId() {
+			static_assert(std::is_trivially_copyable_v<T>, "Components are moved with memcpy");
+			static_assert(std::is_trivially_destructible_v<T>, "Components are never destroyed");
+
+			static const uint32_t id = Register(sizeof(T), alignof(T));
+			return id;
+		}
+
+		// Throws past ECS_MAX_COMPONENT_TYPES
+		static uint32_t Register(size_t size, size_t alignment);
+	};
+
+	// ------------ ARCHETYPE ------------
+
+	// Entities sharing one set of components. Every chunk is full except the last one.
+	class Archetype {
+	public:
+		explicit Archetype(ComponentMask mask);
+		~Archetype();
+
+		Archetype(const Archetype&) = delete;
+		Archetype& operator=(const Archetype&) = delete;
+
+		ComponentMask GetMask() const {
+			return m_Mask;
+		}
+		bool Has(uint32_t componentId) const {
+			return (m_Mask >> componentId) & 1;
+		}
+
+		// Entities per chunk
+		uint32_t GetChunkCapacity() const {
+			return m_Capacity;
+		}
+		size_t GetChunkCount() const {
+			return m_Chunks.size();
+		}
+		uint32_t GetCount(size_t chunk) const {
+			return m_Chunks[chunk].Count;
+		}
+		size_t GetEntityCount() const {
+			return m_EntityCount;
+		}
+
+		const Entity* GetEntities(size_t chunk) const {
+			return reinterpret_cast<const Entity*>(m_Chunks[chunk].Data);
+		}
+
+		// The archetype must have T
+		template<typename T>
+		T* GetColumn(size_t chunk) const {
+			return reinterpret_cast<T*>(m_Chunks[chunk].Data + m_Offsets[ComponentRegistry::GetId<T>()]);
+		}
+
+		// nullptr when the archetype does not have T
+		template<typename T>
+		T* TryGetColumn(size_t chunk) const {
+			const uint32_t id = ComponentRegistry::GetId<T>();
+			return Has(id) ? reinterpret_cast<T*>(m_Chunks[chunk].Data + m_Offsets[id]) : nullptr;
+		}
+
+		std::byte* GetComponent(uint32_t componentId, size_t chunk, uint32_t row) const {
+			return m_Chunks[chunk].Data + m_Offsets[componentId] + static_cast<size_t>(m_Sizes[componentId]) * row;
+		}
+
+	private:
+		friend class World;
+
+		// Appends an entity with uninitialized components
+		void AddRow(Entity entity, uint32_t& chunk, uint32_t& row);
+		// Fills the hole with the last entity of the archetype. Returns the entity moved, invalid if none was.
+		Entity RemoveRow(uint32_t chunk, uint32_t row);
+
+	private:
+		struct Chunk {
+			std::byte* Data = nullptr; // ECS_CHUNK_SIZE bytes: entities, then one array per component
+			uint32_t Count = 0;
+		};
+
+		ComponentMask m_Mask = 0;
+		uint32_t m_Capacity = 0;
+		std::array<uint32_t, ECS_MAX_COMPONENT_TYPES> m_Offsets{}; // Of each component array in a chunk
+		std::array<uint32_t, ECS_MAX_COMPONENT_TYPES> m_Sizes{};
+		std::vector<uint32_t> m_ComponentIds;
+
+		std::vector<Chunk> m_Chunks;
+		size_t m_EntityCount = 0;
+	};
+
+	// One chunk seen by a query
+	struct ChunkView {
+		const Archetype* Owner = nullptr;
+		size_t Index = 0;
+		uint32_t Count = 0;
+
+		const Entity* GetEntities() const {
+			return Owner->GetEntities(Index);
+		}
+		// The query must include T
+		template<typename T>
+		T* Get() const {
+			return Owner->GetColumn<T>(Index);
+		}
+		// nullptr when the chunk does not have T, for optional components
+		template<typename T>
+		T* TryGet() const {
+			return Owner->TryGetColumn<T>(Index);
+		}
+	};
+
+	// ------------ WORLD ------------
+
+	// Entities and their components. Not thread-safe for structural changes (create, destroy, add, remove):
+	// queries may run in parallel as long as nothing changes the structure meanwhile.
+	class World {
+	public:
+		World() = default;
+		~World() = default;
+
+		World(const World&) = delete;
+		World& operator=(const World&) = delete;
+
+		template<typename... Ts>
+		Entity Create(const Ts&... components);
+		void Destroy(Entity entity);
+		bool IsAlive(Entity entity) const;
+
+		// nullptr when the entity is dead or does not have T. Invalidated by structural changes.
+		template<typename T>
+		T* Get(Entity entity);
+		template<typename T>
+		bool Has(Entity entity) const;
+
+		// Overwrites T if the entity already has it
+		template<typename T>
+		void Add(Entity entity, const T& component);
+		template<typename T>
+		void Remove(Entity entity);
+
+		size_t GetEntityCount() const {
+			return m_EntityCount;
+		}
+		size_t GetArchetypeCount() const {
+			return m_Archetypes.size();
+		}
+		// Incremented by every Create, Destroy, Add and Remove: caches built from queries compare it
+		// to tell a changed set of entities from one of the same size
+		uint64_t GetStructureVersion() const {
+			return m_StructureVersion;
+		}
+
+		// ------------ QUERIES ------------
+
+		// Calls function(const ChunkView&) for every chunk having all of Ts
+		template<typename... Ts, typename F>
+		void EachChunk(F&& function);
+
+		// Calls function(Ts&...) for every entity having all of Ts
+		template<typename... Ts, typename F>
+		void Each(F&& function);
+
+		// EachChunk with the chunks of each archetype split across the job system.
+		// function is called concurrently, on different chunks.
+		template<typename... Ts, typename F>
+		void ParallelEachChunk(JobSystem& jobSystem, F&& function);
+
+		template<typename... Ts, typename F>
+		void ParallelEach(JobSystem& jobSystem, F&& function);
+
+	private:
+		struct EntityRecord {
+			Archetype* Owner = nullptr;
+			uint32_t Chunk = 0;
+			uint32_t Row = 0;
+			uint32_t Generation = 0;
+		};
+
+		Archetype& GetArchetype(ComponentMask mask);
+		Entity CreateInArchetype(Archetype& archetype);
+		// Moves the entity and the components both archetypes have, the others are left uninitialized
+		void MoveEntity(Entity entity, Archetype& target);
+		const EntityRecord* FindRecord(Entity entity) const;
+
+	private:
+		std::vector<EntityRecord> m_Records;
+		std::vector<uint32_t> m_FreeIndices;
+		std::vector<std::unique_ptr<Archetype>> m_Archetypes;
+		std::unordered_map<ComponentMask, Archetype*> m_ArchetypesByMask;
+		size_t m_EntityCount = 0;
+		uint64_t m_StructureVersion = 0;
+	};
+
+	// ------------ SYSTEMS ------------
+
+	// Runs systems on the job system. Each system declares the components it reads and writes.
+	// A system goes in the stage after the last earlier system it conflicts with (one writes what the other uses),
+	// so conflicting systems keep their registration order and the others run at the same time.
+	// Systems may run queries, in parallel too, but must not change the structure of the world.
+	class SystemScheduler {
+	public:
+		using SystemFunction = std::function<void(World&, JobSystem&)>;
+
+		void Add(const char* name, ComponentMask reads, ComponentMask writes, SystemFunction function);
+		void Clear();
+
+		// One stage after the other, the systems of a stage concurrently
+		void Run(World& world, JobSystem& jobSystem);
+
+		size_t GetSystemCount() const {
+			return m_Systems.size();
+		}
+		uint32_t GetStageCount() const {
+			return m_StageCount;
+		}
+
+	private:
+		struct System {
+			const char* Name = nullptr;
+			ComponentMask Reads = 0;
+			ComponentMask Writes = 0;
+			SystemFunction Function;
+			uint32_t Stage = 0;
+		};
+
+		std::vector<System> m_Systems;
+		uint32_t m_StageCount = 0;
+	};
+
+	// ------------ TEMPLATES IMPLEMENTATION ------------
+
+	template<typename... Ts>
+	Entity World::Create(const Ts&... components) {
+		Archetype& archetype = GetArchetype(ComponentRegistry::GetMask<Ts...>());
+		const Entity entity = CreateInArchetype(archetype);
+
+		const EntityRecord& record = m_Records[entity.Index];
+		(new (archetype.GetComponent(ComponentRegistry::GetId<Ts>(), record.Chunk, record.Row)) Ts(components), ...);
+		return entity;
+	}
+
+	template<typename T>
+	T* World::Get(Entity entity) {
+		const EntityRecord* record = FindRecord(entity);
+		const uint32_t id = ComponentRegistry::GetId<T>();
+		if (!record || !record->Owner->Has(id)) {
+			return nullptr;
+		}
+		return reinterpret_cast<T*>(record->Owner->GetComponent(id, record->Chunk, record->Row));
+	}
+
+	template<typename T>
+	bool World::Has(Entity entity) const {
+		const EntityRecord* record = FindRecord(entity);
+		return record && record->Owner->Has(ComponentRegistry::GetId<T>());
+	}
+
+	template<typename T>
+	void World::Add(Entity entity, const T& component) {
+		const EntityRecord* record = FindRecord(entity);
+		if (!record) {
+			return;
+		}
+
+		const uint32_t id = ComponentRegistry::GetId<T>();
+		if (!record->Owner->Has(id)) {
+			MoveEntity(entity, GetArchetype(record->Owner->GetMask() | (ComponentMask{ 1 } << id)));
+		}
+		new (record->Owner->GetComponent(id, record->Chunk, record->Row)) T(component);
+		// Also when overwritten: a different MeshRef changes what is drawn as much as a new one
+		m_StructureVersion++;
+	}
+
+	template<typename T>
+	void World::Remove(Entity entity) {
+		const EntityRecord* record = FindRecord(entity);
+		const uint32_t id = ComponentRegistry::GetId<T>();
+		if (!record || !record->Owner->Has(id)) {
+			return;
+		}
+		MoveEntity(entity, GetArchetype(record->Owner->GetMask() & ~(ComponentMask{ 1 } << id)));
+	}
+
+	template<typename... Ts, typename F>
+	void World::EachChunk(F&& function) {
+		const ComponentMask required = ComponentRegistry::GetMask<Ts...>();
+		for (const std::unique_ptr<Archetype>& archetype : m_Archetypes) {
+			if ((archetype->GetMask() & required) != required) {
+				continue;
+			}
+			for (size_t chunk = 0; chunk < archetype->GetChunkCount(); chunk++) {
+				function(ChunkView{ archetype.get(), chunk, archetype->GetCount(chunk) });
+			}
+		}
+	}
+
+	template<typename... Ts, typename F>
+	void World::Each(F&& function) {
+		EachChunk<Ts...>([&function](const ChunkView& chunk) {
+			const std::tuple<Ts*...> columns{ chunk.Get<Ts>()... };
+			for (uint32_t i = 0; i < chunk.Count; i++) {
+				function(std::get<Ts*>(columns)[i]...);
+			}
+			});
+	}
+
+	template<typename... Ts, typename F>
+	void World::ParallelEachChunk(JobSystem& jobSystem, F&& function) {
+		const ComponentMask required = ComponentRegistry::GetMask<Ts...>();
+		for (const std::unique_ptr<Archetype>& archetype : m_Archetypes) {
+			if ((archetype->GetMask() & required) != required) {
+				continue;
+			}
+
+			const Archetype* owner = archetype.get();
+			jobSystem.ParallelFor(0, owner->GetChunkCount(), [owner, &function](size_t begin, size_t end) {
+				for (size_t chunk = begin; chunk < end; chunk++) {
+					function(ChunkView{ owner, chunk, owner->GetCount(chunk) });
+				}
+				});
+		}
+	}
+
+	template<typename... Ts, typename F>
+	void World::ParallelEach(JobSystem& jobSystem, F&& function) {
+		ParallelEachChunk<Ts...>(jobSystem, [&function](const ChunkView& chunk) {
+			const std::tuple<Ts*...> columns{ chunk.Get<Ts>()... };
+			for (uint32_t i = 0; i < chunk.Count; i++) {
+				function(std::get<Ts*>(columns)[i]...);
+			}
+			});
+	}
+
+} // namespace Onion::Core
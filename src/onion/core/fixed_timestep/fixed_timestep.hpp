@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Onion::Core {
+
+	// Accumulator driving a fixed rate simulation from a variable rate loop.
+	// Each frame, Advance() returns how many ticks to run; GetAlpha() is how far the
+	// loop is between the last two ticks, used to interpolate what gets rendered.
+	class FixedTimestep {
+	public:
+		struct Settings {
+			double TickRate = 60.0;			 // Ticks per second
+			int MaxTicksPerFrame = 5;		 // Spiral-of-death protection: simulation time beyond that is dropped
+			double MaxFrameTime = 0.25;		 // Longer frames (debugger, window drag) are clamped first
+		};
+
+		FixedTimestep() = default;
+		explicit FixedTimestep(const Settings& settings) { SetSettings(settings); }
+
+		void SetSettings(const Settings& settings) {
+			m_Settings = settings;
+			m_Settings.TickRate = std::max(m_Settings.TickRate, 1.0);
+			m_Settings.MaxTicksPerFrame = std::max(m_Settings.MaxTicksPerFrame, 1);
+			m_TickDuration = 1.0 / m_Settings.TickRate;
+			m_Accumulator = std::min(m_Accumulator, m_TickDuration);
+		}
+
+		const Settings& GetSettings() const {
+			return m_Settings;
+		}
+
+		// Adds the elapsed frame time, returns the number of ticks to run this frame
+		int Advance(double frameTime) {
+			frameTime = std::clamp(frameTime, 0.0, m_Settings.MaxFrameTime);
+			m_Accumulator += frameTime;
+
+			int ticks = static_cast<int>(m_Accumulator / m_TickDuration);
+			if (ticks > m_Settings.MaxTicksPerFrame) {
+				// The simulation cannot keep up: run slower than real time instead of falling further behind
+				const double dropped = (ticks - m_Settings.MaxTicksPerFrame) * m_TickDuration;
+				m_DroppedTime += dropped;
+				m_Accumulator -= dropped;
+				ticks = m_Settings.MaxTicksPerFrame;
+			}
+
+			m_Accumulator -= ticks * m_TickDuration;
+			m_TotalTicks += static_cast<uint64_t>(ticks);
+			return ticks;
+		}
+
+		// Interpolation factor between the previous and the current tick, in [0, 1)
+		float GetAlpha() const {
+			return static_cast<float>(std::clamp(m_Accumulator / m_TickDuration, 0.0, 1.0));
+		}
+
+		double GetTickDuration() const {
+			return m_TickDuration;
+		}
+
+		uint64_t GetTotalTicks() const {
+			return m_TotalTicks;
+		}
+
+		// Simulation time skipped by the spiral-of-death protection, in seconds
+		double GetDroppedTime() const {
+			return m_DroppedTime;
+		}
+
+	private:
+		Settings m_Settings;
+		double m_TickDuration = 1.0 / 60.0;
+		double m_Accumulator = 0.0;
+		double m_DroppedTime = 0.0;
+		uint64_t m_TotalTicks = 0;
+	};
+
+} // namespace Onion::Core
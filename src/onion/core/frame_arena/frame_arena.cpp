@@ -0,0 +1,99 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+
+using namespace Onion::Core;
+
+namespace {
+	// Block alignment, enough for any type including SIMD ones
+	constexpr size_t BLOCK_ALIGNMENT = 64;
+
+	size_t AlignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	std::byte* AllocateBlock(size_t size, size_t alignment = BLOCK_ALIGNMENT) {
+		return static_cast<std::byte*>(::operator new(size, std::align_val_t(alignment)));
+	}
+
+	void FreeBlock(void* block, size_t alignment = BLOCK_ALIGNMENT) {
+		::operator delete(block, std::align_val_t(alignment));
+	}
+}
+
+LinearArena::LinearArena(size_t capacity)
+	: m_Capacity(AlignUp(std::max<size_t>(capacity, BLOCK_ALIGNMENT), BLOCK_ALIGNMENT))
+{
+	m_Block = AllocateBlock(m_Capacity);
+}
+
+LinearArena::~LinearArena()
+{
+	Reset();
+	FreeBlock(m_Block);
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+		throw std::invalid_argument("LinearArena::Allocate: the alignment must be a power of two");
+	}
+
+	// Aligned by address: the block itself is only BLOCK_ALIGNMENT aligned
+	const uintptr_t base = reinterpret_cast<uintptr_t>(m_Block);
+	const size_t offset = static_cast<size_t>(AlignUp(base + m_Offset, alignment) - base);
+	if (offset + size <= m_Capacity) {
+		m_Offset = offset + size;
+		return m_Block + offset;
+	}
+
+	// Full: a dedicated heap block, with the list link in front of the data
+	const size_t blockAlignment = std::max(alignment, BLOCK_ALIGNMENT);
+	const size_t header = AlignUp(sizeof(OverflowBlock), blockAlignment);
+	std::byte* block = AllocateBlock(header + size, blockAlignment);
+	OverflowBlock* overflow = reinterpret_cast<OverflowBlock*>(block);
+	overflow->Next = m_Overflow;
+	overflow->Alignment = blockAlignment;
+	m_Overflow = overflow;
+	m_OverflowBytes += size;
+	m_OverflowCount++;
+	return block + header;
+}
+
+void LinearArena::Reset()
+{
+	const size_t peak = m_Offset + m_OverflowBytes;
+
+	while (m_Overflow) {
+		OverflowBlock* next = m_Overflow->Next;
+		FreeBlock(m_Overflow, m_Overflow->Alignment);
+		m_Overflow = next;
+	}
+
+	// Grow to what the last use needed (with slack for alignment), the next one fits in the block
+	if (m_OverflowCount > 0) {
+		FreeBlock(m_Block);
+		m_Capacity = AlignUp(peak + peak / 2, BLOCK_ALIGNMENT);
+		m_Block = AllocateBlock(m_Capacity);
+	}
+
+	m_Offset = 0;
+	m_OverflowBytes = 0;
+	m_OverflowCount = 0;
+}
+
+FrameArena::FrameArena(size_t capacityPerFrame)
+{
+	for (auto& arena : m_Arenas) {
+		arena = std::make_unique<LinearArena>(capacityPerFrame);
+	}
+}
+
+void FrameArena::BeginFrame()
+{
+	m_Current = (m_Current + 1) % FRAME_COUNT;
+	m_Arenas[m_Current]->Reset();
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Onion::Core {
+
+	// Bump allocator: allocating moves a pointer, nothing is freed individually, Reset releases
+	// everything at once. When the block is full, overflow blocks come from the heap; on the next
+	// Reset the block grows to the peak usage, so a steady workload stops allocating after a few frames.
+	// Single thread.
+	class LinearArena {
+	public:
+		explicit LinearArena(size_t capacity = 64 * 1024);
+		~LinearArena();
+
+		LinearArena(const LinearArena&) = delete;
+		LinearArena& operator=(const LinearArena&) = delete;
+
+		// Any power of two alignment: above the block alignment (64) the pointer is aligned by address
+		void* Allocate(size_t size, size_t alignment);
+		void Reset();
+
+		size_t GetUsed() const {
+			return m_Offset + m_OverflowBytes;
+		}
+		size_t GetCapacity() const {
+			return m_Capacity;
+		}
+		// Heap blocks allocated since the last Reset
+		uint32_t GetOverflowCount() const {
+			return m_OverflowCount;
+		}
+
+	private:
+		struct OverflowBlock {
+			OverflowBlock* Next;
+			size_t Alignment;	// Of the heap block, needed to free it
+		};
+
+		std::byte* m_Block = nullptr;
+		size_t m_Capacity = 0;
+		size_t m_Offset = 0;
+
+		OverflowBlock* m_Overflow = nullptr;
+		size_t m_OverflowBytes = 0;
+		uint32_t m_OverflowCount = 0;
+	};
+
+	// One arena per frame in flight. Memory handed out during a frame stays valid until the arena
+	// comes around again, FRAME_COUNT - 1 frames later.
+	class FrameArena {
+	public:
+		static constexpr size_t FRAME_COUNT = 2;
+
+		explicit FrameArena(size_t capacityPerFrame = 64 * 1024);
+
+		// Switches to the next arena and releases everything it held, O(1) (unless it overflowed)
+		void BeginFrame();
+
+		LinearArena& Get() {
+			return *m_Arenas[m_Current];
+		}
+		const LinearArena& Get() const {
+			return *m_Arenas[m_Current];
+		}
+
+	private:
+		std::unique_ptr<LinearArena> m_Arenas[FRAME_COUNT];
+		size_t m_Current = 0;
+	};
+
+	// STL allocator on top of a LinearArena. deallocate does nothing: containers release their
+	// memory when the arena is reset, they must not be used after that.
+	template<typename T>
+	class ArenaAllocator {
+	public:
+		using value_type = T;
+
+		explicit ArenaAllocator(LinearArena& arena) noexcept
+			: m_Arena(&arena) {
+		}
+
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+			: m_Arena(other.GetArena()) {
+		}
+
+		T* allocate(size_t count) {
+			return static_cast<T*>(m_Arena->Allocate(count * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T*, size_t) noexcept {
+		}
+
+		LinearArena* GetArena() const noexcept {
+			return m_Arena;
+		}
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>& other) const noexcept {
+			return m_Arena == other.GetArena();
+		}
+
+	private:
+		LinearArena* m_Arena;
+	};
+
+	template<typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace Onion::Core
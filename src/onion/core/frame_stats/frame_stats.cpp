@@ -0,0 +1,202 @@
+#include "frame_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace Onion::Core;
+
+namespace {
+	// Nearest-rank percentile of sorted values
+	float PercentileOfSorted(const std::vector<float>& sorted, float percentile) {
+		if (sorted.empty()) {
+			return 0.0f;
+		}
+		const size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0f * static_cast<float>(sorted.size())));
+		return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+	}
+
+	void WritePercentiles(std::ostream& out, const char* name, const FrameStats::Percentiles& p, bool last) {
+		out << "      \"" << name << "\": { \"mean\": " << p.Mean << ", \"p50\": " << p.P50 << ", \"p95\": " << p.P95
+			<< ", \"p99\": " << p.P99 << ", \"max\": " << p.Max << " }" << (last ? "\n" : ",\n");
+	}
+
+	void WriteSummaryJson(std::ostream& out, const char* name, const FrameStats::Summary& summary, bool last) {
+		out << "    \"" << name << "\": {\n";
+		out << "      \"frames\": " << summary.FrameCount << ",\n";
+		out << "      \"hitches\": " << summary.HitchCount << ",\n";
+		out << "      \"duration_s\": " << summary.DurationSeconds << ",\n";
+		WritePercentiles(out, "frame_ms", summary.FrameMs, false);
+		WritePercentiles(out, "cpu_ms", summary.CpuMs, false);
+		WritePercentiles(out, "gpu_ms", summary.GpuMs, true);
+		out << "    }" << (last ? "\n" : ",\n");
+	}
+}
+
+FrameStats::FrameStats() : FrameStats(Settings{})
+{
+}
+
+FrameStats::FrameStats(const Settings& settings) : m_Settings(settings)
+{
+	m_SortScratch.reserve(WINDOW_SIZE);
+}
+
+void FrameStats::AddFrame(float frameMs, float cpuMs, float gpuMs)
+{
+	// Hitch against the recent median, once there is enough history for it to mean something
+	if (m_Count >= 30 && frameMs > m_Settings.HitchFactor * m_WindowSummary.FrameMs.P50) {
+		m_SessionHitches++;
+	}
+
+	m_FrameMs[m_Next] = frameMs;
+	m_CpuMs[m_Next] = cpuMs;
+	m_GpuMs[m_Next] = gpuMs;
+	m_Next = (m_Next + 1) % WINDOW_SIZE;
+	m_Count = std::min(m_Count + 1, WINDOW_SIZE);
+
+	m_SessionFrameMs.Add(frameMs);
+	m_SessionCpuMs.Add(cpuMs);
+	m_SessionGpuMs.Add(gpuMs);
+	m_SessionSeconds += frameMs / 1000.0;
+
+	if (++m_FramesSinceRecompute >= m_Settings.RecomputeInterval || m_Count < 30) {
+		RecomputeWindow();
+		m_FramesSinceRecompute = 0;
+	}
+}
+
+void FrameStats::RecomputeWindow()
+{
+	m_WindowSummary.FrameCount = m_Count;
+	m_WindowSummary.FrameMs = ComputeWindow(m_FrameMs);
+	m_WindowSummary.CpuMs = ComputeWindow(m_CpuMs);
+	m_WindowSummary.GpuMs = ComputeWindow(m_GpuMs);
+
+	double duration = 0.0;
+	uint64_t hitches = 0;
+	for (size_t i = 0; i < m_Count; i++) {
+		duration += m_FrameMs[i];
+		hitches += m_FrameMs[i] > m_Settings.HitchFactor * m_WindowSummary.FrameMs.P50 ? 1 : 0;
+	}
+	m_WindowSummary.DurationSeconds = duration / 1000.0;
+	m_WindowSummary.HitchCount = hitches;
+}
+
+FrameStats::Percentiles FrameStats::ComputeWindow(const std::array<float, WINDOW_SIZE>& values)
+{
+	m_SortScratch.assign(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(m_Count));
+	std::sort(m_SortScratch.begin(), m_SortScratch.end());
+
+	Percentiles result;
+	if (m_SortScratch.empty()) {
+		return result;
+	}
+
+	double sum = 0.0;
+	for (const float value : m_SortScratch) {
+		sum += value;
+	}
+	result.Mean = static_cast<float>(sum / static_cast<double>(m_SortScratch.size()));
+	result.P50 = PercentileOfSorted(m_SortScratch, 50.0f);
+	result.P95 = PercentileOfSorted(m_SortScratch, 95.0f);
+	result.P99 = PercentileOfSorted(m_SortScratch, 99.0f);
+	result.Max = m_SortScratch.back();
+	return result;
+}
+
+FrameStats::Summary FrameStats::ComputeSessionSummary() const
+{
+	Summary summary;
+	summary.FrameCount = m_SessionFrameMs.Count;
+	summary.HitchCount = m_SessionHitches;
+	summary.DurationSeconds = m_SessionSeconds;
+	summary.FrameMs = m_SessionFrameMs.Compute();
+	summary.CpuMs = m_SessionCpuMs.Compute();
+	summary.GpuMs = m_SessionGpuMs.Compute();
+	return summary;
+}
+
+const float* FrameStats::GetFrameTimeHistory(int& count, int& offset) const
+{
+	count = static_cast<int>(m_Count);
+	// Once the ring is full, the oldest frame is the next one to be overwritten
+	offset = m_Count == WINDOW_SIZE ? static_cast<int>(m_Next) : 0;
+	return m_FrameMs.data();
+}
+
+bool FrameStats::WriteSummary(const std::string& basePath) const
+{
+	const std::string jsonPath = basePath + ".json";
+	std::ofstream json(jsonPath);
+	if (!json.is_open()) {
+		std::cout << "[FRAME STATS] [ERROR] : Unable to open " << jsonPath << std::endl;
+		return false;
+	}
+
+	json << std::fixed << std::setprecision(3);
+	json << "{\n  \"frame_stats\": {\n";
+	WriteSummaryJson(json, "session", ComputeSessionSummary(), false);
+	WriteSummaryJson(json, "last_frames", m_WindowSummary, true);
+	json << "  }\n}\n";
+
+	const std::string csvPath = basePath + ".csv";
+	std::ofstream csv(csvPath);
+	if (!csv.is_open()) {
+		std::cout << "[FRAME STATS] [ERROR] : Unable to open " << csvPath << std::endl;
+		return false;
+	}
+
+	csv << std::fixed << std::setprecision(3);
+	csv << "frame,frame_ms,cpu_ms,gpu_ms\n";
+	const size_t first = m_Count == WINDOW_SIZE ? m_Next : 0;
+	for (size_t i = 0; i < m_Count; i++) {
+		const size_t index = (first + i) % WINDOW_SIZE;
+		csv << i << ',' << m_FrameMs[index] << ',' << m_CpuMs[index] << ',' << m_GpuMs[index] << '\n';
+	}
+
+	std::cout << "[FRAME STATS] Summary written to " << jsonPath << " and " << csvPath << std::endl;
+	return true;
+}
+
+void FrameStats::Histogram::Add(float ms)
+{
+	const float clamped = std::max(ms, 0.0f);
+	const size_t bucket = std::min(static_cast<size_t>(clamped / HISTOGRAM_BUCKET_MS), HISTOGRAM_BUCKETS - 1);
+	Buckets[bucket]++;
+	Sum += clamped;
+	Max = std::max(Max, clamped);
+	Count++;
+}
+
+FrameStats::Percentiles FrameStats::Histogram::Compute() const
+{
+	Percentiles result;
+	if (Count == 0) {
+		return result;
+	}
+
+	result.Mean = static_cast<float>(Sum / static_cast<double>(Count));
+	result.Max = Max;
+
+	// Nearest rank, reported as the upper edge of the bucket (never optimistic)
+	const std::array<float, 3> percentiles{ 50.0f, 95.0f, 99.0f };
+	std::array<float*, 3> outputs{ &result.P50, &result.P95, &result.P99 };
+
+	size_t next = 0;
+	uint64_t cumulated = 0;
+	for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS && next < percentiles.size(); bucket++) {
+		cumulated += Buckets[bucket];
+		while (next < percentiles.size()) {
+			const uint64_t rank = static_cast<uint64_t>(std::ceil(percentiles[next] / 100.0 * static_cast<double>(Count)));
+			if (cumulated < rank) {
+				break;
+			}
+			*outputs[next] = std::min(static_cast<float>(bucket + 1) * HISTOGRAM_BUCKET_MS, Max);
+			next++;
+		}
+	}
+	return result;
+}
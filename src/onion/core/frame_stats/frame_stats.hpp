@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Onion::Core {
+
+	// Per-frame timings and their distribution.
+	// Keeps the last WINDOW_SIZE frames for graphs and recent percentiles, and a fixed-width histogram
+	// of the whole session for the summary written on exit. Tail latency (p99, max, hitches) is what
+	// shows stutter, an average does not.
+	class FrameStats {
+	public:
+		static constexpr size_t WINDOW_SIZE = 1024;
+
+		static constexpr float HISTOGRAM_BUCKET_MS = 0.05f;
+		static constexpr size_t HISTOGRAM_BUCKETS = 5000; // Up to 250 ms, longer frames land in the last bucket
+
+		struct Percentiles {
+			float Mean = 0.0f;
+			float P50 = 0.0f;
+			float P95 = 0.0f;
+			float P99 = 0.0f;
+			float Max = 0.0f;
+		};
+
+		struct Summary {
+			uint64_t FrameCount = 0;
+			uint64_t HitchCount = 0;
+			double DurationSeconds = 0.0;
+			Percentiles FrameMs;	// Frame to frame time
+			Percentiles CpuMs;		// Render thread work, without the pacing waits
+			Percentiles GpuMs;
+		};
+
+		struct Settings {
+			// A frame is a hitch when it takes more than HitchFactor times the recent median
+			float HitchFactor = 2.0f;
+			// Recent percentiles are recomputed every N frames, sorting the window is not free
+			int RecomputeInterval = 15;
+		};
+
+		FrameStats();
+		explicit FrameStats(const Settings& settings);
+
+		void AddFrame(float frameMs, float cpuMs, float gpuMs);
+
+		// Last WINDOW_SIZE frames
+		const Summary& GetWindowSummary() const {
+			return m_WindowSummary;
+		}
+
+		// Whole session, percentiles have the resolution of a histogram bucket
+		Summary ComputeSessionSummary() const;
+
+		// Oldest to newest, for ImGui::PlotLines
+		const float* GetFrameTimeHistory(int& count, int& offset) const;
+
+		// Writes <basePath>.json (session and window summaries) and <basePath>.csv (frames of the window)
+		bool WriteSummary(const std::string& basePath) const;
+
+	private:
+		struct Histogram {
+			std::vector<uint32_t> Buckets = std::vector<uint32_t>(HISTOGRAM_BUCKETS, 0);
+			double Sum = 0.0;
+			float Max = 0.0f;
+			uint64_t Count = 0;
+
+			void Add(float ms);
+			Percentiles Compute() const;
+		};
+
+		void RecomputeWindow();
+		Percentiles ComputeWindow(const std::array<float, WINDOW_SIZE>& values);
+
+	private:
+		Settings m_Settings;
+
+		std::array<float, WINDOW_SIZE> m_FrameMs{};
+		std::array<float, WINDOW_SIZE> m_CpuMs{};
+		std::array<float, WINDOW_SIZE> m_GpuMs{};
+		size_t m_Next = 0;
+		size_t m_Count = 0;
+		int m_FramesSinceRecompute = 0;
+
+		Summary m_WindowSummary;
+		std::vector<float> m_SortScratch; // Reserved once, recomputing does not allocate
+
+		Histogram m_SessionFrameMs;
+		Histogram m_SessionCpuMs;
+		Histogram m_SessionGpuMs;
+		uint64_t m_SessionHitches = 0;
+		double m_SessionSeconds = 0.0;
+	};
+
+} // namespace Onion::Core
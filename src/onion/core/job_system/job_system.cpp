@@ -0,0 +1,357 @@
+#include "job_system.hpp"
+
+#include "../profiler/profiler.hpp"
+
+#include <string>
+
+using namespace Onion::Core;
+
+namespace {
+	// Identifies the worker running on the current thread
+	thread_local const JobSystem* t_JobSystem = nullptr;
+	thread_local int t_WorkerIndex = -1;
+
+	uint32_t NextRandom(uint32_t& state) {
+		// xorshift32, only used to pick steal victims
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+}
+
+JobSystem::JobSystem(int workerCount)
+{
+	const unsigned int count = workerCount < 0 ? GetDefaultWorkerCount() : static_cast<unsigned int>(workerCount);
+
+	m_Workers.reserve(count);
+	for (unsigned int i = 0; i < count; i++) {
+		auto worker = std::make_unique<Worker>();
+		worker->RandomState = 0x9E3779B9u * (i + 1);
+		m_Workers.push_back(std::move(worker));
+	}
+
+	// Threads are started once every deque exists, so they can steal from each other right away
+	for (unsigned int i = 0; i < count; i++) {
+		m_Workers[i]->Thread = std::jthread([this, i](std::stop_token st) {
+			WorkerThreadFunction(st, static_cast<int>(i));
+			});
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	for (auto& worker : m_Workers) {
+		worker->Thread.request_stop();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_MutexWake);
+	}
+	m_WakeCondition.notify_all();
+
+	for (auto& worker : m_Workers) {
+		if (worker->Thread.joinable()) {
+			worker->Thread.join();
+		}
+	}
+
+	// Run whatever is left, jobs may own resources (heap callables, continuations)
+	while (Job* job = FindJob()) {
+		Execute(job);
+	}
+}
+
+unsigned int JobSystem::GetDefaultWorkerCount()
+{
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+int JobSystem::GetCurrentWorkerIndex() const
+{
+	return t_JobSystem == this ? t_WorkerIndex : -1;
+}
+
+Job* JobSystem::AllocateFromPool(JobPool& pool)
+{
+	// Ring allocation. Slots are handed out in order, so when a few consecutive ones are
+	// still in flight the ring is most likely saturated: do not scan it all.
+	constexpr size_t MAX_PROBES = 8;
+	for (size_t attempt = 0; attempt < MAX_PROBES; attempt++) {
+		Job& job = pool.Jobs[pool.Next++ & (POOL_SIZE - 1)];
+		if (job.Free.load(std::memory_order_acquire)) {
+			job.Free.store(false, std::memory_order_relaxed);
+			job.HeapAllocated = false;
+			return &job;
+		}
+	}
+
+	// Too many jobs in flight, fall back to the heap
+	Job* job = new Job();
+	job->Free.store(false, std::memory_order_relaxed);
+	job->HeapAllocated = true;
+	return job;
+}
+
+Job* JobSystem::AllocateJob()
+{
+	const int index = GetCurrentWorkerIndex();
+	if (index >= 0) {
+		return AllocateFromPool(m_Workers[static_cast<size_t>(index)]->Pool);
+	}
+
+	std::lock_guard<std::mutex> lock(m_MutexExternal);
+	return AllocateFromPool(m_ExternalPool);
+}
+
+void JobSystem::Submit(Job* job)
+{
+	const int index = GetCurrentWorkerIndex();
+
+	if (index >= 0) {
+		m_QueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+		if (!m_Workers[static_cast<size_t>(index)]->Queue.Push(job)) {
+			// Deque full: run it right away rather than growing
+			m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			Execute(job);
+			return;
+		}
+	}
+	else {
+		// Without workers, the job runs when somebody Waits
+		std::lock_guard<std::mutex> lock(m_MutexExternal);
+		m_ExternalQueue.push_back(job);
+		m_ExternalCount.fetch_add(1, std::memory_order_relaxed);
+		m_QueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+	}
+
+	WakeWorker();
+}
+
+void JobSystem::WakeWorker()
+{
+	if (m_SleepingWorkers.load(std::memory_order_seq_cst) == 0) {
+		// Every worker is busy (or there is none): a blocked Wait can run the job instead
+		WakeWaiters();
+		return;
+	}
+
+	{
+		// Synchronizes with the predicate check of the sleeping worker, no lost wake-up
+		std::lock_guard<std::mutex> lock(m_MutexWake);
+	}
+	m_WakeCondition.notify_one();
+}
+
+void JobSystem::WakeWaiters()
+{
+	if (m_SleepingWaiters.load(std::memory_order_seq_cst) == 0) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_MutexWake);
+	}
+	m_WaitCondition.notify_all();
+}
+
+Job* JobSystem::FindJob()
+{
+	const int index = GetCurrentWorkerIndex();
+
+	// 1. Own deque, most recent job first
+	if (index >= 0) {
+		if (Job* job = m_Workers[static_cast<size_t>(index)]->Queue.Pop()) {
+			m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	// 2. Jobs submitted by external threads
+	if (m_ExternalCount.load(std::memory_order_relaxed) > 0) {
+		std::lock_guard<std::mutex> lock(m_MutexExternal);
+		if (!m_ExternalQueue.empty()) {
+			Job* job = m_ExternalQueue.front();
+			m_ExternalQueue.pop_front();
+			m_ExternalCount.fetch_sub(1, std::memory_order_relaxed);
+			m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	// 3. Steal from a random victim
+	const size_t workerCount = m_Workers.size();
+	if (workerCount == 0) {
+		return nullptr;
+	}
+
+	thread_local uint32_t externalRandomState = 0x12345678u;
+	uint32_t& randomState = index >= 0 ? m_Workers[static_cast<size_t>(index)]->RandomState : externalRandomState;
+	const size_t start = NextRandom(randomState) % workerCount;
+
+	for (size_t i = 0; i < workerCount; i++) {
+		const size_t victim = (start + i) % workerCount;
+		if (static_cast<int>(victim) == index) {
+			continue;
+		}
+
+		if (Job* job = m_Workers[victim]->Queue.Steal()) {
+			m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	JobCounter* counter = job->Counter;
+
+	{
+		ONION_PROFILE_SCOPE("Job");
+		job->Invoke(*job);
+	}
+
+	// The slot can be reused as soon as the callable is gone
+	if (job->HeapAllocated) {
+		delete job;
+	}
+	else {
+		job->Free.store(true, std::memory_order_release);
+	}
+
+	if (counter) {
+		Complete(*counter);
+	}
+}
+
+void JobSystem::Complete(JobCounter& counter)
+{
+	counter.m_Completing.fetch_add(1, std::memory_order_seq_cst);
+
+	const bool last = counter.m_Pending.fetch_sub(1, std::memory_order_seq_cst) == 1;
+	if (last) {
+		std::vector<Job*> continuations;
+		{
+			std::lock_guard<std::mutex> lock(counter.m_MutexContinuations);
+			continuations.swap(counter.m_Continuations);
+		}
+
+		for (Job* continuation : continuations) {
+			Submit(continuation);
+		}
+	}
+
+	// Last access to the counter, a waiter may destroy it right after
+	counter.m_Completing.fetch_sub(1, std::memory_order_release);
+
+	if (last) {
+		WakeWaiters();
+	}
+}
+
+void JobSystem::BeginExternal(JobCounter& counter, int count)
+{
+	counter.m_Pending.fetch_add(count, std::memory_order_relaxed);
+}
+
+void JobSystem::EndExternal(JobCounter& counter)
+{
+	Complete(counter);
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	int idleSpins = 0;
+
+	while (!counter.IsDone()) {
+		if (Job* job = FindJob()) {
+			Execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		// Remaining jobs are running on other threads, or outside the job system (I/O, ...)
+		if (++idleSpins <= 64) {
+			continue;
+		}
+		if (idleSpins <= 128) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Nothing left to help with: sleep until a counter reaches zero or a job is queued.
+		// Only the thread taking the counter to zero notifies, so wake on m_Pending alone: the
+		// other completions still finishing (IsDone) are short and covered by the spin above.
+		std::unique_lock<std::mutex> lock(m_MutexWake);
+		m_SleepingWaiters.fetch_add(1, std::memory_order_seq_cst);
+		m_WaitCondition.wait(lock, [&]() {
+			return counter.m_Pending.load(std::memory_order_seq_cst) == 0 || m_QueuedJobs.load(std::memory_order_seq_cst) > 0;
+			});
+		m_SleepingWaiters.fetch_sub(1, std::memory_order_seq_cst);
+		idleSpins = 0;
+	}
+}
+
+bool JobSystem::RunPendingJob()
+{
+	Job* job = FindJob();
+	if (!job) {
+		return false;
+	}
+	Execute(job);
+	return true;
+}
+
+bool JobSystem::ShouldSplit() const
+{
+	if (m_Workers.empty()) {
+		return false;
+	}
+
+	// Only give work away when our own queue is empty, and when there are fewer
+	// unclaimed jobs than workers: somebody is probably looking for work.
+	const int index = GetCurrentWorkerIndex();
+	if (index >= 0 && !m_Workers[static_cast<size_t>(index)]->Queue.IsEmpty()) {
+		return false;
+	}
+
+	return m_QueuedJobs.load(std::memory_order_relaxed) < static_cast<int>(m_Workers.size());
+}
+
+void JobSystem::WorkerThreadFunction(std::stop_token stopToken, int index)
+{
+	t_JobSystem = this;
+	t_WorkerIndex = index;
+
+	ONION_PROFILE_THREAD("Worker " + std::to_string(index));
+
+	while (!stopToken.stop_requested()) {
+		if (Job* job = FindJob()) {
+			Execute(job);
+			continue;
+		}
+
+		// Spin a little before sleeping, jobs often come in bursts
+		bool workAvailable = false;
+		for (int spin = 0; spin < 64 && !workAvailable; spin++) {
+			std::this_thread::yield();
+			workAvailable = m_QueuedJobs.load(std::memory_order_relaxed) > 0;
+		}
+		if (workAvailable) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_MutexWake);
+		m_SleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+		m_WakeCondition.wait(lock, [&]() {
+			return stopToken.stop_requested() || m_QueuedJobs.load(std::memory_order_seq_cst) > 0;
+			});
+		m_SleepingWorkers.fetch_sub(1, std::memory_order_seq_cst);
+	}
+
+	t_JobSystem = nullptr;
+	t_WorkerIndex = -1;
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "work_stealing_deque.hpp"
+
+namespace Onion::Core {
+
+	class JobCounter;
+
+	// Unit of work, one cache line. Small callables are stored inline, larger ones on the heap.
+	struct alignas(64) Job {
+		static constexpr size_t STORAGE_SIZE = 32;
+
+		void (*Invoke)(Job& job) = nullptr; // Runs then destroys the stored callable
+		JobCounter* Counter = nullptr;
+		std::atomic<bool> Free{ true };
+		bool HeapAllocated = false;
+		alignas(16) unsigned char Storage[STORAGE_SIZE];
+	};
+	static_assert(sizeof(Job) == 64, "Job must fit in a cache line");
+
+	// Counts the jobs that still have to run. Jobs can be chained after a counter with JobSystem::RunAfter.
+	// A counter must not be destroyed before JobSystem::Wait returned (or IsDone is true) for it.
+	class JobCounter {
+	public:
+		JobCounter() = default;
+		~JobCounter() = default;
+
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool IsDone() const {
+			return m_Pending.load(std::memory_order_seq_cst) == 0 && m_Completing.load(std::memory_order_seq_cst) == 0;
+		}
+
+		int GetPending() const {
+			return m_Pending.load(std::memory_order_relaxed);
+		}
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int> m_Pending{ 0 };
+		// Threads still touching the counter after their decrement (continuations), IsDone waits for them
+		std::atomic<int> m_Completing{ 0 };
+
+		std::mutex m_MutexContinuations;
+		std::vector<Job*> m_Continuations;
+	};
+
+	// Work-stealing job system: one worker thread per core, each with its own lock-free deque.
+	// Threads that are not workers (main, render, ...) submit through a shared queue and help while they Wait.
+	class JobSystem {
+	public:
+		// workerCount < 0 picks one worker per hardware thread, minus the calling thread.
+		// workerCount == 0 is valid: every job then runs on the thread calling Wait.
+		explicit JobSystem(int workerCount = -1);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// Schedules a job. If a counter is given, it is incremented now and decremented when the job has run.
+		template<typename F>
+		void Run(F&& function, JobCounter* counter = nullptr);
+
+		// Schedules a job once 'dependency' reaches zero. 'dependency' must outlive the wait.
+		template<typename F>
+		void RunAfter(JobCounter& dependency, F&& function, JobCounter* counter = nullptr);
+
+		// Blocks until the counter reaches zero, executing other jobs in the meantime.
+		// Once nothing is left to run, the thread sleeps until a job is queued or a counter completes.
+		void Wait(JobCounter& counter);
+
+		// Work tracked by a counter but done outside the job system (I/O requests, GPU fences, ...).
+		// Each BeginExternal unit must be matched by one EndExternal, which may be called from any thread.
+		void BeginExternal(JobCounter& counter, int count = 1);
+		void EndExternal(JobCounter& counter);
+
+		// Runs one queued job on the calling thread, false when none was found.
+		// For threads that wait on something else than a counter.
+		bool RunPendingJob();
+
+		// Calls function(chunkBegin, chunkEnd) over [begin, end) and waits for completion.
+		// Chunks are split lazily: a range is only halved while other threads are short of work,
+		// so the chunk count adapts to the load instead of being fixed up front.
+		// grainSize is the smallest chunk, 0 picks one from the range size and worker count.
+		template<typename F>
+		void ParallelFor(size_t begin, size_t end, F&& function, size_t grainSize = 0);
+
+		unsigned int GetWorkerCount() const {
+			return static_cast<unsigned int>(m_Workers.size());
+		}
+
+		// True when called from one of this system's worker threads
+		bool IsWorkerThread() const {
+			return GetCurrentWorkerIndex() >= 0;
+		}
+
+		static unsigned int GetDefaultWorkerCount();
+
+	private:
+		static constexpr size_t DEQUE_CAPACITY = 4096;
+		static constexpr size_t POOL_SIZE = 4096;
+
+		struct JobPool {
+			std::unique_ptr<Job[]> Jobs = std::make_unique<Job[]>(POOL_SIZE);
+			uint32_t Next = 0;
+		};
+
+		struct Worker {
+			WorkStealingDeque<Job, DEQUE_CAPACITY> Queue;
+			JobPool Pool;
+			uint32_t RandomState = 0;
+			std::jthread Thread;
+		};
+
+		template<typename F>
+		Job* CreateJob(F&& function, JobCounter* counter);
+		Job* AllocateJob();
+		static Job* AllocateFromPool(JobPool& pool);
+
+		void Submit(Job* job);
+		Job* FindJob();
+		void Execute(Job* job);
+		void Complete(JobCounter& counter);
+		void WakeWorker();
+		void WakeWaiters();
+
+		void WorkerThreadFunction(std::stop_token stopToken, int index);
+		int GetCurrentWorkerIndex() const;
+
+		// ParallelFor
+		template<typename F>
+		struct ParallelForContext {
+			JobSystem* System = nullptr;
+			F* Function = nullptr;
+			size_t Grain = 1;
+			JobCounter Counter;
+		};
+
+		template<typename Context>
+		static void ParallelForRange(Context* context, size_t begin, size_t end);
+		bool ShouldSplit() const;
+
+	private:
+		std::vector<std::unique_ptr<Worker>> m_Workers;
+
+		// Jobs submitted from threads that are not workers
+		std::mutex m_MutexExternal;
+		std::deque<Job*> m_ExternalQueue;
+		std::atomic<int> m_ExternalCount{ 0 };
+		JobPool m_ExternalPool;
+
+		// Jobs pushed but not yet picked up, used to put workers to sleep and to drive splitting
+		std::atomic<int> m_QueuedJobs{ 0 };
+
+		std::mutex m_MutexWake;
+		std::condition_variable m_WakeCondition;
+		std::atomic<int> m_SleepingWorkers{ 0 };
+
+		// Threads blocked in Wait, woken when a counter completes or a job is queued. Separate from
+		// m_WakeCondition so a notify_one meant for a worker never lands on a waiter.
+		std::condition_variable m_WaitCondition;
+		std::atomic<int> m_SleepingWaiters{ 0 };
+	};
+
+	// ------------ TEMPLATES IMPLEMENTATION ------------
+
+	template<typename F>
+	Job* JobSystem::CreateJob(F&& function, JobCounter* counter) {
+		using Function = std::decay_t<F>;
+
+		Job* job = AllocateJob();
+		job->Counter = counter;
+
+		if constexpr (sizeof(Function) <= Job::STORAGE_SIZE && alignof(Function) <= 16) {
+			new (job->Storage) Function(std::forward<F>(function));
+			job->Invoke = [](Job& j) {
+				Function* fn = std::launder(reinterpret_cast<Function*>(j.Storage));
+				(*fn)();
+				fn->~Function();
+				};
+		}
+		else {
+			Function* heapFunction = new Function(std::forward<F>(function));
+			std::memcpy(job->Storage, &heapFunction, sizeof(heapFunction));
+			job->Invoke = [](Job& j) {
+				Function* fn = nullptr;
+				std::memcpy(&fn, j.Storage, sizeof(fn));
+				(*fn)();
+				delete fn;
+				};
+		}
+
+		if (counter) {
+			counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	template<typename F>
+	void JobSystem::Run(F&& function, JobCounter* counter) {
+		Submit(CreateJob(std::forward<F>(function), counter));
+	}
+
+	template<typename F>
+	void JobSystem::RunAfter(JobCounter& dependency, F&& function, JobCounter* counter) {
+		Job* job = CreateJob(std::forward<F>(function), counter);
+
+		{
+			// Checked under the lock: the last job of the dependency takes the same lock after its decrement
+			std::lock_guard<std::mutex> lock(dependency.m_MutexContinuations);
+			if (dependency.m_Pending.load(std::memory_order_seq_cst) != 0) {
+				dependency.m_Continuations.push_back(job);
+				return;
+			}
+		}
+
+		Submit(job);
+	}
+
+	template<typename F>
+	void JobSystem::ParallelFor(size_t begin, size_t end, F&& function, size_t grainSize) {
+		if (begin >= end) {
+			return;
+		}
+
+		const size_t count = end - begin;
+		if (grainSize == 0) {
+			grainSize = std::max<size_t>(1, count / ((static_cast<size_t>(GetWorkerCount()) + 1) * 64));
+		}
+
+		ParallelForContext<std::remove_reference_t<F>> context;
+		context.System = this;
+		context.Function = &function;
+		context.Grain = grainSize;
+
+		// The calling thread takes part, then helps with whatever was split off
+		ParallelForRange(&context, begin, end);
+		Wait(context.Counter);
+	}
+
+	template<typename Context>
+	void JobSystem::ParallelForRange(Context* context, size_t begin, size_t end) {
+		JobSystem& system = *context->System;
+
+		while (begin < end) {
+			if (end - begin > context->Grain && system.ShouldSplit()) {
+				// Hand the upper half to a thief, keep working on the lower half
+				const size_t middle = begin + (end - begin) / 2;
+				system.Run([context, middle, end]() { ParallelForRange(context, middle, end); }, &context->Counter);
+				end = middle;
+				continue;
+			}
+
+			const size_t chunkEnd = std::min(end, begin + context->Grain);
+			(*context->Function)(begin, chunkEnd);
+			begin = chunkEnd;
+		}
+	}
+
+} // namespace Onion::Core
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Onion::Core {
+
+	// Fixed capacity Chase-Lev work-stealing deque.
+	// The owner thread pushes and pops at the bottom, any other thread steals from the top.
+	// Memory orderings follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013).
+	template<typename T, size_t Capacity>
+	class WorkStealingDeque {
+		static_assert((Capacity& (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	public:
+		WorkStealingDeque() = default;
+
+		WorkStealingDeque(const WorkStealingDeque&) = delete;
+		WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+		// Owner only. Returns false when the deque is full.
+		bool Push(T* item) {
+			const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+			const int64_t top = m_Top.load(std::memory_order_acquire);
+			if (bottom - top >= static_cast<int64_t>(Capacity)) {
+				return false;
+			}
+
+			m_Buffer[static_cast<size_t>(bottom) & MASK].store(item, std::memory_order_relaxed);
+			// Publishes the item (and the job it points to) to thieves acquiring m_Bottom
+			m_Bottom.store(bottom + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Owner only. LIFO end, keeps the most recent (cache-hot) work local.
+		T* Pop() {
+			const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+			m_Bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = m_Top.load(std::memory_order_relaxed);
+
+			if (top > bottom) {
+				// Empty
+				m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			T* item = m_Buffer[static_cast<size_t>(bottom) & MASK].load(std::memory_order_relaxed);
+			if (top == bottom) {
+				// Last item, race against thieves
+				if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					item = nullptr;
+				}
+				m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return item;
+		}
+
+		// Any thread. FIFO end, returns nullptr when empty or when the race was lost.
+		T* Steal() {
+			int64_t top = m_Top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+			if (top >= bottom) {
+				return nullptr;
+			}
+
+			T* item = m_Buffer[static_cast<size_t>(top) & MASK].load(std::memory_order_relaxed);
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				return nullptr;
+			}
+			return item;
+		}
+
+		// Approximate, only meant for heuristics
+		size_t Size() const {
+			const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+			const int64_t top = m_Top.load(std::memory_order_relaxed);
+			return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+		}
+
+		bool IsEmpty() const {
+			return Size() == 0;
+		}
+
+	private:
+		static constexpr size_t MASK = Capacity - 1;
+
+		alignas(64) std::atomic<int64_t> m_Top{ 0 };
+		alignas(64) std::atomic<int64_t> m_Bottom{ 0 };
+		alignas(64) std::array<std::atomic<T*>, Capacity> m_Buffer{};
+	};
+
+} // namespace Onion::Core
@@ -0,0 +1,390 @@
+#include "pack_archive.hpp"
+
+#include "../block_compression/block_compression.hpp"
+#include "../profiler/profiler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Onion::Core;
+
+static_assert(std::endian::native == std::endian::little, "The .onionpak table of contents is read in place");
+
+namespace {
+	constexpr size_t TABLE_ALIGNMENT = 16;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// [offset, offset + size) inside a file of 'fileSize' bytes, without overflowing
+	bool IsInFile(uint64_t offset, uint64_t size, uint64_t fileSize) {
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+// ------------ READER ------------
+
+PackArchive::~PackArchive()
+{
+	Close();
+}
+
+void PackArchive::Open(const std::string& path)
+{
+	ONION_PROFILE_SCOPE("PackArchive::Open");
+	Close();
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open archive: " + path);
+	}
+	LARGE_INTEGER size{};
+	GetFileSizeEx(file, &size);
+	HANDLE mapping = size.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view) {
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map archive: " + path);
+	}
+	m_File = file;
+	m_Mapping = mapping;
+	m_Size = static_cast<size_t>(size.QuadPart);
+#else
+	// open, fstat, mmap, close: the only syscalls of the archive, entries are then read through page faults
+	const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0) {
+		throw std::runtime_error("Failed to open archive: " + path);
+	}
+	struct stat info {};
+	void* view = MAP_FAILED;
+	if (::fstat(file, &info) == 0 && info.st_size > 0) {
+		view = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	::close(file);
+	if (view == MAP_FAILED) {
+		throw std::runtime_error("Failed to map archive: " + path);
+	}
+	m_Size = static_cast<size_t>(info.st_size);
+#endif
+
+	m_Data = static_cast<const uint8_t*>(view);
+	m_Path = path;
+
+	try {
+		Validate();
+	}
+	catch (...) {
+		Close();
+		throw;
+	}
+}
+
+void PackArchive::Close()
+{
+	if (!m_Data) {
+		return;
+	}
+
+#if defined(_WIN32)
+	UnmapViewOfFile(m_Data);
+	CloseHandle(static_cast<HANDLE>(m_Mapping));
+	CloseHandle(static_cast<HANDLE>(m_File));
+	m_Mapping = nullptr;
+	m_File = nullptr;
+#else
+	::munmap(const_cast<uint8_t*>(m_Data), m_Size);
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Path.clear();
+}
+
+void PackArchive::Validate() const
+{
+	const auto fail = [this](const std::string& reason) {
+		throw std::runtime_error("Invalid archive " + m_Path + ": " + reason);
+	};
+
+	if (m_Size < sizeof(PackHeader)) {
+		fail("truncated header");
+	}
+	const PackHeader& header = *reinterpret_cast<const PackHeader*>(m_Data);
+	if (std::memcmp(header.Magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) {
+		fail("not an .onionpak");
+	}
+	if (header.Version != PACK_VERSION) {
+		fail("version " + std::to_string(header.Version) + ", expected " + std::to_string(PACK_VERSION));
+	}
+	if (header.FileSize != m_Size) {
+		fail("truncated");
+	}
+	if (!std::has_single_bit(header.BucketCount) || header.BucketCount < header.EntryCount) {
+		fail("bad hash table size");
+	}
+	if (header.EntriesOffset % alignof(PackEntry) != 0 || header.BucketsOffset % alignof(uint32_t) != 0
+		|| !IsInFile(header.EntriesOffset, uint64_t(header.EntryCount) * sizeof(PackEntry), m_Size)
+		|| !IsInFile(header.BucketsOffset, uint64_t(header.BucketCount) * sizeof(uint32_t), m_Size)
+		|| !IsInFile(header.NamesOffset, header.NamesSize, m_Size)) {
+		fail("table of contents out of the file");
+	}
+
+	const uint32_t* buckets = reinterpret_cast<const uint32_t*>(m_Data + header.BucketsOffset);
+	for (uint32_t i = 0; i < header.BucketCount; i++) {
+		if (buckets[i] > header.EntryCount) {
+			fail("bad hash table");
+		}
+	}
+
+	for (uint32_t i = 0; i < header.EntryCount; i++) {
+		const PackEntry& entry = GetEntry(i);
+		if (!IsInFile(entry.Offset, entry.StoredSize, m_Size)
+			|| !IsInFile(entry.NameOffset, entry.NameLength, header.NamesSize)
+			|| (!IsCompressed(entry) && entry.StoredSize != entry.Size)
+			|| (IsCompressed(entry) && entry.Size > BlockCompression::GetMaxDecompressedSize(entry.StoredSize))) {
+			fail("bad entry " + std::to_string(i));
+		}
+	}
+}
+
+const PackEntry* PackArchive::Find(std::string_view path) const
+{
+	if (!m_Data) {
+		return nullptr;
+	}
+
+	const std::string name = NormalizePath(path);
+	const uint64_t hash = HashName(name);
+
+	const PackHeader& header = *reinterpret_cast<const PackHeader*>(m_Data);
+	const uint32_t* buckets = reinterpret_cast<const uint32_t*>(m_Data + header.BucketsOffset);
+	const uint32_t mask = header.BucketCount - 1;
+
+	// Linear probing, the table is at most half full
+	for (uint32_t probe = 0; probe < header.BucketCount; probe++) {
+		const uint32_t slot = buckets[(static_cast<uint32_t>(hash) + probe) & mask];
+		if (slot == 0) {
+			return nullptr;
+		}
+		const PackEntry& entry = GetEntry(slot - 1);
+		if (entry.NameHash == hash && GetName(entry) == name) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+uint32_t PackArchive::GetEntryCount() const
+{
+	return m_Data ? reinterpret_cast<const PackHeader*>(m_Data)->EntryCount : 0;
+}
+
+const PackEntry& PackArchive::GetEntry(uint32_t index) const
+{
+	const PackHeader& header = *reinterpret_cast<const PackHeader*>(m_Data);
+	return reinterpret_cast<const PackEntry*>(m_Data + header.EntriesOffset)[index];
+}
+
+std::string_view PackArchive::GetName(const PackEntry& entry) const
+{
+	const PackHeader& header = *reinterpret_cast<const PackHeader*>(m_Data);
+	return std::string_view(reinterpret_cast<const char*>(m_Data + header.NamesOffset + entry.NameOffset), entry.NameLength);
+}
+
+bool PackArchive::Extract(const PackEntry& entry, std::vector<uint8_t>& contents) const
+{
+	contents.resize(static_cast<size_t>(entry.Size));
+	if (!IsCompressed(entry)) {
+		if (entry.Size > 0) {
+			std::memcpy(contents.data(), GetStoredData(entry), contents.size());
+		}
+		return true;
+	}
+
+	ONION_PROFILE_SCOPE("PackArchive::Decompress");
+	return BlockCompression::Decompress(GetStoredData(entry), static_cast<size_t>(entry.StoredSize), contents.data(), contents.size());
+}
+
+uint64_t PackArchive::HashName(std::string_view name)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const char c : name) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string PackArchive::NormalizePath(std::string_view path)
+{
+	std::vector<std::string_view> segments;
+	size_t begin = 0;
+	while (begin <= path.size()) {
+		size_t end = path.find_first_of("/\\", begin);
+		if (end == std::string_view::npos) {
+			end = path.size();
+		}
+
+		const std::string_view segment = path.substr(begin, end - begin);
+		if (segment == "..") {
+			if (!segments.empty() && segments.back() != "..") {
+				segments.pop_back();
+			}
+			else {
+				segments.push_back(segment);
+			}
+		}
+		else if (!segment.empty() && segment != ".") {
+			segments.push_back(segment);
+		}
+		begin = end + 1;
+	}
+
+	std::string normalized;
+	normalized.reserve(path.size());
+	for (const std::string_view segment : segments) {
+		if (!normalized.empty()) {
+			normalized += '/';
+		}
+		normalized += segment;
+	}
+	return normalized;
+}
+
+// ------------ WRITER ------------
+
+void PackWriter::SetSettings(const Settings& settings)
+{
+	if (!std::has_single_bit(settings.Alignment)) {
+		throw std::runtime_error("Archive alignment must be a power of two");
+	}
+	m_Settings = settings;
+}
+
+void PackWriter::Add(std::string_view name, const uint8_t* data, size_t size)
+{
+	PendingEntry entry;
+	entry.Name = PackArchive::NormalizePath(name);
+	entry.Size = size;
+	if (!m_Names.insert(entry.Name).second) {
+		throw std::runtime_error("Duplicate archive entry: " + entry.Name);
+	}
+
+	if (m_Settings.Compress && size > 0) {
+		entry.Data.resize(BlockCompression::GetMaxCompressedSize(size));
+		const size_t compressedSize = BlockCompression::Compress(data, size, entry.Data.data(), entry.Data.size());
+		if (static_cast<float>(compressedSize) <= static_cast<float>(size) * m_Settings.MaxCompressedRatio) {
+			entry.Data.resize(compressedSize);
+			entry.Compressed = true;
+		}
+	}
+	if (!entry.Compressed) {
+		entry.Data.assign(data, data + size);
+	}
+
+	m_Stats.EntryCount++;
+	m_Stats.CompressedCount += entry.Compressed ? 1 : 0;
+	m_Stats.Bytes += size;
+	m_Stats.StoredBytes += entry.Data.size();
+	m_Entries.push_back(std::move(entry));
+}
+
+void PackWriter::Write(const std::string& path) const
+{
+	const uint32_t entryCount = static_cast<uint32_t>(m_Entries.size());
+	// At most half full, probes stay short
+	const uint32_t bucketCount = std::bit_ceil(std::max(entryCount * 2, 16u));
+
+	PackHeader header{};
+	std::memcpy(header.Magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+	header.Version = PACK_VERSION;
+	header.EntryCount = entryCount;
+	header.BucketCount = bucketCount;
+	header.Alignment = m_Settings.Alignment;
+	header.EntriesOffset = AlignUp(sizeof(PackHeader), TABLE_ALIGNMENT);
+	header.BucketsOffset = AlignUp(header.EntriesOffset + uint64_t(entryCount) * sizeof(PackEntry), TABLE_ALIGNMENT);
+	header.NamesOffset = AlignUp(header.BucketsOffset + uint64_t(bucketCount) * sizeof(uint32_t), TABLE_ALIGNMENT);
+
+	std::vector<PackEntry> entries(entryCount);
+	std::vector<uint32_t> buckets(bucketCount, 0);
+	std::string names;
+
+	for (uint32_t i = 0; i < entryCount; i++) {
+		const PendingEntry& pending = m_Entries[i];
+		PackEntry& entry = entries[i];
+		entry.NameHash = PackArchive::HashName(pending.Name);
+		entry.NameOffset = static_cast<uint32_t>(names.size());
+		entry.NameLength = static_cast<uint32_t>(pending.Name.size());
+		entry.StoredSize = pending.Data.size();
+		entry.Size = pending.Size;
+		entry.Flags = pending.Compressed ? PACK_ENTRY_COMPRESSED : 0;
+		names += pending.Name;
+
+		uint32_t slot = static_cast<uint32_t>(entry.NameHash) & (bucketCount - 1);
+		while (buckets[slot] != 0) {
+			slot = (slot + 1) & (bucketCount - 1);
+		}
+		buckets[slot] = i + 1;
+	}
+	header.NamesSize = names.size();
+
+	uint64_t offset = AlignUp(header.NamesOffset + header.NamesSize, m_Settings.Alignment);
+	for (PackEntry& entry : entries) {
+		entry.Offset = offset;
+		offset = AlignUp(offset + entry.StoredSize, m_Settings.Alignment);
+	}
+	// The last entry is not padded
+	header.FileSize = entries.empty() ? header.NamesOffset + header.NamesSize : entries.back().Offset + entries.back().StoredSize;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Failed to create archive: " + path);
+	}
+
+	uint64_t written = 0;
+	const auto write = [&](const void* data, uint64_t size) {
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		written += size;
+	};
+	const auto padTo = [&](uint64_t position) {
+		static constexpr char zeros[256] = {};
+		while (written < position) {
+			write(zeros, std::min<uint64_t>(sizeof(zeros), position - written));
+		}
+	};
+
+	write(&header, sizeof(header));
+	padTo(header.EntriesOffset);
+	write(entries.data(), uint64_t(entryCount) * sizeof(PackEntry));
+	padTo(header.BucketsOffset);
+	write(buckets.data(), uint64_t(bucketCount) * sizeof(uint32_t));
+	padTo(header.NamesOffset);
+	write(names.data(), names.size());
+	for (uint32_t i = 0; i < entryCount; i++) {
+		padTo(entries[i].Offset);
+		write(m_Entries[i].Data.data(), m_Entries[i].Data.size());
+	}
+
+	if (!file.flush()) {
+		throw std::runtime_error("Failed to write archive: " + path);
+	}
+}
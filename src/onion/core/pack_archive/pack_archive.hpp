@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace Onion::Core {
+
+	// ------------ FILE FORMAT ------------
+
+	// .onionpak layout, little-endian:
+	//   header | entries | hash table | names | data of each entry, aligned to PackHeader::Alignment
+	// The table of contents (everything before the data) is read in place from the mapping.
+	constexpr char PACK_MAGIC[8] = { 'O', 'N', 'I', 'O', 'N', 'P', 'A', 'K' };
+	constexpr uint32_t PACK_VERSION = 1;
+
+	// PackEntry::Flags
+	constexpr uint32_t PACK_ENTRY_COMPRESSED = 1u << 0; // BlockCompression, StoredSize -> Size
+
+	struct PackHeader {
+		char Magic[8];
+		uint32_t Version;
+		uint32_t EntryCount;
+		uint32_t BucketCount;		// Power of two. Each bucket holds an entry index + 1, 0 when empty.
+		uint32_t Alignment;
+		uint64_t EntriesOffset;
+		uint64_t BucketsOffset;
+		uint64_t NamesOffset;
+		uint64_t NamesSize;
+		uint64_t FileSize;
+	};
+	static_assert(sizeof(PackHeader) == 64);
+
+	struct PackEntry {
+		uint64_t NameHash;			// PackArchive::HashName of the normalized path
+		uint64_t Offset;			// From the start of the file
+		uint64_t StoredSize;
+		uint64_t Size;				// Once decompressed
+		uint32_t NameOffset;		// In the names block, not null-terminated
+		uint32_t NameLength;
+		uint32_t Flags;
+		uint32_t Reserved;
+	};
+	static_assert(sizeof(PackEntry) == 48);
+
+	// ------------ READER ------------
+
+	// Read-only view of a .onionpak. The whole file is memory-mapped by Open, so a lookup is a hash
+	// probe into the mapped table of contents, and reading an uncompressed entry is a pointer.
+	// Lookups are thread-safe once opened.
+	class PackArchive {
+	public:
+		PackArchive() = default;
+		~PackArchive();
+
+		PackArchive(const PackArchive&) = delete;
+		PackArchive& operator=(const PackArchive&) = delete;
+
+		// Maps the file and checks its table of contents. Throws std::runtime_error.
+		void Open(const std::string& path);
+		void Close();
+
+		bool IsOpen() const {
+			return m_Data != nullptr;
+		}
+		const std::string& GetPath() const {
+			return m_Path;
+		}
+
+		// nullptr when missing. 'path' is normalized first.
+		const PackEntry* Find(std::string_view path) const;
+
+		uint32_t GetEntryCount() const;
+		const PackEntry& GetEntry(uint32_t index) const;
+		std::string_view GetName(const PackEntry& entry) const;
+
+		// Stored bytes, inside the mapping. Decompressed contents when the entry is not compressed.
+		const uint8_t* GetStoredData(const PackEntry& entry) const {
+			return m_Data + entry.Offset;
+		}
+		static bool IsCompressed(const PackEntry& entry) {
+			return (entry.Flags & PACK_ENTRY_COMPRESSED) != 0;
+		}
+
+		// Decompressed contents, copied. False if the entry is corrupt.
+		bool Extract(const PackEntry& entry, std::vector<uint8_t>& contents) const;
+
+		// FNV-1a, 64 bits
+		static uint64_t HashName(std::string_view name);
+		// Forward slashes, no "." or ".." segments, no leading "./": the key of an entry
+		static std::string NormalizePath(std::string_view path);
+
+	private:
+		void Validate() const;
+
+	private:
+		std::string m_Path;
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+
+#if defined(_WIN32)
+		void* m_File = nullptr;
+		void* m_Mapping = nullptr;
+#endif
+	};
+
+	// ------------ WRITER ------------
+
+	// Builds a .onionpak in memory, used by the OnionPak tool
+	class PackWriter {
+	public:
+		struct Settings {
+			uint32_t Alignment = 4096;		// Power of two. Page-aligned entries map straight to their own pages.
+			bool Compress = true;
+			float MaxCompressedRatio = 0.9f;	// Entries that do not shrink below this are stored as is
+		};
+
+		struct Stats {
+			uint32_t EntryCount = 0;
+			uint32_t CompressedCount = 0;
+			uint64_t Bytes = 0;				// Sum of the entry sizes
+			uint64_t StoredBytes = 0;		// Same, as stored
+		};
+
+		// Before the first Add. Throws std::runtime_error if the alignment is not a power of two.
+		void SetSettings(const Settings& settings);
+
+		// Compresses right away when enabled. Throws std::runtime_error on duplicate names.
+		void Add(std::string_view name, const uint8_t* data, size_t size);
+
+		// Throws std::runtime_error
+		void Write(const std::string& path) const;
+
+		const Stats& GetStats() const {
+			return m_Stats;
+		}
+
+	private:
+		struct PendingEntry {
+			std::string Name;
+			std::vector<uint8_t> Data;	// As stored
+			uint64_t Size = 0;
+			bool Compressed = false;
+		};
+
+		Settings m_Settings;
+		Stats m_Stats;
+		std::vector<PendingEntry> m_Entries;
+		std::unordered_set<std::string> m_Names;
+	};
+
+} // namespace Onion::Core
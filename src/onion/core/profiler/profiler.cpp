@@ -0,0 +1,213 @@
+#include "profiler.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace Onion::Core;
+
+struct Profiler::ThreadBuffer {
+	std::unique_ptr<Zone[]> Zones; // Allocated on the first zone, threads that never record cost nothing
+	std::atomic<uint32_t> Count{ 0 };
+	std::atomic<uint64_t> Dropped{ 0 };
+	std::atomic<uint32_t> CaptureIndex{ 0 };
+
+	uint32_t ThreadId = 0;
+	std::string Name; // Guarded by the registry mutex
+};
+
+namespace {
+	// Every buffer ever created. Buffers outlive their thread, so a capture can still be exported.
+	struct Registry {
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Buffers;
+
+		// Ticks to microseconds, calibrated against steady_clock over the capture
+		uint64_t CaptureStartTicks = 0;
+		uint64_t CaptureEndTicks = 0;
+		std::chrono::steady_clock::time_point CaptureStartTime;
+		std::chrono::steady_clock::time_point CaptureEndTime;
+	};
+
+	Registry& GetRegistry() {
+		static Registry registry;
+		return registry;
+	}
+
+	void WriteJsonString(std::ostream& out, const std::string& value) {
+		out << '"';
+		for (const char c : value) {
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				out << ' ';
+			}
+			else {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+{
+	if (!t_Buffer) {
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+
+		auto buffer = std::make_unique<ThreadBuffer>();
+		buffer->ThreadId = static_cast<uint32_t>(registry.Buffers.size() + 1);
+		buffer->Name = "Thread " + std::to_string(buffer->ThreadId);
+		t_Buffer = buffer.get();
+		registry.Buffers.push_back(std::move(buffer));
+	}
+	return *t_Buffer;
+}
+
+void Profiler::BeginCapture()
+{
+	Registry& registry = GetRegistry();
+	{
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+		registry.CaptureStartTime = std::chrono::steady_clock::now();
+		registry.CaptureStartTicks = GetTicks();
+	}
+
+	// Buffers reset themselves lazily, on their first zone of the new capture
+	s_CaptureIndex.fetch_add(1, std::memory_order_release);
+	s_Capturing.store(true, std::memory_order_release);
+}
+
+void Profiler::EndCapture()
+{
+	s_Capturing.store(false, std::memory_order_release);
+
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	registry.CaptureEndTicks = GetTicks();
+	registry.CaptureEndTime = std::chrono::steady_clock::now();
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+	buffer.Name = name;
+}
+
+void Profiler::LeaveZone(const char* name, uint64_t begin, uint64_t end, uint32_t depth)
+{
+	t_Depth = depth;
+
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	const uint32_t captureIndex = s_CaptureIndex.load(std::memory_order_acquire);
+	uint32_t count = buffer.Count.load(std::memory_order_relaxed);
+	if (buffer.CaptureIndex.load(std::memory_order_relaxed) != captureIndex) {
+		buffer.CaptureIndex.store(captureIndex, std::memory_order_relaxed);
+		buffer.Dropped.store(0, std::memory_order_relaxed);
+		count = 0;
+	}
+
+	if (count >= ZONES_PER_THREAD) {
+		buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	if (!buffer.Zones) {
+		buffer.Zones.reset(new Zone[ZONES_PER_THREAD]);
+	}
+
+	buffer.Zones[count] = Zone{ name, begin, end, depth };
+	// Publishes the zone to the exporter
+	buffer.Count.store(count + 1, std::memory_order_release);
+}
+
+uint64_t Profiler::GetRecordedZoneCount()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	const uint32_t captureIndex = s_CaptureIndex.load(std::memory_order_acquire);
+	uint64_t total = 0;
+	for (const auto& buffer : registry.Buffers) {
+		if (buffer->CaptureIndex.load(std::memory_order_relaxed) == captureIndex) {
+			total += buffer->Count.load(std::memory_order_acquire);
+		}
+	}
+	return total;
+}
+
+uint64_t Profiler::GetDroppedZoneCount()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	const uint32_t captureIndex = s_CaptureIndex.load(std::memory_order_acquire);
+	uint64_t total = 0;
+	for (const auto& buffer : registry.Buffers) {
+		if (buffer->CaptureIndex.load(std::memory_order_relaxed) == captureIndex) {
+			total += buffer->Dropped.load(std::memory_order_relaxed);
+		}
+	}
+	return total;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		std::cout << "[PROFILER] [ERROR] : Unable to open " << path << std::endl;
+		return false;
+	}
+
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	const double elapsedUs = std::chrono::duration<double, std::micro>(registry.CaptureEndTime - registry.CaptureStartTime).count();
+	const uint64_t elapsedTicks = registry.CaptureEndTicks - registry.CaptureStartTicks;
+	const double ticksPerUs = elapsedUs > 0.0 && elapsedTicks > 0 ? static_cast<double>(elapsedTicks) / elapsedUs : 1.0;
+	const uint64_t origin = registry.CaptureStartTicks;
+
+	const uint32_t captureIndex = s_CaptureIndex.load(std::memory_order_acquire);
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+
+	for (const auto& buffer : registry.Buffers) {
+		if (buffer->CaptureIndex.load(std::memory_order_relaxed) != captureIndex) {
+			continue;
+		}
+
+		// Thread name metadata
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->ThreadId << ",\"args\":{\"name\":";
+		WriteJsonString(file, buffer->Name);
+		file << "}}";
+		first = false;
+
+		const uint32_t count = buffer->Count.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < count; i++) {
+			const Zone& zone = buffer->Zones[i];
+			// Signed: counters of different cores can be slightly apart
+			const double ts = static_cast<double>(static_cast<int64_t>(zone.Begin - origin)) / ticksPerUs;
+			const double dur = static_cast<double>(zone.End - zone.Begin) / ticksPerUs;
+
+			file << ",\n{\"name\":";
+			WriteJsonString(file, zone.Name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->ThreadId << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+		}
+	}
+
+	file << "\n]}\n";
+
+	std::cout << "[PROFILER] Trace written to " << path << std::endl;
+	return true;
+}
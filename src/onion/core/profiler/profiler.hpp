@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ONION_PROFILER_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ONION_PROFILER_HAS_TSC 1
+#else
+#include <chrono>
+#define ONION_PROFILER_HAS_TSC 0
+#endif
+
+// Set by CMake (ONION_ENABLE_PROFILER option). When 0 the macros below compile to nothing.
+#ifndef ONION_ENABLE_PROFILER
+#define ONION_ENABLE_PROFILER 0
+#endif
+
+namespace Onion::Core {
+
+	// Hierarchical CPU profiler.
+	// Zones are recorded into per-thread buffers, each written by its own thread only: recording takes
+	// no lock and does not allocate. Nothing is recorded outside of a capture.
+	// Zone names must be string literals (or outlive the capture), only the pointer is stored.
+	class Profiler {
+	public:
+		struct Zone {
+			const char* Name;
+			uint64_t Begin;	 // Ticks, see GetTicks
+			uint64_t End;
+			uint32_t Depth;
+		};
+
+		// Per-thread capacity, zones beyond it are counted as dropped
+		static constexpr size_t ZONES_PER_THREAD = 1 << 16;
+
+		static uint64_t GetTicks() {
+#if ONION_PROFILER_HAS_TSC
+			return __rdtsc();
+#else
+			return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+		}
+
+		static bool IsCapturing() {
+			return s_Capturing.load(std::memory_order_relaxed);
+		}
+
+		// Starts a new capture, previous zones are discarded
+		static void BeginCapture();
+		static void EndCapture();
+
+		// Names the calling thread in the exported trace
+		static void SetThreadName(const std::string& name);
+
+		// Writes the last capture as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+		// Call after EndCapture.
+		static bool ExportChromeTrace(const std::string& path);
+
+		static uint64_t GetRecordedZoneCount();
+		static uint64_t GetDroppedZoneCount();
+
+		// Hot path, used by ProfileScope
+		static uint32_t EnterZone() {
+			return t_Depth++;
+		}
+		static void LeaveZone(const char* name, uint64_t begin, uint64_t end, uint32_t depth);
+
+		// Opaque, defined in profiler.cpp
+		struct ThreadBuffer;
+
+	private:
+		static ThreadBuffer& GetThreadBuffer();
+
+		static inline std::atomic<bool> s_Capturing{ false };
+		static inline std::atomic<uint32_t> s_CaptureIndex{ 0 };
+
+		static inline thread_local uint32_t t_Depth = 0;
+		static inline thread_local ThreadBuffer* t_Buffer = nullptr;
+	};
+
+	class ProfileScope {
+	public:
+		explicit ProfileScope(const char* name) {
+			if (Profiler::IsCapturing()) {
+				m_Name = name;
+				m_Depth = Profiler::EnterZone();
+				m_Begin = Profiler::GetTicks();
+			}
+		}
+
+		~ProfileScope() {
+			if (m_Name) {
+				Profiler::LeaveZone(m_Name, m_Begin, Profiler::GetTicks(), m_Depth);
+			}
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		const char* m_Name = nullptr;
+		uint64_t m_Begin = 0;
+		uint32_t m_Depth = 0;
+	};
+
+} // namespace Onion::Core
+
+#if ONION_ENABLE_PROFILER
+#define ONION_PROFILE_CONCAT_INNER(a, b) a##b
+#define ONION_PROFILE_CONCAT(a, b) ONION_PROFILE_CONCAT_INNER(a, b)
+#define ONION_PROFILE_SCOPE(name) ::Onion::Core::ProfileScope ONION_PROFILE_CONCAT(onionProfileScope, __LINE__)(name)
+#define ONION_PROFILE_THREAD(name) ::Onion::Core::Profiler::SetThreadName(name)
+#else
+#define ONION_PROFILE_SCOPE(name) ((void)0)
+#define ONION_PROFILE_THREAD(name) ((void)0)
+#endif
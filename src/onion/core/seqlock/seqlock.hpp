@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Onion::Core {
+
+	// Single writer / any number of readers sequence lock for small trivially copyable values.
+	// The writer never waits. Readers copy the value and retry if a write happened meanwhile,
+	// they never block each other and never allocate.
+	// The value is kept as relaxed atomic words, so a torn read is well defined (and discarded).
+	template<typename T>
+	class SeqLock {
+		static_assert(std::is_trivially_copyable_v<T>, "SeqLock values are copied bytewise");
+		static_assert(std::is_default_constructible_v<T>, "SeqLock values must be default constructible");
+
+	public:
+		SeqLock() {
+			const T value{};
+			Word words[WORD_COUNT] = {};
+			std::memcpy(words, &value, sizeof(T));
+			for (size_t i = 0; i < WORD_COUNT; i++) {
+				m_Words[i].store(words[i], std::memory_order_relaxed);
+			}
+		}
+
+		SeqLock(const SeqLock&) = delete;
+		SeqLock& operator=(const SeqLock&) = delete;
+
+		// Writer only
+		void Store(const T& value) {
+			Word words[WORD_COUNT] = {};
+			std::memcpy(words, &value, sizeof(T));
+
+			const uint64_t sequence = m_Sequence.load(std::memory_order_relaxed);
+			m_Sequence.store(sequence + 1, std::memory_order_relaxed); // Odd: write in progress
+			std::atomic_thread_fence(std::memory_order_release);
+
+			for (size_t i = 0; i < WORD_COUNT; i++) {
+				m_Words[i].store(words[i], std::memory_order_relaxed);
+			}
+
+			m_Sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+		// Any thread
+		T Load() const {
+			Word words[WORD_COUNT];
+
+			for (;;) {
+				const uint64_t before = m_Sequence.load(std::memory_order_acquire);
+				if (before & 1) {
+					continue; // The writer only copies a few words, spin
+				}
+
+				for (size_t i = 0; i < WORD_COUNT; i++) {
+					words[i] = m_Words[i].load(std::memory_order_relaxed);
+				}
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (m_Sequence.load(std::memory_order_relaxed) == before) {
+					break;
+				}
+			}
+
+			T value;
+			std::memcpy(&value, words, sizeof(T));
+			return value;
+		}
+
+		// Number of Store calls so far
+		uint64_t GetVersion() const {
+			return m_Sequence.load(std::memory_order_acquire) / 2;
+		}
+
+	private:
+		using Word = uint64_t;
+		static constexpr size_t WORD_COUNT = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+		alignas(64) std::atomic<uint64_t> m_Sequence{ 0 };
+		std::atomic<Word> m_Words[WORD_COUNT];
+	};
+
+} // namespace Onion::Core
@@ -0,0 +1,332 @@
+#include "simulation.hpp"
+
+#include "../../renderer/world_streamer/world_streamer.hpp"
+
+#include <glm/glm.hpp>
+
+using namespace Onion::Core;
+using namespace Onion::Controls;
+using namespace Onion::Rendering;
+
+Simulation::Simulation(JobSystem& jobSystem) : m_JobSystem(jobSystem), m_Camera(glm::vec3(0.0f, 0.0f, -3.0f), 800, 600)
+{
+	m_Camera.SetFront(glm::vec3(0.0f, 0.0f, 1.0f)); // Look towards positive Z
+
+	// Drawn once SetAppleModel gave it a mesh
+	m_Apple = m_World.Create(Transform(), PreviousTransform(), CachedModelMatrix());
+
+	SnapPreviousState();
+}
+
+void Simulation::RegisterInputs(InputsManager& inputsManager)
+{
+	m_InputIdMoveForward = inputsManager.RegisterInput(Key::W);
+	m_InputIdMoveBackward = inputsManager.RegisterInput(Key::S);
+	m_InputIdMoveLeft = inputsManager.RegisterInput(Key::A);
+	m_InputIdMoveRight = inputsManager.RegisterInput(Key::D);
+	m_InputIdMoveUp = inputsManager.RegisterInput(Key::Space);
+	m_InputIdMoveDown = inputsManager.RegisterInput(Key::LeftShift);
+	m_InputIdSpeedUp = inputsManager.RegisterInput(Key::LeftControl);
+	m_InputIdUnfocus = inputsManager.RegisterInput(Key::Escape);
+}
+
+void Simulation::SetAppleModel(const Model* model)
+{
+	if (!model) {
+		m_World.Remove<MeshRef>(m_Apple);
+		m_World.Remove<MaterialRef>(m_Apple);
+		return;
+	}
+
+	m_World.Add(m_Apple, MeshRef{ model, true });
+	m_World.Add(m_Apple, MaterialRef{ nullptr }); // The material set on the model
+}
+
+void Simulation::SampleInputs(const InputsSnapshot& inputs)
+{
+	if (inputs.Sequence == 0 || inputs.Sequence == m_Inputs.Sequence) {
+		return; // Nothing new since the last frame
+	}
+	m_Inputs = inputs;
+
+	// The framebuffer size is a state, not an event: always in sync even if a snapshot was missed
+	if (inputs.Framebuffer.Width > 0 && inputs.Framebuffer.Height > 0) {
+		const float aspectRatio = static_cast<float>(inputs.Framebuffer.Width) / static_cast<float>(inputs.Framebuffer.Height);
+		if (aspectRatio != m_Camera.GetAspectRatio()) {
+			m_Camera.SetAspectRatio(aspectRatio);
+		}
+	}
+
+	ProcessInputs(inputs);
+
+	if (inputs.Mouse.CaptureEnabled) {
+		if (inputs.Mouse.MovementOffsetChanged) {
+			m_PendingMouseOffset += glm::vec2(static_cast<float>(inputs.Mouse.Xoffset), static_cast<float>(inputs.Mouse.Yoffset));
+		}
+		if (inputs.Mouse.ScrollOffsetChanged) {
+			m_PendingScrollOffset += static_cast<float>(inputs.Mouse.ScrollYoffset);
+		}
+	}
+}
+
+void Simulation::Tick(double deltaTime)
+{
+	m_PreviousCameraPosition = m_Camera.GetPosition();
+	m_PreviousCameraYaw = m_Camera.GetYaw();
+	m_PreviousCameraPitch = m_Camera.GetPitch();
+	SavePreviousTransforms();
+
+	m_TickIndex++;
+	m_Time += deltaTime;
+
+	if (m_Inputs.Sequence != 0) {
+		ProcessCameraMovement(m_Inputs, deltaTime);
+	}
+
+	m_Systems.Run(m_World, m_JobSystem);
+
+	m_PendingMouseOffset = glm::vec2(0.0f);
+	m_PendingScrollOffset = 0.0f;
+}
+
+void Simulation::SnapPreviousState()
+{
+	m_PreviousCameraPosition = m_Camera.GetPosition();
+	m_PreviousCameraYaw = m_Camera.GetYaw();
+	m_PreviousCameraPitch = m_Camera.GetPitch();
+	SavePreviousTransforms();
+}
+
+void Simulation::SavePreviousTransforms()
+{
+	m_World.ParallelEachChunk<const Transform, PreviousTransform>(m_JobSystem, [](const ChunkView& chunk) {
+		const Transform* transforms = chunk.Get<const Transform>();
+		PreviousTransform* previous = chunk.Get<PreviousTransform>();
+		for (uint32_t i = 0; i < chunk.Count; i++) {
+			previous[i].Value = transforms[i];
+		}
+		});
+}
+
+void Simulation::ProcessInputs(const InputsSnapshot& inputs)
+{
+	if (inputs.GetKeyState(m_InputIdUnfocus).IsPressed && inputs.Mouse.CaptureEnabled) {
+		m_MouseCaptureEnabled = false;
+	}
+
+	const bool rightPressed = inputs.Mouse.RightButtonPressed;
+	if ((rightPressed) && !inputs.Mouse.CaptureEnabled) {
+		m_MouseCaptureEnabled = true;
+	}
+}
+
+void Simulation::ProcessCameraMovement(const InputsSnapshot& inputs, double deltaTime)
+{
+	if (!inputs.Mouse.CaptureEnabled) {
+		return; // If mouse capture is not enabled, skip camera movement processing
+	}
+
+	// Camera's Orientation
+	if (m_PendingMouseOffset != glm::vec2(0.0f)) {
+		const float sensitivity = 0.1f;
+		const float xoffset = m_PendingMouseOffset.x * sensitivity;
+		const float yoffset = m_PendingMouseOffset.y * sensitivity;
+
+		m_Camera.SetYaw(m_Camera.GetYaw() + xoffset);
+		m_Camera.SetPitch(m_Camera.GetPitch() + yoffset);
+
+		if (m_Camera.GetPitch() > 89.0f)
+			m_Camera.SetPitch(89.0f);
+		if (m_Camera.GetPitch() < -89.0f)
+			m_Camera.SetPitch(-89.0f);
+	}
+
+	// Adjust camera Speed
+	{
+		const float yoffset = m_PendingScrollOffset;
+		if (yoffset != 0.f) {
+			float coeefIncrease = 1.3f;
+			float coeefDecrease = 0.7f;
+			if (yoffset > 0) {
+				m_CameraSpeed *= coeefIncrease; // Speed up
+			}
+			else if (yoffset < 0) {
+				m_CameraSpeed *= coeefDecrease; // Slow down
+			}
+		}
+	}
+
+	// Camera's Position
+	float velocity = static_cast<float>(m_CameraSpeed * deltaTime);
+
+	if (inputs.GetKeyState(m_InputIdSpeedUp).IsPressed) {
+		velocity *= 2.0f; // Double speed if left control is pressed
+	}
+
+	// Flatten the front vector for XZ movement
+	glm::vec3 CamFront = m_Camera.GetFront();
+	glm::vec3 frontXZ = glm::normalize(glm::vec3(CamFront.x, 0.0f, CamFront.z));
+	const glm::vec3 Up(0.0f, 1.0f, 0.0f); // Up vector
+
+	if (inputs.GetKeyState(m_InputIdMoveForward).IsPressed)
+		m_Camera.SetPosition(m_Camera.GetPosition() + frontXZ * velocity);
+	if (inputs.GetKeyState(m_InputIdMoveBackward).IsPressed)
+		m_Camera.SetPosition(m_Camera.GetPosition() - frontXZ * velocity);
+	if (inputs.GetKeyState(m_InputIdMoveLeft).IsPressed)
+		m_Camera.SetPosition(m_Camera.GetPosition() - glm::normalize(glm::cross(frontXZ, Up)) * velocity);
+	if (inputs.GetKeyState(m_InputIdMoveRight).IsPressed)
+		m_Camera.SetPosition(m_Camera.GetPosition() + glm::normalize(glm::cross(frontXZ, Up)) * velocity);
+	if (inputs.GetKeyState(m_InputIdMoveUp).IsPressed) // Jump / up
+		m_Camera.SetPosition(m_Camera.GetPosition() + Up * velocity);
+	if (inputs.GetKeyState(m_InputIdMoveDown).IsPressed) // Down
+		m_Camera.SetPosition(m_Camera.GetPosition() - Up * velocity);
+}
+
+void Simulation::ApplySettings(const SceneSettings& before, const SceneSettings& after)
+{
+	// Only the fields edited by the user are applied: 'before' is a few frames old,
+	// applying it all would undo the movement that happened in the meantime.
+	if (after.CameraPosition != before.CameraPosition)
+		m_Camera.SetPosition(after.CameraPosition);
+	if (after.CameraYaw != before.CameraYaw)
+		m_Camera.SetYaw(after.CameraYaw);
+	if (after.CameraPitch != before.CameraPitch)
+		m_Camera.SetPitch(after.CameraPitch);
+	if (after.CameraFovY != before.CameraFovY)
+		m_Camera.SetFovY(after.CameraFovY);
+	if (after.CameraSpeed != before.CameraSpeed)
+		m_CameraSpeed = after.CameraSpeed;
+
+	const Transform& oldTransform = before.AppleTransform;
+	const Transform& newTransform = after.AppleTransform;
+	Transform* appleTransform = m_World.Get<Transform>(m_Apple);
+	if (appleTransform && (newTransform.Position != oldTransform.Position || newTransform.Rotation != oldTransform.Rotation || newTransform.Scale != oldTransform.Scale)) {
+		appleTransform->Position = newTransform.Position;
+		appleTransform->Rotation = newTransform.Rotation;
+		appleTransform->Scale = newTransform.Scale;
+		appleTransform->MarkDirty();
+	}
+
+	if (after.Light.Direction != before.Light.Direction)
+		m_Light.Direction = glm::normalize(after.Light.Direction);
+	if (after.Light.Color != before.Light.Color)
+		m_Light.Color = after.Light.Color;
+	if (after.Light.Ambient != before.Light.Ambient)
+		m_Light.Ambient = after.Light.Ambient;
+	if (after.Light.SpecularStrength != before.Light.SpecularStrength)
+		m_Light.SpecularStrength = after.Light.SpecularStrength;
+
+	// Edited values are applied as is, not blended in over a tick
+	SnapPreviousState();
+}
+
+void Simulation::BuildSnapshot(FrameSnapshot& snapshot, float alpha)
+{
+	// Spawns and despawns streamed entities, the snapshot below is the first to see the change
+	if (m_WorldStreamer) {
+		m_WorldStreamer->Update(m_World, m_Camera);
+		snapshot.StreamingEpoch = m_WorldStreamer->GetEpoch();
+	}
+
+	snapshot.FrameIndex = m_TickIndex;
+	snapshot.SimulationTime = m_Time;
+	snapshot.InterpolationAlpha = alpha;
+	snapshot.InputsTime = m_Inputs.Sequence != 0 ? m_Inputs.Time : 0.0;
+
+	snapshot.SceneCamera = m_Camera;
+	snapshot.SceneCamera.SetPosition(glm::mix(m_PreviousCameraPosition, m_Camera.GetPosition(), alpha));
+	snapshot.SceneCamera.SetYaw(glm::mix(m_PreviousCameraYaw, m_Camera.GetYaw(), alpha));
+	snapshot.SceneCamera.SetPitch(glm::mix(m_PreviousCameraPitch, m_Camera.GetPitch(), alpha));
+	snapshot.Light = m_Light;
+	snapshot.MouseCaptureEnabled = m_MouseCaptureEnabled;
+
+	// Between two ticks the interpolated casters still move, the shadow cache must see every frame as a change
+	bool castersMoving = false;
+	uint64_t castersVersionSum = 0;
+
+	// clear() keeps the capacity, no allocation once the list reached its size
+	snapshot.DrawList.clear();
+	m_MatrixBatch.Clear();
+	m_PendingMatrices.clear();
+
+	// Queues a matrix for the batch below, 'cache' receives it too
+	const auto composeLater = [this, &snapshot](const Transform& transform, CachedModelMatrix* cache) {
+		m_MatrixBatch.Create(transform.Position, transform.GetOrientation(), transform.Scale);
+		m_PendingMatrices.push_back({ snapshot.DrawList.size(), cache, transform.Version });
+	};
+	m_World.EachChunk<const Transform, const MeshRef, const MaterialRef>([&](const ChunkView& chunk) {
+		const Transform* transforms = chunk.Get<const Transform>();
+		const MeshRef* meshes = chunk.Get<const MeshRef>();
+		const MaterialRef* materials = chunk.Get<const MaterialRef>();
+		const PreviousTransform* previous = chunk.TryGet<const PreviousTransform>();
+		CachedModelMatrix* cachedMatrices = chunk.TryGet<CachedModelMatrix>();
+
+		for (uint32_t i = 0; i < chunk.Count; i++) {
+			if (!meshes[i].Source) {
+				continue;
+			}
+
+			const Transform& transform = transforms[i];
+			const bool moving = previous && previous[i].Value.Version != transform.Version;
+
+			DrawItem item;
+			item.SourceModel = meshes[i].Source;
+			item.SourceMaterial = materials[i].Source;
+			item.CastsShadows = meshes[i].CastsShadows;
+
+			if (moving) {
+				composeLater(Transform::Interpolate(previous[i].Value, transform, alpha), nullptr);
+			}
+			else if (cachedMatrices) {
+				// At rest the matrix only changes with the transform, compose it once
+				CachedModelMatrix& cached = cachedMatrices[i];
+				if (!cached.Valid || cached.Version != transform.Version) {
+					composeLater(transform, &cached);
+				}
+				else {
+					item.ModelMatrix = cached.Matrix;
+				}
+			}
+			else {
+				composeLater(transform, nullptr);
+			}
+
+			if (item.CastsShadows) {
+				castersMoving |= moving;
+				castersVersionSum += transform.Version;
+			}
+			snapshot.DrawList.push_back(item);
+		}
+		});
+
+	// Composed together, split across the workers when there are many (a streamed world settling, everything moving)
+	m_MatrixBatch.UpdateMatrices(m_JobSystem);
+	for (size_t i = 0; i < m_PendingMatrices.size(); i++) {
+		const PendingMatrix& pending = m_PendingMatrices[i];
+		const glm::mat4& matrix = m_MatrixBatch.GetWorldMatrix(static_cast<TransformSystem::Handle>(i));
+		snapshot.DrawList[pending.DrawIndex].ModelMatrix = matrix;
+		if (pending.Cache) {
+			pending.Cache->Matrix = matrix;
+			pending.Cache->Version = pending.Version;
+			pending.Cache->Valid = true;
+		}
+	}
+
+	const uint64_t structureVersion = m_World.GetStructureVersion();
+	if (castersMoving || castersVersionSum != m_LastCastersVersionSum || structureVersion != m_LastWorldStructureVersion) {
+		m_SnapshotCastersVersion++;
+		m_LastCastersVersionSum = castersVersionSum;
+		m_LastWorldStructureVersion = structureVersion;
+	}
+	snapshot.CastersVersion = m_SnapshotCastersVersion;
+
+	SceneSettings& settings = snapshot.Settings;
+	settings.CameraPosition = m_Camera.GetPosition();
+	settings.CameraYaw = m_Camera.GetYaw();
+	settings.CameraPitch = m_Camera.GetPitch();
+	settings.CameraFovY = m_Camera.GetFovY();
+	settings.CameraSpeed = m_CameraSpeed;
+	const Transform* appleTransform = m_World.Get<Transform>(m_Apple);
+	settings.AppleTransform = appleTransform ? *appleTransform : Transform();
+	settings.Light = m_Light;
+}
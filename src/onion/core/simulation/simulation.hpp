@@ -0,0 +1,131 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../ecs/ecs.hpp"
+#include "../job_system/job_system.hpp"
+#include "../../renderer/camera/camera.hpp"
+#include "../../renderer/inputs_manager/inputs_manager.hpp"
+#include "../../renderer/structs/frame_snapshot.hpp"
+#include "../../renderer/structs/scene_components.hpp"
+#include "../../renderer/structs/transform.hpp"
+#include "../../renderer/transform_system/transform_system.hpp"
+
+namespace Onion::Rendering {
+	class WorldStreamer;
+}
+
+namespace Onion::Core {
+
+	// Game side of the engine: owns the scene state, reacts to inputs and produces the frame snapshots.
+	// Runs on the simulation (main) thread, never touches OpenGL or GLFW windows.
+	// Scene objects are entities of an ECS world, updated by the registered systems once per tick.
+	class Simulation {
+	public:
+		explicit Simulation(JobSystem& jobSystem);
+		~Simulation() = default;
+
+		void RegisterInputs(Onion::Controls::InputsManager& inputsManager);
+
+		// The model is owned by the renderer, only its address is stored in the draw list
+		void SetAppleModel(const Onion::Rendering::Model* model);
+
+		// Cells around the camera are streamed in and out of the world before each snapshot. nullptr: none.
+		void SetWorldStreamer(Onion::Rendering::WorldStreamer* streamer) {
+			m_WorldStreamer = streamer;
+		}
+
+		// Called once per frame with the latest inputs. Mouse and scroll offsets are accumulated
+		// until the next tick, so none are lost when a frame runs no tick.
+		void SampleInputs(const Onion::Controls::InputsSnapshot& inputs);
+
+		// Advances the simulation by one fixed step
+		void Tick(double deltaTime);
+
+		// Applies the values edited in the debug panel
+		void ApplySettings(const Onion::Rendering::SceneSettings& before, const Onion::Rendering::SceneSettings& after);
+
+		// Renders the state 'alpha' of the way between the last two ticks
+		void BuildSnapshot(Onion::Rendering::FrameSnapshot& snapshot, float alpha);
+
+		uint64_t GetTickIndex() const {
+			return m_TickIndex;
+		}
+
+		// Entities are drawn when they have Transform, MeshRef and MaterialRef (scene_components.hpp)
+		World& GetWorld() {
+			return m_World;
+		}
+		// Run in parallel on every tick, after the previous transforms were saved
+		SystemScheduler& GetSystems() {
+			return m_Systems;
+		}
+
+	private:
+		void ProcessInputs(const Onion::Controls::InputsSnapshot& inputs);
+		void ProcessCameraMovement(const Onion::Controls::InputsSnapshot& inputs, double deltaTime);
+
+		// Interpolation restarts from the current state, for teleports and edits
+		void SnapPreviousState();
+		void SavePreviousTransforms();
+
+	private:
+		JobSystem& m_JobSystem;
+		Onion::Rendering::WorldStreamer* m_WorldStreamer = nullptr;
+
+		uint64_t m_TickIndex = 0;
+		double m_Time = 0.0;
+
+		Onion::Controls::InputsSnapshot m_Inputs; // Sequence 0 until the first inputs were polled
+		bool m_MouseCaptureEnabled = false;
+
+		// Offsets sampled since the last tick
+		glm::vec2 m_PendingMouseOffset{ 0.0f };
+		float m_PendingScrollOffset = 0.0f;
+
+		int m_InputIdMoveForward = -1;
+		int m_InputIdMoveBackward = -1;
+		int m_InputIdMoveLeft = -1;
+		int m_InputIdMoveRight = -1;
+		int m_InputIdMoveUp = -1;
+		int m_InputIdMoveDown = -1;
+		int m_InputIdSpeedUp = -1;
+		int m_InputIdUnfocus = -1;
+
+		// ------------ SCENE ------------
+	private:
+		Onion::Rendering::Camera m_Camera;
+		float m_CameraSpeed = 5.0f;
+
+		World m_World;
+		SystemScheduler m_Systems;
+
+		Entity m_Apple; // Edited from the debug panel
+		Onion::Rendering::DirectionalLight m_Light;
+
+		// State at the previous tick, rendering interpolates from it
+		glm::vec3 m_PreviousCameraPosition{ 0.0f };
+		float m_PreviousCameraYaw = 0.0f;
+		float m_PreviousCameraPitch = 0.0f;
+
+		// Model matrices composed by BuildSnapshot (interpolated or stale caches), batched for the SIMD kernels.
+		// Refilled every snapshot, the capacity is kept.
+		struct PendingMatrix {
+			size_t DrawIndex = 0;
+			Onion::Rendering::CachedModelMatrix* Cache = nullptr; // Written back when set
+			uint32_t Version = 0;
+		};
+		Onion::Rendering::TransformSystem m_MatrixBatch;
+		std::vector<PendingMatrix> m_PendingMatrices;
+
+		// Shadow casters version seen by the renderer, bumped while interpolated casters move
+		uint64_t m_SnapshotCastersVersion = 0;
+		// Sum of the caster transform versions at the last snapshot, changed by any transform edit.
+		// Spawns and despawns are seen through the world structure version: streamed entities start
+		// at version 0, a cell replaced by one with as many casters leaves the sum unchanged.
+		uint64_t m_LastCastersVersionSum = 0;
+		uint64_t m_LastWorldStructureVersion = 0;
+	};
+
+} // namespace Onion::Core
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Onion::Core {
+
+	// Lock-free single producer / single consumer ring buffer with a fixed capacity.
+	// The producer never waits: pushing into a full ring fails and the item is dropped.
+	// Each side caches the other side's index, so the shared cache lines are only read when
+	// the ring looks full (producer) or empty (consumer).
+	template<typename T, size_t Capacity>
+	class SpscRing {
+		static_assert((Capacity& (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	public:
+		SpscRing() = default;
+
+		SpscRing(const SpscRing&) = delete;
+		SpscRing& operator=(const SpscRing&) = delete;
+
+		// ------------ PRODUCER ------------
+
+		bool TryPush(const T& item) {
+			const size_t head = m_Head.load(std::memory_order_relaxed);
+			if (head - m_CachedTail >= Capacity) {
+				m_CachedTail = m_Tail.load(std::memory_order_acquire);
+				if (head - m_CachedTail >= Capacity) {
+					return false;
+				}
+			}
+
+			m_Items[head & MASK] = item;
+			m_Head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// ------------ CONSUMER ------------
+
+		bool TryPop(T& item) {
+			const size_t tail = m_Tail.load(std::memory_order_relaxed);
+			if (tail == m_CachedHead) {
+				m_CachedHead = m_Head.load(std::memory_order_acquire);
+				if (tail == m_CachedHead) {
+					return false;
+				}
+			}
+
+			item = m_Items[tail & MASK];
+			m_Tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Approximate when called while the other side is running
+		size_t Size() const {
+			const size_t head = m_Head.load(std::memory_order_acquire);
+			const size_t tail = m_Tail.load(std::memory_order_acquire);
+			return head - tail;
+		}
+
+		static constexpr size_t GetCapacity() {
+			return Capacity;
+		}
+
+	private:
+		static constexpr size_t MASK = Capacity - 1;
+
+		alignas(64) std::atomic<size_t> m_Head{ 0 };	// Written by the producer
+		size_t m_CachedTail = 0;						// Producer only
+		alignas(64) std::atomic<size_t> m_Tail{ 0 };	// Written by the consumer
+		size_t m_CachedHead = 0;						// Consumer only
+		alignas(64) std::array<T, Capacity> m_Items{};
+	};
+
+} // namespace Onion::Core
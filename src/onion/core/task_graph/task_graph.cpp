@@ -0,0 +1,360 @@
+#include "task_graph.hpp"
+
+#include "../profiler/profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Onion::Core;
+
+namespace {
+	void WriteJsonString(std::ostream& out, const std::string& text) {
+		out << '"';
+		for (const char c : text) {
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				out << ' ';
+			}
+			else {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+
+	double ToMs(std::chrono::steady_clock::duration duration) {
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+}
+
+TaskGraph::TaskGraph(JobSystem& jobSystem)
+	: m_JobSystem(jobSystem)
+{
+}
+
+TaskGraph::TaskId TaskGraph::Add(std::string name, Affinity affinity, std::function<void()> function, std::initializer_list<TaskId> dependencies)
+{
+	return Add(std::move(name), affinity, std::move(function), std::vector<TaskId>(dependencies));
+}
+
+TaskGraph::TaskId TaskGraph::Add(std::string name, Affinity affinity, std::function<void()> function, const std::vector<TaskId>& dependencies)
+{
+	const TaskId id = static_cast<TaskId>(m_Tasks.size());
+
+	auto task = std::make_unique<Task>();
+	task->Name = std::move(name);
+	task->TaskAffinity = affinity;
+	task->Function = std::move(function);
+	for (const TaskId dependency : dependencies) {
+		if (dependency >= id) {
+			throw std::runtime_error("TaskGraph: '" + task->Name + "' depends on a task added after it");
+		}
+		task->Dependencies.push_back(dependency);
+		m_Tasks[dependency]->Dependents.push_back(id);
+	}
+	m_Tasks.push_back(std::move(task));
+
+	return id;
+}
+
+TaskGraph::TaskId TaskGraph::AddExternal(std::string name, std::initializer_list<TaskId> dependencies)
+{
+	return Add(std::move(name), Affinity::External, nullptr, std::vector<TaskId>(dependencies));
+}
+
+void TaskGraph::Complete(TaskId id, bool succeeded)
+{
+	Task& task = *m_Tasks[id];
+	if (task.CompleteTaken.exchange(true, std::memory_order_acq_rel)) {
+		return;
+	}
+	if (!succeeded) {
+		task.ExternalFailed.store(true, std::memory_order_relaxed);
+	}
+	if (task.Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		Dispatch(id);
+	}
+}
+
+// ------------ EXECUTION ------------
+
+void TaskGraph::Run()
+{
+	ONION_PROFILE_SCOPE("TaskGraph::Run");
+
+	m_Start = std::chrono::steady_clock::now();
+	m_ContextThread = std::this_thread::get_id();
+	m_Completed = 0;
+	m_FirstError = nullptr;
+
+	for (auto& task : m_Tasks) {
+		const bool external = task->TaskAffinity == Affinity::External;
+		task->Remaining.store(static_cast<uint32_t>(task->Dependencies.size()) + (external ? 1 : 0), std::memory_order_relaxed);
+		task->Skipped.store(false, std::memory_order_relaxed);
+		task->ExternalFailed.store(false, std::memory_order_relaxed);
+		task->CompleteTaken.store(false, std::memory_order_relaxed);
+	}
+	for (TaskId id = 0; id < m_Tasks.size(); id++) {
+		if (m_Tasks[id]->Dependencies.empty() && m_Tasks[id]->TaskAffinity != Affinity::External) {
+			Dispatch(id);
+		}
+	}
+
+	// Context tasks are run here as they become ready. With workers, this thread does nothing else,
+	// so a GL task starts as soon as its inputs are decoded. Without, it runs the worker tasks too.
+	const bool helpWorkers = m_JobSystem.GetWorkerCount() == 0;
+	while (true) {
+		TaskId id = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_MutexContext);
+			if (m_ContextQueue.empty()) {
+				if (m_Completed == m_Tasks.size()) {
+					break;
+				}
+				if (helpWorkers) {
+					lock.unlock();
+					if (!m_JobSystem.RunPendingJob()) {
+						std::this_thread::yield();
+					}
+					continue;
+				}
+				m_ContextCondition.wait(lock, [this]() { return !m_ContextQueue.empty() || m_Completed == m_Tasks.size(); });
+				continue;
+			}
+			id = m_ContextQueue.front();
+			m_ContextQueue.pop_front();
+		}
+		Execute(id);
+	}
+
+	// The last worker jobs may still be returning
+	m_JobSystem.Wait(m_WorkerTasks);
+
+	m_Duration_ms = ToMs(std::chrono::steady_clock::now() - m_Start);
+	BuildTrace();
+
+	if (m_FirstError) {
+		std::rethrow_exception(m_FirstError);
+	}
+}
+
+void TaskGraph::Dispatch(TaskId id)
+{
+	switch (m_Tasks[id]->TaskAffinity) {
+	case Affinity::Worker:
+		m_JobSystem.Run([this, id]() { Execute(id); }, &m_WorkerTasks);
+		return;
+	case Affinity::External:
+		// Only bookkeeping left, done by whoever completed it last
+		Execute(id);
+		return;
+	case Affinity::Context:
+		break;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_MutexContext);
+		m_ContextQueue.push_back(id);
+	}
+	m_ContextCondition.notify_all();
+}
+
+void TaskGraph::Execute(TaskId id)
+{
+	Task& task = *m_Tasks[id];
+	task.Thread = std::this_thread::get_id();
+	task.Start = std::chrono::steady_clock::now();
+
+	bool failed = task.Skipped.load(std::memory_order_relaxed);
+	if (!failed && task.TaskAffinity == Affinity::External && task.ExternalFailed.load(std::memory_order_relaxed)) {
+		failed = true;
+		std::lock_guard<std::mutex> lock(m_MutexContext);
+		if (!m_FirstError) {
+			m_FirstError = std::make_exception_ptr(std::runtime_error("'" + task.Name + "' failed"));
+		}
+	}
+	else if (!failed && task.Function) {
+		ONION_PROFILE_SCOPE("TaskGraph::Task");
+		try {
+			task.Function();
+		}
+		catch (...) {
+			failed = true;
+			std::lock_guard<std::mutex> lock(m_MutexContext);
+			if (!m_FirstError) {
+				m_FirstError = std::current_exception();
+			}
+		}
+	}
+	task.Function = nullptr; // Releases the captures right away
+	task.End = std::chrono::steady_clock::now();
+
+	for (const TaskId dependentId : task.Dependents) {
+		Task& dependent = *m_Tasks[dependentId];
+		if (failed) {
+			dependent.Skipped.store(true, std::memory_order_relaxed);
+			// Whatever was to complete it may never start: takes the share of Complete, this dependency's is still held
+			if (dependent.TaskAffinity == Affinity::External && !dependent.CompleteTaken.exchange(true, std::memory_order_acq_rel)) {
+				dependent.Remaining.fetch_sub(1, std::memory_order_acq_rel);
+			}
+		}
+		// Release: the last dependency publishes its results (and Skipped) to the dependent
+		if (dependent.Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			Dispatch(dependentId);
+		}
+	}
+
+	// Notified under the lock: Run may return, and the graph be destroyed, as soon as it is released
+	std::lock_guard<std::mutex> lock(m_MutexContext);
+	m_Completed++;
+	m_ContextCondition.notify_all();
+}
+
+// ------------ TRACE ------------
+
+void TaskGraph::BuildTrace()
+{
+	m_Timings.clear();
+	m_CriticalPath.clear();
+	if (m_Tasks.empty()) {
+		return;
+	}
+
+	// Lanes: the context thread, then the other threads in the order they started their first task
+	std::vector<TaskId> byStart(m_Tasks.size());
+	for (TaskId id = 0; id < m_Tasks.size(); id++) {
+		byStart[id] = id;
+	}
+	std::sort(byStart.begin(), byStart.end(), [this](TaskId a, TaskId b) { return m_Tasks[a]->Start < m_Tasks[b]->Start; });
+	std::vector<std::thread::id> lanes = { m_ContextThread };
+
+	m_Timings.resize(m_Tasks.size());
+	for (const TaskId id : byStart) {
+		const Task& task = *m_Tasks[id];
+		TaskTiming& timing = m_Timings[id];
+		timing.Name = task.Name;
+		timing.TaskAffinity = task.TaskAffinity;
+		timing.Start_ms = ToMs(task.Start - m_Start);
+		timing.End_ms = ToMs(task.End - m_Start);
+		timing.Skipped = task.Skipped.load(std::memory_order_relaxed);
+
+		if (task.TaskAffinity != Affinity::External) {
+			auto lane = std::find(lanes.begin(), lanes.end(), task.Thread);
+			if (lane == lanes.end()) {
+				lane = lanes.insert(lanes.end(), task.Thread);
+			}
+			timing.Lane = static_cast<uint32_t>(lane - lanes.begin());
+		}
+	}
+
+	// External work starts with the graph, or once the task that launched it ended
+	for (TaskId id = 0; id < m_Tasks.size(); id++) {
+		if (m_Tasks[id]->TaskAffinity != Affinity::External) {
+			continue;
+		}
+		TaskTiming& timing = m_Timings[id];
+		timing.Start_ms = 0.0;
+		for (const TaskId dependency : m_Tasks[id]->Dependencies) {
+			timing.Start_ms = std::max(timing.Start_ms, m_Timings[dependency].End_ms);
+		}
+	}
+
+	// Walk back from the task that ended last, through the dependency that held each task back
+	TaskId current = 0;
+	for (TaskId id = 1; id < m_Tasks.size(); id++) {
+		if (m_Timings[id].End_ms > m_Timings[current].End_ms) {
+			current = id;
+		}
+	}
+	while (true) {
+		m_CriticalPath.push_back(current);
+		m_Timings[current].Critical = true;
+
+		const std::vector<TaskId>& dependencies = m_Tasks[current]->Dependencies;
+		if (dependencies.empty()) {
+			break;
+		}
+		current = *std::max_element(dependencies.begin(), dependencies.end(),
+			[this](TaskId a, TaskId b) { return m_Timings[a].End_ms < m_Timings[b].End_ms; });
+	}
+	std::reverse(m_CriticalPath.begin(), m_CriticalPath.end());
+}
+
+void TaskGraph::PrintSummary(const std::string& tag) const
+{
+	// External tasks only wait for work done elsewhere (file reads, GPU), not counted as work
+	double work_ms = 0.0;
+	for (const TaskTiming& timing : m_Timings) {
+		if (timing.TaskAffinity != Affinity::External) {
+			work_ms += timing.End_ms - timing.Start_ms;
+		}
+	}
+
+	const std::ios_base::fmtflags flags = std::cout.flags();
+	const std::streamsize precision = std::cout.precision();
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << tag << " " << m_Timings.size() << " tasks in " << m_Duration_ms << " ms (" << work_ms << " ms of work, "
+		<< (m_Duration_ms > 0.0 ? work_ms / m_Duration_ms : 0.0) << "x in parallel)" << std::endl;
+	std::cout << tag << " Critical path:" << std::endl;
+	for (const TaskId id : m_CriticalPath) {
+		const TaskTiming& timing = m_Timings[id];
+		std::cout << tag << "   " << std::setw(8) << timing.Start_ms << " ms  " << std::setw(8) << timing.End_ms - timing.Start_ms << " ms  "
+			<< (timing.TaskAffinity == Affinity::Context ? "[context]  " : timing.TaskAffinity == Affinity::Worker ? "[worker]   " : "[external] ") << timing.Name
+			<< (timing.Skipped ? " (skipped)" : "") << std::endl;
+	}
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
+
+bool TaskGraph::ExportChromeTrace(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		std::cout << "[TASK GRAPH] [ERROR] : Unable to open " << path << std::endl;
+		return false;
+	}
+
+	uint32_t laneCount = 0;
+	for (const TaskTiming& timing : m_Timings) {
+		laneCount = std::max(laneCount, timing.Lane + 1);
+	}
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	for (uint32_t lane = 0; lane < laneCount; lane++) {
+		file << (lane == 0 ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << lane << ",\"args\":{\"name\":";
+		WriteJsonString(file, lane == 0 ? std::string("Context") : "Worker " + std::to_string(lane));
+		file << "}}";
+	}
+	for (size_t id = 0; id < m_Timings.size(); id++) {
+		const TaskTiming& timing = m_Timings[id];
+		const char* category = timing.Critical ? "critical" : "task";
+		const char* args = timing.Critical ? (timing.Skipped ? "{\"critical\":true,\"skipped\":true}" : "{\"critical\":true}")
+			: (timing.Skipped ? "{\"skipped\":true}" : "{}");
+
+		if (timing.TaskAffinity == Affinity::External) {
+			// Async begin and end pair, external tasks overlap each other
+			for (int end = 0; end < 2; end++) {
+				file << ",\n{\"name\":";
+				WriteJsonString(file, timing.Name);
+				file << ",\"cat\":\"" << category << "\",\"ph\":\"" << (end ? 'e' : 'b') << "\",\"id\":" << id << ",\"pid\":1,\"tid\":0,\"ts\":"
+					<< (end ? timing.End_ms : timing.Start_ms) * 1000.0 << ",\"args\":" << args << "}";
+			}
+			continue;
+		}
+
+		file << ",\n{\"name\":";
+		WriteJsonString(file, timing.Name);
+		file << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << timing.Lane
+			<< ",\"ts\":" << timing.Start_ms * 1000.0 << ",\"dur\":" << (timing.End_ms - timing.Start_ms) * 1000.0 << ",\"args\":" << args << "}";
+	}
+	file << "\n]}\n";
+
+	std::cout << "[TASK GRAPH] Trace written to " << path << std::endl;
+	return true;
+}
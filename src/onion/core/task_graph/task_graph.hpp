@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../job_system/job_system.hpp"
+
+namespace Onion::Core {
+
+	// One-shot dependency graph, used to initialize the engine concurrently.
+	// Worker tasks run on the JobSystem. Context tasks run on the thread calling Run, the one owning the
+	// OpenGL context, so the GL calls stay serialized there. A task starts once all its dependencies ran.
+	// External tasks stand for work done outside the graph (file reads through AsyncFileIO for instance).
+	// Run records when and where each task ran: the critical path (the chain of dependencies that ended last)
+	// is the part worth shortening.
+	class TaskGraph {
+	public:
+		using TaskId = uint32_t;
+
+		enum class Affinity {
+			Worker,
+			Context,
+			External	// No function, done once Complete was called
+		};
+
+		struct TaskTiming {
+			std::string Name;
+			Affinity TaskAffinity = Affinity::Worker;
+			double Start_ms = 0.0;		// From the start of Run
+			double End_ms = 0.0;
+			uint32_t Lane = 0;			// 0 is the context thread, then the workers by first use. Unused by external tasks.
+			bool Skipped = false;		// A dependency failed
+			bool Critical = false;
+		};
+
+		explicit TaskGraph(JobSystem& jobSystem);
+
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph& operator=(const TaskGraph&) = delete;
+
+		// Dependencies must have been added before. Build the whole graph, then Run it once.
+		TaskId Add(std::string name, Affinity affinity, std::function<void()> function, std::initializer_list<TaskId> dependencies = {});
+		TaskId Add(std::string name, Affinity affinity, std::function<void()> function, const std::vector<TaskId>& dependencies);
+
+		// Done once its dependencies ran and Complete was called for it, in any order. Complete is thread-safe
+		// and must be called during Run, by work started from a task (the external work starts after the graph does).
+		TaskId AddExternal(std::string name, std::initializer_list<TaskId> dependencies = {});
+		// A failure is handled like a throwing task: the dependents are skipped and Run throws.
+		// Once a dependency failed the task is skipped without waiting, a later Complete is ignored.
+		void Complete(TaskId id, bool succeeded = true);
+
+		// Returns once every task ran. When a task throws, the tasks depending on it are skipped
+		// and the first exception is rethrown here, after the others finished.
+		void Run();
+
+		// ------------ TRACE ------------
+		// After Run
+
+		const std::vector<TaskTiming>& GetTimings() const {
+			return m_Timings;
+		}
+		double GetDuration_ms() const {
+			return m_Duration_ms;
+		}
+		// First to last task
+		const std::vector<TaskId>& GetCriticalPath() const {
+			return m_CriticalPath;
+		}
+
+		// Totals and the tasks on the critical path, each line prefixed by 'tag'
+		void PrintSummary(const std::string& tag) const;
+		// Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev), one track per thread,
+		// the critical path in its own category
+		bool ExportChromeTrace(const std::string& path) const;
+
+	private:
+		struct Task {
+			std::string Name;
+			Affinity TaskAffinity = Affinity::Worker;
+			std::function<void()> Function;
+			std::vector<TaskId> Dependencies;
+			std::vector<TaskId> Dependents;
+
+			std::atomic<uint32_t> Remaining{ 0 };	// Dependencies, plus Complete for external tasks
+			std::atomic<bool> Skipped{ false };
+			std::atomic<bool> ExternalFailed{ false };
+			std::atomic<bool> CompleteTaken{ false };	// External: by Complete, or by a failed dependency
+
+			std::chrono::steady_clock::time_point Start;
+			std::chrono::steady_clock::time_point End;
+			std::thread::id Thread;
+		};
+
+		void Dispatch(TaskId id);
+		void Execute(TaskId id);
+		void BuildTrace();
+
+	private:
+		JobSystem& m_JobSystem;
+		std::vector<std::unique_ptr<Task>> m_Tasks;
+
+		// Context tasks ready to run, and the completion count the context thread waits on
+		std::mutex m_MutexContext;
+		std::condition_variable m_ContextCondition;
+		std::deque<TaskId> m_ContextQueue;
+		size_t m_Completed = 0;
+		std::exception_ptr m_FirstError;
+
+		JobCounter m_WorkerTasks;
+
+		std::chrono::steady_clock::time_point m_Start;
+		std::thread::id m_ContextThread;
+
+		std::vector<TaskTiming> m_Timings;
+		std::vector<TaskId> m_CriticalPath;
+		double m_Duration_ms = 0.0;
+	};
+
+} // namespace Onion::Core
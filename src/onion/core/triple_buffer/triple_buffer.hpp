@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Onion::Core {
+
+	// Lock-free single producer / single consumer triple buffer.
+	// The producer always has a buffer to write into, the consumer always reads the most recent
+	// published one, and neither ever waits for the other.
+	template<typename T>
+	class TripleBuffer {
+	public:
+		TripleBuffer() = default;
+
+		TripleBuffer(const TripleBuffer&) = delete;
+		TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+		// ------------ PRODUCER ------------
+
+		T& GetWriteBuffer() {
+			return m_Buffers[m_Back];
+		}
+
+		// Makes the write buffer the latest one, and gets back a buffer to write the next value into
+		void Publish() {
+			m_Back = static_cast<uint8_t>(m_Middle.exchange(static_cast<uint8_t>(m_Back | DIRTY_BIT), std::memory_order_acq_rel) & INDEX_MASK);
+		}
+
+		// ------------ CONSUMER ------------
+
+		// Swaps in the latest published buffer. Returns false (and keeps the current one) if nothing new was published.
+		bool Consume() {
+			if ((m_Middle.load(std::memory_order_relaxed) & DIRTY_BIT) == 0) {
+				return false;
+			}
+
+			m_Front = static_cast<uint8_t>(m_Middle.exchange(m_Front, std::memory_order_acq_rel) & INDEX_MASK);
+			return true;
+		}
+
+		const T& GetReadBuffer() const {
+			return m_Buffers[m_Front];
+		}
+
+	private:
+		static constexpr uint8_t INDEX_MASK = 0x3;
+		static constexpr uint8_t DIRTY_BIT = 0x4;
+
+		std::array<T, 3> m_Buffers{};
+
+		alignas(64) uint8_t m_Back = 0;					 // Producer only
+		alignas(64) std::atomic<uint8_t> m_Middle{ 1 };	 // Shared: index + dirty bit
+		alignas(64) uint8_t m_Front = 2;					 // Consumer only
+	};
+
+} // namespace Onion::Core
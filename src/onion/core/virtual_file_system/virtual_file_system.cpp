@@ -0,0 +1,230 @@
+#include "virtual_file_system.hpp"
+
+#include "../async_file_io/async_file_io.hpp"
+#include "../pack_archive/pack_archive.hpp"
+#include "../profiler/profiler.hpp"
+
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+using namespace Onion::Core;
+
+namespace {
+	struct MountTable {
+		std::shared_mutex Mutex;
+		std::vector<std::unique_ptr<PackArchive>> Archives; // Searched from the back
+		std::atomic<uint64_t> Reads{ 0 };
+		std::atomic<uint64_t> ArchiveReads{ 0 };
+	};
+
+	MountTable& GetMountTable() {
+		static MountTable table;
+		return table;
+	}
+
+	bool ReadLooseFile(const std::string& path, std::vector<uint8_t>& contents) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) {
+			return false;
+		}
+		const std::streamsize size = file.tellg();
+		if (size < 0) {
+			return false;
+		}
+		contents.resize(static_cast<size_t>(size));
+		file.seekg(0);
+		return size == 0 || file.read(reinterpret_cast<char*>(contents.data()), size).good();
+	}
+}
+
+bool VirtualFileSystem::Mount(const std::string& archivePath)
+{
+	auto archive = std::make_unique<PackArchive>();
+	try {
+		archive->Open(archivePath);
+	}
+	catch (const std::exception& e) {
+		std::cout << "[VFS] [ERROR] : " << e.what() << std::endl;
+		return false;
+	}
+
+	std::cout << "[VFS] Mounted " << archivePath << " (" << archive->GetEntryCount() << " files)" << std::endl;
+
+	MountTable& table = GetMountTable();
+	std::unique_lock<std::shared_mutex> lock(table.Mutex);
+	table.Archives.push_back(std::move(archive));
+	return true;
+}
+
+void VirtualFileSystem::UnmountAll()
+{
+	MountTable& table = GetMountTable();
+	std::unique_lock<std::shared_mutex> lock(table.Mutex);
+	table.Archives.clear();
+}
+
+size_t VirtualFileSystem::GetMountCount()
+{
+	MountTable& table = GetMountTable();
+	std::shared_lock<std::shared_mutex> lock(table.Mutex);
+	return table.Archives.size();
+}
+
+bool VirtualFileSystem::Exists(const std::string& path)
+{
+	{
+		MountTable& table = GetMountTable();
+		std::shared_lock<std::shared_mutex> lock(table.Mutex);
+		for (auto it = table.Archives.rbegin(); it != table.Archives.rend(); ++it) {
+			if ((*it)->Find(path)) {
+				return true;
+			}
+		}
+	}
+
+	std::error_code error;
+	return std::filesystem::is_regular_file(path, error);
+}
+
+bool VirtualFileSystem::ReadFile(const std::string& path, FileData& file)
+{
+	ONION_PROFILE_SCOPE("VirtualFileSystem::ReadFile");
+
+	MountTable& table = GetMountTable();
+	table.Reads.fetch_add(1, std::memory_order_relaxed);
+
+	file.m_Data = nullptr;
+	file.m_Size = 0;
+	file.m_Storage.clear();
+
+	{
+		std::shared_lock<std::shared_mutex> lock(table.Mutex);
+		for (auto it = table.Archives.rbegin(); it != table.Archives.rend(); ++it) {
+			const PackArchive& archive = **it;
+			const PackEntry* entry = archive.Find(path);
+			if (!entry) {
+				continue;
+			}
+
+			table.ArchiveReads.fetch_add(1, std::memory_order_relaxed);
+			if (!PackArchive::IsCompressed(*entry)) {
+				file.m_Data = archive.GetStoredData(*entry);
+				file.m_Size = static_cast<size_t>(entry->Size);
+				return true;
+			}
+			if (!archive.Extract(*entry, file.m_Storage)) {
+				std::cout << "[VFS] [ERROR] : Corrupt entry " << path << " in " << archive.GetPath() << std::endl;
+				file.m_Storage.clear();
+				return false;
+			}
+			file.m_Data = file.m_Storage.data();
+			file.m_Size = file.m_Storage.size();
+			return true;
+		}
+	}
+
+	if (!ReadLooseFile(path, file.m_Storage)) {
+		return false;
+	}
+	file.m_Data = file.m_Storage.data();
+	file.m_Size = file.m_Storage.size();
+	return true;
+}
+
+bool VirtualFileSystem::ReadText(const std::string& path, std::string& text)
+{
+	FileData file;
+	if (!ReadFile(path, file)) {
+		return false;
+	}
+	text.assign(file.GetText());
+	return true;
+}
+
+void VirtualFileSystem::ReadFilesAsync(AsyncFileIO& io, const std::vector<std::string>& paths, std::vector<FileData>& files,
+	JobCounter& counter, std::function<void(size_t, bool)> onRead, IoPriority priority)
+{
+	ONION_PROFILE_SCOPE("VirtualFileSystem::ReadFilesAsync");
+
+	MountTable& table = GetMountTable();
+	table.Reads.fetch_add(paths.size(), std::memory_order_relaxed);
+
+	files.clear();
+	files.resize(paths.size());
+
+	// Shared by every completion
+	auto callback = std::make_shared<std::function<void(size_t, bool)>>(std::move(onRead));
+	auto complete = [callback](size_t index, bool succeeded) {
+		if (*callback) {
+			(*callback)(index, succeeded);
+		}
+		};
+
+	JobSystem& jobSystem = io.GetJobSystem();
+	std::vector<IoRequest> requests;
+
+	{
+		std::shared_lock<std::shared_mutex> lock(table.Mutex);
+		for (size_t i = 0; i < paths.size(); i++) {
+			const PackArchive* archive = nullptr;
+			const PackEntry* entry = nullptr;
+			for (auto it = table.Archives.rbegin(); it != table.Archives.rend() && !entry; ++it) {
+				archive = it->get();
+				entry = archive->Find(paths[i]);
+			}
+
+			FileData& file = files[i];
+			if (entry && !PackArchive::IsCompressed(*entry)) {
+				table.ArchiveReads.fetch_add(1, std::memory_order_relaxed);
+				file.m_Data = archive->GetStoredData(*entry);
+				file.m_Size = static_cast<size_t>(entry->Size);
+				jobSystem.Run([complete, i]() { complete(i, true); }, &counter);
+				continue;
+			}
+			if (entry) {
+				table.ArchiveReads.fetch_add(1, std::memory_order_relaxed);
+				jobSystem.Run([complete, archive, entry, &file, &path = paths[i], i]() {
+					if (!archive->Extract(*entry, file.m_Storage)) {
+						std::cout << "[VFS] [ERROR] : Corrupt entry " << path << " in " << archive->GetPath() << std::endl;
+						file.m_Storage.clear();
+						complete(i, false);
+						return;
+					}
+					file.m_Data = file.m_Storage.data();
+					file.m_Size = file.m_Storage.size();
+					complete(i, true);
+					}, &counter);
+				continue;
+			}
+
+			IoRequest request;
+			request.Path = paths[i];
+			request.WholeFile = &file.m_Storage;
+			request.Priority = priority;
+			request.OnComplete = [complete, &file, i](const IoResult& result) {
+				file.m_Data = file.m_Storage.data();
+				file.m_Size = file.m_Storage.size();
+				complete(i, result.Succeeded());
+				};
+			requests.push_back(std::move(request));
+		}
+	}
+
+	io.Submit(std::move(requests), counter);
+}
+
+uint64_t VirtualFileSystem::GetReadCount()
+{
+	return GetMountTable().Reads.load(std::memory_order_relaxed);
+}
+
+uint64_t VirtualFileSystem::GetArchiveReadCount()
+{
+	return GetMountTable().ArchiveReads.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Onion::Core {
+
+	class AsyncFileIO;
+	class JobCounter;
+	enum class IoPriority : uint8_t;
+
+	// Contents of a file read through the VirtualFileSystem: either a view into a mapped archive
+	// (entries stored uncompressed), or bytes it owns. Views stay valid until the archive is unmounted.
+	class FileData {
+	public:
+		const uint8_t* GetData() const {
+			return m_Data;
+		}
+		size_t GetSize() const {
+			return m_Size;
+		}
+		std::string_view GetText() const {
+			return std::string_view(reinterpret_cast<const char*>(m_Data), m_Size);
+		}
+		// True when the bytes are read in place from an archive, without a copy
+		bool IsMapped() const {
+			return m_Data != nullptr && m_Storage.empty();
+		}
+
+	private:
+		friend class VirtualFileSystem;
+
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+		std::vector<uint8_t> m_Storage;
+	};
+
+	// Single entry point for reading assets. Paths are looked up in the mounted .onionpak archives,
+	// the last mounted first, then on disk, so loose files keep working while developing.
+	// Mount and Unmount before or after the loads: lookups take a shared lock, mounting an exclusive one.
+	class VirtualFileSystem {
+	public:
+		// False (and an error logged) when the archive cannot be opened
+		static bool Mount(const std::string& archivePath);
+		static void UnmountAll();
+		static size_t GetMountCount();
+
+		static bool Exists(const std::string& path);
+
+		// False when the file is missing or a compressed entry is corrupt
+		static bool ReadFile(const std::string& path, FileData& file);
+		static bool ReadText(const std::string& path, std::string& text);
+
+		// Issues every read at once. Archive entries complete right away, compressed ones are decompressed in a job,
+		// loose files are read through 'io'. onRead(index, succeeded) then runs as a job as soon as files[index] is filled,
+		// so decoding overlaps with the reads still in flight. 'counter' covers the reads and the callbacks,
+		// 'files' is resized to paths.size(), it and 'paths' must stay untouched until it is done.
+		static void ReadFilesAsync(AsyncFileIO& io, const std::vector<std::string>& paths, std::vector<FileData>& files,
+			JobCounter& counter, std::function<void(size_t, bool)> onRead, IoPriority priority);
+
+		// Files read through ReadFile since startup, and how many of them came from an archive
+		static uint64_t GetReadCount();
+		static uint64_t GetArchiveReadCount();
+	};
+
+} // namespace Onion::Core
@@ -2,9 +2,12 @@
 
 #include <stdexcept>
 
+#include "../../core/profiler/profiler.hpp"
+
 using namespace Onion::Rendering;
 
 Texture* AssetManager::LoadTexture(const std::string& filePath) {
+	ONION_PROFILE_SCOPE("AssetManager::LoadTexture");
 	// Check if texture is already loaded
 	auto it = m_Textures.find(filePath);
 	if (it != m_Textures.end()) {
@@ -22,6 +25,16 @@ Texture* AssetManager::LoadTexture(const std::string& filePath) {
 	return texturePtr;
 }
 
+Texture* AssetManager::AddTexture(const std::string& filePath, std::unique_ptr<Texture> texture) {
+	texture->Bind();
+	if (!texture->HasBeenLoaded()) {
+		throw std::runtime_error("Failed to load texture: " + filePath);
+	}
+	Texture* texturePtr = texture.get();
+	m_Textures[filePath] = std::move(texture);
+	return texturePtr;
+}
+
 Material* AssetManager::CreateMaterial(const std::string& name) {
 
 	// Check if material already exists
@@ -16,6 +16,8 @@ namespace Onion::Rendering {
 		~AssetManager() = default;
 
 		Texture* LoadTexture(const std::string& filePath);
+		// Takes a texture decoded elsewhere (on a worker) and uploads it, on the GL thread. Throws if it failed to load.
+		Texture* AddTexture(const std::string& filePath, std::unique_ptr<Texture> texture);
 
 		Material* CreateMaterial(const std::string& name);
 
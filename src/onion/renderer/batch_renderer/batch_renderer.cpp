@@ -0,0 +1,255 @@
+#include "batch_renderer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "../camera/camera.hpp"
+#include "../image_writer/image_writer.hpp"
+#include "../../core/profiler/profiler.hpp"
+
+using namespace Onion::Rendering;
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	double ElapsedMs(Clock::time_point start, Clock::time_point end) {
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+BatchRenderer::BatchRenderer(Onion::Core::JobSystem& jobSystem)
+	: m_JobSystem(jobSystem)
+{
+}
+
+BatchRenderer::~BatchRenderer()
+{
+	if (HasBeenInitialized()) {
+		std::cout << "[BATCH RENDERER] [WARNING] : Batch renderer not deleted before destruction. There is a memory leak." << std::endl;
+	}
+}
+
+void BatchRenderer::Init(const Settings& settings)
+{
+	if (HasBeenInitialized()) {
+		Delete();
+	}
+
+	m_Settings = settings;
+	m_Settings.InFlightImages = std::max(1, m_Settings.InFlightImages);
+	m_Settings.MaxPendingEncodes = std::max(1, m_Settings.MaxPendingEncodes);
+
+	m_ShaderModel = Shader("assets/shaders/model.vert", "assets/shaders/model.frag");
+	MaterialTable::SetupShader(m_ShaderModel);
+	// No shadow pass: with no cascade every fragment is lit. The sampler still needs its own unit.
+	m_ShaderModel.setInt("uShadowMap", static_cast<int>(MaterialSlot::Count));
+	m_ShaderModel.setInt("uCascadeCount", 0);
+	m_Materials.Create();
+
+	// Framebuffers are sized by the first job using them
+	for (int i = 0; i < m_Settings.InFlightImages; i++) {
+		auto slot = std::make_unique<Slot>();
+		glGenBuffers(1, &slot->Pbo);
+		m_Slots.push_back(std::move(slot));
+	}
+}
+
+void BatchRenderer::Delete()
+{
+	m_JobSystem.Wait(m_EncodeCounter);
+
+	for (auto& slot : m_Slots) {
+		if (slot->Fence) {
+			glDeleteSync(slot->Fence);
+		}
+		glDeleteBuffers(1, &slot->Pbo);
+		slot->Target.Delete();
+	}
+	m_Slots.clear();
+
+	m_Skybox.Delete();
+	m_Materials.Delete();
+	m_ShaderModel.Delete();
+}
+
+BatchRenderer::Stats BatchRenderer::Render(const std::vector<BatchJob>& jobs)
+{
+	ONION_PROFILE_SCOPE("BatchRenderer::Render");
+
+	Stats stats;
+	if (!HasBeenInitialized() || jobs.empty()) {
+		return stats;
+	}
+
+	m_ImagesWritten = 0;
+	m_ImagesFailed = 0;
+	m_EncodeNs = 0;
+	m_ReadbackWaitMs = 0.0;
+	double renderMs = 0.0;
+
+	GLint oldFramebuffer = 0;
+	GLint oldViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &oldFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, oldViewport);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	const auto start = Clock::now();
+
+	for (size_t i = 0; i < jobs.size(); i++) {
+		// Round robin: the slot was used InFlightImages jobs ago, its readback had that long to complete
+		Slot& slot = *m_Slots[i % m_Slots.size()];
+		if (slot.Job) {
+			CompleteReadback(slot);
+		}
+
+		const auto renderStart = Clock::now();
+		RenderJob(jobs[i], slot);
+		renderMs += ElapsedMs(renderStart, Clock::now());
+	}
+
+	// Drain in submission order
+	for (size_t i = 0; i < m_Slots.size(); i++) {
+		Slot& slot = *m_Slots[(jobs.size() + i) % m_Slots.size()];
+		if (slot.Job) {
+			CompleteReadback(slot);
+		}
+	}
+	m_JobSystem.Wait(m_EncodeCounter);
+
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(oldFramebuffer));
+	glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
+
+	const double count = static_cast<double>(jobs.size());
+	stats.ImagesWritten = m_ImagesWritten.load();
+	stats.ImagesFailed = m_ImagesFailed.load();
+	stats.Seconds = seconds;
+	stats.ImagesPerSecond = seconds > 0.0 ? static_cast<double>(stats.ImagesWritten) / seconds : 0.0;
+	stats.RenderMs = renderMs / count;
+	stats.ReadbackWaitMs = m_ReadbackWaitMs / count;
+	stats.EncodeMs = static_cast<double>(m_EncodeNs.load()) / 1e6 / count;
+	return stats;
+}
+
+void BatchRenderer::RenderJob(const BatchJob& job, Slot& slot)
+{
+	ONION_PROFILE_SCOPE("BatchRenderer::RenderJob");
+
+	if (slot.Target.GetWidth() != job.Width || slot.Target.GetHeight() != job.Height || !slot.Target.HasBeenCreated()) {
+		slot.Target.Create(job.Width, job.Height);
+	}
+
+	Camera camera(job.CameraPosition, job.Width, job.Height);
+	camera.SetAspectRatio(static_cast<float>(job.Width) / static_cast<float>(job.Height));
+	camera.SetFovY(job.CameraFovY);
+	camera.SetFront(glm::normalize(job.CameraTarget - job.CameraPosition));
+
+	const glm::mat4 view = camera.GetViewMatrix();
+	const glm::mat4 projection = camera.GetProjectionMatrix();
+
+	slot.Target.Bind();
+	glClearColor(m_Settings.ClearColor.x, m_Settings.ClearColor.y, m_Settings.ClearColor.z, m_Settings.ClearColor.w);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	if (m_Settings.Skybox) {
+		m_Skybox.Render(view, projection);
+	}
+
+	m_ShaderModel.Use();
+	m_ShaderModel.setMat4("uView", view);
+	m_ShaderModel.setMat4("uProj", projection);
+	m_ShaderModel.setMat4("uViewProj", projection * view);
+	m_ShaderModel.setVec3("uLightDir", glm::normalize(m_Settings.Light.Direction));
+	m_ShaderModel.setVec3("uLightColor", m_Settings.Light.Color);
+	m_ShaderModel.setVec3("uAmbient", m_Settings.Light.Ambient);
+	m_ShaderModel.setVec3("uCameraPos", camera.GetPosition());
+	m_ShaderModel.setFloat("uSpecularStrength", m_Settings.Light.SpecularStrength);
+	m_ShaderModel.setMat4("uModel", job.ModelMatrix);
+
+	// One material per job
+	m_Materials.Begin();
+	const uint32_t block = m_Materials.Add(*job.SourceModel->GetMaterial());
+	m_Materials.Upload();
+	m_Materials.Bind(block);
+
+	job.SourceModel->Draw(m_ShaderModel);
+
+	// Asynchronous copy into the PBO, glReadPixels returns right away with a pack buffer bound
+	const size_t size = static_cast<size_t>(job.Width) * static_cast<size_t>(job.Height) * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Pbo);
+	if (slot.PboSize != size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+		slot.PboSize = size;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, slot.Target.GetId());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, job.Width, job.Height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.Job = &job;
+}
+
+void BatchRenderer::CompleteReadback(Slot& slot)
+{
+	ONION_PROFILE_SCOPE("BatchRenderer::CompleteReadback");
+
+	// Usually signaled already. Otherwise flush, so the fence can signal at all, and block.
+	const auto waitStart = Clock::now();
+	GLenum result = glClientWaitSync(slot.Fence, 0, 0);
+	while (result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100'000'000);
+	}
+	m_ReadbackWaitMs += ElapsedMs(waitStart, Clock::now());
+	glDeleteSync(slot.Fence);
+	slot.Fence = nullptr;
+
+	const BatchJob& job = *slot.Job;
+	slot.Job = nullptr;
+
+	auto task = std::make_unique<EncodeTask>();
+	task->OutputPath = job.OutputPath;
+	task->Width = job.Width;
+	task->Height = job.Height;
+	task->Pixels.resize(slot.PboSize);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Pbo);
+	const void* mapped = result == GL_WAIT_FAILED ? nullptr : glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(slot.PboSize), GL_MAP_READ_BIT);
+	if (mapped) {
+		std::memcpy(task->Pixels.data(), mapped, slot.PboSize);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (!mapped) {
+		std::cout << "[BATCH RENDERER] [ERROR] : Readback failed for " << job.OutputPath << std::endl;
+		m_ImagesFailed++;
+		return;
+	}
+
+	// Bounded queue: with too many images waiting, help the workers before rendering more
+	if (m_EncodeCounter.GetPending() >= m_Settings.MaxPendingEncodes) {
+		m_JobSystem.Wait(m_EncodeCounter);
+	}
+
+	m_JobSystem.Run([this, task = std::move(task)]() {
+		const auto encodeStart = Clock::now();
+		const bool written = WritePng(task->OutputPath, task->Width, task->Height, task->Pixels.data());
+		m_EncodeNs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - encodeStart).count());
+		if (written) {
+			m_ImagesWritten++;
+		}
+		else {
+			m_ImagesFailed++;
+		}
+		}, &m_EncodeCounter);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../framebuffer/framebuffer.hpp"
+#include "../material_table/material_table.hpp"
+#include "../model/model.hpp"
+#include "../shader/shader.hpp"
+#include "../skybox/skybox.hpp"
+#include "../structs/frame_snapshot.hpp"
+
+#include "../../core/job_system/job_system.hpp"
+
+namespace Onion::Rendering {
+
+	// One image to produce
+	struct BatchJob {
+		const Model* SourceModel = nullptr; // Must have a material
+		glm::mat4 ModelMatrix{ 1.0f };
+
+		glm::vec3 CameraPosition{ 0.0f, 0.0f, -3.0f };
+		glm::vec3 CameraTarget{ 0.0f };
+		float CameraFovY = 45.0f;
+
+		int Width = 256;
+		int Height = 256;
+		std::string OutputPath; // PNG
+	};
+
+	// Renders lists of jobs to image files, for thumbnails and turntables.
+	// Each job goes to a framebuffer of a small pool, its pixels are copied to a pixel buffer object
+	// and fenced: the next jobs are rendered while the copy completes, the CPU only maps a buffer once
+	// its fence signaled. PNG encoding runs on the job system workers.
+	// Must be used on a thread with a current OpenGL context (OffscreenContext, headless renderer).
+	class BatchRenderer {
+	public:
+		struct Settings {
+			int InFlightImages = 2;		// Framebuffer + PBO pairs, 2 is double buffering
+			int MaxPendingEncodes = 16;	// Images waiting for a worker, bounds the memory used
+			bool Skybox = false;
+			glm::vec4 ClearColor{ 0.1f, 0.1f, 0.12f, 1.0f };
+			DirectionalLight Light;
+		};
+
+		struct Stats {
+			uint64_t ImagesWritten = 0;
+			uint64_t ImagesFailed = 0;
+			double Seconds = 0.0;
+			double ImagesPerSecond = 0.0;
+			double RenderMs = 0.0;		// Average CPU time to submit one image
+			double ReadbackWaitMs = 0.0;	// Average time blocked on a readback fence
+			double EncodeMs = 0.0;		// Average PNG encoding time, on the workers
+		};
+
+	public:
+		explicit BatchRenderer(Onion::Core::JobSystem& jobSystem);
+		~BatchRenderer();
+
+		BatchRenderer(const BatchRenderer&) = delete;
+		BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+		// Compiles the shaders and allocates the pool. Throws std::runtime_error on failure.
+		void Init(const Settings& settings);
+		void Delete();
+		bool HasBeenInitialized() const {
+			return !m_Slots.empty();
+		}
+
+		// Renders every job and returns once all the images are written
+		Stats Render(const std::vector<BatchJob>& jobs);
+
+	private:
+		struct Slot {
+			Framebuffer Target;
+			GLuint Pbo = 0;
+			size_t PboSize = 0;
+			GLsync Fence = nullptr;
+			const BatchJob* Job = nullptr; // Job whose pixels are in flight, nullptr when free
+		};
+
+		struct EncodeTask {
+			std::string OutputPath;
+			int Width = 0;
+			int Height = 0;
+			std::vector<uint8_t> Pixels;
+		};
+
+		void RenderJob(const BatchJob& job, Slot& slot);
+		// Waits for the slot's readback, then hands its pixels to a worker
+		void CompleteReadback(Slot& slot);
+
+	private:
+		Onion::Core::JobSystem& m_JobSystem;
+		Settings m_Settings;
+
+		std::vector<std::unique_ptr<Slot>> m_Slots;
+		Shader m_ShaderModel;
+		MaterialTable m_Materials;
+		Skybox m_Skybox;
+
+		Onion::Core::JobCounter m_EncodeCounter;
+		std::atomic<uint64_t> m_ImagesWritten{ 0 };
+		std::atomic<uint64_t> m_ImagesFailed{ 0 };
+		std::atomic<uint64_t> m_EncodeNs{ 0 };
+		double m_ReadbackWaitMs = 0.0;
+	};
+
+} // namespace Onion::Rendering
@@ -100,5 +100,13 @@ namespace Onion::Rendering {
 		float GetFovY() const {
 			return FovY;
 		}
+
+		float GetNearPlane() const {
+			return NearPlane;
+		}
+
+		float GetFarPlane() const {
+			return FarPlane;
+		}
 	};
 } // namespace Onion::Rendering
@@ -0,0 +1,135 @@
+#include "frame_pacer.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <thread>
+
+using namespace Onion::Rendering;
+
+const char* Onion::Rendering::ToString(PresentMode mode)
+{
+	switch (mode) {
+	case PresentMode::VSync:
+		return "VSync";
+	case PresentMode::Uncapped:
+		return "Uncapped";
+	case PresentMode::Limited:
+		return "Limited";
+	case PresentMode::LowLatency:
+		return "Low latency";
+	}
+	return "Unknown";
+}
+
+void FramePacer::SetSettings(const Settings& settings)
+{
+	if (settings.Mode != m_Settings.Mode) {
+		m_SwapIntervalDirty = true;
+		m_NextDeadline = Clock::time_point{};
+	}
+
+	m_Settings = settings;
+	m_Settings.TargetFps = std::max(m_Settings.TargetFps, 1.0);
+	m_Settings.SpinMs = std::max(m_Settings.SpinMs, 0.0);
+}
+
+const FramePacer::Settings& FramePacer::GetSettings() const
+{
+	return m_Settings;
+}
+
+const FramePacer::Stats& FramePacer::GetStats() const
+{
+	return m_Stats;
+}
+
+void FramePacer::BeginFrame()
+{
+	if (m_SwapIntervalDirty) {
+		const bool vsync = m_Settings.Mode == PresentMode::VSync || m_Settings.Mode == PresentMode::LowLatency;
+		glfwSwapInterval(vsync ? 1 : 0);
+		m_SwapIntervalDirty = false;
+	}
+
+	const Clock::time_point start = Clock::now();
+	m_Stats.FenceWaitMs = 0.0;
+
+	switch (m_Settings.Mode) {
+	case PresentMode::Limited:
+		WaitForDeadline();
+		break;
+	case PresentMode::LowLatency:
+		WaitForPreviousFrame();
+		break;
+	default:
+		break;
+	}
+
+	m_Stats.WaitMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void FramePacer::EndFrame()
+{
+	if (m_Settings.Mode != PresentMode::LowLatency) {
+		return;
+	}
+
+	// Signaled once the GPU is done with this frame, including the swap
+	if (m_FrameFence) {
+		glDeleteSync(m_FrameFence);
+	}
+	m_FrameFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FramePacer::Delete()
+{
+	if (m_FrameFence) {
+		glDeleteSync(m_FrameFence);
+		m_FrameFence = nullptr;
+	}
+}
+
+void FramePacer::WaitForDeadline()
+{
+	const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_Settings.TargetFps));
+	const auto spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(m_Settings.SpinMs));
+
+	Clock::time_point now = Clock::now();
+	if (m_NextDeadline == Clock::time_point{} || now - m_NextDeadline > period) {
+		// First frame, or more than a frame late: restart the schedule instead of rushing to catch up
+		m_NextDeadline = now + period;
+		return;
+	}
+
+	// Coarse sleep, then spin for the last bit: OS sleeps routinely overshoot by a millisecond or more
+	if (m_NextDeadline - now > spin) {
+		std::this_thread::sleep_until(m_NextDeadline - spin);
+	}
+	while (Clock::now() < m_NextDeadline) {
+		std::this_thread::yield();
+	}
+
+	m_NextDeadline += period;
+}
+
+void FramePacer::WaitForPreviousFrame()
+{
+	if (!m_FrameFence) {
+		return;
+	}
+
+	const Clock::time_point start = Clock::now();
+
+	// The flush bit makes sure the fence is submitted, otherwise the wait could never end
+	constexpr GLuint64 TIMEOUT_NS = 100'000'000;
+	GLenum result = glClientWaitSync(m_FrameFence, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT_NS);
+	while (result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(m_FrameFence, 0, TIMEOUT_NS);
+	}
+
+	glDeleteSync(m_FrameFence);
+	m_FrameFence = nullptr;
+
+	m_Stats.FenceWaitMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
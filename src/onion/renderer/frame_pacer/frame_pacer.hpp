@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+
+namespace Onion::Rendering {
+
+	enum class PresentMode {
+		VSync,		// Swap interval 1, the driver may queue a few frames
+		Uncapped,	// Swap interval 0, as fast as possible
+		Limited,	// Swap interval 0, CPU frame limiter (sleep then spin) at TargetFps
+		LowLatency	// Swap interval 1, at most one frame in flight (fences), inputs sampled just before the frame
+	};
+
+	const char* ToString(PresentMode mode);
+
+	// Controls when the render thread starts a frame. Must be used on the thread owning the GL context.
+	class FramePacer {
+	public:
+		struct Settings {
+			PresentMode Mode = PresentMode::VSync;
+			double TargetFps = 120.0;	// Limited mode only
+			double SpinMs = 1.5;		// Limited mode: the end of the wait is spun, sleeping is not precise enough
+		};
+
+		struct Stats {
+			double WaitMs = 0.0;		// Time spent throttling before the last frame
+			double FenceWaitMs = 0.0;	// Part of it waiting for the GPU (LowLatency)
+		};
+
+		FramePacer() = default;
+		~FramePacer() = default;
+
+		FramePacer(const FramePacer&) = delete;
+		FramePacer& operator=(const FramePacer&) = delete;
+
+		void SetSettings(const Settings& settings);
+		const Settings& GetSettings() const;
+
+		// Blocks until the next frame may start. Call before sampling inputs.
+		void BeginFrame();
+		// Call right after the buffer swap
+		void EndFrame();
+
+		void Delete();
+
+		const Stats& GetStats() const;
+
+		// Whether inputs must be sampled after BeginFrame, as late as possible
+		bool UsesLateInputSampling() const {
+			return m_Settings.Mode == PresentMode::LowLatency;
+		}
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		void WaitForDeadline();
+		void WaitForPreviousFrame();
+
+	private:
+		Settings m_Settings;
+		Stats m_Stats;
+
+		bool m_SwapIntervalDirty = true;
+		Clock::time_point m_NextDeadline{};
+
+		GLsync m_FrameFence = nullptr;
+	};
+
+} // namespace Onion::Rendering
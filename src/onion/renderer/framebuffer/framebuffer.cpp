@@ -0,0 +1,87 @@
+#include "framebuffer.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+using namespace Onion::Rendering;
+
+Framebuffer::~Framebuffer()
+{
+	if (m_Fbo != 0) {
+		std::cout << "[FRAMEBUFFER] [WARNING] : Framebuffer not deleted before destruction. There is a memory leak." << std::endl;
+	}
+}
+
+void Framebuffer::Create(int width, int height)
+{
+	if (HasBeenCreated()) {
+		Delete();
+	}
+
+	m_Width = width;
+	m_Height = height;
+
+	glGenTextures(1, &m_ColorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_ColorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_DepthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_DepthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_Fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_Fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ColorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthRenderbuffer);
+
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		Delete();
+		throw std::runtime_error("Framebuffer is incomplete");
+	}
+}
+
+void Framebuffer::Delete()
+{
+	if (m_Fbo != 0) {
+		glDeleteFramebuffers(1, &m_Fbo);
+		m_Fbo = 0;
+	}
+	if (m_ColorTexture != 0) {
+		glDeleteTextures(1, &m_ColorTexture);
+		m_ColorTexture = 0;
+	}
+	if (m_DepthRenderbuffer != 0) {
+		glDeleteRenderbuffers(1, &m_DepthRenderbuffer);
+		m_DepthRenderbuffer = 0;
+	}
+}
+
+void Framebuffer::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_Fbo);
+	glViewport(0, 0, m_Width, m_Height);
+}
+
+void Framebuffer::Unbind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::ReadPixels(std::vector<uint8_t>& pixels) const
+{
+	pixels.resize(static_cast<size_t>(m_Width) * static_cast<size_t>(m_Height) * 4);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_Fbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace Onion::Rendering {
+
+	// Offscreen render target: RGBA8 color texture and a depth renderbuffer.
+	// GL objects must be released with Delete on the thread owning the context.
+	class Framebuffer {
+	public:
+		Framebuffer() = default;
+		~Framebuffer();
+
+		Framebuffer(const Framebuffer&) = delete;
+		Framebuffer& operator=(const Framebuffer&) = delete;
+
+		// Throws std::runtime_error if the framebuffer is incomplete
+		void Create(int width, int height);
+		void Delete();
+		bool HasBeenCreated() const {
+			return m_Fbo != 0;
+		}
+
+		// Binds the framebuffer and sets the viewport to its size
+		void Bind() const;
+		static void Unbind();
+
+		// Blocking read of the color attachment, rows bottom to top. Resizes 'pixels' to width * height * 4.
+		void ReadPixels(std::vector<uint8_t>& pixels) const;
+
+		GLuint GetId() const {
+			return m_Fbo;
+		}
+		GLuint GetColorTexture() const {
+			return m_ColorTexture;
+		}
+		int GetWidth() const {
+			return m_Width;
+		}
+		int GetHeight() const {
+			return m_Height;
+		}
+
+	private:
+		GLuint m_Fbo = 0;
+		GLuint m_ColorTexture = 0;
+		GLuint m_DepthRenderbuffer = 0;
+		int m_Width = 0;
+		int m_Height = 0;
+	};
+
+} // namespace Onion::Rendering
@@ -0,0 +1,179 @@
+#include "gpu_profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace Onion::Rendering;
+
+void GpuProfiler::Delete()
+{
+	for (Pass& pass : m_Passes) {
+		glDeleteQueries(FRAME_LATENCY, pass.Queries.data());
+		pass.Queries.fill(0);
+		pass.QueryIssued.fill(false);
+	}
+	m_Passes.clear();
+	m_OpenPass = -1;
+}
+
+void GpuProfiler::BeginFrame()
+{
+	m_FrameSlot = (m_FrameSlot + 1) % FRAME_LATENCY;
+
+	// The slot about to be reused was issued FRAME_LATENCY frames ago
+	for (Pass& pass : m_Passes) {
+		pass.SeenThisFrame = false;
+
+		if (!pass.QueryIssued[m_FrameSlot]) {
+			continue;
+		}
+
+		GLint available = 0;
+		glGetQueryObjectiv(pass.Queries[m_FrameSlot], GL_QUERY_RESULT_AVAILABLE, &available);
+		pass.QueryIssued[m_FrameSlot] = false;
+		if (!available) {
+			// Still pending: drop the sample rather than stalling, the query gets reissued this frame
+			continue;
+		}
+
+		GLuint64 elapsedNs = 0;
+		glGetQueryObjectui64v(pass.Queries[m_FrameSlot], GL_QUERY_RESULT, &elapsedNs);
+		const float ms = static_cast<float>(static_cast<double>(elapsedNs) / 1e6);
+
+		AddSample(pass, ms);
+	}
+}
+
+void GpuProfiler::EndFrame()
+{
+	if (m_OpenPass >= 0) {
+		EndPass();
+	}
+}
+
+void GpuProfiler::BeginPass(const char* name)
+{
+	if (m_OpenPass >= 0) {
+		if (!m_WarnedNesting) {
+			std::cout << "[GPU PROFILER] [WARNING] : pass '" << name << "' started inside '" << m_Passes[static_cast<size_t>(m_OpenPass)].Name << "', ignored." << std::endl;
+			m_WarnedNesting = true;
+		}
+		return;
+	}
+
+	const int index = FindOrCreatePass(name);
+	Pass& pass = m_Passes[static_cast<size_t>(index)];
+	pass.SeenThisFrame = true;
+
+	glBeginQuery(GL_TIME_ELAPSED, pass.Queries[m_FrameSlot]);
+	m_OpenPass = index;
+}
+
+void GpuProfiler::EndPass()
+{
+	if (m_OpenPass < 0) {
+		return;
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_Passes[static_cast<size_t>(m_OpenPass)].QueryIssued[m_FrameSlot] = true;
+	m_OpenPass = -1;
+}
+
+void GpuProfiler::RecordPassTime(const char* name, float ms)
+{
+	Pass& pass = m_Passes[static_cast<size_t>(FindOrCreatePass(name))];
+	pass.SeenThisFrame = true;
+	AddSample(pass, ms);
+}
+
+int GpuProfiler::FindOrCreatePass(const char* name)
+{
+	// A handful of passes, a linear scan is cheaper than hashing the name
+	for (size_t i = 0; i < m_Passes.size(); i++) {
+		if (std::strcmp(m_Passes[i].Name.c_str(), name) == 0) {
+			return static_cast<int>(i);
+		}
+	}
+
+	Pass pass;
+	pass.Name = name;
+	pass.Stats.Name = name;
+	glGenQueries(FRAME_LATENCY, pass.Queries.data());
+
+	std::lock_guard<std::mutex> lock(m_MutexStats);
+	m_Passes.push_back(std::move(pass));
+	return static_cast<int>(m_Passes.size() - 1);
+}
+
+void GpuProfiler::AddSample(Pass& pass, float ms)
+{
+	pass.History[static_cast<size_t>(pass.HistoryNext)] = ms;
+	pass.HistoryNext = (pass.HistoryNext + 1) % HISTORY_SIZE;
+	pass.HistoryCount = std::min(pass.HistoryCount + 1, HISTORY_SIZE);
+
+	std::lock_guard<std::mutex> lock(m_MutexStats);
+	GpuPassStats& stats = pass.Stats;
+	stats.MinMs = stats.SampleCount == 0 ? ms : std::min(stats.MinMs, ms);
+	stats.MaxMs = stats.SampleCount == 0 ? ms : std::max(stats.MaxMs, ms);
+	stats.SampleCount++;
+	stats.LastMs = ms;
+	pass.TotalMs += ms;
+	stats.AverageMs = static_cast<float>(pass.TotalMs / static_cast<double>(stats.SampleCount));
+}
+
+int GpuProfiler::GetPassCount() const
+{
+	return static_cast<int>(m_Passes.size());
+}
+
+const std::string& GpuProfiler::GetPassName(int pass) const
+{
+	return m_Passes[static_cast<size_t>(pass)].Name;
+}
+
+const float* GpuProfiler::GetPassHistory(int pass, int& count, int& offset) const
+{
+	const Pass& p = m_Passes[static_cast<size_t>(pass)];
+	count = p.HistoryCount;
+	// Once the ring is full, the oldest sample is the next one to be overwritten
+	offset = p.HistoryCount == HISTORY_SIZE ? p.HistoryNext : 0;
+	return p.History.data();
+}
+
+float GpuProfiler::GetPassLastMs(int pass) const
+{
+	return m_Passes[static_cast<size_t>(pass)].Stats.LastMs;
+}
+
+float GpuProfiler::GetFrameGpuMs() const
+{
+	float total = 0.0f;
+	for (const Pass& pass : m_Passes) {
+		total += pass.Stats.LastMs;
+	}
+	return total;
+}
+
+std::vector<GpuPassStats> GpuProfiler::GetPassStats() const
+{
+	std::lock_guard<std::mutex> lock(m_MutexStats);
+
+	std::vector<GpuPassStats> stats;
+	stats.reserve(m_Passes.size());
+	for (const Pass& pass : m_Passes) {
+		stats.push_back(pass.Stats);
+	}
+	return stats;
+}
+
+void GpuProfiler::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_MutexStats);
+	for (Pass& pass : m_Passes) {
+		pass.Stats = GpuPassStats{};
+		pass.Stats.Name = pass.Name;
+		pass.TotalMs = 0.0;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Onion::Rendering {
+
+	struct GpuPassStats {
+		std::string Name;
+		float LastMs = 0.0f;
+		// Since the last ResetStats
+		float AverageMs = 0.0f;
+		float MinMs = 0.0f;
+		float MaxMs = 0.0f;
+		uint64_t SampleCount = 0;
+	};
+
+	// GPU time per render pass, measured with GL_TIME_ELAPSED queries.
+	// Each pass owns a ring of queries FRAME_LATENCY frames deep: results are read back
+	// that many frames later, when they are ready, so the CPU never waits for the GPU.
+	// GL_TIME_ELAPSED queries cannot nest, passes must not overlap.
+	class GpuProfiler {
+	public:
+		static constexpr int FRAME_LATENCY = 4;
+		static constexpr int HISTORY_SIZE = 240;
+
+		GpuProfiler() = default;
+		~GpuProfiler() = default;
+
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		void Delete();
+
+		// Collects the results of the frame issued FRAME_LATENCY frames ago
+		void BeginFrame();
+		void EndFrame();
+
+		void BeginPass(const char* name);
+		void EndPass();
+
+		// For passes timed by their own queries (shadow cascades)
+		void RecordPassTime(const char* name, float ms);
+
+		// ------------ RESULTS (render thread) ------------
+
+		int GetPassCount() const;
+		const std::string& GetPassName(int pass) const;
+		// Oldest to newest
+		const float* GetPassHistory(int pass, int& count, int& offset) const;
+		float GetPassLastMs(int pass) const;
+
+		// Sum of the latest sample of every pass, in ms
+		float GetFrameGpuMs() const;
+
+		// ------------ RESULTS (any thread, for benchmarks) ------------
+
+		std::vector<GpuPassStats> GetPassStats() const;
+		void ResetStats();
+
+	private:
+		struct Pass {
+			std::string Name;
+			std::array<GLuint, FRAME_LATENCY> Queries{};
+			std::array<bool, FRAME_LATENCY> QueryIssued{};
+			bool SeenThisFrame = false;
+
+			std::array<float, HISTORY_SIZE> History{};
+			int HistoryNext = 0;
+			int HistoryCount = 0;
+
+			GpuPassStats Stats;
+			double TotalMs = 0.0;
+		};
+
+		int FindOrCreatePass(const char* name);
+		void AddSample(Pass& pass, float ms);
+
+	private:
+		std::vector<Pass> m_Passes;
+		int m_FrameSlot = 0;
+		int m_OpenPass = -1;
+		bool m_WarnedNesting = false;
+
+		// Guards the Stats of the passes, read by benchmarks from other threads
+		mutable std::mutex m_MutexStats;
+	};
+
+	// Times the enclosing scope as a GPU pass
+	class ScopedGpuPass {
+	public:
+		ScopedGpuPass(GpuProfiler& profiler, const char* name) : m_Profiler(profiler) {
+			m_Profiler.BeginPass(name);
+		}
+		~ScopedGpuPass() {
+			m_Profiler.EndPass();
+		}
+
+		ScopedGpuPass(const ScopedGpuPass&) = delete;
+		ScopedGpuPass& operator=(const ScopedGpuPass&) = delete;
+
+	private:
+		GpuProfiler& m_Profiler;
+	};
+
+} // namespace Onion::Rendering
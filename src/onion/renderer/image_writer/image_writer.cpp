@@ -0,0 +1,25 @@
+#include "image_writer.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <iostream>
+
+#include "../../core/profiler/profiler.hpp"
+
+bool Onion::Rendering::WritePng(const std::string& filePath, int width, int height, const uint8_t* rgba, bool bottomUp)
+{
+	ONION_PROFILE_SCOPE("WritePng");
+
+	const int stride = width * 4;
+
+	// stbi_flip_vertically_on_write is a global, a negative stride flips without touching shared state
+	const uint8_t* first = bottomUp ? rgba + static_cast<size_t>(stride) * static_cast<size_t>(height - 1) : rgba;
+	const int rowStride = bottomUp ? -stride : stride;
+
+	if (!stbi_write_png(filePath.c_str(), width, height, 4, first, rowStride)) {
+		std::cout << "[IMAGE WRITER] [ERROR] : Failed to write " << filePath << std::endl;
+		return false;
+	}
+	return true;
+}
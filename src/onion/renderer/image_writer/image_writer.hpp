@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Onion::Rendering {
+
+	// Encodes 8-bit RGBA pixels to a PNG file. Thread-safe, can run on worker threads.
+	// bottomUp: rows are stored bottom to top, as glReadPixels returns them.
+	bool WritePng(const std::string& filePath, int width, int height, const uint8_t* rgba, bool bottomUp = true);
+
+} // namespace Onion::Rendering
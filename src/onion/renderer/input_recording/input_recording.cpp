@@ -0,0 +1,255 @@
+#include "input_recording.hpp"
+
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Onion::Controls;
+
+// Values are written as raw fixed-width fields: recordings are portable between little-endian machines
+static_assert(std::endian::native == std::endian::little, "Input recordings are little-endian");
+
+namespace {
+	constexpr char MAGIC[8] = { 'O', 'N', 'I', 'O', 'N', 'R', 'E', 'C' };
+	constexpr uint32_t VERSION = 1;
+
+	// What follows the fixed part of a frame
+	enum FrameFlags : uint8_t {
+		NEW_INPUTS = 1 << 0,	// Time, the inputs were polled again
+		FRAMEBUFFER = 1 << 1,	// Resized, Width, Height
+		MOUSE = 1 << 2,			// Button and flag bits, then offsets
+		KEYS = 1 << 3,			// Pressed and double pressed masks, one bit per input ID
+	};
+
+	enum MouseBits : uint8_t {
+		CAPTURE_ENABLED = 1 << 0,
+		MOVEMENT_CHANGED = 1 << 1,
+		SCROLL_CHANGED = 1 << 2,
+		LEFT_PRESSED = 1 << 3,
+		RIGHT_PRESSED = 1 << 4,
+	};
+
+	template<typename T>
+	void WriteValue(std::ofstream& file, T value) {
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	bool ReadValue(std::ifstream& file, T& value) {
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	void GetKeyMasks(const InputsSnapshot& inputs, uint64_t& pressed, uint64_t& doublePressed) {
+		static_assert(MAX_INPUTS <= 64, "Key states are recorded as 64 bit masks");
+		pressed = 0;
+		doublePressed = 0;
+		for (size_t i = 0; i < inputs.KeysStates.size(); i++) {
+			pressed |= static_cast<uint64_t>(inputs.KeysStates[i].IsPressed) << i;
+			doublePressed |= static_cast<uint64_t>(inputs.KeysStates[i].IsDoublePressed) << i;
+		}
+	}
+
+	bool SameFramebuffer(const FramebufferState& a, const FramebufferState& b) {
+		return a.Resized == b.Resized && a.Width == b.Width && a.Height == b.Height;
+	}
+
+	bool SameMouse(const MouseState& a, const MouseState& b) {
+		return a.CaptureEnabled == b.CaptureEnabled
+			&& a.MovementOffsetChanged == b.MovementOffsetChanged && a.Xoffset == b.Xoffset && a.Yoffset == b.Yoffset
+			&& a.ScrollOffsetChanged == b.ScrollOffsetChanged && a.ScrollXoffset == b.ScrollXoffset && a.ScrollYoffset == b.ScrollYoffset
+			&& a.LeftButtonPressed == b.LeftButtonPressed && a.RightButtonPressed == b.RightButtonPressed;
+	}
+}
+
+// ------------ RECORDER ------------
+
+InputRecorder::~InputRecorder()
+{
+	Close();
+}
+
+void InputRecorder::Open(const std::string& path)
+{
+	Close();
+
+	m_File.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_File) {
+		throw std::runtime_error("Cannot create input recording: " + path);
+	}
+
+	m_File.write(MAGIC, sizeof(MAGIC));
+	WriteValue(m_File, VERSION);
+	WriteValue(m_File, static_cast<uint32_t>(MAX_INPUTS));
+
+	m_Previous = InputsSnapshot();
+	m_FrameCount = 0;
+}
+
+void InputRecorder::Write(const RecordedFrame& frame)
+{
+	if (!m_File.is_open()) {
+		return;
+	}
+
+	const InputsSnapshot& inputs = frame.Inputs;
+
+	uint64_t pressed = 0;
+	uint64_t doublePressed = 0;
+	GetKeyMasks(inputs, pressed, doublePressed);
+	uint64_t previousPressed = 0;
+	uint64_t previousDoublePressed = 0;
+	GetKeyMasks(m_Previous, previousPressed, previousDoublePressed);
+
+	uint8_t flags = 0;
+	if (inputs.Sequence != m_Previous.Sequence) {
+		flags |= NEW_INPUTS;
+		if (!SameFramebuffer(inputs.Framebuffer, m_Previous.Framebuffer)) {
+			flags |= FRAMEBUFFER;
+		}
+		if (!SameMouse(inputs.Mouse, m_Previous.Mouse)) {
+			flags |= MOUSE;
+		}
+		if (pressed != previousPressed || doublePressed != previousDoublePressed) {
+			flags |= KEYS;
+		}
+	}
+
+	WriteValue(m_File, frame.DeltaTime);
+	WriteValue(m_File, frame.StateHash);
+	WriteValue(m_File, flags);
+
+	if (flags & NEW_INPUTS) {
+		WriteValue(m_File, inputs.Time);
+	}
+	if (flags & FRAMEBUFFER) {
+		WriteValue(m_File, static_cast<uint8_t>(inputs.Framebuffer.Resized));
+		WriteValue(m_File, static_cast<int32_t>(inputs.Framebuffer.Width));
+		WriteValue(m_File, static_cast<int32_t>(inputs.Framebuffer.Height));
+	}
+	if (flags & MOUSE) {
+		const MouseState& mouse = inputs.Mouse;
+		uint8_t bits = 0;
+		bits |= mouse.CaptureEnabled ? CAPTURE_ENABLED : 0;
+		bits |= mouse.MovementOffsetChanged ? MOVEMENT_CHANGED : 0;
+		bits |= mouse.ScrollOffsetChanged ? SCROLL_CHANGED : 0;
+		bits |= mouse.LeftButtonPressed ? LEFT_PRESSED : 0;
+		bits |= mouse.RightButtonPressed ? RIGHT_PRESSED : 0;
+		WriteValue(m_File, bits);
+		WriteValue(m_File, mouse.Xoffset);
+		WriteValue(m_File, mouse.Yoffset);
+		WriteValue(m_File, mouse.ScrollXoffset);
+		WriteValue(m_File, mouse.ScrollYoffset);
+	}
+	if (flags & KEYS) {
+		WriteValue(m_File, pressed);
+		WriteValue(m_File, doublePressed);
+	}
+
+	m_Previous = inputs;
+	m_FrameCount++;
+}
+
+void InputRecorder::Close()
+{
+	if (!m_File.is_open()) {
+		return;
+	}
+
+	m_File.close();
+	if (m_File.fail()) {
+		std::cout << "[INPUT RECORDING] [ERROR] : Failed to write the recording." << std::endl;
+	}
+}
+
+// ------------ PLAYER ------------
+
+void InputPlayer::Open(const std::string& path)
+{
+	Close();
+
+	m_File.open(path, std::ios::binary);
+	if (!m_File) {
+		throw std::runtime_error("Cannot open input recording: " + path);
+	}
+
+	char magic[sizeof(MAGIC)] = {};
+	uint32_t version = 0;
+	uint32_t maxInputs = 0;
+	m_File.read(magic, sizeof(magic));
+	if (!m_File || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+		m_File.close();
+		throw std::runtime_error("Not an input recording: " + path);
+	}
+	if (!ReadValue(m_File, version) || !ReadValue(m_File, maxInputs) || version != VERSION || maxInputs != static_cast<uint32_t>(MAX_INPUTS)) {
+		m_File.close();
+		throw std::runtime_error("Incompatible input recording (version " + std::to_string(version) + "): " + path);
+	}
+
+	m_Current = InputsSnapshot();
+	m_FrameCount = 0;
+}
+
+bool InputPlayer::Read(RecordedFrame& frame)
+{
+	if (!m_File.is_open()) {
+		return false;
+	}
+
+	uint8_t flags = 0;
+	if (!ReadValue(m_File, frame.DeltaTime) || !ReadValue(m_File, frame.StateHash) || !ReadValue(m_File, flags)) {
+		return false; // End of the recording
+	}
+
+	bool complete = true;
+	if (flags & NEW_INPUTS) {
+		m_Current.Sequence++;
+		complete &= ReadValue(m_File, m_Current.Time);
+	}
+	if (flags & FRAMEBUFFER) {
+		uint8_t resized = 0;
+		int32_t width = 0;
+		int32_t height = 0;
+		complete &= ReadValue(m_File, resized) && ReadValue(m_File, width) && ReadValue(m_File, height);
+		m_Current.Framebuffer.Resized = resized != 0;
+		m_Current.Framebuffer.Width = width;
+		m_Current.Framebuffer.Height = height;
+	}
+	if (flags & MOUSE) {
+		MouseState& mouse = m_Current.Mouse;
+		uint8_t bits = 0;
+		complete &= ReadValue(m_File, bits)
+			&& ReadValue(m_File, mouse.Xoffset) && ReadValue(m_File, mouse.Yoffset)
+			&& ReadValue(m_File, mouse.ScrollXoffset) && ReadValue(m_File, mouse.ScrollYoffset);
+		mouse.CaptureEnabled = (bits & CAPTURE_ENABLED) != 0;
+		mouse.MovementOffsetChanged = (bits & MOVEMENT_CHANGED) != 0;
+		mouse.ScrollOffsetChanged = (bits & SCROLL_CHANGED) != 0;
+		mouse.LeftButtonPressed = (bits & LEFT_PRESSED) != 0;
+		mouse.RightButtonPressed = (bits & RIGHT_PRESSED) != 0;
+	}
+	if (flags & KEYS) {
+		uint64_t pressed = 0;
+		uint64_t doublePressed = 0;
+		complete &= ReadValue(m_File, pressed) && ReadValue(m_File, doublePressed);
+		for (size_t i = 0; i < m_Current.KeysStates.size(); i++) {
+			m_Current.KeysStates[i].IsPressed = ((pressed >> i) & 1) != 0;
+			m_Current.KeysStates[i].IsDoublePressed = ((doublePressed >> i) & 1) != 0;
+		}
+	}
+
+	if (!complete) {
+		std::cout << "[INPUT RECORDING] [WARNING] : Recording truncated after " << m_FrameCount << " frames." << std::endl;
+		return false;
+	}
+
+	frame.Inputs = m_Current;
+	m_FrameCount++;
+	return true;
+}
+
+void InputPlayer::Close()
+{
+	if (m_File.is_open()) {
+		m_File.close();
+	}
+}
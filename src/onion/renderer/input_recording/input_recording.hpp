@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "../inputs_manager/inputs_manager.hpp"
+
+namespace Onion::Controls {
+
+	// One simulation frame of a recording
+	struct RecordedFrame {
+		double DeltaTime = 0.0;		// Frame time fed to the fixed timestep
+		InputsSnapshot Inputs;		// Inputs sampled by the simulation for this frame
+		uint64_t StateHash = 0;		// Simulation state once the frame was simulated, checked on replay
+	};
+
+	// Writes the frames of a session to a compact binary file (.onionrec).
+	// Only what changed since the previous frame is stored: a frame without new inputs is 17 bytes.
+	class InputRecorder {
+	public:
+		InputRecorder() = default;
+		~InputRecorder();
+
+		InputRecorder(const InputRecorder&) = delete;
+		InputRecorder& operator=(const InputRecorder&) = delete;
+
+		// Throws if the file cannot be created
+		void Open(const std::string& path);
+		void Write(const RecordedFrame& frame);
+		void Close();
+
+		bool IsOpen() const {
+			return m_File.is_open();
+		}
+		uint64_t GetFrameCount() const {
+			return m_FrameCount;
+		}
+
+	private:
+		std::ofstream m_File;
+		InputsSnapshot m_Previous;
+		uint64_t m_FrameCount = 0;
+	};
+
+	// Reads back a file written by InputRecorder. The frames replace the clock and the live inputs,
+	// so the simulation goes through exactly the same states as in the recorded session.
+	class InputPlayer {
+	public:
+		InputPlayer() = default;
+
+		InputPlayer(const InputPlayer&) = delete;
+		InputPlayer& operator=(const InputPlayer&) = delete;
+
+		// Throws if the file is missing, not a recording or from an incompatible version
+		void Open(const std::string& path);
+		// False at the end of the recording
+		bool Read(RecordedFrame& frame);
+		void Close();
+
+		bool IsOpen() const {
+			return m_File.is_open();
+		}
+		uint64_t GetFrameCount() const {
+			return m_FrameCount;
+		}
+
+	private:
+		std::ifstream m_File;
+		InputsSnapshot m_Current;
+		uint64_t m_FrameCount = 0;
+	};
+
+} // namespace Onion::Controls
@@ -1,28 +1,31 @@
 #include "inputs_manager.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
 using namespace Onion::Controls;
 
+namespace {
+	uint64_t InputBit(int inputId) {
+		return uint64_t{ 1 } << static_cast<unsigned int>(inputId);
+	}
+}
+
 void InputsManager::Init(GLFWwindow* window) {
 
 	m_Window = window;
 	glfwSetWindowUserPointer(window, this);
 
-	{
-		std::unique_lock<std::mutex> lockFramebuffer(m_MutexFramebuffer);
-		glfwGetFramebufferSize(m_Window, &m_FramebufferState.Width, &m_FramebufferState.Height);
-		m_FramebufferState.Resized = true;
-	}
+	glfwGetFramebufferSize(m_Window, &m_FramebufferState.Width, &m_FramebufferState.Height);
+	m_FramebufferState.Resized = true;
 
 	InitCallbacks();
 }
 
 void InputsManager::PoolInputs() {
 
-	{
-		std::unique_lock<std::mutex> lockInputs(m_MutexSnapshot);
-		m_InputsSnapshot = nullptr;
-	}
-
 	m_GlfwTime = glfwGetTime();
 
 	PoolMouseMovement();
@@ -35,78 +38,61 @@ void InputsManager::PoolInputs() {
 }
 
 void InputsManager::PoolMouseMovement() {
-	std::unique_lock<std::mutex> lock(m_MutexMouse);
-
+	// Offsets were accumulated by the cursor callback since the last poll
 	m_MouseState.CaptureEnabled = IsMouseCaptureEnabled();
-
-	if (!IsMouseCaptureEnabled()) {
-		return;
-	}
-
-	double xpos, ypos;
-	glfwGetCursorPos(m_Window, &xpos, &ypos);
-
-	if (m_FirstMouse) {
-		m_MouseLastX = xpos;
-		m_MouseLastY = ypos;
-		m_FirstMouse = false;
-	}
-
-	if (xpos == m_MouseLastX && ypos == m_MouseLastY) {
-		// No movement
-		m_MouseState.MovementOffsetChanged = false;
-		m_MouseState.Xoffset = 0.0;
-		m_MouseState.Yoffset = 0.0;
-		return;
-	}
-	else {
-		// Movement detected
-		double xoffset = xpos - m_MouseLastX;
-		double yoffset = m_MouseLastY - ypos; // reversed since y-coordinates range bottom to top
-
-		m_MouseState.MovementOffsetChanged = true;
-		m_MouseState.Xoffset = xoffset;
-		m_MouseState.Yoffset = yoffset;
-	}
-
-	m_MouseLastX = xpos;
-	m_MouseLastY = ypos;
-
 }
 
 void InputsManager::PoolMouseInputs() {
-	std::unique_lock<std::mutex> lock(m_MutexMouse);
-	m_MouseState.LeftButtonPressed = glfwGetMouseButton(m_Window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
-	m_MouseState.RightButtonPressed = glfwGetMouseButton(m_Window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+	// A click shorter than a frame still shows up as pressed for one snapshot
+	m_MouseState.LeftButtonPressed = m_MouseButtons[GLFW_MOUSE_BUTTON_LEFT].Down || m_MouseButtons[GLFW_MOUSE_BUTTON_LEFT].PressedSincePoll;
+	m_MouseState.RightButtonPressed = m_MouseButtons[GLFW_MOUSE_BUTTON_RIGHT].Down || m_MouseButtons[GLFW_MOUSE_BUTTON_RIGHT].PressedSincePoll;
+
+	for (MouseButtonControl& button : m_MouseButtons) {
+		button.PressedSincePoll = false;
+	}
 }
 
 void InputsManager::PollKeyboardInputs() {
-	std::unique_lock<std::mutex> lock(m_MutexRegisteredInputs);
-	for (auto& [inputId, keyControl] : m_RegisteredInputs) {
-		bool isKeyDown = glfwGetKey(m_Window, static_cast<int>(keyControl.key)) == GLFW_PRESS;
-		keyControl.Update(isKeyDown);
+	// Only inputs with something going on (held, or changed since the last poll) are visited,
+	// the key callback flags them. Idle registered inputs cost nothing.
+	uint64_t activeInputs = m_ActiveInputs;
+	while (activeInputs != 0) {
+		const int inputId = std::countr_zero(activeInputs);
+		activeInputs &= activeInputs - 1;
+
+		KeyInputControl& keyControl = m_RegisteredInputs[static_cast<size_t>(inputId)];
+		keyControl.Update(m_GlfwTime);
+
+		KeyState& keyState = m_Building.KeysStates[static_cast<size_t>(inputId)];
+		keyState.IsPressed = keyControl.IsPressed();
+		keyState.IsDoublePressed = keyControl.IsDoublePressed();
+
+		if (!keyControl.IsActive()) {
+			m_ActiveInputs &= ~InputBit(inputId);
+		}
 	}
 }
 
 void InputsManager::ResetFlags()
 {
-	{
-		std::unique_lock<std::mutex> lockFramebuffer(m_MutexFramebuffer);
-		m_FramebufferState.Resized = false;
-	}
+	m_FramebufferState.Resized = false;
+
+	m_MouseState.ScrollOffsetChanged = false;
+	m_MouseState.ScrollXoffset = 0.0;
+	m_MouseState.ScrollYoffset = 0.0;
+	m_MouseState.MovementOffsetChanged = false;
+	m_MouseState.Xoffset = 0.0;
+	m_MouseState.Yoffset = 0.0;
+}
 
-	{
-		std::unique_lock<std::mutex> lock(m_MutexMouse);
-		m_MouseState.ScrollOffsetChanged = false;
-		m_MouseState.MovementOffsetChanged = false;
-	}
+InputsSnapshot InputsManager::GetInputsSnapshot() const {
+	return m_Published.Load();
 }
 
-std::shared_ptr<InputsSnapshot> InputsManager::GetInputsSnapshot() {
-	if (m_InputsSnapshot == nullptr) {
-		throw std::runtime_error("InputsSnapshot is not initialized. Make sure to call PoolInputs() before GetInputsSnapshot().");
-	}
-	return m_InputsSnapshot;
+void InputsManager::PublishSnapshot(const InputsSnapshot& snapshot) {
+	m_Building = snapshot;
+	m_Building.Sequence = m_Published.GetVersion() + 1;
+	m_Published.Store(m_Building);
 }
 
 void InputsManager::InitCallbacks() {
@@ -123,20 +109,137 @@ void InputsManager::InitCallbacks() {
 		if (self)
 			self->MouseScrollCallback(xoffset, yoffset);
 		});
+
+	glfwSetKeyCallback(m_Window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+		(void)scancode;
+		(void)mods;
+		auto* self = static_cast<InputsManager*>(glfwGetWindowUserPointer(window));
+		if (self)
+			self->KeyCallback(key, action);
+		});
+
+	glfwSetMouseButtonCallback(m_Window, [](GLFWwindow* window, int button, int action, int mods) {
+		(void)mods;
+		auto* self = static_cast<InputsManager*>(glfwGetWindowUserPointer(window));
+		if (self)
+			self->MouseButtonCallback(button, action);
+		});
+
+	glfwSetCursorPosCallback(m_Window, [](GLFWwindow* window, double xpos, double ypos) {
+		auto* self = static_cast<InputsManager*>(glfwGetWindowUserPointer(window));
+		if (self)
+			self->CursorPositionCallback(xpos, ypos);
+		});
 }
 
 void InputsManager::FramebufferSizeCallback(int width, int height) {
-	std::unique_lock<std::mutex> lock(m_MutexFramebuffer);
 	m_FramebufferState.Resized = true;
 	m_FramebufferState.Width = width;
 	m_FramebufferState.Height = height;
 }
 
 void InputsManager::MouseScrollCallback(double xoffset, double yoffset) {
-	std::unique_lock<std::mutex> lock(m_MutexMouse);
+	PushEvent(InputEventType::Scrolled, 0, xoffset, yoffset);
+
+	// Summed, several scroll events can arrive between two polls
 	m_MouseState.ScrollOffsetChanged = true;
-	m_MouseState.ScrollXoffset = xoffset;
-	m_MouseState.ScrollYoffset = yoffset;
+	m_MouseState.ScrollXoffset += xoffset;
+	m_MouseState.ScrollYoffset += yoffset;
+}
+
+void InputsManager::KeyCallback(int key, int action) {
+	// Held key repeats are derived from timing, the OS auto-repeat is ignored
+	if (action == GLFW_REPEAT) {
+		return;
+	}
+
+	const bool isDown = action == GLFW_PRESS;
+	const double time = PushEvent(isDown ? InputEventType::KeyPressed : InputEventType::KeyReleased, key, 0.0, 0.0);
+
+	if (key < 0 || key > GLFW_KEY_LAST) {
+		return; // GLFW_KEY_UNKNOWN
+	}
+
+	uint64_t inputs = m_KeyInputs[static_cast<size_t>(key)];
+	m_ActiveInputs |= inputs;
+	while (inputs != 0) {
+		const int inputId = std::countr_zero(inputs);
+		inputs &= inputs - 1;
+		m_RegisteredInputs[static_cast<size_t>(inputId)].OnKeyEvent(isDown, time);
+	}
+}
+
+void InputsManager::MouseButtonCallback(int button, int action) {
+	const bool isDown = action == GLFW_PRESS;
+	PushEvent(isDown ? InputEventType::MouseButtonPressed : InputEventType::MouseButtonReleased, button, 0.0, 0.0);
+
+	if (button < 0 || button >= static_cast<int>(m_MouseButtons.size())) {
+		return;
+	}
+
+	MouseButtonControl& control = m_MouseButtons[static_cast<size_t>(button)];
+	control.Down = isDown;
+	control.PressedSincePoll |= isDown;
+}
+
+void InputsManager::CursorPositionCallback(double xpos, double ypos) {
+	PushEvent(InputEventType::CursorMoved, 0, xpos, ypos);
+
+	if (!IsMouseCaptureEnabled()) {
+		return;
+	}
+
+	if (m_FirstMouse) {
+		m_MouseLastX = xpos;
+		m_MouseLastY = ypos;
+		m_FirstMouse = false;
+		return;
+	}
+
+	if (xpos == m_MouseLastX && ypos == m_MouseLastY) {
+		return;
+	}
+
+	// Summed until the next poll, no motion is lost when the frame rate is lower than the mouse rate
+	m_MouseState.MovementOffsetChanged = true;
+	m_MouseState.Xoffset += xpos - m_MouseLastX;
+	m_MouseState.Yoffset += m_MouseLastY - ypos; // reversed since y-coordinates range bottom to top
+
+	m_MouseLastX = xpos;
+	m_MouseLastY = ypos;
+}
+
+double InputsManager::PushEvent(InputEventType type, int code, double x, double y) {
+	// GLFW does not forward the OS event time: events are stamped when they are dispatched,
+	// which keeps their order and their spacing within a poll
+	const double time = glfwGetTime();
+
+	if (!m_EventStreamEnabled.load(std::memory_order_relaxed)) {
+		return time;
+	}
+
+	InputEvent event;
+	event.Time = time;
+	event.Type = type;
+	event.Code = code;
+	event.X = x;
+	event.Y = y;
+	if (!m_Events.TryPush(event)) {
+		m_DroppedEvents.fetch_add(1, std::memory_order_relaxed);
+	}
+	return time;
+}
+
+void InputsManager::SetEventStreamEnabled(bool enabled) {
+	m_EventStreamEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool InputsManager::PopEvent(InputEvent& event) {
+	return m_Events.TryPop(event);
+}
+
+uint64_t InputsManager::GetDroppedEventCount() const {
+	return m_DroppedEvents.load(std::memory_order_relaxed);
 }
 
 void InputsManager::SetMouseCaptureEnabled(bool enabled) {
@@ -159,100 +262,128 @@ bool InputsManager::IsMouseCaptureEnabled() const {
 }
 
 void InputsManager::GetFramebufferSize(int& width, int& height) {
-	std::unique_lock<std::mutex> lock(m_MutexFramebuffer);
 	width = m_FramebufferState.Width;
 	height = m_FramebufferState.Height;
 }
 
 int Onion::Controls::InputsManager::RegisterInput(const Key key, InputConfig config)
 {
-	std::unique_lock<std::mutex> lock(m_MutexRegisteredInputs);
-
-	int inputId = m_NextInputId++;
+	// Reuse the first free slot, IDs stay small and the polled range dense
+	int inputId = 1;
+	while (inputId < m_InputIdEnd && m_RegisteredInputs[static_cast<size_t>(inputId)].Registered) {
+		inputId++;
+	}
+	if (inputId >= MAX_INPUTS) {
+		throw std::runtime_error("Too many registered inputs, MAX_INPUTS is " + std::to_string(MAX_INPUTS) + ".");
+	}
+	m_InputIdEnd = std::max(m_InputIdEnd, inputId + 1);
 
 	KeyInputControl keyControl;
+	keyControl.Registered = true;
 	keyControl.key = key;
 	keyControl.EnableControlledKeyRepeat = config.EnableControlledKeyRepeatWhenHold;
 	keyControl.KeyRepeatDelay = config.KeyRepeatDelayWhenHold;
 	keyControl.KeyRepeatInterval = config.KeyRepeatIntervalWhenHold;
 	keyControl.DoublePressDelay = config.DoublePressDelay;
 
-	m_RegisteredInputs[inputId] = keyControl;
+	m_RegisteredInputs[static_cast<size_t>(inputId)] = keyControl;
+	m_Building.KeysStates[static_cast<size_t>(inputId)] = KeyState{};
+
+	const int keyCode = static_cast<int>(key);
+	if (keyCode >= 0 && keyCode <= GLFW_KEY_LAST) {
+		m_KeyInputs[static_cast<size_t>(keyCode)] |= InputBit(inputId);
+	}
 
 	return inputId;
 }
 
 void InputsManager::UnregisterInput(int inputId)
 {
-	std::unique_lock<std::mutex> lock(m_MutexRegisteredInputs);
-	m_RegisteredInputs.erase(inputId);
+	if (inputId <= 0 || inputId >= m_InputIdEnd) {
+		return;
+	}
+
+	const int keyCode = static_cast<int>(m_RegisteredInputs[static_cast<size_t>(inputId)].key);
+	if (keyCode >= 0 && keyCode <= GLFW_KEY_LAST) {
+		m_KeyInputs[static_cast<size_t>(keyCode)] &= ~InputBit(inputId);
+	}
+	m_ActiveInputs &= ~InputBit(inputId);
+
+	m_RegisteredInputs[static_cast<size_t>(inputId)] = KeyInputControl();
+	m_Building.KeysStates[static_cast<size_t>(inputId)] = KeyState{};
+	while (m_InputIdEnd > 1 && !m_RegisteredInputs[static_cast<size_t>(m_InputIdEnd - 1)].Registered) {
+		m_InputIdEnd--;
+	}
 }
 
 void InputsManager::UpdateInputsSnapshot()
 {
-	std::shared_ptr<InputsSnapshot> inputs = std::make_shared<InputsSnapshot>();
+	InputsSnapshot& inputs = m_Building;
+	inputs.Time = m_GlfwTime;
+	inputs.Framebuffer = m_FramebufferState;
+	inputs.Mouse = m_MouseState;
+	// Key states were written by PollKeyboardInputs
+
+	inputs.Sequence = m_Published.GetVersion() + 1;
+	m_Published.Store(inputs);
+}
 
-	{
-		std::unique_lock lock(m_MutexFramebuffer);
-		inputs->Framebuffer = m_FramebufferState;
-		m_FramebufferState.Resized = false; // Reset the framebuffer resized flag
+void InputsManager::KeyInputControl::OnKeyEvent(bool isDown, double time) {
+	if (isDown == m_IsDown) {
+		return;
 	}
+	m_IsDown = isDown;
 
-	{
-		std::unique_lock<std::mutex> lock(m_MutexMouse);
-		inputs->Mouse = m_MouseState;
+	if (!isDown) {
+		return;
 	}
 
-	{
-		std::unique_lock<std::mutex> lockInputs(m_MutexRegisteredInputs);
-		for (const auto& [inputId, keyControl] : m_RegisteredInputs) {
-			KeyState keyState;
-			keyState.IsPressed = keyControl.IsPressed();
-			keyState.IsDoublePressed = keyControl.IsDoublePressed();
-			inputs->KeysStates[inputId] = keyState;
-		}
-	}
+	m_PressedSincePoll = true;
+	m_PressTime = time;
 
-	std::unique_lock<std::mutex> lockInputs(m_MutexSnapshot);
-	m_InputsSnapshot = inputs;
+	// Double presses are measured between the actual events, not between frames
+	if (m_LastPressedTimeDouble != 0.0 && (time - m_LastPressedTimeDouble <= DoublePressDelay)) {
+		m_DoublePressedSincePoll = true; // Double press detected
+		m_LastPressedTimeDouble = 0.0;	 // Reset for next detection
+	}
+	else {
+		m_LastPressedTimeDouble = time; // Update last pressed time
+	}
 }
 
-void InputsManager::KeyInputControl::Update(bool isKeyDown) {
-	double now = glfwGetTime();
+void InputsManager::KeyInputControl::Update(double now) {
+	m_IsDoublePressed = m_DoublePressedSincePoll;
 
 	if (EnableControlledKeyRepeat == false) {
-		m_IsPressed = isKeyDown;
-		return;
+		// Pressed and released between two polls still counts as pressed once
+		m_IsPressed = m_IsDown || m_PressedSincePoll;
 	}
-
-	// Handle Repeated Key presses
-	if (isKeyDown) {
-		if (!m_WasDown) {
-			// Key was just pressed this frame
-			m_IsPressed = true; // This frame, report as pressed
-			m_IsHeld = true;
-			m_FirstDelay = true;
-			m_LastPressedTime = now;
+	else if (m_PressedSincePoll) {
+		// Key was just pressed this frame
+		m_IsPressed = true; // This frame, report as pressed
+		m_IsHeld = m_IsDown;
+		m_FirstDelay = true;
+		m_LastPressedTime = m_PressTime;
+	}
+	else if (m_IsDown && m_IsHeld) {
+		// Handle Repeated Key presses
+		if (m_FirstDelay) {
+			if (now - m_LastPressedTime >= KeyRepeatDelay) {
+				m_IsPressed = true; // First repeat
+				m_FirstDelay = false;
+				m_LastPressedTime = now;
+			}
+			else {
+				m_IsPressed = false; // Wait for initial delay
+			}
 		}
-		else if (m_IsHeld) {
-			if (m_FirstDelay) {
-				if (now - m_LastPressedTime >= KeyRepeatDelay) {
-					m_IsPressed = true; // First repeat
-					m_FirstDelay = false;
-					m_LastPressedTime = now;
-				}
-				else {
-					m_IsPressed = false; // Wait for initial delay
-				}
+		else {
+			if (now - m_LastPressedTime >= KeyRepeatInterval) {
+				m_IsPressed = true; // Subsequent repeats
+				m_LastPressedTime = now;
 			}
 			else {
-				if (now - m_LastPressedTime >= KeyRepeatInterval) {
-					m_IsPressed = true; // Subsequent repeats
-					m_LastPressedTime = now;
-				}
-				else {
-					m_IsPressed = false; // Not yet time for another repeat
-				}
+				m_IsPressed = false; // Not yet time for another repeat
 			}
 		}
 	}
@@ -264,21 +395,13 @@ void InputsManager::KeyInputControl::Update(bool isKeyDown) {
 		m_LastPressedTime = 0.0;
 	}
 
-	// Handle Double Key presses
-	m_IsDoublePressed = false; // Reset double pressed state
-	if (isKeyDown && !m_WasDown) {
-		// Key was just pressed this frame
-		// Check for double press
-		if (m_LastPressedTimeDouble != 0.0 && (now - m_LastPressedTimeDouble <= DoublePressDelay)) {
-			m_IsDoublePressed = true;	   // Double press detected
-			m_LastPressedTimeDouble = 0.0; // Reset for next detection
-		}
-		else {
-			m_LastPressedTimeDouble = now; // Update last pressed time
-		}
-	}
+	m_PressedSincePoll = false;
+	m_DoublePressedSincePoll = false;
+}
 
-	m_WasDown = isKeyDown;
+bool InputsManager::KeyInputControl::IsActive() const {
+	// Stays active one more poll after the release, so the snapshot goes back to released
+	return m_IsDown || m_PressedSincePoll || m_IsPressed || m_IsDoublePressed;
 }
 
 bool InputsManager::KeyInputControl::IsPressed() const {
@@ -288,12 +411,3 @@ bool InputsManager::KeyInputControl::IsPressed() const {
 bool InputsManager::KeyInputControl::IsDoublePressed() const {
 	return m_IsDoublePressed;
 }
-
-KeyState InputsSnapshot::GetKeyState(int inputId) const
-{
-	auto it = KeysStates.find(inputId);
-	if (it != KeysStates.end()) {
-		return it->second;
-	}
-	throw std::runtime_error("Input ID not found in InputsSnapshot Key States.");
-}
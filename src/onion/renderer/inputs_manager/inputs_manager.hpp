@@ -4,10 +4,14 @@
 
 #include <GLFW/glfw3.h>
 
-#include <shared_mutex>
-#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
 
 #include "inputs.h"
+#include "../../core/seqlock/seqlock.hpp"
+#include "../../core/spsc_ring/spsc_ring.hpp"
 
 namespace Onion::Controls {
 
@@ -38,11 +42,41 @@ namespace Onion::Controls {
 		bool IsDoublePressed = false;
 	};
 
+	// Input IDs index the key states directly, 0 is never handed out
+	static constexpr int MAX_INPUTS = 64;
+
+	// Fixed size, trivially copyable: published and read by copy, from any thread
 	struct InputsSnapshot {
+		uint64_t Sequence = 0; // Increases with every published snapshot, 0 = nothing polled yet
+		double Time = 0.0; // glfwGetTime() when the inputs were polled
 		FramebufferState Framebuffer;
 		MouseState Mouse;
-		std::unordered_map<int, KeyState> KeysStates;
-		KeyState GetKeyState(int inputId) const;
+		std::array<KeyState, MAX_INPUTS> KeysStates{};
+
+		// Unknown IDs read as released
+		KeyState GetKeyState(int inputId) const noexcept {
+			return inputId > 0 && inputId < MAX_INPUTS ? KeysStates[static_cast<size_t>(inputId)] : KeyState{};
+		}
+	};
+	static_assert(std::is_trivially_copyable_v<InputsSnapshot>, "InputsSnapshot is copied bytewise across threads");
+
+
+	enum class InputEventType : uint8_t {
+		KeyPressed,
+		KeyReleased,
+		MouseButtonPressed,
+		MouseButtonReleased,
+		CursorMoved,
+		Scrolled,
+	};
+
+	// Raw GLFW event, in the order GLFW delivered them
+	struct InputEvent {
+		double Time = 0.0; // glfwGetTime() when GLFW dispatched the event
+		InputEventType Type = InputEventType::KeyPressed;
+		int Code = 0;	  // GLFW key or mouse button
+		double X = 0.0;	  // Cursor position or scroll offset
+		double Y = 0.0;
 	};
 
 
@@ -63,6 +97,11 @@ namespace Onion::Controls {
 	};
 
 
+	// Turns GLFW events into InputsSnapshot values.
+	// Key, mouse button and cursor callbacks update the state as events arrive, so presses shorter than
+	// a frame are not lost, and PoolInputs only publishes it: its cost does not depend on the registered keys.
+	// Everything but GetInputsSnapshot and the event stream must be called from the thread polling GLFW
+	// events (callbacks run there). Inputs are registered before polling starts, or from the polling thread.
 	class InputsManager {
 	public:
 		InputsManager() = default;
@@ -71,19 +110,33 @@ namespace Onion::Controls {
 		void Init(GLFWwindow* window);
 
 		void PoolInputs();
-		std::shared_ptr<InputsSnapshot> GetInputsSnapshot();
+
+		// Latest published snapshot. Any thread, lock-free, does not allocate.
+		InputsSnapshot GetInputsSnapshot() const;
+
+		// Publishes a snapshot that was not polled (headless runs). Its Sequence is overwritten.
+		void PublishSnapshot(const InputsSnapshot& snapshot);
+
+		// Raw event stream, for consumers that need every event and its time rather than per-frame state.
+		// Off by default. Single consumer, on any thread. When the consumer falls EVENT_RING_CAPACITY
+		// events behind, new events are dropped (and counted): the producer never waits.
+		static constexpr size_t EVENT_RING_CAPACITY = 1024;
+		void SetEventStreamEnabled(bool enabled);
+		bool PopEvent(InputEvent& event);
+		uint64_t GetDroppedEventCount() const;
 
 		void SetMouseCaptureEnabled(bool enabled);
 		bool IsMouseCaptureEnabled() const;
 
 		void GetFramebufferSize(int& width, int& height);
 
+		// Throws when MAX_INPUTS - 1 inputs are already registered
 		int RegisterInput(const Key key, InputConfig config = InputConfig());
 		void UnregisterInput(int inputId);
 
 	private:
-		mutable std::mutex m_MutexSnapshot;
-		std::shared_ptr<InputsSnapshot> m_InputsSnapshot;
+		InputsSnapshot m_Building;
+		Onion::Core::SeqLock<InputsSnapshot> m_Published;
 		void UpdateInputsSnapshot();
 
 	private:
@@ -93,24 +146,14 @@ namespace Onion::Controls {
 		GLFWwindow* m_Window = nullptr;
 		double m_GlfwTime = 0.f;
 
-	private:
-		mutable std::mutex m_MutexRegisteredInputs;
-		int m_NextInputId = 1;
-		std::unordered_map<int, KeyInputControl> m_RegisteredInputs;
-
 		// Internal States
 	private:
-		mutable std::mutex m_MutexMouse;
 		MouseState m_MouseState;
 		bool m_MouseCaptureEnabled = true;
 		bool m_FirstMouse = true;
 		double m_MouseLastX = 0.f;
 		double m_MouseLastY = 0.f;
-		double m_MouseXoffset = 0.f;
-		double m_MouseYoffset = 0.f;
-
 
-		mutable std::mutex m_MutexFramebuffer;
 		FramebufferState m_FramebufferState;
 
 		// Pool inputs
@@ -128,6 +171,23 @@ namespace Onion::Controls {
 		void InitCallbacks();
 		void FramebufferSizeCallback(int width, int height);
 		void MouseScrollCallback(double xoffset, double yoffset);
+		void KeyCallback(int key, int action);
+		void MouseButtonCallback(int button, int action);
+		void CursorPositionCallback(double xpos, double ypos);
+
+		// Returns the event time
+		double PushEvent(InputEventType type, int code, double x, double y);
+
+	private:
+		Onion::Core::SpscRing<InputEvent, EVENT_RING_CAPACITY> m_Events;
+		std::atomic<bool> m_EventStreamEnabled{ false };
+		std::atomic<uint64_t> m_DroppedEvents{ 0 };
+
+		struct MouseButtonControl {
+			bool Down = false;
+			bool PressedSincePoll = false;
+		};
+		std::array<MouseButtonControl, GLFW_MOUSE_BUTTON_LAST + 1> m_MouseButtons{};
 
 	public:
 		InputsManager(const InputsManager&) = delete;
@@ -141,11 +201,17 @@ namespace Onion::Controls {
 			KeyInputControl() = default;
 			~KeyInputControl() = default;
 
-			void Update(bool isKeyDown);
+			// From the key callback
+			void OnKeyEvent(bool isDown, double time);
+			// Once per poll: derives the per-frame state from the events received since the last one
+			void Update(double now);
 
 			bool IsPressed() const;
 			bool IsDoublePressed() const;
+			// Needs Update on the next poll
+			bool IsActive() const;
 
+			bool Registered = false;
 			Key key = Key::Unknown;
 
 			bool EnableControlledKeyRepeat = false;
@@ -154,8 +220,11 @@ namespace Onion::Controls {
 
 			double DoublePressDelay = 0.5f; // Delay for double key press detection
 		private:
-			// Previous state
-			bool m_WasDown = false;
+			// Set by events
+			bool m_IsDown = false;
+			bool m_PressedSincePoll = false;
+			bool m_DoublePressedSincePoll = false;
+			double m_PressTime = 0.0;
 
 			// For Repeated Key Presses
 			bool m_IsPressed = false;
@@ -167,6 +236,17 @@ namespace Onion::Controls {
 			bool m_IsDoublePressed = false;
 			double m_LastPressedTimeDouble = 0.0;
 		};
+
+	private:
+		// Indexed by input ID, slot 0 unused
+		std::array<KeyInputControl, MAX_INPUTS> m_RegisteredInputs;
+		int m_InputIdEnd = 1;
+
+		// Input IDs bound to each GLFW key, one bit per ID
+		static_assert(MAX_INPUTS <= 64, "Input ID masks are 64 bits");
+		std::array<uint64_t, GLFW_KEY_LAST + 1> m_KeyInputs{};
+		// Inputs PollKeyboardInputs must update: held, or changed since the last poll
+		uint64_t m_ActiveInputs = 0;
 	};
 
 } // namespace Onion::Controls
\ No newline at end of file
@@ -1,3 +1,29 @@
 #include "material.hpp"
 
-using namespace Onion::Rendering;
\ No newline at end of file
+using namespace Onion::Rendering;
+
+Texture* Material::GetTexture(MaterialSlot slot) const
+{
+	switch (slot) {
+	case MaterialSlot::Albedo:
+		return Albedo;
+	case MaterialSlot::Normal:
+		return Normal;
+	case MaterialSlot::Roughness:
+		return Roughness;
+	default:
+		return nullptr;
+	}
+}
+
+MaterialParameters Material::GetBlock() const
+{
+	MaterialParameters block = Parameters;
+	block.TextureMask = 0;
+	for (uint32_t slot = 0; slot < static_cast<uint32_t>(MaterialSlot::Count); slot++) {
+		if (GetTexture(static_cast<MaterialSlot>(slot))) {
+			block.TextureMask |= 1u << slot;
+		}
+	}
+	return block;
+}
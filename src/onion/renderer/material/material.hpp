@@ -1,9 +1,32 @@
 #pragma once
 
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
 #include "../texture/texture.hpp"
 
 namespace Onion::Rendering {
 
+	// Texture units of the model shader, the same for every material.
+	// The units from Count on are free for the renderer (shadow map, ...).
+	enum class MaterialSlot : uint32_t {
+		Albedo = 0,
+		Normal,
+		Roughness,
+		Count
+	};
+
+	// MaterialBlock of model.frag, std140 layout: keep both in sync
+	struct MaterialParameters {
+		glm::vec4 BaseColor{ 1.0f };	// Multiplies the albedo texture, or replaces it when there is none
+		float Roughness = 1.0f;			// Same with the roughness texture
+		float NormalStrength = 1.0f;	// Scales the normal map tilt, 0 keeps the mesh normals
+		uint32_t TextureMask = 0;		// Bit per MaterialSlot with a texture, filled by MaterialTable
+		float Padding = 0.0f;
+	};
+	static_assert(sizeof(MaterialParameters) == 32, "MaterialParameters must match the std140 MaterialBlock");
+
 	class Material {
 
 	public:
@@ -15,6 +38,12 @@ namespace Onion::Rendering {
 		Texture* Normal = nullptr;
 		Texture* Roughness = nullptr;
 
+		MaterialParameters Parameters;
+
+		Texture* GetTexture(MaterialSlot slot) const;
+		// Parameters, with the mask of the textures set
+		MaterialParameters GetBlock() const;
+
 	};
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,136 @@
+#include "material_table.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include "../structs/render_stats.hpp"
+#include "../../core/profiler/profiler.hpp"
+
+using namespace Onion::Rendering;
+
+namespace {
+	// Sampler names, per MaterialSlot
+	constexpr const char* SLOT_SAMPLERS[] = { "uAlbedo", "uNormal", "uRoughness" };
+	static_assert(std::size(SLOT_SAMPLERS) == static_cast<size_t>(MaterialSlot::Count), "A sampler per material slot");
+}
+
+MaterialTable::~MaterialTable()
+{
+	if (HasBeenCreated()) {
+		std::cout << "[MATERIAL TABLE] [WARNING] : Material table not deleted before destruction. There is a memory leak." << std::endl;
+	}
+}
+
+void MaterialTable::Create()
+{
+	if (HasBeenCreated()) {
+		return;
+	}
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment = std::max(alignment, 1);
+	const size_t align = static_cast<size_t>(alignment);
+	m_Stride = (sizeof(MaterialParameters) + align - 1) / align * align;
+
+	glGenBuffers(1, &m_Buffer);
+	m_Capacity = 0;
+	Begin();
+}
+
+void MaterialTable::Delete()
+{
+	glDeleteBuffers(1, &m_Buffer);
+	m_Buffer = 0;
+	m_Capacity = 0;
+	m_Blocks.clear();
+	m_Materials.clear();
+}
+
+void MaterialTable::SetupShader(const Shader& shader)
+{
+	const GLuint blockIndex = glGetUniformBlockIndex(shader.ID, "MaterialBlock");
+	if (blockIndex == GL_INVALID_INDEX) {
+		std::cout << "[MATERIAL TABLE] [WARNING] : The shader has no MaterialBlock, materials keep their default parameters" << std::endl;
+	}
+	else {
+		glUniformBlockBinding(shader.ID, blockIndex, BLOCK_BINDING);
+	}
+
+	shader.Use();
+	for (size_t slot = 0; slot < std::size(SLOT_SAMPLERS); slot++) {
+		shader.setInt(SLOT_SAMPLERS[slot], static_cast<int>(slot));
+	}
+}
+
+void MaterialTable::Begin()
+{
+	m_Blocks.clear();
+	m_Materials.clear();
+	// Anything may have been bound on the slots since the last pass (ImGui, texture uploads)
+	m_BoundTextures.fill(nullptr);
+	m_BoundBlock = UINT32_MAX;
+}
+
+uint32_t MaterialTable::Add(const Material& material)
+{
+	if (!m_Materials.empty() && m_Materials.back() == &material) {
+		return static_cast<uint32_t>(m_Materials.size() - 1);
+	}
+
+	const MaterialParameters block = material.GetBlock();
+	const size_t offset = m_Blocks.size();
+	m_Blocks.resize(offset + m_Stride);
+	std::memcpy(m_Blocks.data() + offset, &block, sizeof(block));
+
+	m_Materials.push_back(&material);
+	return static_cast<uint32_t>(m_Materials.size() - 1);
+}
+
+void MaterialTable::Upload()
+{
+	ONION_PROFILE_SCOPE("MaterialTable::Upload");
+	if (m_Blocks.empty()) {
+		return;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+	if (m_Blocks.size() > m_Capacity) {
+		m_Capacity = std::max(m_Blocks.size(), m_Capacity * 2);
+	}
+	// Orphaned: the blocks of the previous pass may still be read by the GPU
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_Capacity), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(m_Blocks.size()), m_Blocks.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void MaterialTable::Bind(uint32_t index)
+{
+	if (index == m_BoundBlock || index >= m_Materials.size()) {
+		return;
+	}
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, BLOCK_BINDING, m_Buffer, static_cast<GLintptr>(index * m_Stride),
+		static_cast<GLsizeiptr>(sizeof(MaterialParameters)));
+	m_BoundBlock = index;
+
+	// A slot without a texture keeps the previous one, the mask tells the shader to ignore it
+	const Material& material = *m_Materials[index];
+	uint32_t textureBinds = 0;
+	for (uint32_t slot = 0; slot < static_cast<uint32_t>(MaterialSlot::Count); slot++) {
+		const Texture* texture = material.GetTexture(static_cast<MaterialSlot>(slot));
+		if (!texture || texture == m_BoundTextures[slot]) {
+			continue;
+		}
+		glActiveTexture(GL_TEXTURE0 + slot);
+		texture->Bind();
+		m_BoundTextures[slot] = texture;
+		textureBinds++;
+	}
+	if (textureBinds > 0) {
+		glActiveTexture(GL_TEXTURE0);
+	}
+	RenderStats::AddMaterialBind(textureBinds);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../material/material.hpp"
+#include "../shader/shader.hpp"
+
+namespace Onion::Rendering {
+
+	// Parameter blocks and textures of the materials drawn in a pass.
+	// Every material added gets its block in one shared uniform buffer, filled by a single update per pass:
+	// switching material is then a glBindBufferRange, plus the textures that differ from the ones already
+	// on their slot (materials sharing textures do not rebind them). Add the materials in draw order,
+	// sorted: uniform and texture traffic then scales with the unique materials, not with the meshes.
+	// Thread owning the context only. One table per context, the buffer is not shared.
+	class MaterialTable {
+	public:
+		// Uniform buffer binding point of MaterialBlock
+		static constexpr GLuint BLOCK_BINDING = 0;
+
+	public:
+		MaterialTable() = default;
+		~MaterialTable();
+
+		MaterialTable(const MaterialTable&) = delete;
+		MaterialTable& operator=(const MaterialTable&) = delete;
+
+		void Create();
+		void Delete();
+		bool HasBeenCreated() const {
+			return m_Buffer != 0;
+		}
+
+		// Points the program's MaterialBlock and samplers to the table's binding and slots
+		static void SetupShader(const Shader& shader);
+
+		// Starts a pass: forgets the blocks and the textures bound by the previous one
+		void Begin();
+		// Index of the material's block. Adding the same material as the previous call returns the same block.
+		uint32_t Add(const Material& material);
+		// Writes the blocks added since Begin, before the first Bind
+		void Upload();
+		// Binds the block and the textures of the material added at 'index', counted in RenderStats
+		void Bind(uint32_t index);
+
+	private:
+		GLuint m_Buffer = 0;
+		size_t m_Stride = 0;		// Block size rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+		size_t m_Capacity = 0;		// Bytes
+
+		std::vector<uint8_t> m_Blocks;					// CPU copy of the pass, m_Stride apart
+		std::vector<const Material*> m_Materials;		// Per block
+		std::array<const Texture*, static_cast<size_t>(MaterialSlot::Count)> m_BoundTextures{};
+		uint32_t m_BoundBlock = UINT32_MAX;
+	};
+
+} // namespace Onion::Rendering
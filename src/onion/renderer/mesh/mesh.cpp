@@ -1,28 +1,25 @@
 #include "mesh.hpp"
 
+#include "../structs/render_stats.hpp"
+
 using namespace Onion::Rendering;
 
 Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	: Mesh(UploadBuffers(vertices, indices))
 {
-	indexCount = static_cast<uint32_t>(indices.size());
+}
 
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-	glGenBuffers(1, &ebo);
+Mesh::Mesh(const MeshBuffers& buffers)
+{
+	vbo = buffers.Vertices;
+	ebo = buffers.Indices;
+	indexCount = buffers.IndexCount;
 
+	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER,
-		vertices.size() * sizeof(Vertex),
-		vertices.data(),
-		GL_STATIC_DRAW);
-
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-		indices.size() * sizeof(uint32_t),
-		indices.data(),
-		GL_STATIC_DRAW);
 
 	// Position
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
@@ -43,14 +40,65 @@ Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& ind
 	);
 	glEnableVertexAttribArray(2);
 
+	// Tangent and handedness
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE,
+		sizeof(Vertex),
+		(void*)offsetof(Vertex, Tangent));
+	glEnableVertexAttribArray(3);
+
 	glBindVertexArray(0);
 }
 
+MeshBuffers Mesh::UploadBuffers(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	MeshBuffers buffers;
+	buffers.IndexCount = static_cast<uint32_t>(indices.size());
+
+	glGenBuffers(1, &buffers.Vertices);
+	glGenBuffers(1, &buffers.Indices);
+
+	// The element array binding belongs to the vertex array: the indices go through a generic target
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.Vertices);
+	glBufferData(GL_ARRAY_BUFFER,
+		vertices.size() * sizeof(Vertex),
+		vertices.data(),
+		GL_STATIC_DRAW);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers.Indices);
+	glBufferData(GL_COPY_WRITE_BUFFER,
+		indices.size() * sizeof(uint32_t),
+		indices.data(),
+		GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return buffers;
+}
+
+void Mesh::DeleteBuffers(MeshBuffers& buffers)
+{
+	glDeleteBuffers(1, &buffers.Vertices);
+	glDeleteBuffers(1, &buffers.Indices);
+	buffers = MeshBuffers();
+}
+
 void Mesh::Draw(const Shader& shader) const
 {
 	shader.Use();
 
 	glBindVertexArray(vao);
 	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+	RenderStats::AddDraw(indexCount / 3);
 	glBindVertexArray(0);
 }
+
+void Mesh::Delete()
+{
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ebo);
+	vao = 0;
+	vbo = 0;
+	ebo = 0;
+	indexCount = 0;
+}
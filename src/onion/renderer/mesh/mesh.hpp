@@ -4,11 +4,18 @@
 #include <glad/glad.h>
 
 #include "../structs/vertex.hpp"
-#include "../material/material.hpp"
 #include "../shader/shader.hpp"
 
 namespace Onion::Rendering {
 
+	// GL buffers of a mesh. Buffers are shared between contexts, unlike the vertex array:
+	// they can be filled by the upload context (see UploadContext).
+	struct MeshBuffers {
+		GLuint Vertices = 0;
+		GLuint Indices = 0;
+		uint32_t IndexCount = 0;
+	};
+
 	class Mesh
 	{
 
@@ -19,10 +26,15 @@ namespace Onion::Rendering {
 	public:
 		Mesh() = default;
 		Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		// Takes the buffers, creates the vertex array on the current context
+		explicit Mesh(const MeshBuffers& buffers);
 
-		Material* material = nullptr;
+		// Any context
+		static MeshBuffers UploadBuffers(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		static void DeleteBuffers(MeshBuffers& buffers);
 
 		void Draw(const Shader& shader) const;
+		void Delete();
 	};
 
 } // namespace Onion::Rendering
\ No newline at end of file
@@ -1,18 +1,146 @@
 #include "model.hpp"
 
+#include "../../core/profiler/profiler.hpp"
+#include "../../core/virtual_file_system/virtual_file_system.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
 using namespace Onion::Rendering;
 
+namespace {
+	// Assimp reads the model, and the files it references (glTF buffers, ...), through the VFS
+	class VfsStream : public Assimp::IOStream {
+	public:
+		explicit VfsStream(Onion::Core::FileData&& file) : m_File(std::move(file)) {
+		}
+
+		size_t Read(void* buffer, size_t size, size_t count) override {
+			if (size == 0) {
+				return 0;
+			}
+			const size_t items = std::min(count, (m_File.GetSize() - m_Position) / size);
+			if (items > 0) {
+				std::memcpy(buffer, m_File.GetData() + m_Position, items * size);
+				m_Position += items * size;
+			}
+			return items;
+		}
+
+		size_t Write(const void*, size_t, size_t) override {
+			return 0;
+		}
+
+		aiReturn Seek(size_t offset, aiOrigin origin) override {
+			const size_t size = m_File.GetSize();
+			size_t position = 0;
+			switch (origin) {
+			case aiOrigin_SET:
+				position = offset;
+				break;
+			case aiOrigin_CUR:
+				position = m_Position + offset;
+				break;
+			case aiOrigin_END:
+				// Like Assimp's memory streams: 'offset' bytes before the end
+				position = offset <= size ? size - offset : size + 1;
+				break;
+			default:
+				return aiReturn_FAILURE;
+			}
+			if (position > size) {
+				return aiReturn_FAILURE;
+			}
+			m_Position = position;
+			return aiReturn_SUCCESS;
+		}
+
+		size_t Tell() const override {
+			return m_Position;
+		}
+
+		size_t FileSize() const override {
+			return m_File.GetSize();
+		}
+
+		void Flush() override {
+		}
+
+	private:
+		Onion::Core::FileData m_File;
+		size_t m_Position = 0;
+	};
+
+	class VfsIOSystem : public Assimp::IOSystem {
+	public:
+		bool Exists(const char* path) const override {
+			return Onion::Core::VirtualFileSystem::Exists(path);
+		}
+
+		char getOsSeparator() const override {
+			return '/';
+		}
+
+		Assimp::IOStream* Open(const char* path, const char* mode) override {
+			// Read-only
+			if (mode && (std::strchr(mode, 'w') || std::strchr(mode, 'a'))) {
+				return nullptr;
+			}
+			Onion::Core::FileData file;
+			if (!Onion::Core::VirtualFileSystem::ReadFile(path, file)) {
+				return nullptr;
+			}
+			return new VfsStream(std::move(file));
+		}
+
+		void Close(Assimp::IOStream* stream) override {
+			delete stream;
+		}
+	};
+}
+
 Model::Model(const std::string& path)
+	: Model(Import(path))
 {
-	Load(path);
+}
+
+Model::Model(const std::vector<MeshData>& meshes)
+	: Model(UploadBuffers(meshes))
+{
+}
+
+Model::Model(const std::vector<MeshBuffers>& meshes)
+{
+	m_Meshes.reserve(meshes.size());
+	for (const MeshBuffers& mesh : meshes) {
+		m_Meshes.emplace_back(mesh);
+	}
+}
+
+std::vector<MeshBuffers> Model::UploadBuffers(const std::vector<MeshData>& meshes)
+{
+	ONION_PROFILE_SCOPE("Model::UploadBuffers");
+	std::vector<MeshBuffers> buffers;
+	buffers.reserve(meshes.size());
+	for (const MeshData& mesh : meshes) {
+		buffers.push_back(Mesh::UploadBuffers(mesh.Vertices, mesh.Indices));
+	}
+	return buffers;
+}
+
+void Model::DeleteBuffers(std::vector<MeshBuffers>& meshes)
+{
+	for (MeshBuffers& mesh : meshes) {
+		Mesh::DeleteBuffers(mesh);
+	}
+	meshes.clear();
 }
 
 void Model::Draw(const Shader& shader) const
 {
 	for (const auto& mesh : m_Meshes) {
-		if (mesh.material)
-			mesh.material->Albedo->Bind();
-
 		mesh.Draw(shader);
 	}
 }
@@ -20,9 +148,6 @@ void Model::Draw(const Shader& shader) const
 void Model::SetMaterial(Material* material)
 {
 	m_Material = material;
-
-	for (auto& mesh : m_Meshes)
-		mesh.material = material;
 }
 
 Material* Onion::Rendering::Model::GetMaterial() const
@@ -30,59 +155,73 @@ Material* Onion::Rendering::Model::GetMaterial() const
 	return m_Material;
 }
 
-void Model::Load(const std::string& path)
+void Model::Delete()
 {
+	for (Mesh& mesh : m_Meshes) {
+		mesh.Delete();
+	}
+	m_Meshes.clear();
+}
+
+std::vector<MeshData> Model::Import(const std::string& path)
+{
+	ONION_PROFILE_SCOPE("Model::Import");
 	Assimp::Importer importer;
+	importer.SetIOHandler(new VfsIOSystem()); // Owned by the importer
 	const aiScene* scene = importer.ReadFile(
 		path,
 		aiProcess_Triangulate |
 		aiProcess_GenNormals |       // safety
 		aiProcess_FlipWindingOrder |
-		aiProcess_CalcTangentSpace   // REQUIRED for normal maps
+		aiProcess_CalcTangentSpace   // Tangents for the normal maps, see Vertex::Tangent
 	);
 
 	if (!scene || !scene->mRootNode)
 		throw std::runtime_error(importer.GetErrorString());
 
-	ProcessNode(scene->mRootNode, scene);
+	std::vector<MeshData> meshes;
+	ProcessNode(scene->mRootNode, scene, meshes);
+	return meshes;
 }
 
-void Model::ProcessNode(aiNode* node, const aiScene* scene)
+void Model::ProcessNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes)
 {
 	for (uint32_t i = 0; i < node->mNumMeshes; i++)
 	{
 		aiMesh* ai_mesh = scene->mMeshes[node->mMeshes[i]];
-		m_Meshes.push_back(ProcessMesh(ai_mesh));
+		MeshData& mesh = meshes.emplace_back();
+		ConvertMesh(*ai_mesh, mesh.Vertices, mesh.Indices);
 	}
 
 	for (uint32_t i = 0; i < node->mNumChildren; i++)
-		ProcessNode(node->mChildren[i], scene);
+		ProcessNode(node->mChildren[i], scene, meshes);
 }
 
-Mesh Model::ProcessMesh(aiMesh* mesh) {
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
+void Model::ConvertMesh(const aiMesh& mesh, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	vertices.clear();
+	indices.clear();
 
-	for (uint32_t i = 0; i < mesh->mNumVertices; i++)
+	for (uint32_t i = 0; i < mesh.mNumVertices; i++)
 	{
 		Vertex v{};
 		v.Position = {
-			mesh->mVertices[i].x,
-			mesh->mVertices[i].y,
-			mesh->mVertices[i].z
+			mesh.mVertices[i].x,
+			mesh.mVertices[i].y,
+			mesh.mVertices[i].z
 		};
 
 		v.Normal = {
-			mesh->mNormals[i].x,
-			mesh->mNormals[i].y,
-			mesh->mNormals[i].z
+			mesh.mNormals[i].x,
+			mesh.mNormals[i].y,
+			mesh.mNormals[i].z
 		};
 
-		if (mesh->HasTextureCoords(0))
+		if (mesh.HasTextureCoords(0))
 		{
 			v.UV = {
-				mesh->mTextureCoords[0][i].x,
-				mesh->mTextureCoords[0][i].y
+				mesh.mTextureCoords[0][i].x,
+				mesh.mTextureCoords[0][i].y
 			};
 		}
 		else
@@ -90,16 +229,27 @@ Mesh Model::ProcessMesh(aiMesh* mesh) {
 			v.UV = { 0.0f, 0.0f };
 		}
 
+		// Only the sign of the bitangent is kept, the shader rebuilds it from the normal and the tangent
+		if (mesh.HasTangentsAndBitangents())
+		{
+			const glm::vec3 tangent(mesh.mTangents[i].x, mesh.mTangents[i].y, mesh.mTangents[i].z);
+			const glm::vec3 bitangent(mesh.mBitangents[i].x, mesh.mBitangents[i].y, mesh.mBitangents[i].z);
+			const float handedness = glm::dot(glm::cross(v.Normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+			v.Tangent = glm::vec4(tangent, handedness);
+		}
+		else
+		{
+			v.Tangent = { 0.0f, 0.0f, 0.0f, 1.0f };
+		}
+
 		vertices.push_back(v);
 	}
 
-	for (uint32_t i = 0; i < mesh->mNumFaces; i++)
+	for (uint32_t i = 0; i < mesh.mNumFaces; i++)
 	{
-		const aiFace& face = mesh->mFaces[i];
+		const aiFace& face = mesh.mFaces[i];
 		for (uint32_t j = 0; j < face.mNumIndices; j++)
 			indices.push_back(face.mIndices[j]);
 	}
-
-	return Mesh(vertices, indices);
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../mesh/mesh.hpp"
+#include "../material/material.hpp"
 #include "../shader/shader.hpp"
 
 #include <stdexcept>
@@ -10,26 +11,46 @@
 
 namespace Onion::Rendering
 {
+	// CPU side of one mesh, ready to upload
+	struct MeshData {
+		std::vector<Vertex> Vertices;
+		std::vector<uint32_t> Indices;
+	};
+
 	class Model
 	{
 	public:
 		Model() = default;
 		explicit Model(const std::string& path);
+		// Uploads meshes imported with Import
+		explicit Model(const std::vector<MeshData>& meshes);
+		// Takes buffers filled by UploadBuffers, possibly on another context. Creates the vertex arrays.
+		explicit Model(const std::vector<MeshBuffers>& meshes);
 
+		// Only the meshes: the caller binds the material (see MaterialTable)
 		void Draw(const Shader& shader) const;
 
+		// Frees the GL buffers
+		void Delete();
+
+		// Any context: fills the buffers of every mesh, the vertex arrays are created by the constructor
+		static std::vector<MeshBuffers> UploadBuffers(const std::vector<MeshData>& meshes);
+		static void DeleteBuffers(std::vector<MeshBuffers>& meshes);
+
 		void SetMaterial(Material* material);
 		Material* GetMaterial() const;
 
+		// CPU side of the mesh import: assimp vertices and faces to the engine layout. No GL calls.
+		static void ConvertMesh(const aiMesh& mesh, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		// Reads and converts every mesh of a file. No GL calls, can run on any thread. Throws on failure.
+		static std::vector<MeshData> Import(const std::string& path);
+
 	private:
 		std::vector<Mesh> m_Meshes;
 		Material* m_Material = nullptr;
 
-		void Load(const std::string& path);
-
-		void ProcessNode(aiNode* node, const aiScene* scene);
-
-		Mesh ProcessMesh(aiMesh* mesh);
+		static void ProcessNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes);
 	};
 
 } // namespace Onion::Rendering
@@ -0,0 +1,134 @@
+#include "offscreen_context.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+using namespace Onion::Rendering;
+
+const char* Onion::Rendering::ToString(OffscreenBackend backend)
+{
+	switch (backend) {
+	case OffscreenBackend::Auto:
+		return "auto";
+	case OffscreenBackend::HiddenWindow:
+		return "window";
+	case OffscreenBackend::EGL:
+		return "egl";
+	case OffscreenBackend::OSMesa:
+		return "osmesa";
+	}
+	return "unknown";
+}
+
+bool Onion::Rendering::ParseOffscreenBackend(const std::string& text, OffscreenBackend& backend)
+{
+	for (OffscreenBackend candidate : { OffscreenBackend::Auto, OffscreenBackend::HiddenWindow, OffscreenBackend::EGL, OffscreenBackend::OSMesa }) {
+		if (text == ToString(candidate)) {
+			backend = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+OffscreenContext::~OffscreenContext()
+{
+	Destroy();
+}
+
+void OffscreenContext::Create(const Settings& settings)
+{
+	if (IsCreated()) {
+		return;
+	}
+
+	if (settings.Backend != OffscreenBackend::Auto) {
+		if (!TryCreate(settings.Backend, settings)) {
+			throw std::runtime_error(std::string("Failed to create an offscreen OpenGL context with backend ") + ToString(settings.Backend));
+		}
+		return;
+	}
+
+	for (OffscreenBackend backend : { OffscreenBackend::HiddenWindow, OffscreenBackend::EGL, OffscreenBackend::OSMesa }) {
+		if (backend == OffscreenBackend::HiddenWindow && !settings.AllowHiddenWindow) {
+			continue;
+		}
+		if (TryCreate(backend, settings)) {
+			return;
+		}
+	}
+
+	throw std::runtime_error("Failed to create an offscreen OpenGL context, no backend available");
+}
+
+bool OffscreenContext::TryCreate(OffscreenBackend backend, const Settings& settings)
+{
+	// The platform is an init hint, GLFW is initialized again for every attempt
+	const bool headless = backend != OffscreenBackend::HiddenWindow;
+	glfwInitHint(GLFW_PLATFORM, headless ? GLFW_PLATFORM_NULL : GLFW_ANY_PLATFORM);
+
+	if (!glfwInit()) {
+		std::cout << "[OFFSCREEN] [WARNING] : GLFW initialization failed for backend " << ToString(backend) << std::endl;
+		return false;
+	}
+
+	glfwDefaultWindowHints();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_FOCUSED, GLFW_FALSE);
+
+	if (backend == OffscreenBackend::EGL) {
+		// Mesa falls back to its surfaceless platform when there is no display, llvmpipe included
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+	}
+	else if (backend == OffscreenBackend::OSMesa) {
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+	}
+
+	m_Window = glfwCreateWindow(settings.Width, settings.Height, "Onion Offscreen", nullptr, nullptr);
+	if (!m_Window) {
+		std::cout << "[OFFSCREEN] [WARNING] : Context creation failed for backend " << ToString(backend) << std::endl;
+		glfwTerminate();
+		return false;
+	}
+
+	glfwMakeContextCurrent(m_Window);
+	glfwSwapInterval(0);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "[OFFSCREEN] [WARNING] : GLAD initialization failed for backend " << ToString(backend) << std::endl;
+		glfwDestroyWindow(m_Window);
+		m_Window = nullptr;
+		glfwTerminate();
+		return false;
+	}
+
+	m_Backend = backend;
+	return true;
+}
+
+void OffscreenContext::Destroy()
+{
+	if (!m_Window) {
+		return;
+	}
+
+	glfwMakeContextCurrent(nullptr);
+	glfwDestroyWindow(m_Window);
+	m_Window = nullptr;
+	glfwTerminate();
+}
+
+std::string OffscreenContext::GetRendererName() const
+{
+	const GLubyte* renderer = glGetString(GL_RENDERER);
+	return renderer ? reinterpret_cast<const char*>(renderer) : "";
+}
+
+std::string OffscreenContext::GetVersionString() const
+{
+	const GLubyte* version = glGetString(GL_VERSION);
+	return version ? reinterpret_cast<const char*>(version) : "";
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <string>
+
+namespace Onion::Rendering {
+
+	enum class OffscreenBackend {
+		Auto,			// First of HiddenWindow, EGL, OSMesa that works
+		HiddenWindow,	// Invisible window on the desktop platform, needs a display
+		EGL,			// GLFW null platform + EGL pbuffer / surfaceless, no display needed
+		OSMesa			// GLFW null platform + OSMesa software rendering
+	};
+
+	const char* ToString(OffscreenBackend backend);
+	bool ParseOffscreenBackend(const std::string& text, OffscreenBackend& backend);
+
+	// OpenGL 3.3 core context that never shows anything on screen, for benchmarks and batch rendering.
+	// Rendering goes to framebuffer objects, the default framebuffer must not be relied on.
+	// Owns GLFW: it must not be used alongside a Renderer in the same process.
+	class OffscreenContext {
+	public:
+		struct Settings {
+			OffscreenBackend Backend = OffscreenBackend::Auto;
+			int Width = 1280;
+			int Height = 720;
+			bool AllowHiddenWindow = true; // Auto only: false goes straight to EGL / OSMesa (servers)
+		};
+
+	public:
+		OffscreenContext() = default;
+		~OffscreenContext();
+
+		OffscreenContext(const OffscreenContext&) = delete;
+		OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+		// Creates the context, makes it current on the calling thread and loads the GL functions.
+		// Throws std::runtime_error if no backend could be created.
+		void Create(const Settings& settings);
+		void Destroy();
+
+		bool IsCreated() const {
+			return m_Window != nullptr;
+		}
+		OffscreenBackend GetBackend() const {
+			return m_Backend;
+		}
+		GLFWwindow* GetWindow() const {
+			return m_Window;
+		}
+
+		// GL_RENDERER / GL_VERSION of the created context
+		std::string GetRendererName() const;
+		std::string GetVersionString() const;
+
+	private:
+		bool TryCreate(OffscreenBackend backend, const Settings& settings);
+
+	private:
+		GLFWwindow* m_Window = nullptr;
+		OffscreenBackend m_Backend = OffscreenBackend::Auto;
+	};
+
+} // namespace Onion::Rendering
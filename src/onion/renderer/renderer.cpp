@@ -1,8 +1,20 @@
 #include "renderer.hpp"
 
 #include "opengl_helper.h"
-
+#include "image_writer/image_writer.hpp"
+#include "world_streamer/world_streamer.hpp"
+#include "../core/allocation_tracker/allocation_tracker.hpp"
+#include "../core/task_graph/task_graph.hpp"
+#include "../core/virtual_file_system/virtual_file_system.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <cfloat>
+#include <cstdio>
+#include <deque>
+#include <exception>
 #include <iostream>
+#include <memory>
 
 using namespace Onion::Rendering;
 using namespace Onion::Controls;
@@ -11,13 +23,26 @@ static void error_callback(int code, const char* desc) {
 	std::fprintf(stderr, "GLFW error %d: %s\n", code, desc);
 }
 
-Renderer::Renderer() : m_Camera(glm::vec3(0.0f, 0.0f, -3.0f), m_WindowWidth, m_WindowHeight)
-{
-	m_Camera.SetFront(glm::vec3(0.0f, 0.0f, 1.0f)); // Look towards positive Z
+static const Material* GetDrawMaterial(const DrawItem& item) {
+	return item.SourceMaterial ? item.SourceMaterial : item.SourceModel->GetMaterial();
+}
 
-	m_ViewMatrix = m_Camera.GetViewMatrix();
-	m_ProjectionMatrix = m_Camera.GetProjectionMatrix();
-	m_ViewProjMatrix = m_ProjectionMatrix * m_ViewMatrix;
+// Materials sharing textures end up next to each other, the texture binds are then skipped
+static bool MaterialDrawsBefore(const Material* a, const Material* b) {
+	const std::less<const void*> less;
+	for (uint32_t slot = 0; slot < static_cast<uint32_t>(MaterialSlot::Count); slot++) {
+		const Texture* textureA = a->GetTexture(static_cast<MaterialSlot>(slot));
+		const Texture* textureB = b->GetTexture(static_cast<MaterialSlot>(slot));
+		if (textureA != textureB) {
+			return less(textureA, textureB);
+		}
+	}
+	return less(a, b);
+}
+
+Renderer::Renderer(Onion::Core::JobSystem& jobSystem, Onion::Core::AsyncFileIO& fileIO)
+	: m_JobSystem(jobSystem), m_FileIO(fileIO)
+{
 }
 
 Renderer::~Renderer()
@@ -27,6 +52,9 @@ Renderer::~Renderer()
 
 void Renderer::Start()
 {
+	// Set before the thread starts, the simulation loop checks it right away
+	m_IsRunning = true;
+
 	m_ThreadRenderer = std::jthread([this](std::stop_token st) {
 		RenderThreadFunction(st);
 		});
@@ -39,184 +67,406 @@ void Renderer::Stop()
 		m_ThreadRenderer.join();
 	}
 
-	glfwDestroyWindow(m_Window);
-	glfwTerminate();
+	m_IsRunning = false;
+	NotifyPacing();
+
+	if (m_Headless.Enabled) {
+		m_Window = nullptr;
+		m_OffscreenContext.Destroy();
+	}
+	else if (m_Window) {
+		glfwDestroyWindow(m_Window);
+		m_Window = nullptr;
+		glfwTerminate();
+	}
+}
+
+bool Renderer::IsRunning() const
+{
+	return m_IsRunning.load(std::memory_order_acquire);
+}
+
+void Renderer::RequestClose()
+{
+	m_CloseRequested.store(true, std::memory_order_relaxed);
+}
+
+InputsManager& Renderer::GetInputsManager()
+{
+	return m_InputsManager;
+}
+
+InputsSnapshot Renderer::GetInputsSnapshot() const
+{
+	return m_InputsManager.GetInputsSnapshot();
+}
+
+const Model* Renderer::GetAppleModel() const
+{
+	// Loaded by the render thread, the address is stable
+	return &m_AppleModel;
+}
+
+FrameSnapshot* Renderer::BeginSnapshot()
+{
+	std::unique_lock<std::mutex> lock(m_MutexPacing);
+	m_PacingCondition.wait(lock, [this]() {
+		if (!m_IsRunning.load(std::memory_order_acquire)) {
+			return true;
+		}
+		if (m_SnapshotsConsumed.load(std::memory_order_acquire) < m_SnapshotsPublished.load(std::memory_order_relaxed)) {
+			return false;
+		}
+		// Low latency: build the frame from the inputs the render thread just sampled, not from the previous ones
+		return !m_LateInputSampling.load(std::memory_order_relaxed) || m_InputsPolled.load(std::memory_order_acquire) > m_InputsUsed;
+		});
+
+	if (!m_IsRunning.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+
+	m_InputsUsed = m_InputsPolled.load(std::memory_order_acquire);
+
+	return &m_Snapshots.GetWriteBuffer();
+}
+
+void Renderer::PublishSnapshot()
+{
+	m_Snapshots.Publish();
+	m_SnapshotsPublished.fetch_add(1, std::memory_order_release);
+	NotifyPacing();
+}
+
+void Renderer::SetFramePacerSettings(const FramePacer::Settings& settings)
+{
+	std::lock_guard<std::mutex> lock(m_MutexPacerSettings);
+	m_PendingPacerSettings = settings;
+	m_HasPendingPacerSettings = true;
+}
+
+void Renderer::ApplyFramePacerSettings(const FramePacer::Settings& settings)
+{
+	m_FramePacer.SetSettings(settings);
+	m_LateInputSampling = m_FramePacer.UsesLateInputSampling();
+	m_PendingLatencyInputsTime = 0.0;
+	NotifyPacing();
+}
+
+void Renderer::RecordInputLatency(double inputsTime)
+{
+	if (inputsTime <= 0.0) {
+		return;
+	}
+
+	const double latencyMs = (glfwGetTime() - inputsTime) * 1000.0;
+	m_InputLatencySumMs += latencyMs;
+	m_InputLatencyMaxMs = std::max(m_InputLatencyMaxMs, latencyMs);
+	m_InputLatencySamples++;
+}
+
+std::vector<GpuPassStats> Renderer::GetGpuPassStats() const
+{
+	return m_GpuProfiler.GetPassStats();
+}
+
+void Renderer::ResetGpuPassStats()
+{
+	m_GpuProfiler.ResetStats();
+}
+
+Onion::Core::FrameStats::Summary Renderer::GetFrameStatsSummary() const
+{
+	std::lock_guard<std::mutex> lock(m_MutexFrameStats);
+	return m_FrameStats.ComputeSessionSummary();
+}
+
+void Renderer::SetFrameStatsOutput(const std::string& basePath)
+{
+	m_FrameStatsPath = basePath;
+}
+
+void Renderer::SetHeadless(const HeadlessSettings& settings)
+{
+	m_Headless = settings;
+}
+
+void Renderer::SetWorldStreamer(WorldStreamer* streamer)
+{
+	m_WorldStreamer = streamer;
+}
+
+void Renderer::SetStartupTraceOutput(const std::string& path)
+{
+	m_StartupTracePath = path;
+}
+
+bool Renderer::TakeSceneSettingsEdits(std::vector<SceneSettingsEdit>& edits)
+{
+	edits.clear();
+
+	std::lock_guard<std::mutex> lock(m_MutexSceneEdits);
+	if (m_SceneEdits.empty()) {
+		return false;
+	}
+	edits.swap(m_SceneEdits);
+	return true;
+}
+
+bool Renderer::AcquireSnapshot()
+{
+	// Waits for the simulation a bounded time: if it stalls, the last snapshot is drawn again
+	// so the window (and the debug panel) stays responsive.
+	const auto timeout = std::chrono::milliseconds(m_HasSnapshot ? 100 : 1000);
+	{
+		std::unique_lock<std::mutex> lock(m_MutexPacing);
+		m_PacingCondition.wait_for(lock, timeout, [this]() {
+			return m_SnapshotsPublished.load(std::memory_order_acquire) > m_SnapshotsConsumed.load(std::memory_order_relaxed);
+			});
+	}
+
+	const uint64_t published = m_SnapshotsPublished.load(std::memory_order_acquire);
+	if (m_Snapshots.Consume()) {
+		m_HasSnapshot = true;
+		m_SnapshotsConsumed.store(published, std::memory_order_release);
+		NotifyPacing();
+	}
+
+	return m_HasSnapshot;
+}
+
+void Renderer::NotifyPacing()
+{
+	{
+		// Synchronizes with the predicate check of the waiting thread, no lost wake-up
+		std::lock_guard<std::mutex> lock(m_MutexPacing);
+	}
+	m_PacingCondition.notify_all();
 }
 
 void Renderer::RenderThreadFunction(std::stop_token stopToken)
 {
-	InitWindow();
+	ONION_PROFILE_THREAD("Render");
+
+	RunStartup();
+	if (m_WorldStreamer) {
+		m_WorldStreamer->SetUploadContext(&m_UploadContext);
+	}
 
-	InitOpenGlState();
+	double latencyWindowStart = 0.0;
+	const double latencyWindow_s = 0.5;
 
-	InitImGui(m_Window);
+	uint64_t renderedFrames = 0;
 
-	InitAppleModel();
+	while (!stopToken.stop_requested() && !glfwWindowShouldClose(m_Window) && !m_CloseRequested.load(std::memory_order_relaxed)) {
+		{
+			std::lock_guard<std::mutex> lock(m_MutexPacerSettings);
+			if (m_HasPendingPacerSettings) {
+				ApplyFramePacerSettings(m_PendingPacerSettings);
+				m_HasPendingPacerSettings = false;
+			}
+		}
 
-	int framesAccumulator = 0.0f;
-	double framesCounterStart = 0.0f;
-	double actualizationTime_s = 0.5f;
+		// Frame limiter, or wait for the GPU to finish the previous frame in low latency mode.
+		// Done before sampling inputs, so they are as fresh as possible when the frame is built.
+		{
+			ONION_PROFILE_SCOPE("FramePacer::BeginFrame");
+			m_FramePacer.BeginFrame();
+		}
+
+		ONION_PROFILE_SCOPE("RenderFrame");
+		const uint64_t allocationsStart = Onion::Core::AllocationTracker::GetThreadCount();
+		m_FrameArena.BeginFrame();
+
+		if (m_PendingLatencyInputsTime > 0.0) {
+			// The previous frame is on screen once its fence signaled
+			RecordInputLatency(m_PendingLatencyInputsTime);
+			m_PendingLatencyInputsTime = 0.0;
+		}
+
+		// Headless: there is no default framebuffer, everything goes to the offscreen target
+		if (m_Headless.Enabled) {
+			m_Framebuffer.Bind();
+		}
 
-	while (!stopToken.stop_requested() && !glfwWindowShouldClose(m_Window)) {
 		// No GL calls needed; just clear to black if you like:
 		glClearColor(0.1f, 0.1f, 0.12f, 1.f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Calculate Delta Time
 		double currentFrame = glfwGetTime();
+		const bool firstFrame = m_LastFrame == 0.0;
 		m_DeltaTime = currentFrame - m_LastFrame;
 		m_LastFrame = currentFrame;
 
-		// Calculate FPS Average
-		framesAccumulator++;
-		if (currentFrame - framesCounterStart >= actualizationTime_s) {
-			m_FpsAverage = static_cast<double>(framesAccumulator) / (currentFrame - framesCounterStart);
-			framesAccumulator = 0;
-			framesCounterStart = currentFrame;
+		m_FrameIndex++;
+
+		// Input latency average
+		if (currentFrame - latencyWindowStart >= latencyWindow_s) {
+			latencyWindowStart = currentFrame;
+
+			m_InputLatencyAverageMs = m_InputLatencySamples > 0 ? m_InputLatencySumMs / m_InputLatencySamples : 0.0;
+			m_InputLatencyPeakMs = m_InputLatencyMaxMs;
+			m_InputLatencySumMs = 0.0;
+			m_InputLatencyMaxMs = 0.0;
+			m_InputLatencySamples = 0;
 		}
 
-		// Pool inputs
-		m_InputsManager.PoolInputs();
-		m_InputsSnapshot = m_InputsManager.GetInputsSnapshot();
+		// Pool inputs, the simulation thread reads them on its next update.
+		// Headless: nothing to poll, the simulation keeps the snapshot set by InitHeadless.
+		if (!m_Headless.Enabled) {
+			ONION_PROFILE_SCOPE("PollInputs");
+			glfwPollEvents();
+			m_InputsManager.PoolInputs();
+		}
+		m_InputsPolled.fetch_add(1, std::memory_order_release);
+		NotifyPacing();
 
 		// Process Global Inputs
-		ProcessInputs(m_InputsSnapshot);
-
-		// Process Camera Movement
-		ProcessCameraMovement(m_InputsSnapshot);
+		if (!m_Headless.Enabled) {
+			ProcessInputs(m_InputsManager.GetInputsSnapshot());
+		}
 
-		BeginImGuiFrame();
+		// Latest state published by the simulation thread
+		bool hasSnapshot = false;
+		{
+			ONION_PROFILE_SCOPE("WaitForSimulation");
+			hasSnapshot = AcquireSnapshot();
+		}
+		if (!hasSnapshot) {
+			continue;
+		}
+		const FrameSnapshot& snapshot = m_Snapshots.GetReadBuffer();
+		if (!m_Headless.Enabled) {
+			ApplySnapshotState(snapshot);
+			BeginImGuiFrame();
+		}
+		if (m_WorldStreamer) {
+			m_WorldStreamer->ProcessGpuWork(snapshot.StreamingEpoch);
+		}
+		m_GpuProfiler.BeginFrame();
 
 		// Get Camera projection, view and ProjView Matix
-		m_ProjectionMatrix = m_Camera.GetProjectionMatrix();
-		m_ViewMatrix = m_Camera.GetViewMatrix();
+		m_ProjectionMatrix = snapshot.SceneCamera.GetProjectionMatrix();
+		m_ViewMatrix = snapshot.SceneCamera.GetViewMatrix();
 		m_ViewProjMatrix = m_ProjectionMatrix * m_ViewMatrix;
 
-		// ------ SKYBOX ------
-		m_Skybox.Render(m_ViewMatrix, m_ProjectionMatrix);
+		RenderStats::Reset();
 
+		// ------ SHADOWS ------
+		RenderShadows(snapshot);
 
-		// ------ TESTS MODELS ------
-		UpdateShaderModel();
-		DrawAppleModel();
-
-		// ------ Build ImGui Panels ------
-		BuildImGuiDebugPanel();
-
-		// Render ImGui
-		RenderImGui();
+		// ------ SKYBOX ------
+		{
+			ONION_PROFILE_SCOPE("Skybox");
+			ScopedGpuPass gpuPass(m_GpuProfiler, "Skybox");
+			m_Skybox.Render(m_ViewMatrix, m_ProjectionMatrix);
+		}
 
-		glfwSwapBuffers(m_Window);
-		glfwPollEvents();
 
-		Onion::Debug::CheckGLError("RETRIEVE GL ERRORS", __FILE__, __LINE__);
-	}
+		// ------ TESTS MODELS ------
+		{
+			ONION_PROFILE_SCOPE("Models");
+			ScopedGpuPass gpuPass(m_GpuProfiler, "Models");
+			UpdateShaderModel(snapshot);
+			DrawScene(snapshot);
+		}
 
-	// Cleanup
-	ShutdownImGui();
-	CleanupOpenGL();
-}
+		// Scene only, ImGui draws are not counted
+		m_SceneRenderStats = RenderStats::Current();
 
-void Onion::Rendering::Renderer::RegisterInputs()
-{
-	m_InputIdMoveForward = m_InputsManager.RegisterInput(Key::W);
-	m_InputIdMoveBackward = m_InputsManager.RegisterInput(Key::S);
-	m_InputIdMoveLeft = m_InputsManager.RegisterInput(Key::A);
-	m_InputIdMoveRight = m_InputsManager.RegisterInput(Key::D);
-	m_InputIdMoveUp = m_InputsManager.RegisterInput(Key::Space);
-	m_InputIdMoveDown = m_InputsManager.RegisterInput(Key::LeftShift);
-	m_InputIdSpeedUp = m_InputsManager.RegisterInput(Key::LeftControl);
-	m_InputIdUnfocus = m_InputsManager.RegisterInput(Key::Escape);
-}
+		if (!m_Headless.Enabled) {
+			// ------ Build ImGui Panels ------
+			BuildImGuiDebugPanel(snapshot);
 
-void Renderer::ProcessCameraMovement(const std::shared_ptr<InputsSnapshot>& inputs)
-{
-	if (!inputs->Mouse.CaptureEnabled) {
-		return; // If mouse capture is not enabled, skip camera movement processing
-	}
+			// Render ImGui
+			ONION_PROFILE_SCOPE("ImGui");
+			ScopedGpuPass gpuPass(m_GpuProfiler, "ImGui");
+			RenderImGui();
+		}
+		m_GpuProfiler.EndFrame();
 
-	// Camera's Orientation
-	if (inputs->Mouse.MovementOffsetChanged) {
-		const float sensitivity = 0.1f;
-		const float xoffset = static_cast<float>(inputs->Mouse.Xoffset * sensitivity);
-		const float yoffset = static_cast<float>(inputs->Mouse.Yoffset * sensitivity);
+		if (m_Headless.Enabled) {
+			// Nothing to present, make sure the driver starts on the frame
+			glFlush();
+		}
+		else {
+			ONION_PROFILE_SCOPE("SwapBuffers");
+			glfwSwapBuffers(m_Window);
+		}
+		m_FramePacer.EndFrame();
 
-		m_Camera.SetYaw(m_Camera.GetYaw() + xoffset);
-		m_Camera.SetPitch(m_Camera.GetPitch() + yoffset);
+		m_FrameHeapAllocations = Onion::Core::AllocationTracker::GetThreadCount() - allocationsStart;
 
-		if (m_Camera.GetPitch() > 89.0f)
-			m_Camera.SetPitch(89.0f);
-		if (m_Camera.GetPitch() < -89.0f)
-			m_Camera.SetPitch(-89.0f);
-	}
+		renderedFrames++;
+		if (m_Headless.MaxFrames > 0 && renderedFrames >= m_Headless.MaxFrames) {
+			glfwSetWindowShouldClose(m_Window, GLFW_TRUE);
+		}
 
-	// Adjust camera Speed
-	if (inputs->Mouse.ScrollOffsetChanged) {
-		const float yoffset = static_cast<float>(inputs->Mouse.ScrollYoffset);
-		if (yoffset != 0.f) {
-			float coeefIncrease = 1.3f;
-			float coeefDecrease = 0.7f;
-			if (yoffset > 0) {
-				m_CameraSpeed *= coeefIncrease; // Speed up
-			}
-			else if (yoffset < 0) {
-				m_CameraSpeed *= coeefDecrease; // Slow down
-			}
+		// Frame statistics, the CPU time excludes the pacing wait. GPU times arrive a few frames late.
+		if (!firstFrame) {
+			const float cpuMs = static_cast<float>((glfwGetTime() - currentFrame) * 1000.0);
+			std::lock_guard<std::mutex> lock(m_MutexFrameStats);
+			m_FrameStats.AddFrame(static_cast<float>(m_DeltaTime * 1000.0), cpuMs, m_GpuProfiler.GetFrameGpuMs());
 		}
-	}
 
-	// Camera's Position
-	float velocity = static_cast<float>(m_CameraSpeed * m_DeltaTime);
+		if (m_FramePacer.UsesLateInputSampling()) {
+			m_PendingLatencyInputsTime = snapshot.InputsTime;
+		}
+		else {
+			RecordInputLatency(snapshot.InputsTime);
+		}
 
-	if (inputs->GetKeyState(m_InputIdSpeedUp).IsPressed) {
-		velocity *= 2.0f; // Double speed if left control is pressed
+		Onion::Debug::CheckGLError("RETRIEVE GL ERRORS", __FILE__, __LINE__);
 	}
 
-	// Flatten the front vector for XZ movement
-	glm::vec3 CamFront = m_Camera.GetFront();
-	glm::vec3 frontXZ = glm::normalize(glm::vec3(CamFront.x, 0.0f, CamFront.z));
-	const glm::vec3 Up(0.0f, 1.0f, 0.0f); // Up vector
-
-	if (inputs->GetKeyState(m_InputIdMoveForward).IsPressed)
-		m_Camera.SetPosition(m_Camera.GetPosition() + frontXZ * velocity);
-	if (inputs->GetKeyState(m_InputIdMoveBackward).IsPressed)
-		m_Camera.SetPosition(m_Camera.GetPosition() - frontXZ * velocity);
-	if (inputs->GetKeyState(m_InputIdMoveLeft).IsPressed)
-		m_Camera.SetPosition(m_Camera.GetPosition() - glm::normalize(glm::cross(frontXZ, Up)) * velocity);
-	if (inputs->GetKeyState(m_InputIdMoveRight).IsPressed)
-		m_Camera.SetPosition(m_Camera.GetPosition() + glm::normalize(glm::cross(frontXZ, Up)) * velocity);
-	if (inputs->GetKeyState(m_InputIdMoveUp).IsPressed) // Jump / up
-		m_Camera.SetPosition(m_Camera.GetPosition() + Up * velocity);
-	if (inputs->GetKeyState(m_InputIdMoveDown).IsPressed) // Down
-		m_Camera.SetPosition(m_Camera.GetPosition() - Up * velocity);
-}
+	// Unblocks the simulation thread
+	m_IsRunning = false;
+	NotifyPacing();
 
-void Renderer::ProcessInputs(const std::shared_ptr<InputsSnapshot>& inputs)
-{
-	if (inputs->GetKeyState(m_InputIdUnfocus).IsPressed && inputs->Mouse.CaptureEnabled) {
-		m_InputsManager.SetMouseCaptureEnabled(false);
+	if (!m_FrameStatsPath.empty()) {
+		std::lock_guard<std::mutex> lock(m_MutexFrameStats);
+		m_FrameStats.WriteSummary(m_FrameStatsPath);
 	}
 
-	const bool rightPressed = inputs->Mouse.RightButtonPressed;
-	if ((rightPressed) && !inputs->Mouse.CaptureEnabled) {
-		m_InputsManager.SetMouseCaptureEnabled(true);
+	// Cleanup
+	if (m_Headless.Enabled) {
+		CaptureFramebuffer();
+	}
+	else {
+		ShutdownImGui();
 	}
+	CleanupOpenGL();
+}
 
-	// Resize handling
-	if (inputs->Framebuffer.Resized) {
-		m_WindowWidth = inputs->Framebuffer.Width;
-		m_WindowHeight = inputs->Framebuffer.Height;
-		m_Camera.SetAspectRatio(static_cast<float>(m_WindowWidth) / static_cast<float>(m_WindowHeight));
+void Renderer::ProcessInputs(const InputsSnapshot& inputs)
+{
+	// Resize handling, the simulation updates the camera aspect ratio
+	if (inputs.Framebuffer.Resized) {
+		m_WindowWidth = inputs.Framebuffer.Width;
+		m_WindowHeight = inputs.Framebuffer.Height;
 
 		// Update the OpenGL viewport
 		glViewport(0, 0, m_WindowWidth, m_WindowHeight);
 	}
 }
 
+void Renderer::ApplySnapshotState(const FrameSnapshot& snapshot)
+{
+	// GLFW window state can only be changed from this thread
+	if (snapshot.MouseCaptureEnabled != m_InputsManager.IsMouseCaptureEnabled()) {
+		m_InputsManager.SetMouseCaptureEnabled(snapshot.MouseCaptureEnabled);
+	}
+}
+
 void Renderer::InitWindow()
 {
 	glfwSetErrorCallback(error_callback);
 
+	if (m_Headless.Enabled) {
+		InitHeadless();
+		return;
+	}
+
 	if (!glfwInit()) {
 		std::cerr << "Failed to initialize GLFW" << std::endl;
 		throw std::runtime_error("GLFW initialization failed");
@@ -235,7 +485,7 @@ void Renderer::InitWindow()
 
 	glfwMakeContextCurrent(m_Window);
 
-	glfwSwapInterval(1); // vsync
+	// Swap interval is set by the frame pacer
 
 	// Load OpenGL function pointers with glad
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -246,7 +496,47 @@ void Renderer::InitWindow()
 	// Initialize Inputs Manager
 	m_InputsManager.Init(m_Window);
 	m_InputsManager.SetMouseCaptureEnabled(false);
-	RegisterInputs();
+}
+
+void Renderer::InitHeadless()
+{
+	OffscreenContext::Settings settings;
+	settings.Backend = m_Headless.Backend;
+	settings.Width = m_Headless.Width;
+	settings.Height = m_Headless.Height;
+	settings.AllowHiddenWindow = false;
+
+	// Throws if neither EGL nor OSMesa is available
+	m_OffscreenContext.Create(settings);
+	m_Window = m_OffscreenContext.GetWindow();
+
+	m_WindowWidth = m_Headless.Width;
+	m_WindowHeight = m_Headless.Height;
+	m_Framebuffer.Create(m_WindowWidth, m_WindowHeight);
+
+	std::cout << "[RENDERER] Headless (" << ToString(m_OffscreenContext.GetBackend()) << "): "
+		<< m_OffscreenContext.GetRendererName() << ", " << m_WindowWidth << "x" << m_WindowHeight << std::endl;
+
+	// Never updated: gives the simulation the target size, mouse capture stays off
+	InputsSnapshot inputs;
+	inputs.Framebuffer.Resized = true;
+	inputs.Framebuffer.Width = m_WindowWidth;
+	inputs.Framebuffer.Height = m_WindowHeight;
+	inputs.Mouse.CaptureEnabled = false;
+	m_InputsManager.PublishSnapshot(inputs);
+}
+
+void Renderer::CaptureFramebuffer()
+{
+	if (m_Headless.CapturePath.empty() || !m_Framebuffer.HasBeenCreated()) {
+		return;
+	}
+
+	std::vector<uint8_t> pixels;
+	m_Framebuffer.ReadPixels(pixels);
+	if (WritePng(m_Headless.CapturePath, m_Framebuffer.GetWidth(), m_Framebuffer.GetHeight(), pixels.data())) {
+		std::cout << "[RENDERER] Last frame written to " << m_Headless.CapturePath << std::endl;
+	}
 }
 
 void Onion::Rendering::Renderer::InitOpenGlState()
@@ -264,6 +554,179 @@ void Onion::Rendering::Renderer::InitOpenGlState()
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
+void Onion::Rendering::Renderer::RunStartup()
+{
+	using Affinity = Onion::Core::TaskGraph::Affinity;
+	using TaskId = Onion::Core::TaskGraph::TaskId;
+	Onion::Core::TaskGraph graph(m_JobSystem);
+
+	// Everything GL waits for the context, the file reads and decodes start right away
+	const TaskId window = graph.Add("Create window", Affinity::Context, [this]() {
+		InitWindow();
+		InitOpenGlState();
+		m_UploadContext.Create(m_Window);
+		});
+	if (!m_Headless.Enabled) {
+		graph.Add("Init ImGui", Affinity::Context, [this]() { InitImGui(m_Window); }, { window });
+	}
+
+	// ------------ FILE READS ------------
+	// The images are read in one batch through the async file I/O, each decode starts once its file landed
+	static const char* const APPLE_TEXTURES[3] = {
+		"assets/models/food_apple_01_4k/textures/food_apple_01_diff_4k.jpg",
+		"assets/models/food_apple_01_4k/textures/food_apple_01_nor_gl_4k.jpg",
+		"assets/models/food_apple_01_4k/textures/food_apple_01_rough_4k.jpg"
+	};
+	std::vector<std::string> paths(std::begin(APPLE_TEXTURES), std::end(APPLE_TEXTURES));
+	// A cubemap container is a single read, the six faces otherwise
+	const std::string cubemapPath = Skybox::FindCubemap();
+	if (!cubemapPath.empty()) {
+		paths.push_back(cubemapPath);
+	}
+	else {
+		for (int face = 0; face < Skybox::FACE_COUNT; face++) {
+			paths.push_back(Skybox::GetFacePath(face));
+		}
+	}
+
+	std::vector<Onion::Core::FileData> files;
+	std::vector<TaskId> reads;
+	Onion::Core::JobCounter fileReads;
+	const TaskId submitReads = graph.Add("Submit file reads", Affinity::Worker, [&]() {
+		Onion::Core::VirtualFileSystem::ReadFilesAsync(m_FileIO, paths, files, fileReads,
+			[&graph, &reads](size_t index, bool succeeded) { graph.Complete(reads[index], succeeded); }, Onion::Core::IoPriority::High);
+		});
+	for (const std::string& path : paths) {
+		reads.push_back(graph.AddExternal("Read " + path.substr(path.find_last_of('/') + 1), { submitReads }));
+	}
+
+	// ------------ UPLOADS ------------
+	// Bulk uploads go to the upload context, or run on this thread when it could not be created.
+	// Each is a context task submitting it, then an external task done once its fence signaled.
+	std::deque<TaskId> uploads; // Stable, referenced by the submit tasks
+	const auto addUpload = [&](const std::string& name, std::function<void()> upload, std::vector<TaskId> dependencies) {
+		dependencies.push_back(window);
+		TaskId& uploaded = uploads.emplace_back();
+		const TaskId submit = graph.Add("Submit " + name, Affinity::Context, [this, &graph, &uploaded, upload]() {
+			if (m_UploadContext.IsAvailable()) {
+				m_UploadContext.Submit(upload, [&graph, &uploaded](bool succeeded) { graph.Complete(uploaded, succeeded); });
+				return;
+			}
+			try {
+				upload();
+			}
+			catch (...) {
+				graph.Complete(uploaded, false);
+				throw;
+			}
+			graph.Complete(uploaded);
+			}, dependencies);
+		uploaded = graph.AddExternal(name, { submit });
+		return uploaded;
+	};
+
+	// ------------ SHADERS ------------
+	ShaderSources modelShader;
+	const TaskId readModelShader = graph.Add("Read model shader", Affinity::Worker, [&]() {
+		modelShader = Shader::ReadSources("assets/shaders/model.vert", "assets/shaders/model.frag");
+		});
+	graph.Add("Compile model shader", Affinity::Context, [&]() {
+		m_ShaderModel = Shader(modelShader);
+		MaterialTable::SetupShader(m_ShaderModel);
+		m_MaterialTable.Create();
+		}, { window, readModelShader });
+
+	ShaderSources shadowShader;
+	const TaskId readShadowShader = graph.Add("Read shadow shader", Affinity::Worker, [&]() {
+		shadowShader = CascadedShadowMap::ReadShaderSources();
+		});
+	graph.Add("Init shadows", Affinity::Context, [&]() {
+		m_ShadowMap.Init(CascadedShadowMap::Settings{}, shadowShader);
+		}, { window, readShadowShader });
+
+	// ------------ APPLE MODEL ------------
+	std::vector<MeshData> appleMeshes;
+	const TaskId importApple = graph.Add("Import apple model", Affinity::Worker, [&]() {
+		appleMeshes = Model::Import("assets/models/food_apple_01_4k/food_apple_01_4k.gltf");
+		});
+	std::vector<MeshBuffers> appleBuffers;
+	const TaskId uploadAppleBuffers = addUpload("Upload apple model", [&]() {
+		appleBuffers = Model::UploadBuffers(appleMeshes);
+		appleMeshes.clear();
+		}, { importApple });
+	// Vertex arrays are not shared between contexts
+	const TaskId uploadApple = graph.Add("Create apple model", Affinity::Context, [&]() {
+		m_AppleModel = Model(appleBuffers);
+		}, { uploadAppleBuffers });
+
+	// Each 4K texture is uploaded as soon as it is decoded, while the others are still decoding.
+	// Bound again by the asset manager on this thread once handed over.
+	std::unique_ptr<Texture> appleTextures[3];
+	Texture* appleUploads[3] = {};
+	std::vector<TaskId> appleMaterialInputs = { uploadApple };
+	for (int i = 0; i < 3; i++) {
+		const TaskId decode = graph.Add("Decode " + paths[i].substr(paths[i].find_last_of('/') + 1), Affinity::Worker, [&, i]() {
+			appleTextures[i] = std::make_unique<Texture>(paths[i], std::move(files[i]));
+			}, { reads[i] });
+		const TaskId upload = addUpload("Upload " + paths[i].substr(paths[i].find_last_of('/') + 1), [&, i]() {
+			appleTextures[i]->Bind();
+			appleTextures[i]->Unbind();
+			}, { decode });
+		appleMaterialInputs.push_back(graph.Add("Register " + paths[i].substr(paths[i].find_last_of('/') + 1), Affinity::Context, [&, i]() {
+			appleUploads[i] = m_AssetManager.AddTexture(paths[i], std::move(appleTextures[i]));
+			}, { upload }));
+	}
+
+	graph.Add("Create apple material", Affinity::Context, [&]() {
+		Material* appleMaterial = m_AssetManager.CreateMaterial("Apple");
+		appleMaterial->Albedo = appleUploads[0];
+		appleMaterial->Normal = appleUploads[1];
+		appleMaterial->Roughness = appleUploads[2];
+
+		// Assign Material to Model
+		m_AppleModel.SetMaterial(appleMaterial);
+		}, appleMaterialInputs);
+
+	// ------------ SKYBOX ------------
+	// Otherwise loaded by its first Render
+	std::vector<TaskId> skyboxInputs;
+	if (!cubemapPath.empty()) {
+		skyboxInputs.push_back(graph.Add("Parse skybox cubemap", Affinity::Worker, [&]() {
+			m_Skybox.LoadCubemap(std::move(files[3]), cubemapPath);
+			}, { reads[3] }));
+	}
+	else {
+		for (int face = 0; face < Skybox::FACE_COUNT; face++) {
+			const size_t file = 3 + static_cast<size_t>(face);
+			skyboxInputs.push_back(graph.Add("Decode skybox face " + std::to_string(face), Affinity::Worker, [&, face, file]() {
+				m_Skybox.LoadFace(face, files[file].GetData(), files[file].GetSize());
+				files[file] = Onion::Core::FileData();
+				}, { reads[file] }));
+		}
+	}
+	const TaskId uploadSkybox = addUpload("Upload skybox", [this]() { m_Skybox.UploadTextures(); }, skyboxInputs);
+	const TaskId readSkyboxShader = graph.Add("Read skybox shader", Affinity::Worker, [this]() { m_Skybox.LoadShaderSources(); });
+	graph.Add("Init skybox", Affinity::Context, [this]() { m_Skybox.InitSkybox(); }, { window, uploadSkybox, readSkyboxShader });
+
+	// Rethrows the first failure once everything else ran, after the read callbacks returned
+	std::exception_ptr failure;
+	try {
+		graph.Run();
+	}
+	catch (...) {
+		failure = std::current_exception();
+	}
+	m_JobSystem.Wait(fileReads);
+	if (failure) {
+		std::rethrow_exception(failure);
+	}
+
+	graph.PrintSummary("[STARTUP]");
+	if (!m_StartupTracePath.empty()) {
+		graph.ExportChromeTrace(m_StartupTracePath);
+	}
+}
+
 void Onion::Rendering::Renderer::InitImGui(GLFWwindow* window)
 {
 	IMGUI_CHECKVERSION();
@@ -283,8 +746,12 @@ void Onion::Rendering::Renderer::BeginImGuiFrame()
 	ImGui::NewFrame();
 }
 
-void Onion::Rendering::Renderer::BuildImGuiDebugPanel()
+void Onion::Rendering::Renderer::BuildImGuiDebugPanel(const FrameSnapshot& snapshot)
 {
+	// Widgets edit a copy of the simulation state, changes are sent back to the simulation thread
+	SceneSettings settings = snapshot.Settings;
+	bool settingsChanged = false;
+
 	// Debug panel
 	ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiCond_FirstUseEver);
 	ImGui::SetNextWindowSize(ImVec2(250, 500), ImGuiCond_FirstUseEver);
@@ -292,40 +759,102 @@ void Onion::Rendering::Renderer::BuildImGuiDebugPanel()
 
 	ImGui::Begin("Debug Panel");
 
-	ImGui::Text("FPS: %d", static_cast<int>(m_FpsAverage));
+	// ------------------ FRAME TIMES -----------------------
+	BuildImGuiFrameStats();
+
+	// ------------------ CPU PROFILER -----------------------
+	if (ImGui::CollapsingHeader("CPU Profiler")) {
+		BuildImGuiProfiler();
+	}
+
+	ImGui::Separator();
+
+	// ------------------ GPU TIMINGS -----------------------
+	if (ImGui::CollapsingHeader("GPU Timings")) {
+		BuildImGuiGpuTimings();
+	}
+
+	ImGui::Separator();
+
+	// ------------------ PRESENTATION -----------------------
+	if (ImGui::CollapsingHeader("Presentation")) {
+		FramePacer::Settings pacerSettings = m_FramePacer.GetSettings();
+		bool pacerChanged = false;
+
+		if (ImGui::BeginCombo("Mode##Present", ToString(pacerSettings.Mode))) {
+			for (PresentMode mode : { PresentMode::VSync, PresentMode::Uncapped, PresentMode::Limited, PresentMode::LowLatency }) {
+				if (ImGui::Selectable(ToString(mode), mode == pacerSettings.Mode)) {
+					pacerSettings.Mode = mode;
+					pacerChanged = true;
+				}
+			}
+			ImGui::EndCombo();
+		}
+		if (pacerSettings.Mode == PresentMode::Limited) {
+			float targetFps = static_cast<float>(pacerSettings.TargetFps);
+			if (ImGui::SliderFloat("Target FPS##Present", &targetFps, 15.0f, 480.0f, "%.0f")) {
+				pacerSettings.TargetFps = targetFps;
+				pacerChanged = true;
+			}
+		}
+		if (pacerChanged) {
+			ApplyFramePacerSettings(pacerSettings);
+		}
+
+		const FramePacer::Stats& pacerStats = m_FramePacer.GetStats();
+		ImGui::Text("Throttle wait: %.2f ms (GPU fence %.2f ms)", pacerStats.WaitMs, pacerStats.FenceWaitMs);
+		ImGui::Text("Input to present: %.2f ms (max %.2f ms)", m_InputLatencyAverageMs, m_InputLatencyPeakMs);
+	}
+
+	ImGui::Separator();
+
+	// ------------------ SIMULATION -----------------------
+	if (ImGui::CollapsingHeader("Simulation")) {
+		const SimulationStats& stats = snapshot.Stats;
+		ImGui::Text("Tick: %llu (%.0f Hz)", static_cast<unsigned long long>(snapshot.FrameIndex), stats.TickRate);
+		ImGui::Text("Ticks this frame: %d", stats.TicksThisFrame);
+		ImGui::Text("Tick CPU: %.3f ms", stats.TickCpuMs);
+		ImGui::Text("Interpolation: %.2f", snapshot.InterpolationAlpha);
+		ImGui::Text("Dropped time: %.2f s", stats.DroppedTime);
+		if (Onion::Core::AllocationTracker::IsEnabled()) {
+			ImGui::Text("Heap allocations: %llu", static_cast<unsigned long long>(stats.HeapAllocations));
+		}
+	}
+
+	ImGui::Separator();
+
+	// ------------------ WORLD STREAMING -----------------------
+	if (m_WorldStreamer && m_WorldStreamer->IsEnabled() && ImGui::CollapsingHeader("World Streaming")) {
+		const WorldStreamer::Stats stats = m_WorldStreamer->GetStats();
+		ImGui::Text("Cells: %u active, %u loading, %u retiring", stats.ActiveCells, stats.LoadingCells, stats.RetiringCells);
+		ImGui::Text("Resident: %.1f MB", static_cast<double>(stats.ResidentBytes) / (1024.0 * 1024.0));
+		ImGui::Text("Uploaded this frame: %.2f MB", static_cast<double>(stats.UploadedBytes) / (1024.0 * 1024.0));
+		ImGui::Text("Loaded: %llu, unloaded: %llu", static_cast<unsigned long long>(stats.CellsLoaded),
+			static_cast<unsigned long long>(stats.CellsUnloaded));
+		if (m_UploadContext.IsAvailable()) {
+			const UploadContext::Stats uploads = m_UploadContext.GetStats();
+			ImGui::Text("Background uploads: %llu done, %u pending, %.1f ms", static_cast<unsigned long long>(uploads.Uploads),
+				uploads.Pending, uploads.Upload_ms);
+		}
+	}
+
+	ImGui::Separator();
 
 	// ------------------ CAMERA SETTINGS -----------------------
 	if (ImGui::CollapsingHeader("Camera Settings")) {
 		// Camera position
-		glm::vec3 camPos = m_Camera.GetPosition();
-		if (ImGui::InputFloat3("Position##Cam", &camPos.x, "%.2f")) {
-			m_Camera.SetPosition(camPos);
-		}
-		// Front vector
-		glm::vec3 camFront = m_Camera.GetFront();
-		if (ImGui::InputFloat3("Front##Cam", &camFront.x, "%.2f")) {
-			m_Camera.SetFront(camFront);
-		}
+		settingsChanged |= ImGui::InputFloat3("Position##Cam", &settings.CameraPosition.x, "%.2f");
+		// Front vector, driven by yaw and pitch
+		const glm::vec3 camFront = snapshot.SceneCamera.GetFront();
+		ImGui::Text("Front: %.2f %.2f %.2f", camFront.x, camFront.y, camFront.z);
 		// Yaw
-		float yaw = m_Camera.GetYaw();
-		if (ImGui::SliderFloat("Yaw##Cam", &yaw, -180.0f, 180.0f, "%.1f deg")) {
-			m_Camera.SetYaw(yaw);
-		}
+		settingsChanged |= ImGui::SliderFloat("Yaw##Cam", &settings.CameraYaw, -180.0f, 180.0f, "%.1f deg");
 		// Pitch
-		float pitch = m_Camera.GetPitch();
-		if (ImGui::SliderFloat("Pitch##Cam", &pitch, -89.0f, 89.0f, "%.1f deg")) {
-			m_Camera.SetPitch(pitch);
-		}
+		settingsChanged |= ImGui::SliderFloat("Pitch##Cam", &settings.CameraPitch, -89.0f, 89.0f, "%.1f deg");
 		// Speed
-		float speed = m_CameraSpeed;
-		if (ImGui::SliderFloat("Speed##Cam", &speed, 0.1f, 100.0f, "%.2f")) {
-			m_CameraSpeed = speed;
-		}
+		settingsChanged |= ImGui::SliderFloat("Speed##Cam", &settings.CameraSpeed, 0.1f, 100.0f, "%.2f");
 		// FovY slider
-		float fovY = m_Camera.GetFovY(); // get current FovY from your camera class
-		if (ImGui::SliderFloat("FovY##Cam", &fovY, 20.0f, 120.0f, "%.1f deg")) {
-			m_Camera.SetFovY(fovY); // set the new value if user changed it
-		}
+		settingsChanged |= ImGui::SliderFloat("FovY##Cam", &settings.CameraFovY, 20.0f, 120.0f, "%.1f deg");
 	}
 
 	ImGui::Separator();
@@ -333,27 +862,168 @@ void Onion::Rendering::Renderer::BuildImGuiDebugPanel()
 	// ------------------ APPLE MODEL SETTINGS -----------------------
 	if (ImGui::CollapsingHeader("Apple Model Settings")) {
 		// Tranform
-		ImGui::InputFloat3("Position##Apple", &m_AppleTransform.Position.x, "%.2f");
+		Transform& appleTransform = settings.AppleTransform;
+		settingsChanged |= ImGui::InputFloat3("Position##Apple", &appleTransform.Position.x, "%.2f");
 		ImGui::Text("Apple Rotation (Degrees)");
-		ImGui::SliderFloat("Pitch (X)", &m_AppleTransform.Rotation.x, -180.0f, 180.0f);
-		ImGui::SliderFloat("Yaw   (Y)", &m_AppleTransform.Rotation.y, -180.0f, 180.0f);
-		ImGui::SliderFloat("Roll  (Z)", &m_AppleTransform.Rotation.z, -180.0f, 180.0f);
-		ImGui::SliderFloat3("Scale##Apple", &m_AppleTransform.Scale.x, 0.01f, 5.0f, "%.2f");
-		// Light Direction
-		if (ImGui::InputFloat3("Light Direction##Apple", &m_AppleLightDirection.x, "%.2f")) {
-			m_AppleLightDirection = glm::normalize(m_AppleLightDirection);
-		}
+		settingsChanged |= ImGui::SliderFloat("Pitch (X)", &appleTransform.Rotation.x, -180.0f, 180.0f);
+		settingsChanged |= ImGui::SliderFloat("Yaw   (Y)", &appleTransform.Rotation.y, -180.0f, 180.0f);
+		settingsChanged |= ImGui::SliderFloat("Roll  (Z)", &appleTransform.Rotation.z, -180.0f, 180.0f);
+		settingsChanged |= ImGui::SliderFloat3("Scale##Apple", &appleTransform.Scale.x, 0.01f, 5.0f, "%.2f");
+		// Light Direction, normalized by the simulation
+		settingsChanged |= ImGui::InputFloat3("Light Direction##Apple", &settings.Light.Direction.x, "%.2f");
 		// Light Color
-		ImGui::ColorEdit3("Light Color##Apple", &m_AppleLightColor.x);
+		settingsChanged |= ImGui::ColorEdit3("Light Color##Apple", &settings.Light.Color.x);
 		// Ambient
-		ImGui::ColorEdit3("Ambient##Apple", &m_AppleAmbient.x);
+		settingsChanged |= ImGui::ColorEdit3("Ambient##Apple", &settings.Light.Ambient.x);
 		// Specular Strength
-		ImGui::SliderFloat("Specular Strength##Apple", &m_AppleSpecularStrength, 0.0f, 1.0f, "%.2f");
+		settingsChanged |= ImGui::SliderFloat("Specular Strength##Apple", &settings.Light.SpecularStrength, 0.0f, 1.0f, "%.2f");
+	}
+
+	if (settingsChanged) {
+		std::lock_guard<std::mutex> lock(m_MutexSceneEdits);
+		m_SceneEdits.push_back({ snapshot.Settings, settings });
+	}
+
+	ImGui::Separator();
+
+	// ------------------ SHADOWS -----------------------
+	if (ImGui::CollapsingHeader("Shadows")) {
+		float totalGpuMs = 0.0f;
+		int renderedThisFrame = 0;
+
+		if (ImGui::BeginTable("Cascades##Shadows", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchSame)) {
+			ImGui::TableSetupColumn("#");
+			ImGui::TableSetupColumn("Far");
+			ImGui::TableSetupColumn("GPU ms");
+			ImGui::TableSetupColumn("CPU ms");
+			ImGui::TableSetupColumn("Age");
+			ImGui::TableHeadersRow();
+
+			for (int i = 0; i < m_ShadowMap.GetCascadeCount(); i++) {
+				const auto& stats = m_ShadowMap.GetCascadeStats(i);
+				totalGpuMs += stats.RenderedThisFrame ? stats.GpuTimeMs : 0.0f;
+				renderedThisFrame += stats.RenderedThisFrame ? 1 : 0;
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%d%s", i, stats.Cached ? " (C)" : "");
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f", stats.SplitFar);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", stats.GpuTimeMs);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", stats.CpuTimeMs);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", static_cast<unsigned long long>(m_FrameIndex - stats.LastRenderedFrame));
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::Text("Cascades rendered this frame: %d", renderedThisFrame);
+		ImGui::Text("Shadow pass GPU: %.3f ms", totalGpuMs);
 	}
 
 	ImGui::End();
 }
 
+void Onion::Rendering::Renderer::BuildImGuiFrameStats()
+{
+	const Onion::Core::FrameStats::Summary& stats = m_FrameStats.GetWindowSummary();
+
+	const float fps = stats.FrameMs.Mean > 0.0f ? 1000.0f / stats.FrameMs.Mean : 0.0f;
+	ImGui::Text("FPS: %d  (%.2f ms)", static_cast<int>(fps), stats.FrameMs.Mean);
+	ImGui::Text("Draw calls: %llu  Triangles: %llu",
+		static_cast<unsigned long long>(m_SceneRenderStats.DrawCalls), static_cast<unsigned long long>(m_SceneRenderStats.Triangles));
+	ImGui::Text("Material binds: %llu  Texture binds: %llu",
+		static_cast<unsigned long long>(m_SceneRenderStats.MaterialBinds), static_cast<unsigned long long>(m_SceneRenderStats.TextureBinds));
+	if (Onion::Core::AllocationTracker::IsEnabled()) {
+		ImGui::Text("Heap allocations: %llu", static_cast<unsigned long long>(m_FrameHeapAllocations));
+	}
+	else {
+		ImGui::Text("Heap allocations: not tracked (ONION_TRACK_ALLOCATIONS is off)");
+	}
+	ImGui::Text("Frame arena: %.1f / %.1f KB",
+		static_cast<double>(m_FrameArena.Get().GetUsed()) / 1024.0, static_cast<double>(m_FrameArena.Get().GetCapacity()) / 1024.0);
+
+	int count = 0;
+	int offset = 0;
+	const float* history = m_FrameStats.GetFrameTimeHistory(count, offset);
+	char overlay[64];
+	std::snprintf(overlay, sizeof(overlay), "p99 %.2f ms  max %.2f ms", stats.FrameMs.P99, stats.FrameMs.Max);
+	ImGui::PlotLines("##FrameTimes", history, count, offset, overlay, 0.0f, std::max(33.3f, stats.FrameMs.P99 * 1.5f), ImVec2(0, 60));
+
+	if (ImGui::BeginTable("Percentiles##FrameStats", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchSame)) {
+		ImGui::TableSetupColumn("ms");
+		ImGui::TableSetupColumn("p50");
+		ImGui::TableSetupColumn("p95");
+		ImGui::TableSetupColumn("p99");
+		ImGui::TableSetupColumn("max");
+		ImGui::TableHeadersRow();
+
+		const auto row = [](const char* name, const Onion::Core::FrameStats::Percentiles& p) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", p.P50);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", p.P95);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", p.P99);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", p.Max);
+			};
+		row("Frame", stats.FrameMs);
+		row("CPU", stats.CpuMs);
+		row("GPU", stats.GpuMs);
+		ImGui::EndTable();
+	}
+
+	ImGui::Text("Hitches (> 2x median): %llu in the last %llu frames",
+		static_cast<unsigned long long>(stats.HitchCount), static_cast<unsigned long long>(stats.FrameCount));
+}
+
+void Onion::Rendering::Renderer::BuildImGuiGpuTimings()
+{
+	ImGui::Text("GPU frame: %.3f ms", m_GpuProfiler.GetFrameGpuMs());
+
+	for (int i = 0; i < m_GpuProfiler.GetPassCount(); i++) {
+		int count = 0;
+		int offset = 0;
+		const float* history = m_GpuProfiler.GetPassHistory(i, count, offset);
+
+		char overlay[32];
+		std::snprintf(overlay, sizeof(overlay), "%.3f ms", m_GpuProfiler.GetPassLastMs(i));
+
+		const std::string& name = m_GpuProfiler.GetPassName(i);
+		ImGui::PlotLines(name.c_str(), history, count, offset, overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+	}
+}
+
+void Onion::Rendering::Renderer::BuildImGuiProfiler()
+{
+#if ONION_ENABLE_PROFILER
+	using Onion::Core::Profiler;
+
+	if (!Profiler::IsCapturing()) {
+		if (ImGui::Button("Start capture##Profiler")) {
+			Profiler::BeginCapture();
+		}
+	}
+	else if (ImGui::Button("Stop and export##Profiler")) {
+		Profiler::EndCapture();
+		Profiler::ExportChromeTrace("onion_trace.json");
+	}
+
+	ImGui::Text("Zones: %llu (dropped %llu)",
+		static_cast<unsigned long long>(Profiler::GetRecordedZoneCount()),
+		static_cast<unsigned long long>(Profiler::GetDroppedZoneCount()));
+	ImGui::TextUnformatted("Open onion_trace.json in ui.perfetto.dev");
+#else
+	ImGui::TextUnformatted("Disabled (ONION_ENABLE_PROFILER=OFF)");
+#endif
+}
+
 void Onion::Rendering::Renderer::RenderImGui()
 {
 	ImGui::Render();
@@ -367,27 +1037,7 @@ void Onion::Rendering::Renderer::ShutdownImGui()
 	ImGui::DestroyContext();
 }
 
-void Onion::Rendering::Renderer::InitAppleModel()
-{
-	// Create Model Shader
-	m_ShaderModel = Shader("assets/shaders/model.vert", "assets/shaders/model.frag");
-	m_ShaderModel.setInt("uAlbedo", 0);
-	m_ShaderModel.setInt("uRoughness", 1);
-
-	// Create Model
-	m_AppleModel = Model("assets/models/food_apple_01_4k/food_apple_01_4k.gltf");
-
-	// Create Material
-	Material* appleMaterial = m_AssetManager.CreateMaterial("Apple");
-	appleMaterial->Albedo = m_AssetManager.LoadTexture("assets/models/food_apple_01_4k/textures/food_apple_01_diff_4k.jpg");
-	appleMaterial->Normal = m_AssetManager.LoadTexture("assets/models/food_apple_01_4k/textures/food_apple_01_nor_gl_4k.jpg");
-	appleMaterial->Roughness = m_AssetManager.LoadTexture("assets/models/food_apple_01_4k/textures/food_apple_01_rough_4k.jpg");
-
-	// Assign Material to Model
-	m_AppleModel.SetMaterial(appleMaterial);
-}
-
-void Onion::Rendering::Renderer::UpdateShaderModel()
+void Onion::Rendering::Renderer::UpdateShaderModel(const FrameSnapshot& snapshot)
 {
 	m_ShaderModel.Use();
 
@@ -395,36 +1045,99 @@ void Onion::Rendering::Renderer::UpdateShaderModel()
 	m_ShaderModel.setMat4("uView", m_ViewMatrix);
 	m_ShaderModel.setMat4("uProj", m_ProjectionMatrix);
 	m_ShaderModel.setMat4("uViewProj", m_ViewProjMatrix);
-	m_ShaderModel.setMat4("uModel", m_AppleTransform.GetModelMatrix());
 
 	// Lighting
-	m_ShaderModel.setVec3("uLightDir", glm::normalize(m_AppleLightDirection));
-	m_ShaderModel.setVec3("uLightColor", m_AppleLightColor);
-	m_ShaderModel.setVec3("uAmbient", m_AppleAmbient);
+	m_ShaderModel.setVec3("uLightDir", glm::normalize(snapshot.Light.Direction));
+	m_ShaderModel.setVec3("uLightColor", snapshot.Light.Color);
+	m_ShaderModel.setVec3("uAmbient", snapshot.Light.Ambient);
 
 	// Camera
-	m_ShaderModel.setVec3("uCameraPos", m_Camera.GetPosition());
+	m_ShaderModel.setVec3("uCameraPos", snapshot.SceneCamera.GetPosition());
 
 	// Specular control
-	m_ShaderModel.setFloat("uSpecularStrength", m_AppleSpecularStrength);
+	m_ShaderModel.setFloat("uSpecularStrength", snapshot.Light.SpecularStrength);
+
+	// Shadows, on the first unit after the material textures
+	m_ShadowMap.Bind(m_ShaderModel, static_cast<int>(MaterialSlot::Count));
 
 }
 
-void Onion::Rendering::Renderer::DrawAppleModel()
+void Onion::Rendering::Renderer::DrawScene(const FrameSnapshot& snapshot)
 {
-	Material* appleMaterial = m_AppleModel.GetMaterial();
+	using Onion::Core::ArenaAllocator;
 
-	glActiveTexture(GL_TEXTURE0);
-	appleMaterial->Albedo->Bind();
+	// Draw order grouped by textures, material then model
+	Onion::Core::ArenaVector<const DrawItem*> drawOrder{ ArenaAllocator<const DrawItem*>(m_FrameArena.Get()) };
+	drawOrder.reserve(snapshot.DrawList.size());
+	for (const DrawItem& item : snapshot.DrawList) {
+		drawOrder.push_back(&item);
+	}
+	std::sort(drawOrder.begin(), drawOrder.end(), [](const DrawItem* a, const DrawItem* b) {
+		const Material* materialA = GetDrawMaterial(*a);
+		const Material* materialB = GetDrawMaterial(*b);
+		if (materialA != materialB) {
+			return MaterialDrawsBefore(materialA, materialB);
+		}
+		return std::less<const Model*>()(a->SourceModel, b->SourceModel);
+		});
 
-	glActiveTexture(GL_TEXTURE1);
-	appleMaterial->Roughness->Bind();
+	// A block per unique material, all written by one buffer update
+	Onion::Core::ArenaVector<uint32_t> blocks{ ArenaAllocator<uint32_t>(m_FrameArena.Get()) };
+	blocks.reserve(drawOrder.size());
+	m_MaterialTable.Begin();
+	for (const DrawItem* item : drawOrder) {
+		blocks.push_back(m_MaterialTable.Add(*GetDrawMaterial(*item)));
+	}
+	m_MaterialTable.Upload();
 
-	m_AppleModel.Draw(m_ShaderModel);
+	// Binding the block already bound is a no-op
+	for (size_t i = 0; i < drawOrder.size(); i++) {
+		m_MaterialTable.Bind(blocks[i]);
+		m_ShaderModel.setMat4("uModel", drawOrder[i]->ModelMatrix);
+		drawOrder[i]->SourceModel->Draw(m_ShaderModel);
+	}
+}
+
+void Onion::Rendering::Renderer::RenderShadows(const FrameSnapshot& snapshot)
+{
+	ONION_PROFILE_SCOPE("Shadows");
+	m_ShadowMap.Update(snapshot.SceneCamera, snapshot.Light.Direction, snapshot.CastersVersion);
+
+	// Filtered once, every cascade that renders this frame walks the same list
+	Onion::Core::ArenaVector<const DrawItem*> casters{ Onion::Core::ArenaAllocator<const DrawItem*>(m_FrameArena.Get()) };
+	casters.reserve(snapshot.DrawList.size());
+	for (const DrawItem& item : snapshot.DrawList) {
+		if (item.CastsShadows) {
+			casters.push_back(&item);
+		}
+	}
+
+	m_ShadowMap.Render([&casters](const Shader& depthShader) {
+		for (const DrawItem* item : casters) {
+			depthShader.setMat4("uModel", item->ModelMatrix);
+			item->SourceModel->Draw(depthShader);
+		}
+		});
+
+	// Cascades are timed by the shadow map's own queries, which cannot nest in a profiler pass.
+	// One sample per shadow render once all its queries landed, none for the frames reusing the cached cascades.
+	for (const float gpuMs : m_ShadowMap.GetCompletedRenderTimes()) {
+		m_GpuProfiler.RecordPassTime("Shadows", gpuMs);
+	}
 }
 
 void Onion::Rendering::Renderer::CleanupOpenGL()
 {
+	// Hands over the uploads in flight first, the streamed assets are freed with the rest
+	m_UploadContext.Destroy();
+	m_FramePacer.Delete();
+	m_GpuProfiler.Delete();
+	m_Framebuffer.Delete();
+	m_ShadowMap.Delete();
+	if (m_WorldStreamer) {
+		m_WorldStreamer->ReleaseGpuResources();
+	}
 	m_AssetManager.FreeAllAssets();
+	m_MaterialTable.Delete();
 	m_ShaderModel.Delete();
 }
\ No newline at end of file
@@ -7,8 +7,12 @@
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_opengl3.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #include <string>
+#include <vector>
 
 #include "shader/shader.hpp"
 #include "texture/texture.hpp"
@@ -17,26 +21,111 @@
 #include "model/model.hpp"
 #include "asset_manager/asset_manager.hpp"
 #include "structs/transform.hpp"
+#include "structs/frame_snapshot.hpp"
+#include "structs/render_stats.hpp"
 #include "skybox/skybox.hpp"
+#include "shadows/cascaded_shadow_map.hpp"
+#include "frame_pacer/frame_pacer.hpp"
+#include "gpu_profiler/gpu_profiler.hpp"
+#include "offscreen_context/offscreen_context.hpp"
+#include "framebuffer/framebuffer.hpp"
+#include "upload_context/upload_context.hpp"
+#include "material_table/material_table.hpp"
+
+#include "../core/async_file_io/async_file_io.hpp"
+#include "../core/job_system/job_system.hpp"
+#include "../core/triple_buffer/triple_buffer.hpp"
+#include "../core/profiler/profiler.hpp"
+#include "../core/frame_stats/frame_stats.hpp"
+#include "../core/frame_arena/frame_arena.hpp"
 
 namespace Onion::Rendering
 {
+	class WorldStreamer;
+
 	class Renderer {
 
 	public:
-		Renderer();
+		struct HeadlessSettings {
+			bool Enabled = false;
+			OffscreenBackend Backend = OffscreenBackend::Auto; // Auto: EGL, then OSMesa
+			int Width = 1280;
+			int Height = 720;
+			uint64_t MaxFrames = 0;		// Stops after that many rendered frames, 0 runs until Stop
+			std::string CapturePath;	// PNG of the last rendered frame, written on exit when set
+		};
+
+	public:
+		Renderer(Onion::Core::JobSystem& jobSystem, Onion::Core::AsyncFileIO& fileIO);
 		~Renderer();
 
 		void Start();
 		void Stop();
 
+		// False once the window has been closed
+		bool IsRunning() const;
+		// Closes the window at the end of the current frame. Any thread.
+		void RequestClose();
+
+		// Inputs must be registered before Start
+		Onion::Controls::InputsManager& GetInputsManager();
+		// Latest inputs polled by the render thread, Sequence is 0 until the first frame. Any thread, lock-free.
+		Onion::Controls::InputsSnapshot GetInputsSnapshot() const;
+
+		const Model* GetAppleModel() const;
+
+		// Presentation mode and frame limiter, applied at the start of the next frame
+		void SetFramePacerSettings(const FramePacer::Settings& settings);
+
+		// GPU time per pass, for automated benchmarks. Thread-safe.
+		std::vector<GpuPassStats> GetGpuPassStats() const;
+		void ResetGpuPassStats();
+
+		// Frame time percentiles of the whole session. Thread-safe.
+		Onion::Core::FrameStats::Summary GetFrameStatsSummary() const;
+		// Where the summary is written on exit (<path>.json and <path>.csv), empty to disable. Call before Start.
+		void SetFrameStatsOutput(const std::string& basePath);
+
+		// Renders into an offscreen framebuffer, without a window, ImGui or inputs.
+		// Works without a display or GPU (Mesa llvmpipe). Call before Start.
+		void SetHeadless(const HeadlessSettings& settings);
+		bool IsHeadless() const {
+			return m_Headless.Enabled;
+		}
+
+		// Streamed assets are uploaded and freed by the render thread. Call before Start.
+		void SetWorldStreamer(WorldStreamer* streamer);
+
+		// Writes the startup task graph as a Chrome trace, empty to disable. Call before Start.
+		void SetStartupTraceOutput(const std::string& path);
+
+		// ------------ FRAME SNAPSHOTS (simulation thread) ------------
+
+		// Waits until the render thread picked up the previous snapshot, so the simulation stays at most
+		// one frame ahead, then returns the buffer to fill. Returns nullptr once the renderer stopped.
+		FrameSnapshot* BeginSnapshot();
+		void PublishSnapshot();
+
+		// Moves out the edits made in the debug panel since the last call
+		bool TakeSceneSettingsEdits(std::vector<SceneSettingsEdit>& edits);
+
 	private:
 		void InitWindow();
 		void InitOpenGlState();
 
+		// Window, shaders, skybox and models: CPU work on the workers, GL calls on the render thread,
+		// bulk uploads on the upload context
+		void RunStartup();
+		std::string m_StartupTracePath;
+
 		void RenderThreadFunction(std::stop_token stopToken);
 		std::jthread m_ThreadRenderer;
 
+		// Owned by the Engine
+		Onion::Core::JobSystem& m_JobSystem;
+		Onion::Core::AsyncFileIO& m_FileIO;
+		WorldStreamer* m_WorldStreamer = nullptr;
+
 		//GLFW
 	private:
 		GLFWwindow* m_Window = nullptr;
@@ -49,63 +138,129 @@ namespace Onion::Rendering
 		double m_LastFrame = 0.0f;
 
 	private:
-		Camera m_Camera;
-		glm::mat4 m_ViewMatrix;
-		glm::mat4 m_ProjectionMatrix;
-		glm::mat4 m_ViewProjMatrix;
-
-		float m_CameraSpeed = 5.0f;
+		glm::mat4 m_ViewMatrix{ 1.0f };
+		glm::mat4 m_ProjectionMatrix{ 1.0f };
+		glm::mat4 m_ViewProjMatrix{ 1.0f };
 
 	private:
 		Onion::Controls::InputsManager m_InputsManager;
-		std::shared_ptr<Onion::Controls::InputsSnapshot> m_InputsSnapshot;
-		void RegisterInputs();
-		int m_InputIdMoveForward = -1;
-		int m_InputIdMoveBackward = -1;
-		int m_InputIdMoveLeft = -1;
-		int m_InputIdMoveRight = -1;
-		int m_InputIdMoveUp = -1;
-		int m_InputIdMoveDown = -1;
-		int m_InputIdSpeedUp = -1;
-		int m_InputIdUnfocus = -1;
+
+		// ------------ HEADLESS ------------
+	private:
+		HeadlessSettings m_Headless;
+		OffscreenContext m_OffscreenContext;
+		Framebuffer m_Framebuffer;
+
+		void InitHeadless();
+		void CaptureFramebuffer();
+
+		// ------------ FRAME SNAPSHOTS ------------
+	private:
+		Onion::Core::TripleBuffer<FrameSnapshot> m_Snapshots;
+		bool m_HasSnapshot = false; // Render thread only
+
+		// Pacing between the two threads, the triple buffer itself never blocks
+		std::atomic<bool> m_IsRunning{ false };
+		std::atomic<bool> m_CloseRequested{ false };
+		std::atomic<uint64_t> m_SnapshotsPublished{ 0 };
+		std::atomic<uint64_t> m_SnapshotsConsumed{ 0 };
+		std::mutex m_MutexPacing;
+		std::condition_variable m_PacingCondition;
+
+		// Late input sampling: the simulation waits for inputs polled after its previous snapshot
+		std::atomic<bool> m_LateInputSampling{ false };
+		std::atomic<uint64_t> m_InputsPolled{ 0 };
+		uint64_t m_InputsUsed = 0; // Simulation thread only
+
+		std::mutex m_MutexSceneEdits;
+		std::vector<SceneSettingsEdit> m_SceneEdits;
+
+		bool AcquireSnapshot();
+		void NotifyPacing();
+
+		// ------------ BACKGROUND UPLOADS ------------
+	private:
+		// Shares the render context: textures and buffers are filled by its loader thread, off the frame.
+		// Created with the window, when the platform allows it.
+		UploadContext m_UploadContext;
 
 		// ------------- SKYBOX ------------
 	private:
 		Skybox m_Skybox;
 
+		// ------------ SHADOWS ------------
+	private:
+		CascadedShadowMap m_ShadowMap;
+
+		void RenderShadows(const FrameSnapshot& snapshot);
+
+		// ------------ FRAME PACING ------------
+	private:
+		FramePacer m_FramePacer;
+
+		std::mutex m_MutexPacerSettings;
+		FramePacer::Settings m_PendingPacerSettings;
+		bool m_HasPendingPacerSettings = false;
+
+		void ApplyFramePacerSettings(const FramePacer::Settings& settings);
+		void RecordInputLatency(double inputsTime);
+
+		// ------------ GPU PROFILING ------------
+	private:
+		GpuProfiler m_GpuProfiler;
+
+		void BuildImGuiGpuTimings();
+
+		// ------------ CPU PROFILING ------------
+	private:
+		void BuildImGuiProfiler();
+
 		// ------------ IMGUI ------------
 	private:
 		void InitImGui(GLFWwindow* window);
 		void BeginImGuiFrame();
-		void BuildImGuiDebugPanel();
+		void BuildImGuiDebugPanel(const FrameSnapshot& snapshot);
 		void RenderImGui();
 		void ShutdownImGui();
 
 		// ------------ STATISTICS ------------
 	private:
-		double m_FpsAverage = 0.0;
+		Onion::Core::FrameStats m_FrameStats;
+		mutable std::mutex m_MutexFrameStats;
+		std::string m_FrameStatsPath = "onion_frame_stats";
+		RenderStats m_SceneRenderStats;
+		uint64_t m_FrameHeapAllocations = 0; // operator new calls made by the render thread during the last frame
+
+		void BuildImGuiFrameStats();
+
+		// Inputs poll to frame presented, averaged over the same window as the FPS
+		double m_InputLatencySumMs = 0.0;
+		double m_InputLatencyMaxMs = 0.0;
+		int m_InputLatencySamples = 0;
+		double m_InputLatencyAverageMs = 0.0;
+		double m_InputLatencyPeakMs = 0.0;
+		double m_PendingLatencyInputsTime = 0.0; // LowLatency: measured once the frame fence signaled
+		uint64_t m_FrameIndex = 0;
+
+		// Transient data (sort lists, caster lists) that only lives for the frame being built
+		Onion::Core::FrameArena m_FrameArena;
 
 		// ------------ TESTS ------------
 	private:
 		AssetManager m_AssetManager;
 		Model m_AppleModel;
 		Shader m_ShaderModel;
+		// Blocks and textures of the materials drawn by DrawScene
+		MaterialTable m_MaterialTable;
 
-		void InitAppleModel();
-		void UpdateShaderModel();
-		void DrawAppleModel();
+		void UpdateShaderModel(const FrameSnapshot& snapshot);
+		void DrawScene(const FrameSnapshot& snapshot);
 
 		void CleanupOpenGL();
 
-		Transform m_AppleTransform;
-		glm::vec3 m_AppleLightDirection = glm::normalize(glm::vec3(-1.0f, -1.0f, -0.5f));
-		glm::vec3 m_AppleLightColor = glm::vec3(1.0f);
-		glm::vec3 m_AppleAmbient = glm::vec3(0.5f);
-		float m_AppleSpecularStrength = 0.5f;
-
 	private:
-		void ProcessCameraMovement(const std::shared_ptr<Onion::Controls::InputsSnapshot>& inputs);
-		void ProcessInputs(const std::shared_ptr<Onion::Controls::InputsSnapshot>& inputs);
+		void ProcessInputs(const Onion::Controls::InputsSnapshot& inputs);
+		void ApplySnapshotState(const FrameSnapshot& snapshot);
 
 	};
 }
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "shader.hpp"
 
-#include <fstream>
 #include <glad/glad.h>
 #include <iostream>
-#include <sstream>
+
+#include "../../core/profiler/profiler.hpp"
+#include "../../core/virtual_file_system/virtual_file_system.hpp"
 
 using namespace Onion::Rendering;
 
@@ -11,6 +12,10 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 	Compile(vertexPath, fragmentPath);
 }
 
+Shader::Shader(const ShaderSources& sources) {
+	Compile(sources);
+}
+
 Shader& Shader::operator=(Shader&& other) noexcept {
 	if (this != &other) {
 		ID = other.ID; // Transfer ownership
@@ -20,48 +25,33 @@ Shader& Shader::operator=(Shader&& other) noexcept {
 	return *this;
 }
 
-void Shader::Compile(const char* vertexPath, const char* fragmentPath) {
-	// 1. Retrieve the vertex/fragment source code from filePath
-	std::string vertexCode, fragmentCode;
-	std::ifstream vShaderFile, fShaderFile;
-
-	// Enable exceptions to catch read errors
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-	try {
-		// Open shader files
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-
-		// Check if actually opened (warns about missing file)
-		if (!vShaderFile.is_open()) {
-			std::cout << "WARNING: Failed to open vertex shader file: " << vertexPath << std::endl;
-		}
-		if (!fShaderFile.is_open()) {
-			std::cout << "WARNING: Failed to open fragment shader file: " << fragmentPath << std::endl;
-		}
-
-		// Read file content into streams
-		std::stringstream vShaderStream, fShaderStream;
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-
-		// Close files
-		vShaderFile.close();
-		fShaderFile.close();
-
-		// Convert to strings
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+ShaderSources Shader::ReadSources(const char* vertexPath, const char* fragmentPath) {
+	ONION_PROFILE_SCOPE("Shader::ReadSources");
+	// From the mounted archives, or the loose files
+	ShaderSources sources;
+	sources.VertexPath = vertexPath;
+	sources.FragmentPath = fragmentPath;
+	if (!Onion::Core::VirtualFileSystem::ReadText(vertexPath, sources.Vertex)) {
+		std::cout << "ERROR: Shader file not successfully read: " << vertexPath << std::endl;
+		throw std::runtime_error("Shader file read error");
 	}
-	catch (std::ifstream::failure& e) {
-		std::cout << "ERROR: Shader file not successfully read: " << e.what() << std::endl;
+	if (!Onion::Core::VirtualFileSystem::ReadText(fragmentPath, sources.Fragment)) {
+		std::cout << "ERROR: Shader file not successfully read: " << fragmentPath << std::endl;
 		throw std::runtime_error("Shader file read error");
 	}
+	return sources;
+}
+
+void Shader::Compile(const char* vertexPath, const char* fragmentPath) {
+	// 1. Retrieve the vertex/fragment source code from filePath
+	Compile(ReadSources(vertexPath, fragmentPath));
+}
+
+void Shader::Compile(const ShaderSources& sources) {
+	ONION_PROFILE_SCOPE("Shader::Compile");
 
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
+	const char* vShaderCode = sources.Vertex.c_str();
+	const char* fShaderCode = sources.Fragment.c_str();
 
 	// 2. Compile shaders
 	unsigned int vertex, fragment;
@@ -122,42 +112,42 @@ void Shader::Delete() {
 	ID = 0;
 }
 
-void Shader::setBool(const std::string& name, bool value) const {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+void Shader::setBool(const char* name, bool value) const {
+	glUniform1i(glGetUniformLocation(ID, name), (int)value);
 }
 
-void Shader::setInt(const std::string& name, int value) const {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setInt(const char* name, int value) const {
+	glUniform1i(glGetUniformLocation(ID, name), value);
 }
 
-void Shader::setFloat(const std::string& name, float value) const {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setFloat(const char* name, float value) const {
+	glUniform1f(glGetUniformLocation(ID, name), value);
 }
 
-void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
-	glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::setVec2(const char* name, const glm::vec2& value) const {
+	glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]);
 }
 
-void Shader::setVec2(const std::string& name, float x, float y) const {
-	glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+void Shader::setVec2(const char* name, float x, float y) const {
+	glUniform2f(glGetUniformLocation(ID, name), x, y);
 }
 
-void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::setVec3(const char* name, const glm::vec3& value) const {
+	glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
 }
 
-void Shader::setVec3(const std::string& name, float x, float y, float z) const {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+void Shader::setVec3(const char* name, float x, float y, float z) const {
+	glUniform3f(glGetUniformLocation(ID, name), x, y, z);
 }
 
-void Shader::setMat2(const std::string& name, const glm::mat2& mat) const {
-	glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+void Shader::setMat2(const char* name, const glm::mat2& mat) const {
+	glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::setMat3(const std::string& name, const glm::mat3& mat) const {
-	glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+void Shader::setMat3(const char* name, const glm::mat3& mat) const {
+	glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+void Shader::setMat4(const char* name, const glm::mat4& mat) const {
+	glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
 }
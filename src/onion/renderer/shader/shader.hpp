@@ -5,12 +5,21 @@
 
 namespace Onion::Rendering {
 
+	// Source code of a program, read without any GL call so it can be loaded on any thread
+	struct ShaderSources {
+		std::string VertexPath;
+		std::string FragmentPath;
+		std::string Vertex;
+		std::string Fragment;
+	};
+
 	class Shader {
 	public:
 		unsigned int ID = 0;
 
 		Shader() = default;
 		Shader(const char* vertexPath, const char* fragmentPath);
+		explicit Shader(const ShaderSources& sources);
 		~Shader();
 
 		// Delete copy constructor and assignment
@@ -27,6 +36,10 @@ namespace Onion::Rendering {
 		Shader& operator=(Shader&& other) noexcept;
 
 		void Compile(const char* vertexPath, const char* fragmentPath);
+		void Compile(const ShaderSources& sources);
+
+		// Throws std::runtime_error when a file cannot be read
+		static ShaderSources ReadSources(const char* vertexPath, const char* fragmentPath);
 		bool HasBeenCompiled() const {
 			return m_HasBeenCompiled;
 		}
@@ -34,16 +47,48 @@ namespace Onion::Rendering {
 		void Use() const;
 		void Delete();
 
-		void setBool(const std::string& name, bool value) const;
-		void setInt(const std::string& name, int value) const;
-		void setFloat(const std::string& name, float value) const;
-		void setVec2(const std::string& name, const glm::vec2& value) const;
-		void setVec2(const std::string& name, float x, float y) const;
-		void setVec3(const std::string& name, const glm::vec3& value) const;
-		void setVec3(const std::string& name, float x, float y, float z) const;
-		void setMat2(const std::string& name, const glm::mat2& mat) const;
-		void setMat3(const std::string& name, const glm::mat3& mat) const;
-		void setMat4(const std::string& name, const glm::mat4& mat) const;
+		// Names are passed as C strings: literals do not build a std::string (and allocate) on every call
+		void setBool(const char* name, bool value) const;
+		void setInt(const char* name, int value) const;
+		void setFloat(const char* name, float value) const;
+		void setVec2(const char* name, const glm::vec2& value) const;
+		void setVec2(const char* name, float x, float y) const;
+		void setVec3(const char* name, const glm::vec3& value) const;
+		void setVec3(const char* name, float x, float y, float z) const;
+		void setMat2(const char* name, const glm::mat2& mat) const;
+		void setMat3(const char* name, const glm::mat3& mat) const;
+		void setMat4(const char* name, const glm::mat4& mat) const;
+
+		void setBool(const std::string& name, bool value) const {
+			setBool(name.c_str(), value);
+		}
+		void setInt(const std::string& name, int value) const {
+			setInt(name.c_str(), value);
+		}
+		void setFloat(const std::string& name, float value) const {
+			setFloat(name.c_str(), value);
+		}
+		void setVec2(const std::string& name, const glm::vec2& value) const {
+			setVec2(name.c_str(), value);
+		}
+		void setVec2(const std::string& name, float x, float y) const {
+			setVec2(name.c_str(), x, y);
+		}
+		void setVec3(const std::string& name, const glm::vec3& value) const {
+			setVec3(name.c_str(), value);
+		}
+		void setVec3(const std::string& name, float x, float y, float z) const {
+			setVec3(name.c_str(), x, y, z);
+		}
+		void setMat2(const std::string& name, const glm::mat2& mat) const {
+			setMat2(name.c_str(), mat);
+		}
+		void setMat3(const std::string& name, const glm::mat3& mat) const {
+			setMat3(name.c_str(), mat);
+		}
+		void setMat4(const std::string& name, const glm::mat4& mat) const {
+			setMat4(name.c_str(), mat);
+		}
 
 	private:
 		bool m_HasBeenCompiled = false;
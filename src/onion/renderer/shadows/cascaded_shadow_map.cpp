@@ -0,0 +1,390 @@
+#include "cascaded_shadow_map.hpp"
+
+#include <glad/glad.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include "../../core/profiler/profiler.hpp"
+
+using namespace Onion::Rendering;
+
+namespace {
+	// Built once: Bind runs every frame and must not allocate
+	constexpr const char* CASCADE_VIEW_PROJ_NAMES[] = { "uCascadeViewProj[0]", "uCascadeViewProj[1]", "uCascadeViewProj[2]", "uCascadeViewProj[3]" };
+	constexpr const char* CASCADE_SPLIT_NAMES[] = { "uCascadeSplits[0]", "uCascadeSplits[1]", "uCascadeSplits[2]", "uCascadeSplits[3]" };
+	static_assert(std::size(CASCADE_VIEW_PROJ_NAMES) == static_cast<size_t>(CascadedShadowMap::MAX_CASCADES));
+	static_assert(std::size(CASCADE_SPLIT_NAMES) == static_cast<size_t>(CascadedShadowMap::MAX_CASCADES));
+}
+
+CascadedShadowMap::~CascadedShadowMap()
+{
+	if (m_Fbo != 0) {
+		std::cout << "[SHADOWS] [WARNING] : Shadow map not deleted before destruction. There is a memory leak." << std::endl;
+	}
+}
+
+void CascadedShadowMap::Init(const Settings& settings)
+{
+	Init(settings, ReadShaderSources());
+}
+
+ShaderSources CascadedShadowMap::ReadShaderSources()
+{
+	return Shader::ReadSources("assets/shaders/shadow_depth.vert", "assets/shaders/shadow_depth.frag");
+}
+
+void CascadedShadowMap::Init(const Settings& settings, const ShaderSources& depthShader)
+{
+	m_Settings = settings;
+	m_Settings.CascadeCount = std::clamp(m_Settings.CascadeCount, 1, MAX_CASCADES);
+	m_Settings.AlwaysUpdatedCascades = std::clamp(m_Settings.AlwaysUpdatedCascades, 0, m_Settings.CascadeCount);
+
+	m_ShaderDepth = Shader(depthShader);
+
+	// Depth texture array, one layer per cascade, with hardware depth comparison (PCF)
+	glGenTextures(1, &m_DepthArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_DepthArray);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, m_Settings.Resolution, m_Settings.Resolution, m_Settings.CascadeCount, 0,
+		GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	const float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// Depth only framebuffer, the cascade layer is attached before each render
+	glGenFramebuffers(1, &m_Fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_Fbo);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_DepthArray, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Shadow map framebuffer is incomplete");
+	}
+
+	for (int i = 0; i < m_Settings.CascadeCount; i++) {
+		glGenQueries(2, m_Cascades[i].Queries.data());
+	}
+
+	Invalidate();
+}
+
+void CascadedShadowMap::Delete()
+{
+	for (auto& cascade : m_Cascades) {
+		if (cascade.Queries[0] != 0) {
+			glDeleteQueries(2, cascade.Queries.data());
+			cascade.Queries = { 0, 0 };
+		}
+		cascade.QueryIssued = { false, false };
+	}
+	m_PendingRenders.clear();
+	m_CompletedRenderTimes.clear();
+
+	glDeleteFramebuffers(1, &m_Fbo);
+	glDeleteTextures(1, &m_DepthArray);
+	m_Fbo = 0;
+	m_DepthArray = 0;
+
+	m_ShaderDepth.Delete();
+}
+
+void CascadedShadowMap::Invalidate()
+{
+	m_ForceInvalidate = true;
+}
+
+void CascadedShadowMap::Update(const Camera& camera, const glm::vec3& lightDirection, uint64_t castersVersion)
+{
+	m_FrameIndex++;
+
+	const glm::vec3 light = glm::normalize(lightDirection);
+	const bool lightChanged = glm::dot(light, m_LightDirection) < 0.99999f;
+	const bool castersChanged = castersVersion != m_CastersVersion;
+
+	if (lightChanged || castersChanged || m_ForceInvalidate) {
+		for (int i = 0; i < m_Settings.CascadeCount; i++) {
+			m_Cascades[i].Valid = false;
+		}
+		m_LightDirection = light;
+		m_CastersVersion = castersVersion;
+		m_ForceInvalidate = false;
+	}
+
+	ComputeSplits(camera);
+
+	const glm::vec3 camPos = camera.GetPosition();
+	const glm::vec3 front = glm::normalize(camera.GetFront());
+	const glm::vec3 right = glm::normalize(glm::cross(front, camera.GetUp()));
+	const glm::vec3 up = glm::cross(right, front);
+	const float tanHalfFovY = std::tan(glm::radians(camera.GetFovY()) * 0.5f);
+	const float tanHalfFovX = tanHalfFovY * camera.GetAspectRatio();
+
+	// Candidates for the amortized refresh of cached cascades
+	std::array<int, MAX_CASCADES> staleCascades{};
+	int staleCount = 0;
+
+	for (int i = 0; i < m_Settings.CascadeCount; i++) {
+		Cascade& cascade = m_Cascades[i];
+		cascade.Stats.RenderedThisFrame = false;
+		cascade.Stats.SplitFar = cascade.SplitFar;
+
+		if (i < m_Settings.AlwaysUpdatedCascades) {
+			// Tight bounding sphere of the frustum slice. Its radius does not depend on the camera
+			// orientation, so the projection size is constant and texel snapping keeps the edges stable.
+			glm::vec3 corners[8];
+			int c = 0;
+			for (float dist : { cascade.SplitNear, cascade.SplitFar }) {
+				const glm::vec3 planeCenter = camPos + front * dist;
+				const glm::vec3 dx = right * (dist * tanHalfFovX);
+				const glm::vec3 dy = up * (dist * tanHalfFovY);
+				corners[c++] = planeCenter - dx - dy;
+				corners[c++] = planeCenter + dx - dy;
+				corners[c++] = planeCenter - dx + dy;
+				corners[c++] = planeCenter + dx + dy;
+			}
+
+			glm::vec3 center(0.0f);
+			for (const auto& corner : corners)
+				center += corner;
+			center /= 8.0f;
+
+			float radius = 0.0f;
+			for (const auto& corner : corners)
+				radius = std::max(radius, glm::length(corner - center));
+			radius = std::ceil(radius * 16.0f) / 16.0f;
+
+			cascade.Stats.Cached = false;
+			cascade.Stats.Radius = radius;
+			ComputeCascadeMatrix(cascade, center, radius);
+			cascade.RenderedCenter = center;
+			cascade.NeedsRender = true;
+			continue;
+		}
+
+		// Cached cascades are centered on the camera, so they stay valid whatever the camera orientation.
+		// The radius is padded by twice the threshold, so the slice remains covered until the refresh happens.
+		cascade.Stats.Cached = true;
+		const float sliceRadius = cascade.SplitFar * std::sqrt(1.0f + tanHalfFovX * tanHalfFovX + tanHalfFovY * tanHalfFovY);
+		const float threshold = sliceRadius * m_Settings.UpdateThresholdRatio;
+
+		const bool moved = glm::length(camPos - cascade.RenderedCenter) > threshold;
+		if (cascade.Stats.RenderCount == 0) {
+			// Never rendered: nothing to sample from, render it regardless of the budget
+			const float radius = std::ceil((sliceRadius + 2.0f * threshold) * 16.0f) / 16.0f;
+			cascade.Stats.Radius = radius;
+			ComputeCascadeMatrix(cascade, camPos, radius);
+			cascade.RenderedCenter = camPos;
+			cascade.NeedsRender = true;
+		}
+		else if (!cascade.Valid || moved) {
+			staleCascades[staleCount++] = i;
+		}
+	}
+
+	// Refresh the most outdated cached cascades first, within the per frame budget
+	std::sort(staleCascades.begin(), staleCascades.begin() + staleCount, [this](int a, int b) {
+		return m_Cascades[a].Stats.LastRenderedFrame < m_Cascades[b].Stats.LastRenderedFrame;
+		});
+
+	const int budget = std::min(staleCount, m_Settings.MaxCachedUpdatesPerFrame);
+	for (int s = 0; s < budget; s++) {
+		Cascade& cascade = m_Cascades[staleCascades[s]];
+		const float sliceRadius = cascade.SplitFar * std::sqrt(1.0f + tanHalfFovX * tanHalfFovX + tanHalfFovY * tanHalfFovY);
+		const float threshold = sliceRadius * m_Settings.UpdateThresholdRatio;
+		const float radius = std::ceil((sliceRadius + 2.0f * threshold) * 16.0f) / 16.0f;
+
+		cascade.Stats.Radius = radius;
+		ComputeCascadeMatrix(cascade, camPos, radius);
+		cascade.RenderedCenter = camPos;
+		cascade.NeedsRender = true;
+	}
+}
+
+void CascadedShadowMap::ComputeSplits(const Camera& camera)
+{
+	const float nearPlane = std::max(camera.GetNearPlane(), 0.1f);
+	const float farPlane = std::min(m_Settings.MaxShadowDistance, camera.GetFarPlane());
+	const int count = m_Settings.CascadeCount;
+
+	float previous = nearPlane;
+	for (int i = 0; i < count; i++) {
+		const float p = static_cast<float>(i + 1) / static_cast<float>(count);
+		const float logSplit = nearPlane * std::pow(farPlane / nearPlane, p);
+		const float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+
+		m_Cascades[i].SplitNear = previous;
+		m_Cascades[i].SplitFar = m_Settings.SplitLambda * logSplit + (1.0f - m_Settings.SplitLambda) * uniformSplit;
+		previous = m_Cascades[i].SplitFar;
+	}
+}
+
+void CascadedShadowMap::ComputeCascadeMatrix(Cascade& cascade, const glm::vec3& center, float radius) const
+{
+	// Fixed light orientation, only the ortho bounds move, snapped to whole texels
+	const glm::vec3 up = std::abs(m_LightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), m_LightDirection, up);
+
+	glm::vec3 centerLS = glm::vec3(lightView * glm::vec4(center, 1.0f));
+	const float texelSize = (2.0f * radius) / static_cast<float>(m_Settings.Resolution);
+	centerLS.x = std::floor(centerLS.x / texelSize) * texelSize;
+	centerLS.y = std::floor(centerLS.y / texelSize) * texelSize;
+
+	// Light space looks down -Z: distances along the light are -z
+	const float nearDist = -centerLS.z - radius - m_Settings.DepthPadding;
+	const float farDist = -centerLS.z + radius;
+
+	const glm::mat4 lightProj = glm::ortho(centerLS.x - radius, centerLS.x + radius, centerLS.y - radius, centerLS.y + radius, nearDist, farDist);
+	cascade.ViewProj = lightProj * lightView;
+}
+
+void CascadedShadowMap::ReadBackTimings(Cascade& cascade)
+{
+	// Never blocks: results are only read once the GPU reports them available
+	for (int q = 0; q < 2; q++) {
+		if (!cascade.QueryIssued[q])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(cascade.Queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+
+		GLuint64 elapsedNs = 0;
+		glGetQueryObjectui64v(cascade.Queries[q], GL_QUERY_RESULT, &elapsedNs);
+		cascade.Stats.GpuTimeMs = static_cast<float>(static_cast<double>(elapsedNs) / 1.0e6);
+		cascade.QueryIssued[q] = false;
+		AddRenderTime(cascade.QueryFrame[q], cascade.Stats.GpuTimeMs);
+	}
+}
+
+void CascadedShadowMap::AddRenderTime(uint64_t frame, float gpuTimeMs)
+{
+	for (auto it = m_PendingRenders.begin(); it != m_PendingRenders.end(); ++it) {
+		if (it->Frame != frame) {
+			continue;
+		}
+		it->GpuTimeMs += gpuTimeMs;
+		if (--it->Outstanding == 0) {
+			if (it->Timed) {
+				m_CompletedRenderTimes.push_back(it->GpuTimeMs);
+			}
+			m_PendingRenders.erase(it);
+		}
+		return;
+	}
+}
+
+void CascadedShadowMap::Render(const std::function<void(const Shader& depthShader)>& drawCasters)
+{
+	ONION_PROFILE_SCOPE("CascadedShadowMap::Render");
+	m_CompletedRenderTimes.clear();
+	for (int i = 0; i < m_Settings.CascadeCount; i++) {
+		ReadBackTimings(m_Cascades[i]);
+	}
+
+	bool anyToRender = false;
+	for (int i = 0; i < m_Settings.CascadeCount; i++) {
+		anyToRender |= m_Cascades[i].NeedsRender;
+	}
+	if (!anyToRender)
+		return;
+
+	// Save state
+	GLint oldViewport[4];
+	glGetIntegerv(GL_VIEWPORT, oldViewport);
+	GLint oldFramebuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &oldFramebuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_Fbo);
+	glViewport(0, 0, m_Settings.Resolution, m_Settings.Resolution);
+
+	// Slope scaled bias to fight shadow acne
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+
+	m_ShaderDepth.Use();
+
+	PendingRender& pending = m_PendingRenders.emplace_back();
+	pending.Frame = m_FrameIndex;
+
+	for (int i = 0; i < m_Settings.CascadeCount; i++) {
+		Cascade& cascade = m_Cascades[i];
+		if (!cascade.NeedsRender)
+			continue;
+
+		const auto cpuStart = std::chrono::steady_clock::now();
+
+		// Skip the timing if the query slot is still pending, rather than stalling on it
+		const int queryIndex = cascade.QueryIndex;
+		const bool timed = !cascade.QueryIssued[queryIndex];
+		if (timed)
+			glBeginQuery(GL_TIME_ELAPSED, cascade.Queries[queryIndex]);
+
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_DepthArray, 0, i);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		m_ShaderDepth.setMat4("uLightViewProj", cascade.ViewProj);
+		drawCasters(m_ShaderDepth);
+
+		if (timed) {
+			glEndQuery(GL_TIME_ELAPSED);
+			cascade.QueryIssued[queryIndex] = true;
+			cascade.QueryFrame[queryIndex] = m_FrameIndex;
+			cascade.QueryIndex = queryIndex ^ 1;
+			pending.Outstanding++;
+		}
+		else {
+			pending.Timed = false;
+		}
+
+		const auto cpuEnd = std::chrono::steady_clock::now();
+		cascade.Stats.CpuTimeMs = std::chrono::duration<float, std::milli>(cpuEnd - cpuStart).count();
+		cascade.Stats.RenderedThisFrame = true;
+		cascade.Stats.LastRenderedFrame = m_FrameIndex;
+		cascade.Stats.RenderCount++;
+
+		cascade.NeedsRender = false;
+		cascade.Valid = true;
+	}
+
+	if (pending.Outstanding == 0) {
+		m_PendingRenders.pop_back();
+	}
+
+	// Restore state
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(oldFramebuffer));
+	glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
+}
+
+void CascadedShadowMap::Bind(const Shader& shader, int textureUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(textureUnit));
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_DepthArray);
+	glActiveTexture(GL_TEXTURE0);
+
+	shader.setInt("uShadowMap", textureUnit);
+	shader.setInt("uCascadeCount", m_Settings.CascadeCount);
+	shader.setFloat("uShadowTexelSize", 1.0f / static_cast<float>(m_Settings.Resolution));
+
+	for (int i = 0; i < m_Settings.CascadeCount; i++) {
+		shader.setMat4(CASCADE_VIEW_PROJ_NAMES[i], m_Cascades[i].ViewProj);
+		shader.setFloat(CASCADE_SPLIT_NAMES[i], m_Cascades[i].SplitFar);
+	}
+}
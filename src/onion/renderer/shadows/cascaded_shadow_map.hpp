@@ -0,0 +1,141 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "../shader/shader.hpp"
+#include "../camera/camera.hpp"
+
+namespace Onion::Rendering {
+
+	// Cascaded shadow maps for a single directional light.
+	// Near cascades are re-rendered every frame, far cascades are cached and only re-rendered
+	// when the camera moved more than their threshold, when the casters or the light changed.
+	class CascadedShadowMap {
+	public:
+		static constexpr int MAX_CASCADES = 4;
+
+		struct Settings {
+			int Resolution = 2048;
+			int CascadeCount = 4;
+			float MaxShadowDistance = 60.0f; // Distance from the camera covered by the last cascade
+			float SplitLambda = 0.75f;		 // Blend between logarithmic (1) and uniform (0) splits
+			int AlwaysUpdatedCascades = 1;	 // Number of near cascades re-rendered every frame
+			float UpdateThresholdRatio = 0.1f; // Camera distance (relative to the cascade radius) before a cached cascade is refreshed
+			int MaxCachedUpdatesPerFrame = 1; // Amortization budget for cached cascades
+			float DepthPadding = 50.0f;		 // Extra depth towards the light, for casters outside the view
+		};
+
+		struct CascadeStats {
+			float SplitFar = 0.0f;
+			float Radius = 0.0f;
+			bool Cached = false;
+			bool RenderedThisFrame = false;
+			uint64_t LastRenderedFrame = 0;
+			uint64_t RenderCount = 0;
+			float CpuTimeMs = 0.0f;
+			float GpuTimeMs = 0.0f;
+		};
+
+	public:
+		CascadedShadowMap() = default;
+		~CascadedShadowMap();
+
+		CascadedShadowMap(const CascadedShadowMap&) = delete;
+		CascadedShadowMap& operator=(const CascadedShadowMap&) = delete;
+
+		void Init() {
+			Init(Settings{});
+		}
+		void Init(const Settings& settings);
+		// With the depth shader sources read beforehand (ReadShaderSources), on any thread
+		void Init(const Settings& settings, const ShaderSources& depthShader);
+		static ShaderSources ReadShaderSources();
+		void Delete();
+		bool HasBeenInitialized() const {
+			return m_Fbo != 0;
+		}
+
+		// Computes the cascades and flags the ones that must be re-rendered this frame.
+		// castersVersion must change whenever any shadow caster moved (sum of Transform::Version).
+		void Update(const Camera& camera, const glm::vec3& lightDirection, uint64_t castersVersion);
+
+		// Renders the flagged cascades. drawCasters is called once per rendered cascade,
+		// with the depth shader bound and its 'uLightViewProj' uniform set. It must set 'uModel' and draw.
+		void Render(const std::function<void(const Shader& depthShader)>& drawCasters);
+
+		// Binds the shadow map array on the given texture unit and uploads the cascade uniforms.
+		void Bind(const Shader& shader, int textureUnit) const;
+
+		// Forces every cascade to be re-rendered on next Update (settings change, ...)
+		void Invalidate();
+
+		const Settings& GetSettings() const {
+			return m_Settings;
+		}
+		int GetCascadeCount() const {
+			return m_Settings.CascadeCount;
+		}
+		const CascadeStats& GetCascadeStats(int cascade) const {
+			return m_Cascades[cascade].Stats;
+		}
+		// GPU time of the earlier shadow renders whose cascade queries all landed during this Render, one per render.
+		// Empty on most frames: results arrive a few frames late, and frames reusing the cached cascades render nothing.
+		const std::vector<float>& GetCompletedRenderTimes() const {
+			return m_CompletedRenderTimes;
+		}
+
+	private:
+		struct Cascade {
+			float SplitNear = 0.0f;
+			float SplitFar = 0.0f;
+			glm::mat4 ViewProj{ 1.0f };
+
+			// State of the last render, used to decide whether the cached cascade is still valid
+			glm::vec3 RenderedCenter{ 0.0f };
+			bool NeedsRender = true;
+			bool Valid = false;
+
+			// GPU timing (ping-pong, the result of the previous query is read when available)
+			std::array<unsigned int, 2> Queries{ 0, 0 };
+			std::array<bool, 2> QueryIssued{ false, false };
+			std::array<uint64_t, 2> QueryFrame{ 0, 0 };	// Frame of the render each query timed
+			int QueryIndex = 0;
+
+			CascadeStats Stats;
+		};
+
+		void ComputeSplits(const Camera& camera);
+		void ComputeCascadeMatrix(Cascade& cascade, const glm::vec3& center, float radius) const;
+		void ReadBackTimings(Cascade& cascade);
+		void AddRenderTime(uint64_t frame, float gpuTimeMs);
+
+	private:
+		Settings m_Settings;
+		std::array<Cascade, MAX_CASCADES> m_Cascades;
+
+		unsigned int m_Fbo = 0;
+		unsigned int m_DepthArray = 0;
+		Shader m_ShaderDepth;
+
+		glm::vec3 m_LightDirection{ 0.0f, -1.0f, 0.0f };
+		uint64_t m_CastersVersion = 0;
+		uint64_t m_FrameIndex = 0;
+		bool m_ForceInvalidate = true;
+
+		// Shadow renders waiting for the queries of their cascades. Untimed when a cascade skipped its query.
+		struct PendingRender {
+			uint64_t Frame = 0;
+			int Outstanding = 0;
+			bool Timed = true;
+			float GpuTimeMs = 0.0f;
+		};
+		std::vector<PendingRender> m_PendingRenders;
+		std::vector<float> m_CompletedRenderTimes;
+	};
+
+} // namespace Onion::Rendering
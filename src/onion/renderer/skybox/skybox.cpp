@@ -1,5 +1,9 @@
 #include "skybox.hpp"
 
+#include "../structs/render_stats.hpp"
+#include "../texture_container/texture_container.hpp"
+#include "../../core/virtual_file_system/virtual_file_system.hpp"
+
 #include <glad/glad.h>
 
 #include <GLFW/glfw3.h>
@@ -13,6 +17,23 @@
 
 using namespace Onion::Rendering;
 
+namespace {
+	// Tried in order before the faces
+	const char* const CUBEMAP_PATHS[] = {
+		"assets/textures/skybox/skybox.ktx2",
+		"assets/textures/skybox/skybox.dds"
+	};
+
+	const char* const FACE_PATHS[Skybox::FACE_COUNT] = {
+		"assets/textures/skybox/right.bmp",  // +X
+		"assets/textures/skybox/left.bmp",   // -X
+		"assets/textures/skybox/top.bmp",	   // +Y
+		"assets/textures/skybox/bottom.bmp", // -Y
+		"assets/textures/skybox/front.bmp",  // +Z
+		"assets/textures/skybox/back.bmp"	   // -Z
+	};
+}
+
 Skybox::Skybox() {
 }
 
@@ -65,6 +86,7 @@ void Skybox::Render(const glm::mat4& View, const glm::mat4& Projection)
 
 	glBindVertexArray(m_VAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
+	RenderStats::AddDraw(12);
 	glBindVertexArray(0);
 
 	// ------------------------------------------------------------
@@ -92,6 +114,15 @@ void Skybox::Delete() {
 	glDeleteVertexArrays(1, &m_VAO);
 	glDeleteBuffers(1, &m_VBO);
 	glDeleteTextures(1, &m_TextureID);
+
+	// Loaded but never uploaded
+	m_Cubemap.reset();
+	for (Face& face : m_Faces) {
+		if (face.Data) {
+			stbi_image_free(face.Data);
+			face.Data = nullptr;
+		}
+	}
 }
 
 
@@ -103,9 +134,15 @@ void Skybox::InitSkybox() {
 
 	std::lock_guard<std::mutex> lock(m_MutexInit);
 
-	m_ShaderSkybox = Shader("assets/shaders/skybox.vert", "assets/shaders/skybox.frag");
+	if (!m_HasShaderSources) {
+		LoadShaderSources();
+	}
+	m_ShaderSkybox = Shader(m_ShaderSources);
+	m_ShaderSources = ShaderSources();
 
-	LoadTextures();
+	if (m_TextureID == 0) {
+		UploadTextures();
+	}
 
 	const float skyboxVertices[] = { -1.0f, 1.0f,  -1.0f, // front face
 									-1.0f, -1.0f, -1.0f, 1.0f,	-1.0f, -1.0f, 1.0f,	 -1.0f, -1.0f, 1.0f,  1.0f,	 -1.0f, -1.0f, 1.0f,  -1.0f,
@@ -141,34 +178,109 @@ bool Skybox::HasBeenInitialized() const {
 	return m_HasBeenInitialized;
 }
 
-void Skybox::LoadTextures() {
+void Skybox::LoadShaderSources() {
+	m_ShaderSources = Shader::ReadSources("assets/shaders/skybox.vert", "assets/shaders/skybox.frag");
+	m_HasShaderSources = true;
+}
 
-	const std::vector<std::string> faces = {
-		"assets/textures/skybox/right.bmp",  // +X
-		"assets/textures/skybox/left.bmp",   // -X
-		"assets/textures/skybox/top.bmp",	   // +Y
-		"assets/textures/skybox/bottom.bmp", // -Y
-		"assets/textures/skybox/front.bmp",  // +Z
-		"assets/textures/skybox/back.bmp"	   // -Z
-	};
+std::string Skybox::FindCubemap() {
+	for (const char* path : CUBEMAP_PATHS) {
+		if (Onion::Core::VirtualFileSystem::Exists(path)) {
+			return path;
+		}
+	}
+	return std::string();
+}
+
+bool Skybox::LoadCubemap(Onion::Core::FileData file, const std::string& path) {
+	m_CubemapChecked = true;
+
+	auto cubemap = std::make_unique<TextureContainer>();
+	if (!cubemap->Parse(std::move(file), path)) {
+		return false;
+	}
+	if (cubemap->GetTarget() != TextureContainer::Target::Cubemap) {
+		std::cerr << "Not a cubemap, loading the faces instead: " << path << std::endl;
+		return false;
+	}
+	m_Cubemap = std::move(cubemap);
+	return true;
+}
+
+const char* Skybox::GetFacePath(int face) {
+	return FACE_PATHS[face];
+}
+
+void Skybox::LoadFace(int index) {
+	Onion::Core::FileData file;
+	if (!Onion::Core::VirtualFileSystem::ReadFile(FACE_PATHS[index], file)) {
+		m_Faces[index].Loaded = true;
+		std::cerr << "Failed to load cubemap texture at " << FACE_PATHS[index] << std::endl;
+		return;
+	}
+	LoadFace(index, file.GetData(), file.GetSize());
+}
+
+void Skybox::LoadFace(int index, const uint8_t* fileData, size_t fileSize) {
+	Face& face = m_Faces[index];
+	face.Loaded = true;
+
+	int nrChannels;
+	stbi_set_flip_vertically_on_load_thread(false);
+	face.Data = stbi_load_from_memory(fileData, static_cast<int>(fileSize), &face.Width, &face.Height, &nrChannels, 3);
+	if (!face.Data) {
+		std::cerr << "Failed to load cubemap texture at " << FACE_PATHS[index] << std::endl;
+	}
+}
+
+bool Skybox::UploadCubemap() {
+
+	if (!m_CubemapChecked) {
+		const std::string path = FindCubemap();
+		Onion::Core::FileData file;
+		if (!path.empty() && Onion::Core::VirtualFileSystem::ReadFile(path, file)) {
+			LoadCubemap(std::move(file), path);
+		}
+		m_CubemapChecked = true;
+	}
+	if (!m_Cubemap) {
+		return false;
+	}
+
+	// Faces and mips as stored, nothing to decode
+	const unsigned int textureID = m_Cubemap->Upload();
+	if (textureID != 0) {
+		const bool mipmapped = m_Cubemap->GetLevelCount() > 1;
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		m_TextureID = textureID;
+	}
+	m_Cubemap.reset();
+	return textureID != 0;
+}
+
+void Skybox::UploadTextures() {
+
+	if (UploadCubemap()) {
+		return;
+	}
 
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-	int width, height, nrChannels;
-
-	stbi_set_flip_vertically_on_load(false);
-
-	for (unsigned int i = 0; i < faces.size(); i++) {
-		unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (data) {
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
+	for (int i = 0; i < FACE_COUNT; i++) {
+		Face& face = m_Faces[i];
+		if (!face.Loaded) {
+			LoadFace(i);
 		}
-		else {
-			std::cerr << "Failed to load cubemap texture at " << faces[i] << std::endl;
-			stbi_image_free(data);
+		if (face.Data) {
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, face.Width, face.Height, 0, GL_RGB, GL_UNSIGNED_BYTE, face.Data);
+			stbi_image_free(face.Data);
+			face.Data = nullptr;
 		}
 	}
 
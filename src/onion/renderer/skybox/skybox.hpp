@@ -4,18 +4,49 @@
 // #include <stb_image.h>
 
 #include "../shader/shader.hpp"
+#include "../../core/virtual_file_system/virtual_file_system.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <string>
 
 namespace Onion::Rendering {
+	class TextureContainer;
+
+	// Cubemap from a KTX2/DDS container when there is one (one read, the faces and mips uploaded as stored),
+	// from six images decoded by stb otherwise
 	class Skybox {
 	public:
+		static constexpr int FACE_COUNT = 6; // +X, -X, +Y, -Y, +Z, -Z
+
 		Skybox();
 		~Skybox();
 
 		void Render(const glm::mat4& ViewProjMatrix, const glm::mat4& Projection);
 		void Delete();
 
+		// ------------ LOADING ------------
+	public:
+		// CPU side, no GL calls: can run on workers, concurrently for different faces
+		// Empty when there is no cubemap container, the faces are loaded instead
+		static std::string FindCubemap();
+		// False when the file is not a valid cubemap, the faces are loaded instead
+		bool LoadCubemap(Onion::Core::FileData file, const std::string& path);
+		static const char* GetFacePath(int face);
+		void LoadFace(int face);
+		// Decodes a face file already read
+		void LoadFace(int face, const uint8_t* fileData, size_t fileSize);
+		void LoadShaderSources();
+
+		// Any context (the upload context for instance): uploads the cubemap, loading first what the calls above did not
+		void UploadTextures();
+
+		// Render thread: compiles the shader and creates the vertex array, uploading the cubemap if not done yet.
+		// The first Render calls it otherwise.
+		void InitSkybox();
+
 	private:
 		unsigned int m_TextureID = 0;
 
@@ -23,10 +54,21 @@ namespace Onion::Rendering {
 
 		Shader m_ShaderSkybox;
 
-		void InitSkybox();
 		bool HasBeenInitialized() const;
 
-		void LoadTextures();
+		bool UploadCubemap();
+
+		struct Face {
+			unsigned char* Data = nullptr; // stb_image, freed once uploaded
+			int Width = 0;
+			int Height = 0;
+			bool Loaded = false;
+		};
+		Face m_Faces[FACE_COUNT];
+		std::unique_ptr<TextureContainer> m_Cubemap;
+		bool m_CubemapChecked = false;
+		ShaderSources m_ShaderSources;
+		bool m_HasShaderSources = false;
 
 		mutable std::mutex m_MutexInit;
 		bool m_HasBeenInitialized = false;
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "transform.hpp"
+#include "../camera/camera.hpp"
+
+namespace Onion::Rendering {
+
+	class Model;
+	class Material;
+
+	struct DirectionalLight {
+		glm::vec3 Direction = glm::normalize(glm::vec3(-1.0f, -1.0f, -0.5f));
+		glm::vec3 Color = glm::vec3(1.0f);
+		glm::vec3 Ambient = glm::vec3(0.5f);
+		float SpecularStrength = 0.5f;
+	};
+
+	struct DrawItem {
+		const Model* SourceModel = nullptr;
+		glm::mat4 ModelMatrix{ 1.0f };
+		bool CastsShadows = true;
+		const Material* SourceMaterial = nullptr; // nullptr: the model's own material
+	};
+
+	// Scene values exposed in the debug panel.
+	// The render thread edits a copy and hands it back to the simulation, which applies it on its next update.
+	struct SceneSettings {
+		glm::vec3 CameraPosition{ 0.0f };
+		float CameraYaw = 0.0f;
+		float CameraPitch = 0.0f;
+		float CameraFovY = 45.0f;
+		float CameraSpeed = 5.0f;
+
+		Transform AppleTransform;
+		DirectionalLight Light;
+	};
+
+	struct SceneSettingsEdit {
+		SceneSettings Before;
+		SceneSettings After;
+	};
+
+	// Everything the render thread needs to draw one frame. Written by the simulation thread,
+	// read-only once published. Vectors keep their capacity between frames, so steady state does not allocate.
+	struct SimulationStats {
+		double TickRate = 0.0;
+		int TicksThisFrame = 0;
+		double TickCpuMs = 0.0;		// Average cost of one tick over the last frame that ran some
+		double DroppedTime = 0.0;	// Seconds skipped by the spiral-of-death protection
+		uint64_t HeapAllocations = 0; // operator new calls made by the simulation thread for this frame
+	};
+
+	struct FrameSnapshot {
+		uint64_t FrameIndex = 0;	// Simulation tick
+		double SimulationTime = 0.0;
+		float InterpolationAlpha = 1.0f; // Position between the previous and the current tick
+		double InputsTime = 0.0; // glfwGetTime() when the inputs used for this frame were polled
+		SimulationStats Stats;
+
+		Camera SceneCamera{ glm::vec3(0.0f), 800, 600 };
+		DirectionalLight Light;
+
+		std::vector<DrawItem> DrawList;
+		uint64_t CastersVersion = 0; // Changes whenever a shadow caster moved
+		uint64_t StreamingEpoch = 0; // WorldStreamer::GetEpoch() when built, streamed assets older than this can go
+
+		bool MouseCaptureEnabled = false;
+
+		SceneSettings Settings;
+	};
+
+} // namespace Onion::Rendering
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Onion::Rendering {
+
+	// Draw calls and triangles submitted by the calling thread (the one owning the GL context).
+	// Reset at the start of a frame, read at the end.
+	struct RenderStats {
+		uint64_t DrawCalls = 0;
+		uint64_t Triangles = 0;
+		uint64_t MaterialBinds = 0;		// Parameter blocks bound, see MaterialTable
+		uint64_t TextureBinds = 0;
+
+		static RenderStats& Current() {
+			static thread_local RenderStats stats;
+			return stats;
+		}
+
+		static void Reset() {
+			Current() = RenderStats{};
+		}
+
+		static void AddDraw(uint64_t triangles) {
+			RenderStats& stats = Current();
+			stats.DrawCalls++;
+			stats.Triangles += triangles;
+		}
+
+		static void AddMaterialBind(uint64_t textureBinds) {
+			RenderStats& stats = Current();
+			stats.MaterialBinds++;
+			stats.TextureBinds += textureBinds;
+		}
+	};
+
+} // namespace Onion::Rendering
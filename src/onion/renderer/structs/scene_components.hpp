@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "transform.hpp"
+
+namespace Onion::Rendering {
+
+	class Model;
+	class Material;
+
+	// ECS components of the scene objects. Entities with Transform, MeshRef and MaterialRef are drawn.
+
+	struct MeshRef {
+		const Model* Source = nullptr; // Owned by the renderer or the asset manager
+		bool CastsShadows = true;
+	};
+
+	struct MaterialRef {
+		const Material* Source = nullptr; // nullptr: the model's own material
+	};
+
+	// Transform at the previous tick, rendering interpolates from it. Optional.
+	struct PreviousTransform {
+		Transform Value;
+	};
+
+	// Model matrix kept while the transform does not change. Optional.
+	struct CachedModelMatrix {
+		glm::mat4 Matrix{ 1.0f };
+		uint32_t Version = 0;	// Transform version the matrix was built from
+		bool Valid = false;
+	};
+
+} // namespace Onion::Rendering
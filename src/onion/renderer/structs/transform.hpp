@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdint>
+
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 namespace Onion::Rendering {
 
@@ -10,15 +14,55 @@ namespace Onion::Rendering {
 		glm::vec3 Rotation{ 0.0f, 0.0f, 0.0f }; // Euler angles in degrees
 		glm::vec3 Scale{ 1.0f, 1.0f, 1.0f };
 
+		// Incremented each time the transform is modified.
+		// Consumers (shadow caches, ...) compare it against the last version they have seen.
+		uint32_t Version = 0;
+
+		void MarkDirty() {
+			Version++;
+		}
+
+		// Same rotation as the Euler angles: X, then Y, then Z, in the object frame
+		glm::quat GetOrientation() const {
+			const glm::vec3 angles = glm::radians(Rotation);
+			return glm::angleAxis(angles.x, glm::vec3(1.0f, 0.0f, 0.0f))
+				* glm::angleAxis(angles.y, glm::vec3(0.0f, 1.0f, 0.0f))
+				* glm::angleAxis(angles.z, glm::vec3(0.0f, 0.0f, 1.0f));
+		}
+
 		glm::mat4 GetModelMatrix() const {
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, Position);
-			model = glm::rotate(model, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-			model = glm::rotate(model, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-			model = glm::rotate(model, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-			model = glm::scale(model, Scale);
+			return ComposeMatrix(Position, GetOrientation(), Scale);
+		}
+
+		// translate * rotate * scale written out, without the 4x4 products. 'rotation' must be normalized.
+		static glm::mat4 ComposeMatrix(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+			const float xx = rotation.x * rotation.x;
+			const float yy = rotation.y * rotation.y;
+			const float zz = rotation.z * rotation.z;
+			const float xy = rotation.x * rotation.y;
+			const float xz = rotation.x * rotation.z;
+			const float yz = rotation.y * rotation.z;
+			const float wx = rotation.w * rotation.x;
+			const float wy = rotation.w * rotation.y;
+			const float wz = rotation.w * rotation.z;
+
+			glm::mat4 model;
+			model[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * scale.x, 2.0f * (xy + wz) * scale.x, 2.0f * (xz - wy) * scale.x, 0.0f);
+			model[1] = glm::vec4(2.0f * (xy - wz) * scale.y, (1.0f - 2.0f * (xx + zz)) * scale.y, 2.0f * (yz + wx) * scale.y, 0.0f);
+			model[2] = glm::vec4(2.0f * (xz + wy) * scale.z, 2.0f * (yz - wx) * scale.z, (1.0f - 2.0f * (xx + yy)) * scale.z, 0.0f);
+			model[3] = glm::vec4(position, 1.0f);
 			return model;
 		}
+
+		// Blends two states of the same transform, used to render between two simulation ticks.
+		// Keeps the version of 'to'.
+		static Transform Interpolate(const Transform& from, const Transform& to, float alpha) {
+			Transform result = to;
+			result.Position = glm::mix(from.Position, to.Position, alpha);
+			result.Rotation = glm::mix(from.Rotation, to.Rotation, alpha);
+			result.Scale = glm::mix(from.Scale, to.Scale, alpha);
+			return result;
+		}
 	};
 
-} // namespace Onion::Rendering
\ No newline at end of file
+} // namespace Onion::Rendering
@@ -9,6 +9,9 @@ namespace Onion::Rendering {
 		glm::vec3 Position;
 		glm::vec3 Normal;
 		glm::vec2 UV;
+		// Along +U, for the normal maps. w is the handedness: the bitangent is cross(Normal, Tangent) * w.
+		// Zero when the mesh has no UVs.
+		glm::vec4 Tangent;
 	};
 
 } // namespace Onion::Rendering
\ No newline at end of file
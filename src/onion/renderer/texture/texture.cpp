@@ -7,6 +7,10 @@
 
 #include <iostream>
 
+#include "../../core/profiler/profiler.hpp"
+#include "../../core/virtual_file_system/virtual_file_system.hpp"
+#include "../texture_container/texture_container.hpp"
+
 using namespace Onion::Rendering;
 
 Texture::Texture(const std::string& filePath, Type textureType) {
@@ -16,6 +20,22 @@ Texture::Texture(const std::string& filePath, Type textureType) {
 	}
 }
 
+Texture::Texture(const std::string& name, const uint8_t* data, size_t size, Type textureType) {
+	m_TextureType = textureType;
+	m_FilePath = name;
+	if (!LoadFromMemory(data, size)) {
+		std::cout << "[TEXTURE] [ERROR] : Failed to load texture from memory: " << name << std::endl;
+	}
+}
+
+Texture::Texture(const std::string& name, Onion::Core::FileData file, Type textureType) {
+	m_TextureType = textureType;
+	m_FilePath = name;
+	if (!LoadFromMemory(std::move(file))) {
+		std::cout << "[TEXTURE] [ERROR] : Failed to load texture from memory: " << name << std::endl;
+	}
+}
+
 Texture::~Texture() {
 	if (m_TextureID != 0) {
 		std::cout << "[TEXTURE] [ERROR] : Texture '" << m_FilePath << "' not deleted before destruction. There is a memory leak."
@@ -24,10 +44,53 @@ Texture::~Texture() {
 }
 
 bool Texture::LoadFromFile(const std::string& filePath) {
+	ONION_PROFILE_SCOPE("Texture::LoadFromFile");
 	m_FilePath = filePath;
+	Onion::Core::FileData file;
+	if (!Onion::Core::VirtualFileSystem::ReadFile(m_FilePath, file)) {
+		std::cout << "[TEXTURE] [ERROR] : Failed to read texture: " << m_FilePath << std::endl;
+		return false;
+	}
+
+	return LoadFromMemory(std::move(file));
+}
+
+bool Texture::LoadFromMemory(const uint8_t* fileData, size_t fileSize) {
+	if (!TextureContainer::IsContainer(fileData, fileSize)) {
+		return Decode(fileData, fileSize);
+	}
+
+	auto container = std::make_unique<TextureContainer>();
+	container->Parse(fileData, fileSize, m_FilePath);
+	return SetContainer(std::move(container));
+}
+
+bool Texture::LoadFromMemory(Onion::Core::FileData file) {
+	if (!TextureContainer::IsContainer(file.GetData(), file.GetSize())) {
+		return Decode(file.GetData(), file.GetSize());
+	}
+
+	auto container = std::make_unique<TextureContainer>();
+	container->Parse(std::move(file), m_FilePath);
+	return SetContainer(std::move(container));
+}
+
+bool Texture::SetContainer(std::unique_ptr<TextureContainer> container) {
+	if (!container->IsLoaded()) {
+		return false;
+	}
+	m_Container = std::move(container);
+	m_Width = static_cast<int>(m_Container->GetWidth());
+	m_Height = static_cast<int>(m_Container->GetHeight());
+	m_NrChannels = m_Container->GetFormat().Channels;
+	return true;
+}
+
+bool Texture::Decode(const uint8_t* fileData, size_t fileSize) {
+	ONION_PROFILE_SCOPE("Texture::Decode");
 	int width, height, nrChannels;
-	stbi_set_flip_vertically_on_load(true); // For OpenGL coordinate system
-	unsigned char* data = stbi_load(m_FilePath.c_str(), &width, &height, &nrChannels, 0);
+	stbi_set_flip_vertically_on_load_thread(true); // For OpenGL coordinate system. Per thread, textures are decoded on workers.
+	unsigned char* data = stbi_load_from_memory(fileData, static_cast<int>(fileSize), &width, &height, &nrChannels, 0);
 	if (!data) {
 		// handle error
 		std::cout << "[TEXTURE] [ERROR] : Failed to load texture: " << m_FilePath << std::endl;
@@ -47,6 +110,11 @@ bool Texture::LoadFromFile(const std::string& filePath) {
 
 void Texture::UploadToGPU() const
 {
+	if (m_Container) {
+		UploadContainer();
+		return;
+	}
+
 	if (!m_Data) {
 		std::cout << "[TEXTURE] [ERROR] : No data to upload for texture: "
 			<< m_FilePath << std::endl;
@@ -63,6 +131,7 @@ void Texture::UploadToGPU() const
 
 	glGenTextures(1, &m_TextureID);
 	glBindTexture(GL_TEXTURE_2D, m_TextureID);
+	m_Target = GL_TEXTURE_2D;
 
 	GLenum format = (m_NrChannels == 4) ? GL_RGBA : GL_RGB;
 
@@ -113,28 +182,81 @@ void Texture::UploadToGPU() const
 	m_HasBeenUploadedToGPU = true;
 }
 
+void Texture::UploadContainer() const
+{
+	if (m_HasBeenUploadedToGPU) {
+		std::cout << "[TEXTURE] [WARNING] : Texture already uploaded: "
+			<< m_FilePath << std::endl;
+		return;
+	}
+
+	// Every stored mip, face and layer goes to the driver as it is in the file
+	m_TextureID = m_Container->Upload();
+	m_Target = m_Container->GetGLTarget();
+
+	if (m_TextureID != 0) {
+		const GLenum target = m_Target;
+		const bool clamp = m_Container->GetTarget() == TextureContainer::Target::Cubemap;
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+		glTexParameteri(target, GL_TEXTURE_WRAP_R, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+
+		if (m_TextureType == Type::PixelArt) {
+			glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		else {
+			// Mips are only built here for a single uncompressed level, like the stb images
+			const bool generate = m_Container->GetLevelCount() == 1 && !m_Container->GetFormat().IsCompressed();
+			if (generate) {
+				glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 1000);
+				glGenerateMipmap(target);
+			}
+			const bool mipmapped = generate || m_Container->GetLevelCount() > 1;
+			glTexParameteri(target, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+
+		glBindTexture(target, 0);
+	}
+
+	m_Container.reset();
+	m_HasBeenUploadedToGPU = true;
+}
+
 void Texture::Bind() const {
 
 	if (!m_HasBeenUploadedToGPU) {
 		UploadToGPU();
 	}
 
-	glBindTexture(GL_TEXTURE_2D, m_TextureID);
+	glBindTexture(GetTarget(), m_TextureID);
 }
 
 void Texture::Unbind() const {
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindTexture(GetTarget(), 0);
 }
 
 void Texture::Delete() {
 	glDeleteTextures(1, &m_TextureID);
 	m_TextureID = 0;
+
+	// Never uploaded
+	if (m_Data) {
+		stbi_image_free(m_Data);
+		m_Data = nullptr;
+	}
+	m_Container.reset();
 }
 
 unsigned int Texture::GetTextureID() const {
 	return m_TextureID;
 }
 
+unsigned int Texture::GetTarget() const {
+	return m_Target != 0 ? m_Target : GL_TEXTURE_2D;
+}
+
 bool Texture::HasBeenLoaded() const {
 	return m_TextureID != 0;
 }
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 
+#include "../../core/virtual_file_system/virtual_file_system.hpp"
+
 namespace Onion::Rendering {
 
+	class TextureContainer;
+
+	// An image decoded by stb, or a KTX2/DDS container uploaded as stored (see TextureContainer):
+	// the format is told from the file contents, not its extension.
 	class Texture {
 
 	public:
@@ -17,11 +26,18 @@ namespace Onion::Rendering {
 	public:
 		Texture() = delete;
 		Texture(const std::string& filePath, Type textureType = Type::Classic);
+		// Decodes an encoded image already in memory (a file read by a worker, see AssetManager::AddTexture), 'name' is only used in logs
+		Texture(const std::string& name, const uint8_t* data, size_t size, Type textureType = Type::Classic);
+		// Takes the file: a container is kept as read until the upload, without a copy
+		Texture(const std::string& name, Onion::Core::FileData file, Type textureType = Type::Classic);
 		~Texture();
 
 		// ------------ LOAD ------------
 	public:
 		bool LoadFromFile(const std::string& filePath);
+		// Safe on any thread: only decodes, the upload happens on the first Bind
+		bool LoadFromMemory(const uint8_t* data, size_t size);
+		bool LoadFromMemory(Onion::Core::FileData file);
 
 		// ------------ BIND & UNBIND ------------
 	public:
@@ -36,15 +52,21 @@ namespace Onion::Rendering {
 	private:
 		std::string m_FilePath = "";
 		mutable unsigned int m_TextureID = 0;
+		mutable unsigned int m_Target = 0; // GL_TEXTURE_2D, or the container target
 
 		Type m_TextureType = Type::Classic;
 
+		bool Decode(const uint8_t* data, size_t size);
+		// Keeps a container for the upload, false when it failed to parse
+		bool SetContainer(std::unique_ptr<TextureContainer> container);
 		void UploadToGPU() const;
+		void UploadContainer() const;
 		mutable bool m_HasBeenUploadedToGPU = false;
 
 		// ------------- RAW TEXTURE DATA -------------
 	private:
 		mutable unsigned char* m_Data = nullptr;
+		mutable std::unique_ptr<TextureContainer> m_Container; // Released after uploading to GPU
 
 		// ------------ TEXTURE INFO ------------
 	private:
@@ -55,6 +77,8 @@ namespace Onion::Rendering {
 		// ------------ GETTERS ------------
 	public:
 		unsigned int GetTextureID() const;
+		// GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_2D_ARRAY
+		unsigned int GetTarget() const;
 		bool HasBeenLoaded() const;
 
 		int GetWidth() const;
@@ -0,0 +1,622 @@
+#include "texture_container.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+
+#include "../../core/profiler/profiler.hpp"
+
+using namespace Onion::Rendering;
+
+static_assert(std::endian::native == std::endian::little, "KTX2 and DDS headers are read in place");
+
+// Not part of the GL 3.3 core headers: S3TC is an extension every desktop driver exposes, BPTC is core since 4.2
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#define GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT 0x8E8E
+#define GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT 0x8E8F
+#endif
+
+namespace {
+
+	// ------------ FORMATS ------------
+
+	const TextureFormat R8 = { "R8", GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1, 1, 1 };
+	const TextureFormat RG8 = { "RG8", GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 1, 2, 2 };
+	const TextureFormat RGB8 = { "RGB8", GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 1, 3, 3 };
+	const TextureFormat SRGB8 = { "SRGB8", GL_SRGB8, GL_RGB, GL_UNSIGNED_BYTE, 1, 3, 3 };
+	const TextureFormat RGBA8 = { "RGBA8", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 1, 4, 4 };
+	const TextureFormat SRGB8_ALPHA8 = { "SRGB8_ALPHA8", GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 1, 4, 4 };
+	const TextureFormat BGRA8 = { "BGRA8", GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE, 1, 4, 4 };
+	const TextureFormat SBGR8_ALPHA8 = { "SBGR8_ALPHA8", GL_SRGB8_ALPHA8, GL_BGRA, GL_UNSIGNED_BYTE, 1, 4, 4 };
+	const TextureFormat RGBA16F = { "RGBA16F", GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 1, 8, 4 };
+	const TextureFormat RGBA32F = { "RGBA32F", GL_RGBA32F, GL_RGBA, GL_FLOAT, 1, 16, 4 };
+
+	const TextureFormat BC1 = { "BC1", GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 0, 0, 4, 8, 3 };
+	const TextureFormat BC1_SRGB = { "BC1_SRGB", GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 0, 0, 4, 8, 3 };
+	const TextureFormat BC1_ALPHA = { "BC1_ALPHA", GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 0, 4, 8, 4 };
+	const TextureFormat BC1_ALPHA_SRGB = { "BC1_ALPHA_SRGB", GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 0, 0, 4, 8, 4 };
+	const TextureFormat BC2 = { "BC2", GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, 0, 4, 16, 4 };
+	const TextureFormat BC2_SRGB = { "BC2_SRGB", GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 0, 0, 4, 16, 4 };
+	const TextureFormat BC3 = { "BC3", GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 0, 4, 16, 4 };
+	const TextureFormat BC3_SRGB = { "BC3_SRGB", GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 0, 0, 4, 16, 4 };
+	const TextureFormat BC4 = { "BC4", GL_COMPRESSED_RED_RGTC1, 0, 0, 4, 8, 1 };
+	const TextureFormat BC4_SNORM = { "BC4_SNORM", GL_COMPRESSED_SIGNED_RED_RGTC1, 0, 0, 4, 8, 1 };
+	const TextureFormat BC5 = { "BC5", GL_COMPRESSED_RG_RGTC2, 0, 0, 4, 16, 2 };
+	const TextureFormat BC5_SNORM = { "BC5_SNORM", GL_COMPRESSED_SIGNED_RG_RGTC2, 0, 0, 4, 16, 2 };
+	const TextureFormat BC6H_UFLOAT = { "BC6H_UFLOAT", GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 0, 0, 4, 16, 3 };
+	const TextureFormat BC6H_SFLOAT = { "BC6H_SFLOAT", GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 0, 0, 4, 16, 3 };
+	const TextureFormat BC7 = { "BC7", GL_COMPRESSED_RGBA_BPTC_UNORM, 0, 0, 4, 16, 4 };
+	const TextureFormat BC7_SRGB = { "BC7_SRGB", GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 0, 0, 4, 16, 4 };
+
+	struct FormatCode {
+		uint32_t Code;
+		const TextureFormat* Format;
+	};
+
+	// VkFormat values
+	const FormatCode VK_FORMATS[] = {
+		{ 9, &R8 }, { 16, &RG8 }, { 23, &RGB8 }, { 29, &SRGB8 }, { 37, &RGBA8 }, { 43, &SRGB8_ALPHA8 },
+		{ 44, &BGRA8 }, { 50, &SBGR8_ALPHA8 }, { 97, &RGBA16F }, { 109, &RGBA32F },
+		{ 131, &BC1 }, { 132, &BC1_SRGB }, { 133, &BC1_ALPHA }, { 134, &BC1_ALPHA_SRGB },
+		{ 135, &BC2 }, { 136, &BC2_SRGB }, { 137, &BC3 }, { 138, &BC3_SRGB },
+		{ 139, &BC4 }, { 140, &BC4_SNORM }, { 141, &BC5 }, { 142, &BC5_SNORM },
+		{ 143, &BC6H_UFLOAT }, { 144, &BC6H_SFLOAT }, { 145, &BC7 }, { 146, &BC7_SRGB }
+	};
+
+	// DXGI_FORMAT values, from the DX10 extension of the DDS header
+	const FormatCode DXGI_FORMATS[] = {
+		{ 2, &RGBA32F }, { 10, &RGBA16F }, { 28, &RGBA8 }, { 29, &SRGB8_ALPHA8 }, { 49, &RG8 }, { 61, &R8 },
+		{ 71, &BC1_ALPHA }, { 72, &BC1_ALPHA_SRGB }, { 74, &BC2 }, { 75, &BC2_SRGB }, { 77, &BC3 }, { 78, &BC3_SRGB },
+		{ 80, &BC4 }, { 81, &BC4_SNORM }, { 83, &BC5 }, { 84, &BC5_SNORM }, { 87, &BGRA8 }, { 91, &SBGR8_ALPHA8 },
+		{ 95, &BC6H_UFLOAT }, { 96, &BC6H_SFLOAT }, { 98, &BC7 }, { 99, &BC7_SRGB }
+	};
+
+	constexpr uint32_t FourCC(char a, char b, char c, char d) {
+		return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+	}
+
+	// Legacy DDS header FourCC, D3DFMT numbers included
+	const FormatCode DDS_FOURCC_FORMATS[] = {
+		{ FourCC('D', 'X', 'T', '1'), &BC1_ALPHA }, { FourCC('D', 'X', 'T', '2'), &BC2 }, { FourCC('D', 'X', 'T', '3'), &BC2 },
+		{ FourCC('D', 'X', 'T', '4'), &BC3 }, { FourCC('D', 'X', 'T', '5'), &BC3 },
+		{ FourCC('A', 'T', 'I', '1'), &BC4 }, { FourCC('B', 'C', '4', 'U'), &BC4 }, { FourCC('B', 'C', '4', 'S'), &BC4_SNORM },
+		{ FourCC('A', 'T', 'I', '2'), &BC5 }, { FourCC('B', 'C', '5', 'U'), &BC5 }, { FourCC('B', 'C', '5', 'S'), &BC5_SNORM },
+		{ 113, &RGBA16F }, { 116, &RGBA32F }
+	};
+
+	template <size_t N>
+	const TextureFormat* FindFormat(const FormatCode(&codes)[N], uint32_t code) {
+		for (const FormatCode& entry : codes) {
+			if (entry.Code == code) {
+				return entry.Format;
+			}
+		}
+		return nullptr;
+	}
+
+	bool HasExtension(const char* name) {
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++) {
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+			if (extension && std::strcmp(extension, name) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool IsSupported(const TextureFormat& format) {
+		switch (format.InternalFormat) {
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: {
+			static const bool s3tc = HasExtension("GL_EXT_texture_compression_s3tc");
+			return s3tc;
+		}
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+		case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+		case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT: {
+			static const bool bptc = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2)
+				|| HasExtension("GL_ARB_texture_compression_bptc");
+			return bptc;
+		}
+		default:
+			return true; // RGTC and the uncompressed formats are core in 3.0
+		}
+	}
+
+	// ------------ KTX2 ------------
+
+	constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	struct Ktx2Header {
+		uint8_t Identifier[12];
+		uint32_t VkFormat;
+		uint32_t TypeSize;
+		uint32_t PixelWidth;
+		uint32_t PixelHeight;
+		uint32_t PixelDepth;		// 0 unless 3D
+		uint32_t LayerCount;		// 0 unless an array
+		uint32_t FaceCount;			// 6 for a cubemap
+		uint32_t LevelCount;		// 0: generate the mips at load time
+		uint32_t SupercompressionScheme;
+		uint32_t DfdByteOffset;
+		uint32_t DfdByteLength;
+		uint32_t KvdByteOffset;
+		uint32_t KvdByteLength;
+		uint64_t SgdByteOffset;
+		uint64_t SgdByteLength;
+	};
+	static_assert(sizeof(Ktx2Header) == 80);
+
+	// Follows the header, one per level, the largest first
+	struct Ktx2Level {
+		uint64_t ByteOffset;
+		uint64_t ByteLength;
+		uint64_t UncompressedByteLength;
+	};
+	static_assert(sizeof(Ktx2Level) == 24);
+
+	// ------------ DDS ------------
+
+	constexpr uint32_t DDS_MAGIC = FourCC('D', 'D', 'S', ' ');
+
+	constexpr uint32_t DDPF_ALPHAPIXELS = 0x1;
+	constexpr uint32_t DDPF_FOURCC = 0x4;
+	constexpr uint32_t DDPF_RGB = 0x40;
+	constexpr uint32_t DDPF_LUMINANCE = 0x20000;
+	constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+	constexpr uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xFC00;
+	constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+	constexpr uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+	constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+	struct DdsPixelFormat {
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	// Follows the magic
+	struct DdsHeader {
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		DdsPixelFormat PixelFormat;
+		uint32_t Caps;
+		uint32_t Caps2;
+		uint32_t Caps3;
+		uint32_t Caps4;
+		uint32_t Reserved2;
+	};
+	static_assert(sizeof(DdsHeader) == 124);
+
+	// Follows DdsHeader when its FourCC is DX10
+	struct DdsHeaderDx10 {
+		uint32_t DxgiFormat;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;		// Cubemaps for a cubemap array
+		uint32_t MiscFlags2;
+	};
+	static_assert(sizeof(DdsHeaderDx10) == 20);
+
+	const TextureFormat* FindDdsPixelFormat(const DdsPixelFormat& pixelFormat) {
+		if (pixelFormat.Flags & DDPF_FOURCC) {
+			return FindFormat(DDS_FOURCC_FORMATS, pixelFormat.FourCC);
+		}
+		if ((pixelFormat.Flags & DDPF_RGB) && pixelFormat.RGBBitCount == 32) {
+			const bool alpha = (pixelFormat.Flags & DDPF_ALPHAPIXELS) && pixelFormat.ABitMask == 0xFF000000;
+			if (pixelFormat.RBitMask == 0x000000FF && pixelFormat.GBitMask == 0x0000FF00 && pixelFormat.BBitMask == 0x00FF0000) {
+				return alpha ? &RGBA8 : nullptr;
+			}
+			if (pixelFormat.RBitMask == 0x00FF0000 && pixelFormat.GBitMask == 0x0000FF00 && pixelFormat.BBitMask == 0x000000FF) {
+				return alpha ? &BGRA8 : nullptr;
+			}
+		}
+		if ((pixelFormat.Flags & DDPF_LUMINANCE) && pixelFormat.RGBBitCount == 8) {
+			return &R8;
+		}
+		return nullptr;
+	}
+
+	uint32_t GetMaxLevelCount(uint32_t width, uint32_t height) {
+		return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+	}
+
+	// Size of one image when it is at most 'limit' bytes, without overflowing on absurd dimensions
+	bool GetImageSizeWithin(const TextureFormat& format, uint32_t width, uint32_t height, uint64_t limit, uint64_t& imageSize) {
+		const uint64_t blocksX = (uint64_t(width) + format.BlockSize - 1) / format.BlockSize;
+		const uint64_t blocksY = (uint64_t(height) + format.BlockSize - 1) / format.BlockSize;
+		if (blocksX > limit / (blocksY * format.BlockBytes)) {
+			return false;
+		}
+		imageSize = blocksX * blocksY * format.BlockBytes;
+		return true;
+	}
+}
+
+// ------------ PARSING ------------
+
+bool TextureContainer::IsContainer(const uint8_t* data, size_t size) {
+	if (size >= sizeof(KTX2_IDENTIFIER) && std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+		return true;
+	}
+	uint32_t magic = 0;
+	if (size >= sizeof(magic)) {
+		std::memcpy(&magic, data, sizeof(magic));
+	}
+	return magic == DDS_MAGIC;
+}
+
+bool TextureContainer::Parse(Onion::Core::FileData file, const std::string& name) {
+	m_Name = name;
+	m_File = std::move(file);
+	m_Copy.clear();
+	return ParseBytes();
+}
+
+bool TextureContainer::Parse(const uint8_t* data, size_t size, const std::string& name) {
+	m_Name = name;
+	m_File = Onion::Core::FileData();
+	m_Copy.assign(data, data + size);
+	return ParseBytes();
+}
+
+bool TextureContainer::ParseBytes() {
+	ONION_PROFILE_SCOPE("TextureContainer::Parse");
+	m_Format = nullptr;
+	m_Images.clear();
+	m_GenerateMipmaps = false;
+
+	const uint8_t* bytes = GetBytes();
+	const size_t size = GetByteCount();
+	bool parsed = false;
+	if (size >= sizeof(KTX2_IDENTIFIER) && std::memcmp(bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+		parsed = ParseKtx2();
+	}
+	else if (IsContainer(bytes, size)) {
+		parsed = ParseDds();
+	}
+	else {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Neither a KTX2 nor a DDS file: " << m_Name << std::endl;
+	}
+
+	if (!parsed) {
+		m_Format = nullptr;
+		m_Images.clear();
+	}
+	return parsed;
+}
+
+bool TextureContainer::ParseKtx2() {
+	const uint8_t* bytes = GetBytes();
+	const size_t size = GetByteCount();
+
+	Ktx2Header header;
+	if (size < sizeof(header)) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Truncated KTX2 header: " << m_Name << std::endl;
+		return false;
+	}
+	std::memcpy(&header, bytes, sizeof(header));
+
+	if (header.SupercompressionScheme != 0) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Supercompressed KTX2 (scheme " << header.SupercompressionScheme
+			<< ") is not supported, store the blocks as they are: " << m_Name << std::endl;
+		return false;
+	}
+	m_Format = FindFormat(VK_FORMATS, header.VkFormat);
+	if (!m_Format) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Unsupported KTX2 format " << header.VkFormat << ": " << m_Name << std::endl;
+		return false;
+	}
+	if (header.PixelWidth == 0 || header.PixelHeight == 0 || header.PixelDepth != 0) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Only 2D textures are supported: " << m_Name << std::endl;
+		return false;
+	}
+	if (header.FaceCount != 1 && header.FaceCount != 6) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Invalid face count " << header.FaceCount << ": " << m_Name << std::endl;
+		return false;
+	}
+	if (header.FaceCount == 6 && header.LayerCount != 0) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Cubemap arrays are not supported: " << m_Name << std::endl;
+		return false;
+	}
+
+	m_Target = header.FaceCount == 6 ? Target::Cubemap : (header.LayerCount != 0 ? Target::Array2D : Target::Texture2D);
+	m_Width = header.PixelWidth;
+	m_Height = header.PixelHeight;
+	m_LayerCount = std::max(header.LayerCount, 1u);
+	m_FaceCount = header.FaceCount;
+	m_LevelCount = std::max(header.LevelCount, 1u);
+	m_GenerateMipmaps = header.LevelCount == 0;
+	if (m_LevelCount > GetMaxLevelCount(m_Width, m_Height)) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Invalid level count " << m_LevelCount << ": " << m_Name << std::endl;
+		return false;
+	}
+
+	const size_t dataOffset = sizeof(header) + m_LevelCount * sizeof(Ktx2Level);
+	if (size < dataOffset) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Truncated KTX2 level index: " << m_Name << std::endl;
+		return false;
+	}
+	if (!FitsInFile(size - dataOffset)) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Truncated KTX2 images (" << m_LayerCount << " layers, " << m_LevelCount << " levels): " << m_Name << std::endl;
+		return false;
+	}
+
+	// Each level holds its layers, each layer its faces
+	m_Images.reserve(static_cast<size_t>(m_LevelCount) * m_LayerCount * m_FaceCount);
+	for (uint32_t level = 0; level < m_LevelCount; level++) {
+		Ktx2Level index;
+		std::memcpy(&index, bytes + sizeof(header) + level * sizeof(Ktx2Level), sizeof(index));
+
+		const size_t imageSize = m_Format->GetImageSize(std::max(m_Width >> level, 1u), std::max(m_Height >> level, 1u));
+		if (index.ByteLength < imageSize * m_LayerCount * m_FaceCount) {
+			std::cout << "[TEXTURE CONTAINER] [ERROR] : Level " << level << " is too small: " << m_Name << std::endl;
+			return false;
+		}
+		for (uint32_t layer = 0; layer < m_LayerCount; layer++) {
+			for (uint32_t face = 0; face < m_FaceCount; face++) {
+				const size_t offset = static_cast<size_t>(index.ByteOffset) + (static_cast<size_t>(layer) * m_FaceCount + face) * imageSize;
+				if (!AddImage(level, layer, face, offset)) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool TextureContainer::ParseDds() {
+	const uint8_t* bytes = GetBytes();
+	const size_t size = GetByteCount();
+
+	DdsHeader header;
+	size_t offset = sizeof(DDS_MAGIC) + sizeof(header);
+	if (size < offset) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Truncated DDS header: " << m_Name << std::endl;
+		return false;
+	}
+	std::memcpy(&header, bytes + sizeof(DDS_MAGIC), sizeof(header));
+
+	uint32_t arraySize = 1;
+	bool cubemap = (header.Caps2 & DDSCAPS2_CUBEMAP) != 0;
+	bool flat = (header.Caps2 & DDSCAPS2_VOLUME) == 0;
+	if ((header.PixelFormat.Flags & DDPF_FOURCC) && header.PixelFormat.FourCC == FourCC('D', 'X', '1', '0')) {
+		DdsHeaderDx10 dx10;
+		if (size < offset + sizeof(dx10)) {
+			std::cout << "[TEXTURE CONTAINER] [ERROR] : Truncated DDS DX10 header: " << m_Name << std::endl;
+			return false;
+		}
+		std::memcpy(&dx10, bytes + offset, sizeof(dx10));
+		offset += sizeof(dx10);
+
+		m_Format = FindFormat(DXGI_FORMATS, dx10.DxgiFormat);
+		if (!m_Format) {
+			std::cout << "[TEXTURE CONTAINER] [ERROR] : Unsupported DXGI format " << dx10.DxgiFormat << ": " << m_Name << std::endl;
+			return false;
+		}
+		arraySize = std::max(dx10.ArraySize, 1u);
+		cubemap = (dx10.MiscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) != 0;
+		flat = dx10.ResourceDimension == DDS_DIMENSION_TEXTURE2D;
+	}
+	else {
+		m_Format = FindDdsPixelFormat(header.PixelFormat);
+		if (!m_Format) {
+			std::cout << "[TEXTURE CONTAINER] [ERROR] : Unsupported DDS pixel format: " << m_Name << std::endl;
+			return false;
+		}
+		if (cubemap && (header.Caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES) {
+			std::cout << "[TEXTURE CONTAINER] [ERROR] : Cubemaps missing faces are not supported: " << m_Name << std::endl;
+			return false;
+		}
+	}
+
+	if (!flat || header.Width == 0 || header.Height == 0) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Only 2D textures are supported: " << m_Name << std::endl;
+		return false;
+	}
+	if (cubemap && arraySize > 1) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Cubemap arrays are not supported: " << m_Name << std::endl;
+		return false;
+	}
+
+	m_Target = cubemap ? Target::Cubemap : (arraySize > 1 ? Target::Array2D : Target::Texture2D);
+	m_Width = header.Width;
+	m_Height = header.Height;
+	m_LayerCount = arraySize;
+	m_FaceCount = cubemap ? 6 : 1;
+	m_LevelCount = std::max(header.MipMapCount, 1u);
+	if (m_LevelCount > GetMaxLevelCount(m_Width, m_Height)) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Invalid mip count " << m_LevelCount << ": " << m_Name << std::endl;
+		return false;
+	}
+	if (!FitsInFile(size - offset)) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Truncated DDS images (" << m_LayerCount << " layers, " << m_LevelCount << " mips): " << m_Name << std::endl;
+		return false;
+	}
+
+	// Each layer (each face of a cubemap) holds its whole mip chain
+	m_Images.reserve(static_cast<size_t>(m_LevelCount) * m_LayerCount * m_FaceCount);
+	for (uint32_t layer = 0; layer < m_LayerCount; layer++) {
+		for (uint32_t face = 0; face < m_FaceCount; face++) {
+			for (uint32_t level = 0; level < m_LevelCount; level++) {
+				if (!AddImage(level, layer, face, offset)) {
+					return false;
+				}
+				offset += m_Images.back().Size;
+			}
+		}
+	}
+	return true;
+}
+
+bool TextureContainer::FitsInFile(size_t available) const {
+	const uint64_t imagesPerLevel = uint64_t(m_LayerCount) * m_FaceCount;
+	uint64_t total = 0;
+	for (uint32_t level = 0; level < m_LevelCount; level++) {
+		uint64_t imageSize = 0;
+		if (!GetImageSizeWithin(*m_Format, std::max(m_Width >> level, 1u), std::max(m_Height >> level, 1u), available, imageSize)
+			|| imageSize > (available - total) / imagesPerLevel) {
+			return false;
+		}
+		total += imageSize * imagesPerLevel;
+	}
+	return true;
+}
+
+bool TextureContainer::AddImage(uint32_t level, uint32_t layer, uint32_t face, size_t offset) {
+	Image image;
+	image.Level = level;
+	image.Layer = layer;
+	image.Face = face;
+	image.Width = std::max(m_Width >> level, 1u);
+	image.Height = std::max(m_Height >> level, 1u);
+	image.Offset = offset;
+	image.Size = m_Format->GetImageSize(image.Width, image.Height);
+
+	if (offset > GetByteCount() || image.Size > GetByteCount() - offset) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Truncated image data: " << m_Name << std::endl;
+		return false;
+	}
+	m_Images.push_back(image);
+	return true;
+}
+
+// ------------ UPLOAD ------------
+
+unsigned int TextureContainer::Upload() const {
+	ONION_PROFILE_SCOPE("TextureContainer::Upload");
+	if (!m_Format || !GetBytes()) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : Nothing to upload: " << m_Name << std::endl;
+		return 0;
+	}
+	if (!IsSupported(*m_Format)) {
+		std::cout << "[TEXTURE CONTAINER] [ERROR] : " << m_Format->Name << " is not supported by the driver: " << m_Name << std::endl;
+		return 0;
+	}
+
+	const GLenum target = GetGLTarget();
+	const bool compressed = m_Format->IsCompressed();
+	const uint8_t* bytes = GetBytes();
+
+	// Rows are tightly packed in the file, the caller's unpack alignment is put back after
+	GLint unpackAlignment = 4;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(target, textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// Arrays: the storage of each level first, then the layers in place
+	if (m_Target == Target::Array2D) {
+		for (uint32_t level = 0; level < m_LevelCount; level++) {
+			const uint32_t width = std::max(m_Width >> level, 1u);
+			const uint32_t height = std::max(m_Height >> level, 1u);
+			const GLsizei layers = static_cast<GLsizei>(m_LayerCount);
+			if (compressed) {
+				const size_t levelSize = m_Format->GetImageSize(width, height) * m_LayerCount;
+				glCompressedTexImage3D(target, level, m_Format->InternalFormat, width, height, layers, 0, static_cast<GLsizei>(levelSize), nullptr);
+			}
+			else {
+				glTexImage3D(target, level, m_Format->InternalFormat, width, height, layers, 0, m_Format->Format, m_Format->Type, nullptr);
+			}
+		}
+	}
+
+	for (const Image& image : m_Images) {
+		const GLsizei width = static_cast<GLsizei>(image.Width);
+		const GLsizei height = static_cast<GLsizei>(image.Height);
+		const GLint level = static_cast<GLint>(image.Level);
+		const uint8_t* data = bytes + image.Offset;
+
+		if (m_Target == Target::Array2D) {
+			const GLint layer = static_cast<GLint>(image.Layer);
+			if (compressed) {
+				glCompressedTexSubImage3D(target, level, 0, 0, layer, width, height, 1, m_Format->InternalFormat, static_cast<GLsizei>(image.Size), data);
+			}
+			else {
+				glTexSubImage3D(target, level, 0, 0, layer, width, height, 1, m_Format->Format, m_Format->Type, data);
+			}
+			continue;
+		}
+
+		const GLenum imageTarget = m_Target == Target::Cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + image.Face : GL_TEXTURE_2D;
+		if (compressed) {
+			glCompressedTexImage2D(imageTarget, level, m_Format->InternalFormat, width, height, 0, static_cast<GLsizei>(image.Size), data);
+		}
+		else {
+			glTexImage2D(imageTarget, level, static_cast<GLint>(m_Format->InternalFormat), width, height, 0, m_Format->Format, m_Format->Type, data);
+		}
+	}
+
+	// Sampling stops at the last stored level, a chain cut short stays complete
+	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+	if (!m_GenerateMipmaps) {
+		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(m_LevelCount - 1));
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+
+	return textureID;
+}
+
+void TextureContainer::Release() {
+	m_File = Onion::Core::FileData();
+	m_Copy = std::vector<uint8_t>();
+	m_Images.clear();
+}
+
+unsigned int TextureContainer::GetGLTarget() const {
+	switch (m_Target) {
+	case Target::Cubemap:
+		return GL_TEXTURE_CUBE_MAP;
+	case Target::Array2D:
+		return GL_TEXTURE_2D_ARRAY;
+	default:
+		return GL_TEXTURE_2D;
+	}
+}
+
+const uint8_t* TextureContainer::GetBytes() const {
+	return m_Copy.empty() ? m_File.GetData() : m_Copy.data();
+}
+
+size_t TextureContainer::GetByteCount() const {
+	return m_Copy.empty() ? m_File.GetSize() : m_Copy.size();
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../core/virtual_file_system/virtual_file_system.hpp"
+
+namespace Onion::Rendering {
+
+	// How the texels of a container are handed to OpenGL
+	struct TextureFormat {
+		const char* Name = "";
+		unsigned int InternalFormat = 0;
+		unsigned int Format = 0;	// Uncompressed only, with Type
+		unsigned int Type = 0;
+		uint32_t BlockSize = 1;		// Texels per block side: 4 for the BCn formats, 1 when uncompressed
+		uint32_t BlockBytes = 0;	// Bytes per block, or per texel
+		int Channels = 0;
+
+		bool IsCompressed() const {
+			return BlockSize > 1;
+		}
+		size_t GetImageSize(uint32_t width, uint32_t height) const {
+			const size_t blocksX = (width + BlockSize - 1) / BlockSize;
+			const size_t blocksY = (height + BlockSize - 1) / BlockSize;
+			return blocksX * blocksY * BlockBytes;
+		}
+	};
+
+	// KTX2 and DDS files: textures stored the way the GPU samples them, with their mips, cubemap faces
+	// and array layers already built, BCn compressed or not. Parse only locates the images in the file,
+	// nothing is decoded on the CPU: Upload hands them to OpenGL as they are.
+	// Not supported: 1D and 3D textures, cubemap arrays (GL 4.0), supercompressed KTX2 (Basis, zstd).
+	// The images keep the orientation they were stored with, top row first. For 2D textures, export them
+	// with the origin at the bottom left like the stb loads (toktx --lower_left_maps_to_s0t0, texconv -vflip).
+	class TextureContainer {
+	public:
+		enum class Target {
+			Texture2D,
+			Cubemap,
+			Array2D
+		};
+
+		struct Image {
+			uint32_t Level = 0;
+			uint32_t Layer = 0;
+			uint32_t Face = 0;		// +X, -X, +Y, -Y, +Z, -Z
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			size_t Offset = 0;		// In the file
+			size_t Size = 0;
+		};
+
+		// From the first bytes of a file, whatever its extension
+		static bool IsContainer(const uint8_t* data, size_t size);
+
+		// Keeps the file: an archive entry stored uncompressed is uploaded straight from the mapping, without a copy
+		bool Parse(Onion::Core::FileData file, const std::string& name);
+		// Copies the bytes
+		bool Parse(const uint8_t* data, size_t size, const std::string& name);
+
+		// Context thread: creates the texture, uploads every image and returns its id, 0 when it fails.
+		// The texture is left bound to GetGLTarget. Filtering and wrapping are up to the caller.
+		unsigned int Upload() const;
+		// Frees the file once uploaded
+		void Release();
+
+		bool IsLoaded() const {
+			return m_Format != nullptr;
+		}
+		Target GetTarget() const {
+			return m_Target;
+		}
+		unsigned int GetGLTarget() const;
+		const TextureFormat& GetFormat() const {
+			return *m_Format;
+		}
+
+		uint32_t GetWidth() const {
+			return m_Width;
+		}
+		uint32_t GetHeight() const {
+			return m_Height;
+		}
+		uint32_t GetLevelCount() const {
+			return m_LevelCount;
+		}
+		uint32_t GetLayerCount() const {
+			return m_LayerCount;
+		}
+		// KTX2 files may ask for the mips to be generated at load time instead of storing them
+		bool ShouldGenerateMipmaps() const {
+			return m_GenerateMipmaps;
+		}
+		const std::vector<Image>& GetImages() const {
+			return m_Images;
+		}
+
+	private:
+		bool ParseBytes();
+		bool ParseKtx2();
+		bool ParseDds();
+		// Whether every image, at the level sizes, fits in 'available' bytes. Checked before reserving
+		// the image list, so a corrupt layer or level count fails instead of allocating.
+		bool FitsInFile(size_t available) const;
+		// Checks the image fits in the file and records it
+		bool AddImage(uint32_t level, uint32_t layer, uint32_t face, size_t offset);
+
+		const uint8_t* GetBytes() const;
+		size_t GetByteCount() const;
+
+	private:
+		std::string m_Name;
+		Onion::Core::FileData m_File;
+		std::vector<uint8_t> m_Copy;
+
+		const TextureFormat* m_Format = nullptr;
+		Target m_Target = Target::Texture2D;
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+		uint32_t m_LevelCount = 1;
+		uint32_t m_LayerCount = 1;
+		uint32_t m_FaceCount = 1;
+		bool m_GenerateMipmaps = false;
+		std::vector<Image> m_Images;
+	};
+
+} // namespace Onion::Rendering
@@ -0,0 +1,206 @@
+#include "transform_kernels.hpp"
+
+// No glm, nor any other inline library code here: with ONION_ENABLE_AVX this is the only file built with AVX,
+// inline functions it instantiated could be picked by the linker over the SSE2 ones of the other files.
+#if defined(__AVX__)
+#define ONION_TRANSFORM_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ONION_TRANSFORM_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace Onion::Rendering;
+
+namespace {
+	// Column-major translate * rotate * scale, same formulas as Transform::ComposeMatrix.
+	// 'out' receives 16 floats per transform.
+	[[maybe_unused]] void ComposeScalar(const TransformComponents& c, size_t first, size_t count, float* out) {
+		for (size_t i = first; i < first + count; i++, out += 16) {
+			const float x = c.RotationX[i];
+			const float y = c.RotationY[i];
+			const float z = c.RotationZ[i];
+			const float w = c.RotationW[i];
+			const float sx = c.ScaleX[i];
+			const float sy = c.ScaleY[i];
+			const float sz = c.ScaleZ[i];
+
+			out[0] = (1.0f - 2.0f * (y * y + z * z)) * sx;
+			out[1] = 2.0f * (x * y + w * z) * sx;
+			out[2] = 2.0f * (x * z - w * y) * sx;
+			out[3] = 0.0f;
+			out[4] = 2.0f * (x * y - w * z) * sy;
+			out[5] = (1.0f - 2.0f * (x * x + z * z)) * sy;
+			out[6] = 2.0f * (y * z + w * x) * sy;
+			out[7] = 0.0f;
+			out[8] = 2.0f * (x * z + w * y) * sz;
+			out[9] = 2.0f * (y * z - w * x) * sz;
+			out[10] = (1.0f - 2.0f * (x * x + y * y)) * sz;
+			out[11] = 0.0f;
+			out[12] = c.PositionX[i];
+			out[13] = c.PositionY[i];
+			out[14] = c.PositionZ[i];
+			out[15] = 1.0f;
+		}
+	}
+
+#if defined(ONION_TRANSFORM_AVX)
+
+	// Lane k of a, b, c and d becomes column 'column' of matrix k
+	inline void StoreColumn8(float* out, size_t column, __m256 a, __m256 b, __m256 c, __m256 d) {
+		const __m256 ab0 = _mm256_unpacklo_ps(a, b);	// a0 b0 a1 b1 | a4 b4 a5 b5
+		const __m256 ab1 = _mm256_unpackhi_ps(a, b);	// a2 b2 a3 b3 | a6 b6 a7 b7
+		const __m256 cd0 = _mm256_unpacklo_ps(c, d);
+		const __m256 cd1 = _mm256_unpackhi_ps(c, d);
+
+		const __m256 m0 = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(1, 0, 1, 0));	// Matrices 0 | 4
+		const __m256 m1 = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(3, 2, 3, 2));	// Matrices 1 | 5
+		const __m256 m2 = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(1, 0, 1, 0));	// Matrices 2 | 6
+		const __m256 m3 = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(3, 2, 3, 2));	// Matrices 3 | 7
+
+		out += column * 4;
+		_mm_storeu_ps(out + 0 * 16, _mm256_castps256_ps128(m0));
+		_mm_storeu_ps(out + 1 * 16, _mm256_castps256_ps128(m1));
+		_mm_storeu_ps(out + 2 * 16, _mm256_castps256_ps128(m2));
+		_mm_storeu_ps(out + 3 * 16, _mm256_castps256_ps128(m3));
+		_mm_storeu_ps(out + 4 * 16, _mm256_extractf128_ps(m0, 1));
+		_mm_storeu_ps(out + 5 * 16, _mm256_extractf128_ps(m1, 1));
+		_mm_storeu_ps(out + 6 * 16, _mm256_extractf128_ps(m2, 1));
+		_mm_storeu_ps(out + 7 * 16, _mm256_extractf128_ps(m3, 1));
+	}
+
+	// 'count' is a multiple of 8
+	void ComposeBatch(const TransformComponents& c, size_t first, size_t count, float* out) {
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 two = _mm256_set1_ps(2.0f);
+		const __m256 zero = _mm256_setzero_ps();
+
+		for (size_t i = first; i < first + count; i += 8, out += 8 * 16) {
+			const __m256 x = _mm256_loadu_ps(c.RotationX + i);
+			const __m256 y = _mm256_loadu_ps(c.RotationY + i);
+			const __m256 z = _mm256_loadu_ps(c.RotationZ + i);
+			const __m256 w = _mm256_loadu_ps(c.RotationW + i);
+
+			const __m256 xx = _mm256_mul_ps(x, x);
+			const __m256 yy = _mm256_mul_ps(y, y);
+			const __m256 zz = _mm256_mul_ps(z, z);
+			const __m256 xy = _mm256_mul_ps(x, y);
+			const __m256 xz = _mm256_mul_ps(x, z);
+			const __m256 yz = _mm256_mul_ps(y, z);
+			const __m256 wx = _mm256_mul_ps(w, x);
+			const __m256 wy = _mm256_mul_ps(w, y);
+			const __m256 wz = _mm256_mul_ps(w, z);
+
+			const __m256 sx = _mm256_loadu_ps(c.ScaleX + i);
+			const __m256 sy = _mm256_loadu_ps(c.ScaleY + i);
+			const __m256 sz = _mm256_loadu_ps(c.ScaleZ + i);
+
+			StoreColumn8(out, 0,
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+				zero);
+			StoreColumn8(out, 1,
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+				zero);
+			StoreColumn8(out, 2,
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz),
+				zero);
+			StoreColumn8(out, 3,
+				_mm256_loadu_ps(c.PositionX + i),
+				_mm256_loadu_ps(c.PositionY + i),
+				_mm256_loadu_ps(c.PositionZ + i),
+				one);
+		}
+	}
+
+#elif defined(ONION_TRANSFORM_SSE2)
+
+	// Lane k of a, b, c and d becomes column 'column' of matrix k
+	inline void StoreColumn4(float* out, size_t column, __m128 a, __m128 b, __m128 c, __m128 d) {
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+
+		out += column * 4;
+		_mm_storeu_ps(out + 0 * 16, a);
+		_mm_storeu_ps(out + 1 * 16, b);
+		_mm_storeu_ps(out + 2 * 16, c);
+		_mm_storeu_ps(out + 3 * 16, d);
+	}
+
+	// 'count' is a multiple of 4
+	void ComposeBatch(const TransformComponents& c, size_t first, size_t count, float* out) {
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		for (size_t i = first; i < first + count; i += 4, out += 4 * 16) {
+			const __m128 x = _mm_loadu_ps(c.RotationX + i);
+			const __m128 y = _mm_loadu_ps(c.RotationY + i);
+			const __m128 z = _mm_loadu_ps(c.RotationZ + i);
+			const __m128 w = _mm_loadu_ps(c.RotationW + i);
+
+			const __m128 xx = _mm_mul_ps(x, x);
+			const __m128 yy = _mm_mul_ps(y, y);
+			const __m128 zz = _mm_mul_ps(z, z);
+			const __m128 xy = _mm_mul_ps(x, y);
+			const __m128 xz = _mm_mul_ps(x, z);
+			const __m128 yz = _mm_mul_ps(y, z);
+			const __m128 wx = _mm_mul_ps(w, x);
+			const __m128 wy = _mm_mul_ps(w, y);
+			const __m128 wz = _mm_mul_ps(w, z);
+
+			const __m128 sx = _mm_loadu_ps(c.ScaleX + i);
+			const __m128 sy = _mm_loadu_ps(c.ScaleY + i);
+			const __m128 sz = _mm_loadu_ps(c.ScaleZ + i);
+
+			StoreColumn4(out, 0,
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+				zero);
+			StoreColumn4(out, 1,
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+				zero);
+			StoreColumn4(out, 2,
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+				zero);
+			StoreColumn4(out, 3,
+				_mm_loadu_ps(c.PositionX + i),
+				_mm_loadu_ps(c.PositionY + i),
+				_mm_loadu_ps(c.PositionZ + i),
+				one);
+		}
+	}
+
+#else
+
+	void ComposeBatch(const TransformComponents& c, size_t first, size_t count, float* out) {
+		ComposeScalar(c, first, count, out);
+	}
+
+#endif
+}
+
+void Onion::Rendering::ComposeTransforms(const TransformComponents& components, size_t first, size_t count, float* out)
+{
+	ComposeBatch(components, first, count, out);
+}
+
+const char* Onion::Rendering::GetTransformKernelName()
+{
+#if defined(ONION_TRANSFORM_AVX)
+	return "AVX";
+#elif defined(ONION_TRANSFORM_SSE2)
+	return "SSE2";
+#else
+	return "Scalar";
+#endif
+}
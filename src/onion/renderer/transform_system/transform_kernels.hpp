@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Onion::Rendering {
+
+	// Raw view of the TransformSystem component arrays, the kernels only see floats
+	struct TransformComponents {
+		const float* PositionX;
+		const float* PositionY;
+		const float* PositionZ;
+		const float* RotationX;
+		const float* RotationY;
+		const float* RotationZ;
+		const float* RotationW;
+		const float* ScaleX;
+		const float* ScaleY;
+		const float* ScaleZ;
+	};
+
+	// Column-major translate * rotate * scale of transforms [first, first + count), 16 floats each to 'out'.
+	// 'count' is a multiple of 8 (TransformSystem::BLOCK_SIZE).
+	void ComposeTransforms(const TransformComponents& components, size_t first, size_t count, float* out);
+
+	// "AVX", "SSE2" or "Scalar", the kernel compiled in
+	const char* GetTransformKernelName();
+
+} // namespace Onion::Rendering
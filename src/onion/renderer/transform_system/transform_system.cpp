@@ -0,0 +1,201 @@
+#include "transform_system.hpp"
+
+#include "../../core/job_system/job_system.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#include "transform_kernels.hpp"
+
+using namespace Onion::Rendering;
+
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "World matrices are written as 16 contiguous floats");
+
+// ------------ TRANSFORMS ------------
+
+TransformSystem::Handle TransformSystem::Create(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	const Handle handle = static_cast<Handle>(m_Count);
+	m_Count++;
+
+	if (m_Count > m_PositionX.size()) {
+		// Grow by a whole block of identity transforms
+		const size_t paddedCount = m_PositionX.size() + BLOCK_SIZE;
+		m_PositionX.resize(paddedCount, 0.0f);
+		m_PositionY.resize(paddedCount, 0.0f);
+		m_PositionZ.resize(paddedCount, 0.0f);
+		m_RotationX.resize(paddedCount, 0.0f);
+		m_RotationY.resize(paddedCount, 0.0f);
+		m_RotationZ.resize(paddedCount, 0.0f);
+		m_RotationW.resize(paddedCount, 1.0f);
+		m_ScaleX.resize(paddedCount, 1.0f);
+		m_ScaleY.resize(paddedCount, 1.0f);
+		m_ScaleZ.resize(paddedCount, 1.0f);
+		m_WorldMatrices.resize(paddedCount, glm::mat4(1.0f));
+		m_DirtyBlocks.push_back(0);
+	}
+
+	m_PositionX[handle] = position.x;
+	m_PositionY[handle] = position.y;
+	m_PositionZ[handle] = position.z;
+	m_RotationX[handle] = rotation.x;
+	m_RotationY[handle] = rotation.y;
+	m_RotationZ[handle] = rotation.z;
+	m_RotationW[handle] = rotation.w;
+	m_ScaleX[handle] = scale.x;
+	m_ScaleY[handle] = scale.y;
+	m_ScaleZ[handle] = scale.z;
+	MarkDirty(handle);
+
+	return handle;
+}
+
+void TransformSystem::Reserve(size_t count)
+{
+	const size_t paddedCount = (count + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+	m_PositionX.reserve(paddedCount);
+	m_PositionY.reserve(paddedCount);
+	m_PositionZ.reserve(paddedCount);
+	m_RotationX.reserve(paddedCount);
+	m_RotationY.reserve(paddedCount);
+	m_RotationZ.reserve(paddedCount);
+	m_RotationW.reserve(paddedCount);
+	m_ScaleX.reserve(paddedCount);
+	m_ScaleY.reserve(paddedCount);
+	m_ScaleZ.reserve(paddedCount);
+	m_WorldMatrices.reserve(paddedCount);
+	m_DirtyBlocks.reserve(paddedCount / BLOCK_SIZE);
+}
+
+void TransformSystem::Clear()
+{
+	m_PositionX.clear();
+	m_PositionY.clear();
+	m_PositionZ.clear();
+	m_RotationX.clear();
+	m_RotationY.clear();
+	m_RotationZ.clear();
+	m_RotationW.clear();
+	m_ScaleX.clear();
+	m_ScaleY.clear();
+	m_ScaleZ.clear();
+	m_WorldMatrices.clear();
+	m_DirtyBlocks.clear();
+	m_Count = 0;
+	m_Version++;
+}
+
+void TransformSystem::SetPosition(Handle handle, const glm::vec3& position)
+{
+	m_PositionX[handle] = position.x;
+	m_PositionY[handle] = position.y;
+	m_PositionZ[handle] = position.z;
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetRotation(Handle handle, const glm::quat& rotation)
+{
+	m_RotationX[handle] = rotation.x;
+	m_RotationY[handle] = rotation.y;
+	m_RotationZ[handle] = rotation.z;
+	m_RotationW[handle] = rotation.w;
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetScale(Handle handle, const glm::vec3& scale)
+{
+	m_ScaleX[handle] = scale.x;
+	m_ScaleY[handle] = scale.y;
+	m_ScaleZ[handle] = scale.z;
+	MarkDirty(handle);
+}
+
+glm::vec3 TransformSystem::GetPosition(Handle handle) const
+{
+	return glm::vec3(m_PositionX[handle], m_PositionY[handle], m_PositionZ[handle]);
+}
+
+glm::quat TransformSystem::GetRotation(Handle handle) const
+{
+	return glm::quat(m_RotationW[handle], m_RotationX[handle], m_RotationY[handle], m_RotationZ[handle]);
+}
+
+glm::vec3 TransformSystem::GetScale(Handle handle) const
+{
+	return glm::vec3(m_ScaleX[handle], m_ScaleY[handle], m_ScaleZ[handle]);
+}
+
+void TransformSystem::MarkAllDirty()
+{
+	std::fill(m_DirtyBlocks.begin(), m_DirtyBlocks.end(), static_cast<uint8_t>(1));
+	m_Version++;
+}
+
+void TransformSystem::MarkDirty(Handle handle)
+{
+	m_DirtyBlocks[handle / BLOCK_SIZE] = 1;
+	m_Version++;
+}
+
+// ------------ MATRICES ------------
+
+size_t TransformSystem::UpdateMatrices()
+{
+	return UpdateBlocks(0, m_DirtyBlocks.size());
+}
+
+size_t TransformSystem::UpdateMatrices(Onion::Core::JobSystem& jobSystem)
+{
+	if (m_Count < PARALLEL_THRESHOLD || jobSystem.GetWorkerCount() == 0) {
+		return UpdateMatrices();
+	}
+
+	// 256 blocks (2048 transforms, 128 KB of matrices) per chunk at least, smaller ones do not pay for the job
+	constexpr size_t GRAIN_BLOCKS = 256;
+
+	std::atomic<size_t> updated{ 0 };
+	jobSystem.ParallelFor(0, m_DirtyBlocks.size(), [this, &updated](size_t begin, size_t end) {
+		updated.fetch_add(UpdateBlocks(begin, end), std::memory_order_relaxed);
+		}, GRAIN_BLOCKS);
+
+	return updated.load(std::memory_order_relaxed);
+}
+
+size_t TransformSystem::UpdateBlocks(size_t firstBlock, size_t lastBlock)
+{
+	const TransformComponents components = {
+		m_PositionX.data(), m_PositionY.data(), m_PositionZ.data(),
+		m_RotationX.data(), m_RotationY.data(), m_RotationZ.data(), m_RotationW.data(),
+		m_ScaleX.data(), m_ScaleY.data(), m_ScaleZ.data()
+	};
+	float* matrices = reinterpret_cast<float*>(m_WorldMatrices.data());
+
+	size_t updated = 0;
+	size_t block = firstBlock;
+	while (block < lastBlock) {
+		if (!m_DirtyBlocks[block]) {
+			block++;
+			continue;
+		}
+
+		// Compose consecutive dirty blocks in one go
+		size_t runEnd = block;
+		while (runEnd < lastBlock && m_DirtyBlocks[runEnd]) {
+			m_DirtyBlocks[runEnd] = 0;
+			runEnd++;
+		}
+
+		const size_t first = block * BLOCK_SIZE;
+		const size_t count = (runEnd - block) * BLOCK_SIZE;
+		ComposeTransforms(components, first, count, matrices + first * 16);
+		updated += count;
+		block = runEnd;
+	}
+
+	return updated;
+}
+
+const char* TransformSystem::GetSimdPath()
+{
+	return GetTransformKernelName();
+}
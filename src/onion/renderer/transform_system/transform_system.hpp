@@ -0,0 +1,105 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Onion::Core {
+	class JobSystem;
+}
+
+namespace Onion::Rendering {
+
+	// Transforms stored as a structure of arrays (one array per position, rotation and scale component),
+	// so that world matrices are composed several at a time with SSE or AVX.
+	// World matrices are cached: UpdateMatrices only recomposes the blocks touched since the last update.
+	// Setters and UpdateMatrices must be called from the same thread (UpdateMatrices may fan out to jobs).
+	class TransformSystem {
+	public:
+		using Handle = uint32_t;
+
+		// Transforms are dirty-tracked and composed by blocks of BLOCK_SIZE
+		static constexpr size_t BLOCK_SIZE = 8;
+		// Below this count, UpdateMatrices(JobSystem&) stays on the calling thread
+		static constexpr size_t PARALLEL_THRESHOLD = 16 * 1024;
+
+		TransformSystem() = default;
+		~TransformSystem() = default;
+
+		TransformSystem(const TransformSystem&) = delete;
+		TransformSystem& operator=(const TransformSystem&) = delete;
+
+		// ------------ TRANSFORMS ------------
+
+		Handle Create(const glm::vec3& position = glm::vec3(0.0f), const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+		void Reserve(size_t count);
+		void Clear();
+
+		size_t GetCount() const {
+			return m_Count;
+		}
+
+		void SetPosition(Handle handle, const glm::vec3& position);
+		// 'rotation' must be normalized
+		void SetRotation(Handle handle, const glm::quat& rotation);
+		void SetScale(Handle handle, const glm::vec3& scale);
+
+		glm::vec3 GetPosition(Handle handle) const;
+		glm::quat GetRotation(Handle handle) const;
+		glm::vec3 GetScale(Handle handle) const;
+
+		// Forces every matrix to be recomposed by the next update
+		void MarkAllDirty();
+
+		// Incremented by every change, to tell whether cached data built from the matrices is stale
+		uint64_t GetVersion() const {
+			return m_Version;
+		}
+
+		// ------------ MATRICES ------------
+
+		// Recomposes the dirty blocks and returns the number of transforms recomposed (whole blocks)
+		size_t UpdateMatrices();
+		// Same, with the blocks split across the job system for large counts
+		size_t UpdateMatrices(Onion::Core::JobSystem& jobSystem);
+
+		// As of the last UpdateMatrices
+		const glm::mat4& GetWorldMatrix(Handle handle) const {
+			return m_WorldMatrices[handle];
+		}
+		// GetCount() matrices, contiguous
+		const glm::mat4* GetWorldMatrices() const {
+			return m_WorldMatrices.data();
+		}
+
+		// "AVX", "SSE2" or "Scalar", chosen at compile time
+		static const char* GetSimdPath();
+
+	private:
+		void MarkDirty(Handle handle);
+		size_t UpdateBlocks(size_t firstBlock, size_t lastBlock);
+
+	private:
+		// Components, padded with identity transforms up to a multiple of BLOCK_SIZE so the kernels never handle a tail
+		std::vector<float> m_PositionX;
+		std::vector<float> m_PositionY;
+		std::vector<float> m_PositionZ;
+		std::vector<float> m_RotationX;
+		std::vector<float> m_RotationY;
+		std::vector<float> m_RotationZ;
+		std::vector<float> m_RotationW;
+		std::vector<float> m_ScaleX;
+		std::vector<float> m_ScaleY;
+		std::vector<float> m_ScaleZ;
+
+		std::vector<uint8_t> m_DirtyBlocks;		// One flag per block
+		std::vector<glm::mat4> m_WorldMatrices;	// Padded like the components
+
+		size_t m_Count = 0;
+		uint64_t m_Version = 0;
+	};
+
+} // namespace Onion::Rendering
@@ -0,0 +1,169 @@
+#include "upload_context.hpp"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+#include "../../core/profiler/profiler.hpp"
+
+using namespace Onion::Rendering;
+
+UploadContext::~UploadContext()
+{
+	Destroy();
+}
+
+bool UploadContext::Create(GLFWwindow* sharedWith)
+{
+	if (IsAvailable()) {
+		return true;
+	}
+
+	// Sharing needs the same kind of context: EGL and OSMesa for the headless backends
+	glfwDefaultWindowHints();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_CONTEXT_CREATION_API, glfwGetWindowAttrib(sharedWith, GLFW_CONTEXT_CREATION_API));
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_FOCUSED, GLFW_FALSE);
+
+	// The calling thread keeps its context current
+	m_Window = glfwCreateWindow(1, 1, "Onion Upload", nullptr, sharedWith);
+	if (!m_Window) {
+		std::cout << "[UPLOAD CONTEXT] [WARNING] : Failed to create a shared context, uploads stay on the render thread" << std::endl;
+		return false;
+	}
+
+	m_Stopping = false;
+	m_Thread = std::thread(&UploadContext::LoaderThreadFunction, this);
+	return true;
+}
+
+void UploadContext::Destroy()
+{
+	if (!m_Window) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_Condition.notify_all();
+	m_Thread.join();
+
+	glfwDestroyWindow(m_Window);
+	m_Window = nullptr;
+}
+
+void UploadContext::Submit(std::function<void()> upload, std::function<void(bool)> onReady)
+{
+	if (!IsAvailable()) {
+		throw std::runtime_error("UploadContext::Submit without a shared context");
+	}
+
+	m_Pending.fetch_add(1, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Queue.push_back({ std::move(upload), std::move(onReady) });
+	}
+	m_Condition.notify_one();
+}
+
+UploadContext::Stats UploadContext::GetStats() const
+{
+	Stats stats;
+	stats.Uploads = m_Uploads.load(std::memory_order_relaxed);
+	stats.Pending = m_Pending.load(std::memory_order_relaxed);
+	stats.Upload_ms = static_cast<double>(m_UploadTime_ns.load(std::memory_order_relaxed)) / 1e6;
+	return stats;
+}
+
+void UploadContext::LoaderThreadFunction()
+{
+	ONION_PROFILE_THREAD("Upload");
+	glfwMakeContextCurrent(m_Window);
+
+	// Fences in flight are polled every millisecond while waiting for new uploads
+	const auto pollInterval = std::chrono::milliseconds(1);
+
+	while (true) {
+		PendingUpload pending;
+		bool hasUpload = false;
+		bool stopping = false;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			const auto ready = [this]() { return m_Stopping || !m_Queue.empty(); };
+			if (m_Fenced.empty()) {
+				m_Condition.wait(lock, ready);
+			}
+			else {
+				m_Condition.wait_for(lock, pollInterval, ready);
+			}
+
+			if (!m_Queue.empty()) {
+				pending = std::move(m_Queue.front());
+				m_Queue.pop_front();
+				hasUpload = true;
+			}
+			else if (m_Stopping && m_Fenced.empty()) {
+				break;
+			}
+			stopping = m_Stopping;
+		}
+
+		if (hasUpload) {
+			ONION_PROFILE_SCOPE("UploadContext::Upload");
+			const auto start = std::chrono::steady_clock::now();
+			bool succeeded = true;
+			try {
+				pending.Upload();
+			}
+			catch (const std::exception& e) {
+				std::cout << "[UPLOAD CONTEXT] [ERROR] : " << e.what() << std::endl;
+				succeeded = false;
+			}
+			m_UploadTime_ns.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count()), std::memory_order_relaxed);
+
+			// Flushed, or the fence might never reach the GPU
+			GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+			m_Fenced.push_back({ fence, std::move(pending.OnReady), succeeded });
+		}
+
+		// Nothing left to upload when stopping: block on the fences instead of polling them
+		CollectFences(stopping && !hasUpload ? 1000000 : 0);
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+void UploadContext::CollectFences(uint64_t timeout_ns)
+{
+	// Fences signal in order, the first one not signaled stops the scan
+	while (!m_Fenced.empty()) {
+		FencedUpload& front = m_Fenced.front();
+		const GLenum status = glClientWaitSync(front.Fence, 0, timeout_ns);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			return;
+		}
+		if (status == GL_WAIT_FAILED) {
+			std::cout << "[UPLOAD CONTEXT] [ERROR] : Fence wait failed, handing the upload over after a glFinish" << std::endl;
+			glFinish();
+		}
+		glDeleteSync(front.Fence);
+
+		std::function<void(bool)> onReady = std::move(front.OnReady);
+		const bool succeeded = front.Succeeded;
+		m_Fenced.pop_front();
+		if (onReady) {
+			onReady(succeeded);
+		}
+		m_Uploads.fetch_add(1, std::memory_order_relaxed);
+		m_Pending.fetch_sub(1, std::memory_order_relaxed);
+		timeout_ns = 0;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Onion::Rendering {
+
+	// Loader thread owning a hidden OpenGL context that shares its objects with the render context,
+	// so buffers and textures are created and filled off the render thread.
+	// Each upload is followed by a fence: it is handed over once the GPU signaled it, the render thread
+	// then only binds the objects. Vertex arrays and framebuffers are not shared between contexts,
+	// they still have to be created on the render thread (from the uploaded buffers, see Mesh::UploadBuffers).
+	class UploadContext {
+	public:
+		struct Stats {
+			uint64_t Uploads = 0;		// Handed over
+			uint32_t Pending = 0;		// Queued or waiting for their fence
+			double Upload_ms = 0.0;		// Time spent by the loader thread in the upload functions
+		};
+
+		UploadContext() = default;
+		~UploadContext();
+
+		UploadContext(const UploadContext&) = delete;
+		UploadContext& operator=(const UploadContext&) = delete;
+
+		// Render thread, its context current: creates the shared context and starts the loader thread.
+		// False (and a warning logged) when the context cannot be created, the uploads then stay on the render thread.
+		bool Create(GLFWwindow* sharedWith);
+		// Render thread: runs the queued uploads and their callbacks, then destroys the context
+		void Destroy();
+
+		bool IsAvailable() const {
+			return m_Window != nullptr;
+		}
+
+		// Any thread, once available. 'upload' runs on the loader thread with the shared context current,
+		// 'onReady' on the loader thread too once the GPU finished it, uploads in submission order.
+		// An upload that throws is logged, its callback still runs with 'succeeded' false.
+		void Submit(std::function<void()> upload, std::function<void(bool succeeded)> onReady = {});
+
+		Stats GetStats() const;
+
+	private:
+		struct PendingUpload {
+			std::function<void()> Upload;
+			std::function<void(bool)> OnReady;
+		};
+
+		struct FencedUpload {
+			GLsync Fence = nullptr;
+			std::function<void(bool)> OnReady;
+			bool Succeeded = true;
+		};
+
+		void LoaderThreadFunction();
+		// Hands over the uploads whose fence signaled, waiting up to 'timeout_ns' for the first one
+		void CollectFences(uint64_t timeout_ns);
+
+	private:
+		GLFWwindow* m_Window = nullptr;
+		std::thread m_Thread;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		std::deque<PendingUpload> m_Queue;
+		bool m_Stopping = false;
+
+		std::deque<FencedUpload> m_Fenced; // Loader thread only
+
+		std::atomic<uint64_t> m_Uploads{ 0 };
+		std::atomic<uint32_t> m_Pending{ 0 };
+		std::atomic<uint64_t> m_UploadTime_ns{ 0 };
+	};
+
+} // namespace Onion::Rendering
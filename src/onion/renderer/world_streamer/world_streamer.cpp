@@ -0,0 +1,636 @@
+#include "world_streamer.hpp"
+
+#include "../structs/scene_components.hpp"
+#include "../structs/transform.hpp"
+#include "../upload_context/upload_context.hpp"
+#include "../../core/profiler/profiler.hpp"
+#include "../../core/virtual_file_system/virtual_file_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+using namespace Onion::Rendering;
+using namespace Onion::Core;
+
+WorldStreamer::WorldStreamer(JobSystem& jobSystem) : m_JobSystem(jobSystem)
+{
+}
+
+WorldStreamer::~WorldStreamer()
+{
+	// Load jobs reference this object
+	m_JobSystem.Wait(m_LoadJobs);
+}
+
+void WorldStreamer::SetSettings(const Settings& settings)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Settings = settings;
+	m_Settings.CellSize = std::max(m_Settings.CellSize, 1.0f);
+	m_Settings.UnloadRadius = std::max(m_Settings.UnloadRadius, m_Settings.LoadRadius);
+	m_Settings.MaxLoadingCells = std::max(m_Settings.MaxLoadingCells, 1u);
+}
+
+WorldStreamer::Settings WorldStreamer::GetSettings() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Settings;
+}
+
+bool WorldStreamer::IsEnabled() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return !m_Settings.Directory.empty();
+}
+
+WorldStreamer::Stats WorldStreamer::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Stats;
+}
+
+uint64_t WorldStreamer::GetCellKey(glm::ivec2 coordinates)
+{
+	return (static_cast<uint64_t>(static_cast<uint32_t>(coordinates.x)) << 32) | static_cast<uint32_t>(coordinates.y);
+}
+
+float WorldStreamer::GetCellDistance(glm::ivec2 coordinates, const glm::vec3& position) const
+{
+	// On the ground plane, to the cell center
+	const float centerX = (static_cast<float>(coordinates.x) + 0.5f) * m_Settings.CellSize;
+	const float centerZ = (static_cast<float>(coordinates.y) + 0.5f) * m_Settings.CellSize;
+	const float dx = centerX - position.x;
+	const float dz = centerZ - position.z;
+	return std::sqrt(dx * dx + dz * dz);
+}
+
+// ------------ SIMULATION THREAD ------------
+
+void WorldStreamer::Update(World& world, const Camera& camera)
+{
+	ONION_PROFILE_SCOPE("WorldStreamer::Update");
+
+	const uint64_t epoch = m_Epoch.fetch_add(1, std::memory_order_relaxed) + 1;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_Settings.Directory.empty() || m_Released) {
+		return;
+	}
+
+	const glm::vec3 position = camera.GetPosition();
+
+	// Spawn the cells that finished loading, drop the ones that left the range
+	uint32_t loadingCells = 0;
+	for (auto& [key, cellPtr] : m_Cells) {
+		Cell& cell = *cellPtr;
+		const bool outOfRange = GetCellDistance(cell.Coordinates, position) > m_Settings.UnloadRadius;
+
+		switch (cell.State) {
+		case CellState::Loading:
+			if (outOfRange) {
+				cell.State = CellState::Cancelled;
+			}
+			else {
+				loadingCells++;
+			}
+			break;
+		case CellState::Uploading:
+			if (outOfRange) {
+				// Never spawned, no snapshot references it
+				cell.State = CellState::Retiring;
+				cell.RetireEpoch = 0;
+			}
+			else {
+				loadingCells++;
+			}
+			break;
+		case CellState::Ready:
+			if (outOfRange) {
+				cell.State = CellState::Retiring;
+				cell.RetireEpoch = 0;
+			}
+			else {
+				SpawnCell(world, cell);
+				cell.State = CellState::Active;
+				m_Stats.CellsLoaded++;
+			}
+			break;
+		case CellState::Active:
+			if (outOfRange) {
+				DespawnCell(world, cell);
+				cell.State = CellState::Retiring;
+				cell.RetireEpoch = epoch;
+			}
+			break;
+		case CellState::Cancelled:
+		case CellState::Retiring:
+			break;
+		}
+	}
+
+	// Cells in range and not loaded yet, closest first, the ones in front of the camera before the ones behind
+	const float cellSize = m_Settings.CellSize;
+	const float radius = m_Settings.LoadRadius;
+	const int minX = static_cast<int>(std::floor((position.x - radius) / cellSize));
+	const int maxX = static_cast<int>(std::floor((position.x + radius) / cellSize));
+	const int minZ = static_cast<int>(std::floor((position.z - radius) / cellSize));
+	const int maxZ = static_cast<int>(std::floor((position.z + radius) / cellSize));
+
+	glm::vec2 front(camera.GetFront().x, camera.GetFront().z);
+	const float frontLength = std::sqrt(front.x * front.x + front.y * front.y);
+	front = frontLength > 1e-4f ? front / frontLength : glm::vec2(0.0f);
+
+	m_Candidates.clear();
+	for (int z = minZ; z <= maxZ; z++) {
+		for (int x = minX; x <= maxX; x++) {
+			const glm::ivec2 coordinates(x, z);
+			if (GetCellDistance(coordinates, position) <= radius && m_Cells.find(GetCellKey(coordinates)) == m_Cells.end()) {
+				m_Candidates.push_back(coordinates);
+			}
+		}
+	}
+
+	if (m_Candidates.empty()) {
+		return;
+	}
+
+	const auto priority = [&](glm::ivec2 coordinates) {
+		const float distance = GetCellDistance(coordinates, position);
+		if (distance < 1e-4f) {
+			return 0.0f;
+		}
+		const float dx = ((static_cast<float>(coordinates.x) + 0.5f) * cellSize - position.x) / distance;
+		const float dz = ((static_cast<float>(coordinates.y) + 0.5f) * cellSize - position.z) / distance;
+		const float facing = dx * front.x + dz * front.y;
+		return distance * (1.0f + m_Settings.ViewDirectionWeight * (1.0f - facing) * 0.5f);
+	};
+	std::sort(m_Candidates.begin(), m_Candidates.end(), [&](glm::ivec2 a, glm::ivec2 b) {
+		return priority(a) < priority(b);
+	});
+
+	for (const glm::ivec2 coordinates : m_Candidates) {
+		if (loadingCells >= m_Settings.MaxLoadingCells
+			|| m_Cells.size() >= m_Settings.MaxResidentCells
+			|| m_Stats.ResidentBytes >= m_Settings.MaxResidentBytes) {
+			break;
+		}
+
+		auto cell = std::make_unique<Cell>();
+		cell->Coordinates = coordinates;
+		Cell* loading = cell.get();
+		m_Cells.emplace(GetCellKey(coordinates), std::move(cell));
+		loadingCells++;
+
+		m_JobSystem.Run([this, loading]() { LoadCell(loading); }, &m_LoadJobs);
+	}
+}
+
+void WorldStreamer::SpawnCell(World& world, Cell& cell)
+{
+	const glm::vec3 origin(static_cast<float>(cell.Coordinates.x) * m_Settings.CellSize, 0.0f,
+		static_cast<float>(cell.Coordinates.y) * m_Settings.CellSize);
+
+	// Reserved once: the MaterialRef components point into it
+	cell.Materials.clear();
+	cell.Materials.reserve(cell.Objects.size());
+	cell.Entities.reserve(cell.Objects.size());
+
+	for (size_t i = 0; i < cell.Objects.size(); i++) {
+		const CellObject& object = cell.Objects[i];
+
+		const StreamedModel& model = m_Models.at(object.ModelPath);
+		const StreamedTexture& albedo = m_Textures.at(object.AlbedoPath);
+		const StreamedTexture& roughness = m_Textures.at(object.RoughnessPath);
+		if (model.Failed || albedo.Failed || roughness.Failed) {
+			continue;
+		}
+
+		// Objects with the same textures share their material: one block and one bind for all of them
+		const auto sameTextures = [&](const Material& material) {
+			return material.Albedo == albedo.Image.get() && material.Roughness == roughness.Image.get();
+		};
+		const auto found = std::find_if(cell.Materials.begin(), cell.Materials.end(), sameTextures);
+		Material& material = found != cell.Materials.end() ? *found : cell.Materials.emplace_back();
+		material.Albedo = albedo.Image.get();
+		material.Roughness = roughness.Image.get();
+
+		Transform transform;
+		transform.Position = origin + object.Position;
+		transform.Rotation = object.Rotation;
+		transform.Scale = object.Scale;
+
+		cell.Entities.push_back(world.Create(transform, PreviousTransform{ transform }, CachedModelMatrix{},
+			MeshRef{ model.Gpu.get(), true }, MaterialRef{ &material }));
+	}
+}
+
+void WorldStreamer::DespawnCell(World& world, Cell& cell)
+{
+	for (const Entity entity : cell.Entities) {
+		world.Destroy(entity);
+	}
+	cell.Entities.clear();
+}
+
+// ------------ JOB SYSTEM ------------
+
+void WorldStreamer::LoadCell(Cell* cell)
+{
+	ONION_PROFILE_SCOPE("WorldStreamer::LoadCell");
+
+	std::string directory;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		directory = m_Settings.Directory;
+	}
+
+	// Only this job touches the objects while the cell is loading
+	const std::string fileName = "cell_" + std::to_string(cell->Coordinates.x) + "_" + std::to_string(cell->Coordinates.y) + ".txt";
+	std::string manifest;
+	VirtualFileSystem::ReadText((std::filesystem::path(directory) / fileName).generic_string(), manifest);
+	std::istringstream file(manifest);
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		std::istringstream stream(line);
+		std::string keyword;
+		if (!(stream >> keyword) || keyword[0] == '#') {
+			continue;
+		}
+
+		CellObject object;
+		if (keyword != "object"
+			|| !(stream >> object.ModelPath >> object.AlbedoPath >> object.RoughnessPath)
+			|| !(stream >> object.Position.x >> object.Position.y >> object.Position.z)) {
+			std::cout << "[WORLD STREAMER] [WARNING] : Invalid line " << lineNumber << " in " << fileName << std::endl;
+			continue;
+		}
+		if (stream >> object.Rotation.x) {
+			stream >> object.Rotation.y >> object.Rotation.z;
+			if (stream >> object.Scale.x) {
+				stream >> object.Scale.y >> object.Scale.z;
+			}
+		}
+
+		cell->Objects.push_back(std::move(object));
+	}
+
+	for (const CellObject& object : cell->Objects) {
+		AcquireModel(object.ModelPath);
+		AcquireTexture(object.AlbedoPath);
+		AcquireTexture(object.RoughnessPath);
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (cell->State == CellState::Cancelled) {
+		cell->State = CellState::Retiring;
+		cell->RetireEpoch = 0;
+	}
+	else {
+		cell->State = CellState::Uploading;
+	}
+}
+
+void WorldStreamer::AcquireModel(const std::string& path)
+{
+	StreamedModel* entry = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		entry = &m_Models[path];
+		// Whoever created the entry decodes it. An unreferenced entry is still uploading, it is picked up as is.
+		if (entry->References++ > 0 || entry->Queued) {
+			return;
+		}
+	}
+
+	// The entry stays in the map while referenced
+	std::vector<MeshData> data;
+	bool failed = false;
+	try {
+		data = Model::Import(path);
+	}
+	catch (const std::exception& e) {
+		std::cout << "[WORLD STREAMER] [ERROR] : " << e.what() << std::endl;
+		failed = true;
+	}
+
+	size_t bytes = 0;
+	for (const MeshData& mesh : data) {
+		bytes += mesh.Vertices.size() * sizeof(Vertex) + mesh.Indices.size() * sizeof(unsigned int);
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	entry->Data = std::move(data);
+	entry->Bytes = bytes;
+	entry->Failed = failed;
+	entry->Decoded = true;
+	m_Stats.ResidentBytes += bytes;
+}
+
+void WorldStreamer::AcquireTexture(const std::string& path)
+{
+	StreamedTexture* entry = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		entry = &m_Textures[path];
+		if (entry->References++ > 0 || entry->Queued) {
+			return;
+		}
+	}
+
+	auto image = std::make_unique<Texture>(path);
+	const bool failed = image->GetWidth() <= 0;
+	// Pixels and their mipmaps
+	const size_t bytes = failed ? 0
+		: static_cast<size_t>(image->GetWidth()) * image->GetHeight() * image->GetNrChannels() * 4 / 3;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	entry->Image = std::move(image);
+	entry->Bytes = bytes;
+	entry->Failed = failed;
+	entry->Decoded = true;
+	m_Stats.ResidentBytes += bytes;
+}
+
+// ------------ RENDER THREAD ------------
+
+void WorldStreamer::ProcessGpuWork(uint64_t renderedEpoch)
+{
+	ONION_PROFILE_SCOPE("WorldStreamer::ProcessGpuWork");
+
+	m_ModelUploads.clear();
+	m_TextureUploads.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// Cells the rendered snapshot no longer draws
+		for (auto it = m_Cells.begin(); it != m_Cells.end();) {
+			Cell& cell = *it->second;
+			if (cell.State == CellState::Retiring && cell.RetireEpoch <= renderedEpoch) {
+				ReleaseCell(cell);
+				m_Stats.CellsUnloaded++;
+				it = m_Cells.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+
+		if (m_UploadContext) {
+			// Everything decoded goes to the loader thread, the vertex arrays are not shared between contexts
+			for (auto& [path, model] : m_Models) {
+				if (model.HandedOver && !model.Gpu) {
+					model.Gpu = std::make_unique<Model>(model.Buffers);
+					model.Buffers.clear();
+				}
+			}
+			for (const auto& [key, cell] : m_Cells) {
+				if (cell->State == CellState::Uploading) {
+					SubmitUploads(*cell);
+				}
+			}
+		}
+		else {
+			size_t budget = m_Settings.UploadBudgetBytes;
+			for (const auto& [key, cell] : m_Cells) {
+				if (cell->State == CellState::Uploading && !QueueUploads(*cell, budget)) {
+					break;
+				}
+			}
+		}
+	}
+
+	// Decoded data is only touched by this thread from now on, the uploads run without blocking the loads
+	size_t uploadedBytes = 0;
+	for (StreamedModel* model : m_ModelUploads) {
+		model->Gpu = std::make_unique<Model>(model->Data);
+		model->Data.clear();
+		model->Data.shrink_to_fit();
+		uploadedBytes += model->Bytes;
+	}
+	for (StreamedTexture* texture : m_TextureUploads) {
+		texture->Image->Bind();
+		texture->Image->Unbind();
+		uploadedBytes += texture->Bytes;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (StreamedModel* model : m_ModelUploads) {
+		model->Queued = false;
+	}
+	for (StreamedTexture* texture : m_TextureUploads) {
+		texture->Queued = false;
+		texture->Uploaded = true;
+	}
+
+	m_Stats.ActiveCells = 0;
+	m_Stats.LoadingCells = 0;
+	m_Stats.RetiringCells = 0;
+	for (const auto& [key, cell] : m_Cells) {
+		if (cell->State == CellState::Uploading && IsUploaded(*cell)) {
+			cell->State = CellState::Ready;
+		}
+
+		switch (cell->State) {
+		case CellState::Loading:
+		case CellState::Uploading:
+		case CellState::Ready:
+			m_Stats.LoadingCells++;
+			break;
+		case CellState::Active:
+			m_Stats.ActiveCells++;
+			break;
+		case CellState::Cancelled:
+		case CellState::Retiring:
+			m_Stats.RetiringCells++;
+			break;
+		}
+	}
+	m_Stats.UploadedBytes = uploadedBytes + m_HandedOverBytes;
+	m_HandedOverBytes = 0;
+}
+
+void WorldStreamer::SetUploadContext(UploadContext* context)
+{
+	m_UploadContext = context && context->IsAvailable() ? context : nullptr;
+}
+
+void WorldStreamer::SubmitUploads(const Cell& cell)
+{
+	// Entries stay in the map while queued, even once unreferenced: the callbacks free them then
+	for (const CellObject& object : cell.Objects) {
+		StreamedModel& model = m_Models.at(object.ModelPath);
+		if (model.Decoded && !model.Failed && !model.Gpu && !model.Queued && !model.HandedOver) {
+			model.Queued = true;
+			StreamedModel* entry = &model;
+			m_UploadContext->Submit(
+				[entry]() { entry->Buffers = Model::UploadBuffers(entry->Data); },
+				[this, entry, path = object.ModelPath](bool succeeded) {
+					std::lock_guard<std::mutex> lock(m_Mutex);
+					entry->Queued = false;
+					m_HandedOverBytes += entry->Bytes;
+					if (entry->References == 0) {
+						Model::DeleteBuffers(entry->Buffers);
+						m_Stats.ResidentBytes -= entry->Bytes;
+						m_Models.erase(m_Models.find(path));
+						return;
+					}
+					// Its objects are skipped, like a model that failed to decode
+					entry->Failed = !succeeded;
+					entry->HandedOver = succeeded;
+					entry->Data.clear();
+					entry->Data.shrink_to_fit();
+				});
+		}
+
+		for (const std::string* path : { &object.AlbedoPath, &object.RoughnessPath }) {
+			StreamedTexture& texture = m_Textures.at(*path);
+			if (texture.Decoded && !texture.Failed && !texture.Uploaded && !texture.Queued) {
+				texture.Queued = true;
+				StreamedTexture* entry = &texture;
+				m_UploadContext->Submit(
+					[image = texture.Image.get()]() {
+						image->Bind();
+						image->Unbind();
+					},
+					[this, entry, path = *path](bool succeeded) {
+						std::lock_guard<std::mutex> lock(m_Mutex);
+						entry->Queued = false;
+						m_HandedOverBytes += entry->Bytes;
+						if (entry->References == 0) {
+							entry->Image->Delete();
+							m_Stats.ResidentBytes -= entry->Bytes;
+							m_Textures.erase(m_Textures.find(path));
+							return;
+						}
+						entry->Failed = !succeeded;
+						entry->Uploaded = succeeded;
+					});
+			}
+		}
+	}
+}
+
+bool WorldStreamer::QueueUploads(const Cell& cell, size_t& budget)
+{
+	const auto fits = [&](size_t bytes) {
+		// At least one asset per frame, however large
+		if (bytes > budget && !(m_ModelUploads.empty() && m_TextureUploads.empty())) {
+			return false;
+		}
+		budget -= std::min(bytes, budget);
+		return true;
+	};
+
+	for (const CellObject& object : cell.Objects) {
+		StreamedModel& model = m_Models.at(object.ModelPath);
+		if (model.Decoded && !model.Failed && !model.Gpu && !model.Queued) {
+			if (!fits(model.Bytes)) {
+				return false;
+			}
+			model.Queued = true;
+			m_ModelUploads.push_back(&model);
+		}
+
+		for (const std::string* path : { &object.AlbedoPath, &object.RoughnessPath }) {
+			StreamedTexture& texture = m_Textures.at(*path);
+			if (texture.Decoded && !texture.Failed && !texture.Uploaded && !texture.Queued) {
+				if (!fits(texture.Bytes)) {
+					return false;
+				}
+				texture.Queued = true;
+				m_TextureUploads.push_back(&texture);
+			}
+		}
+	}
+	return true;
+}
+
+bool WorldStreamer::IsUploaded(const Cell& cell) const
+{
+	for (const CellObject& object : cell.Objects) {
+		const StreamedModel& model = m_Models.at(object.ModelPath);
+		if (!model.Decoded || (!model.Failed && !model.Gpu)) {
+			return false;
+		}
+		for (const std::string* path : { &object.AlbedoPath, &object.RoughnessPath }) {
+			const StreamedTexture& texture = m_Textures.at(*path);
+			if (!texture.Decoded || (!texture.Failed && !texture.Uploaded)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void WorldStreamer::ReleaseCell(Cell& cell)
+{
+	for (const CellObject& object : cell.Objects) {
+		ReleaseModel(object.ModelPath);
+		ReleaseTexture(object.AlbedoPath);
+		ReleaseTexture(object.RoughnessPath);
+	}
+	cell.Objects.clear();
+	cell.Materials.clear();
+}
+
+void WorldStreamer::ReleaseModel(const std::string& path)
+{
+	const auto it = m_Models.find(path);
+	if (it == m_Models.end() || --it->second.References > 0) {
+		return;
+	}
+	// Freed by the upload context once handed over
+	if (it->second.Queued) {
+		return;
+	}
+
+	if (it->second.Gpu) {
+		it->second.Gpu->Delete();
+	}
+	else if (!it->second.Buffers.empty()) {
+		Model::DeleteBuffers(it->second.Buffers);
+	}
+	m_Stats.ResidentBytes -= it->second.Bytes;
+	m_Models.erase(it);
+}
+
+void WorldStreamer::ReleaseTexture(const std::string& path)
+{
+	const auto it = m_Textures.find(path);
+	if (it == m_Textures.end() || --it->second.References > 0) {
+		return;
+	}
+	if (it->second.Queued) {
+		return;
+	}
+
+	if (it->second.Image) {
+		it->second.Image->Delete();
+	}
+	m_Stats.ResidentBytes -= it->second.Bytes;
+	m_Textures.erase(it);
+}
+
+void WorldStreamer::ReleaseGpuResources()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Released = true;
+	}
+	m_JobSystem.Wait(m_LoadJobs);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& [key, cell] : m_Cells) {
+		ReleaseCell(*cell);
+	}
+	m_Cells.clear();
+}
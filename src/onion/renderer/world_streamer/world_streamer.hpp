@@ -0,0 +1,188 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../model/model.hpp"
+#include "../texture/texture.hpp"
+#include "../material/material.hpp"
+#include "../camera/camera.hpp"
+#include "../../core/ecs/ecs.hpp"
+#include "../../core/job_system/job_system.hpp"
+
+namespace Onion::Rendering {
+
+	class UploadContext;
+
+	// Streams the scene in square cells around the camera. Each cell has a manifest listing its objects
+	// (cell_<x>_<z>.txt in the world directory, a missing file is an empty cell).
+	// Work is split between three threads:
+	//  - simulation: Update picks the cells to load and unload, and spawns or despawns their entities;
+	//  - job system: cell manifests are read and their models and textures decoded, off the frame;
+	//  - render: ProcessGpuWork uploads the decoded assets within a per-frame budget, and frees the assets
+	//    of unloaded cells once no snapshot in flight can reference them. With an upload context, the assets
+	//    are uploaded by its loader thread instead, the frame only creates the vertex arrays.
+	// Models and textures are shared between cells and reference counted.
+	//
+	// Manifest lines, positions relative to the cell corner:
+	//   object <model path> <albedo path> <roughness path> <x> <y> <z> [<rx> <ry> <rz> [<sx> <sy> <sz>]]
+	class WorldStreamer {
+	public:
+		struct Settings {
+			std::string Directory;					// Empty: streaming disabled
+			float CellSize = 64.0f;
+			float LoadRadius = 160.0f;				// Cells closer than this are loaded
+			float UnloadRadius = 224.0f;			// and dropped once farther than this (hysteresis)
+			float ViewDirectionWeight = 1.0f;		// Cells behind the camera count as up to (1 + weight) times farther
+			uint32_t MaxResidentCells = 64;			// Memory bound: no new load past it, whatever the radius
+			size_t MaxResidentBytes = 1024ull << 20;	// Same, on the estimated size of the assets
+			uint32_t MaxLoadingCells = 4;			// Cells decoded at the same time on the job system
+			size_t UploadBudgetBytes = 16ull << 20;	// Per rendered frame, at least one asset goes through
+		};
+
+		struct Stats {
+			uint32_t ActiveCells = 0;		// Entities spawned
+			uint32_t LoadingCells = 0;		// Decoding or uploading
+			uint32_t RetiringCells = 0;		// Waiting for the renderer to release them
+			size_t ResidentBytes = 0;		// Estimated, CPU and GPU copies of the streamed assets
+			size_t UploadedBytes = 0;		// During the last rendered frame
+			uint64_t CellsLoaded = 0;
+			uint64_t CellsUnloaded = 0;
+		};
+
+		explicit WorldStreamer(Onion::Core::JobSystem& jobSystem);
+		// Waits for the loads in flight. GPU resources must have been released by the render thread.
+		~WorldStreamer();
+
+		WorldStreamer(const WorldStreamer&) = delete;
+		WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+		void SetSettings(const Settings& settings);
+		Settings GetSettings() const;
+		bool IsEnabled() const;
+
+		Stats GetStats() const;
+
+		// ------------ SIMULATION THREAD ------------
+
+		// Once per frame, before the snapshot is built
+		void Update(Onion::Core::World& world, const Camera& camera);
+
+		// Written into each snapshot: identifies which cell unloads the snapshot has seen
+		uint64_t GetEpoch() const {
+			return m_Epoch.load(std::memory_order_relaxed);
+		}
+
+		// ------------ RENDER THREAD ------------
+
+		// Before the first ProcessGpuWork. Must outlive the streamed assets: destroy it before ReleaseGpuResources.
+		void SetUploadContext(UploadContext* context);
+
+		// Once per frame. 'renderedEpoch' is the epoch of the snapshot being rendered.
+		void ProcessGpuWork(uint64_t renderedEpoch);
+
+		// Frees every streamed asset, before the GL context is destroyed
+		void ReleaseGpuResources();
+
+	private:
+		enum class CellState {
+			Loading,	// Manifest and assets decoded on the job system
+			Uploading,	// Assets uploaded by the render thread
+			Ready,		// Waiting for the simulation to spawn its entities
+			Active,		// Entities spawned
+			Cancelled,	// Left the range while loading, released once the job is done
+			Retiring,	// Entities despawned, released once the renderer is past RetireEpoch
+		};
+
+		struct StreamedModel {
+			std::vector<MeshData> Data;		// Until uploaded
+			std::vector<MeshBuffers> Buffers;	// Filled by the upload context, until the vertex arrays are created
+			std::unique_ptr<Model> Gpu;
+			size_t Bytes = 0;
+			uint32_t References = 0;
+			bool Decoded = false;
+			bool Queued = false;			// Picked for upload this frame, or in flight on the upload context
+			bool HandedOver = false;		// Buffers ready
+			bool Failed = false;
+		};
+
+		struct StreamedTexture {
+			std::unique_ptr<Texture> Image;	// Holds the decoded pixels until uploaded
+			size_t Bytes = 0;
+			uint32_t References = 0;
+			bool Decoded = false;
+			bool Queued = false;
+			bool Uploaded = false;
+			bool Failed = false;
+		};
+
+		struct CellObject {
+			std::string ModelPath;
+			std::string AlbedoPath;
+			std::string RoughnessPath;
+			glm::vec3 Position{ 0.0f };
+			glm::vec3 Rotation{ 0.0f };
+			glm::vec3 Scale{ 1.0f };
+		};
+
+		struct Cell {
+			glm::ivec2 Coordinates{ 0 };
+			CellState State = CellState::Loading;
+			std::vector<CellObject> Objects;
+			std::vector<Material> Materials;			// One per texture pair, reserved once uploaded
+			std::vector<Onion::Core::Entity> Entities;
+			uint64_t RetireEpoch = 0;
+		};
+
+		static uint64_t GetCellKey(glm::ivec2 coordinates);
+		float GetCellDistance(glm::ivec2 coordinates, const glm::vec3& position) const;
+
+		// Job system
+		void LoadCell(Cell* cell);
+		void AcquireModel(const std::string& path);
+		void AcquireTexture(const std::string& path);
+
+		// Render thread, m_Mutex held. Uploads themselves run without the lock.
+		bool QueueUploads(const Cell& cell, size_t& budget);
+		void SubmitUploads(const Cell& cell);
+		bool IsUploaded(const Cell& cell) const;
+		void ReleaseCell(Cell& cell);
+		void ReleaseModel(const std::string& path);
+		void ReleaseTexture(const std::string& path);
+
+		// Simulation thread
+		void SpawnCell(Onion::Core::World& world, Cell& cell);
+		void DespawnCell(Onion::Core::World& world, Cell& cell);
+
+	private:
+		Onion::Core::JobSystem& m_JobSystem;
+		Onion::Core::JobCounter m_LoadJobs;
+
+		mutable std::mutex m_Mutex;
+		Settings m_Settings;
+		Stats m_Stats;
+
+		std::unordered_map<uint64_t, std::unique_ptr<Cell>> m_Cells;
+		std::unordered_map<std::string, StreamedModel> m_Models;
+		std::unordered_map<std::string, StreamedTexture> m_Textures;
+
+		std::atomic<uint64_t> m_Epoch{ 0 };
+		bool m_Released = false; // After ReleaseGpuResources, nothing loads anymore
+
+		UploadContext* m_UploadContext = nullptr;
+		size_t m_HandedOverBytes = 0; // By the upload context since the last frame
+
+		std::vector<glm::ivec2> m_Candidates;			// Simulation thread scratch
+		std::vector<StreamedModel*> m_ModelUploads;		// Render thread scratch
+		std::vector<StreamedTexture*> m_TextureUploads;
+	};
+
+} // namespace Onion::Rendering
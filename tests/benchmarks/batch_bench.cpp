@@ -0,0 +1,152 @@
+// Batch offscreen rendering throughput: renders a turntable of a model to PNG files.
+//
+// Usage: OnionBatchBench [--images N] [--size W H] [--in-flight N] [--workers N]
+//                        [--backend auto|window|egl|osmesa] [--output-dir path]
+//   --images      Turntable frames to render (default 360)
+//   --size        Image size (default 256 256)
+//   --in-flight   Framebuffer + PBO pairs in flight (default 2)
+//   --workers     PNG encoding threads, -1 for one per core (default -1)
+//   --output-dir  Where the images go (default onion_batch)
+//
+// The reported metric is images per second, from the first submit to the last file written.
+
+#include <onion/renderer/batch_renderer/batch_renderer.hpp>
+#include <onion/renderer/offscreen_context/offscreen_context.hpp>
+#include <onion/renderer/asset_manager/asset_manager.hpp>
+#include <onion/core/job_system/job_system.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace Onion::Rendering;
+
+namespace {
+
+	struct Options {
+		int Images = 360;
+		int Width = 256;
+		int Height = 256;
+		int InFlight = 2;
+		int Workers = -1;
+		OffscreenBackend Backend = OffscreenBackend::Auto;
+		std::string OutputDir = "onion_batch";
+	};
+
+	Options ParseOptions(int argc, char** argv) {
+		Options options;
+		for (int i = 1; i < argc; i++) {
+			const bool hasValue = i + 1 < argc;
+			if (std::strcmp(argv[i], "--images") == 0 && hasValue) {
+				options.Images = std::max(1, std::atoi(argv[++i]));
+			}
+			else if (std::strcmp(argv[i], "--size") == 0 && i + 2 < argc) {
+				options.Width = std::max(1, std::atoi(argv[++i]));
+				options.Height = std::max(1, std::atoi(argv[++i]));
+			}
+			else if (std::strcmp(argv[i], "--in-flight") == 0 && hasValue) {
+				options.InFlight = std::max(1, std::atoi(argv[++i]));
+			}
+			else if (std::strcmp(argv[i], "--workers") == 0 && hasValue) {
+				options.Workers = std::atoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--backend") == 0 && hasValue) {
+				if (!ParseOffscreenBackend(argv[++i], options.Backend)) {
+					std::fprintf(stderr, "Unknown backend '%s', using auto\n", argv[i]);
+				}
+			}
+			else if (std::strcmp(argv[i], "--output-dir") == 0 && hasValue) {
+				options.OutputDir = argv[++i];
+			}
+		}
+		return options;
+	}
+}
+
+int main(int argc, char** argv) {
+	const Options options = ParseOptions(argc, argv);
+
+	std::error_code error;
+	std::filesystem::create_directories(options.OutputDir, error);
+	if (error) {
+		std::fprintf(stderr, "Cannot create %s: %s\n", options.OutputDir.c_str(), error.message().c_str());
+		return 1;
+	}
+
+	OffscreenContext context;
+	try {
+		context.Create(OffscreenContext::Settings{ options.Backend, options.Width, options.Height });
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	Onion::Core::JobSystem jobSystem(options.Workers);
+	BatchRenderer batch(jobSystem);
+	AssetManager assets;
+	Model model;
+
+	BatchRenderer::Stats stats;
+	int result = 0;
+	try {
+		model = Model("assets/models/food_apple_01_4k/food_apple_01_4k.gltf");
+		Material* material = assets.CreateMaterial("Apple");
+		material->Albedo = assets.LoadTexture("assets/models/food_apple_01_4k/textures/food_apple_01_diff_4k.jpg");
+		material->Roughness = assets.LoadTexture("assets/models/food_apple_01_4k/textures/food_apple_01_rough_4k.jpg");
+		model.SetMaterial(material);
+
+		BatchRenderer::Settings settings;
+		settings.InFlightImages = options.InFlight;
+		batch.Init(settings);
+
+		// Turntable: one full turn around the origin
+		std::vector<BatchJob> jobs(static_cast<size_t>(options.Images));
+		for (int i = 0; i < options.Images; i++) {
+			const float angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(options.Images);
+			BatchJob& job = jobs[static_cast<size_t>(i)];
+			job.SourceModel = &model;
+			job.CameraPosition = glm::vec3(0.25f * std::cos(angle), 0.08f, 0.25f * std::sin(angle));
+			job.CameraTarget = glm::vec3(0.0f, 0.04f, 0.0f);
+			job.Width = options.Width;
+			job.Height = options.Height;
+
+			char name[32];
+			std::snprintf(name, sizeof(name), "/frame_%04d.png", i);
+			job.OutputPath = options.OutputDir + name;
+		}
+
+		stats = batch.Render(jobs);
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		result = 1;
+	}
+
+	if (result == 0) {
+		std::printf("Batch rendering: %d images %dx%d, %d in flight, %u workers, %s (%s)\n", options.Images, options.Width, options.Height,
+			options.InFlight, jobSystem.GetWorkerCount(), ToString(context.GetBackend()), context.GetRendererName().c_str());
+		std::printf("  throughput                %10.1f images/s\n", stats.ImagesPerSecond);
+		std::printf("  submit                    %10.3f ms/image\n", stats.RenderMs);
+		std::printf("  readback wait             %10.3f ms/image\n", stats.ReadbackWaitMs);
+		std::printf("  png encoding (workers)    %10.3f ms/image\n", stats.EncodeMs);
+		if (stats.ImagesFailed > 0) {
+			std::fprintf(stderr, "%llu images failed\n", static_cast<unsigned long long>(stats.ImagesFailed));
+			result = 1;
+		}
+	}
+
+	batch.Delete();
+	assets.FreeAllAssets();
+	context.Destroy();
+
+	return result;
+}
@@ -0,0 +1,194 @@
+// Job system microbenchmarks: spawn overhead, dependency latency and parallel_for scaling.
+//
+// Usage: OnionJobSystemBench [--quick] [--max-threads N]
+//   --quick        Small problem sizes, used by ctest as a smoke test
+//   --max-threads  Upper bound of the scaling sweep (default 64, threads = workers + calling thread)
+
+#include <onion/core/job_system/job_system.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace Onion::Core;
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	struct Options {
+		bool Quick = false;
+		unsigned int MaxThreads = 64;
+	};
+
+	double ElapsedNs(Clock::time_point start, Clock::time_point end) {
+		return std::chrono::duration<double, std::nano>(end - start).count();
+	}
+
+	template<typename F>
+	double MedianNs(int repetitions, F&& run) {
+		std::vector<double> samples;
+		samples.reserve(static_cast<size_t>(repetitions));
+		for (int r = 0; r < repetitions; r++) {
+			samples.push_back(run());
+		}
+		std::sort(samples.begin(), samples.end());
+		return samples[samples.size() / 2];
+	}
+
+	// Empty jobs submitted from a non-worker thread, then waited on
+	void BenchSpawnExternal(JobSystem& jobs, size_t jobCount, int repetitions) {
+		const double ns = MedianNs(repetitions, [&]() {
+			JobCounter counter;
+			const auto start = Clock::now();
+			for (size_t i = 0; i < jobCount; i++) {
+				jobs.Run([]() {}, &counter);
+			}
+			jobs.Wait(counter);
+			return ElapsedNs(start, Clock::now());
+			});
+
+		std::printf("  spawn (external thread)   %10.1f ns/job\n", ns / static_cast<double>(jobCount));
+	}
+
+	// Empty jobs submitted from inside a worker, which goes through the lock-free deque
+	void BenchSpawnWorker(JobSystem& jobs, size_t jobCount, int repetitions) {
+		if (jobs.GetWorkerCount() == 0) {
+			return;
+		}
+
+		const double ns = MedianNs(repetitions, [&]() {
+			JobCounter root;
+			JobCounter children;
+			const auto start = Clock::now();
+			jobs.Run([&]() {
+				for (size_t i = 0; i < jobCount; i++) {
+					jobs.Run([]() {}, &children);
+				}
+				}, &root);
+			jobs.Wait(root);
+			jobs.Wait(children);
+			return ElapsedNs(start, Clock::now());
+			});
+
+		std::printf("  spawn (worker thread)     %10.1f ns/job\n", ns / static_cast<double>(jobCount));
+	}
+
+	// Chain of jobs, each one scheduled after the previous with RunAfter
+	void BenchDependencyChain(JobSystem& jobs, size_t chainLength, int repetitions) {
+		const double ns = MedianNs(repetitions, [&]() {
+			std::vector<JobCounter> counters(chainLength);
+			std::atomic<size_t> executed{ 0 };
+
+			const auto start = Clock::now();
+			jobs.Run([&]() { executed++; }, &counters[0]);
+			for (size_t i = 1; i < chainLength; i++) {
+				jobs.RunAfter(counters[i - 1], [&]() { executed++; }, &counters[i]);
+			}
+			jobs.Wait(counters[chainLength - 1]);
+			const double elapsed = ElapsedNs(start, Clock::now());
+
+			// Earlier counters may still be releasing their continuations
+			for (auto& counter : counters) {
+				jobs.Wait(counter);
+			}
+
+			if (executed.load() != chainLength) {
+				std::fprintf(stderr, "Dependency chain executed %zu jobs, expected %zu\n", executed.load(), chainLength);
+				std::exit(1);
+			}
+			return elapsed;
+			});
+
+		std::printf("  dependency chain          %10.1f ns/link\n", ns / static_cast<double>(chainLength));
+	}
+
+	// Compute bound parallel_for, returns the median time in ns
+	double RunParallelFor(JobSystem& jobs, const std::vector<float>& input, std::vector<float>& output, int repetitions) {
+		return MedianNs(repetitions, [&]() {
+			const auto start = Clock::now();
+			jobs.ParallelFor(0, input.size(), [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					float x = input[i];
+					for (int k = 0; k < 16; k++) {
+						x = std::sqrt(x * x + 1.0f) * 0.5f;
+					}
+					output[i] = x;
+				}
+				});
+			return ElapsedNs(start, Clock::now());
+			});
+	}
+
+	void BenchScaling(const Options& options) {
+		const size_t elementCount = options.Quick ? (size_t{ 1 } << 16) : (size_t{ 1 } << 22);
+		const int repetitions = options.Quick ? 3 : 9;
+
+		std::vector<float> input(elementCount);
+		for (size_t i = 0; i < elementCount; i++) {
+			input[i] = static_cast<float>(i % 1024);
+		}
+		std::vector<float> reference(elementCount);
+		std::vector<float> output(elementCount);
+
+		std::printf("\nparallel_for scaling (%zu elements)\n", elementCount);
+		std::printf("  %8s %14s %10s %12s\n", "threads", "time (ms)", "speedup", "efficiency");
+
+		double baseline = 0.0;
+		for (unsigned int threads = 1; threads <= options.MaxThreads; threads *= 2) {
+			// The calling thread takes part in ParallelFor, so N threads is N - 1 workers
+			JobSystem jobs(static_cast<int>(threads) - 1);
+
+			std::fill(output.begin(), output.end(), 0.0f);
+			const double ns = RunParallelFor(jobs, input, output, repetitions);
+
+			if (threads == 1) {
+				baseline = ns;
+				reference = output;
+			}
+			else if (std::memcmp(reference.data(), output.data(), elementCount * sizeof(float)) != 0) {
+				std::fprintf(stderr, "parallel_for produced a different result with %u threads\n", threads);
+				std::exit(1);
+			}
+
+			const double speedup = baseline / ns;
+			std::printf("  %8u %14.3f %10.2f %11.0f%%\n", threads, ns / 1.0e6, speedup, 100.0 * speedup / threads);
+		}
+	}
+
+	Options ParseOptions(int argc, char** argv) {
+		Options options;
+		for (int i = 1; i < argc; i++) {
+			if (std::strcmp(argv[i], "--quick") == 0) {
+				options.Quick = true;
+			}
+			else if (std::strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
+				options.MaxThreads = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+			}
+		}
+		return options;
+	}
+}
+
+int main(int argc, char** argv) {
+	const Options options = ParseOptions(argc, argv);
+
+	const size_t spawnCount = options.Quick ? 10'000 : 200'000;
+	const size_t chainLength = options.Quick ? 1'000 : 20'000;
+	const int repetitions = options.Quick ? 3 : 9;
+
+	JobSystem jobs;
+	std::printf("Job system (%u workers + calling thread)\n", jobs.GetWorkerCount());
+	BenchSpawnExternal(jobs, spawnCount, repetitions);
+	BenchSpawnWorker(jobs, spawnCount, repetitions);
+	BenchDependencyChain(jobs, chainLength, repetitions);
+
+	BenchScaling(options);
+
+	return 0;
+}
@@ -0,0 +1,744 @@
+// Microbenchmarks of engine hot paths: time and heap allocations per operation.
+//
+// Usage: OnionMicroBench [--quick] [--filter text] [--output path]
+//   --quick    Small iteration counts, used by ctest as a smoke test
+//   --filter   Only runs the cases whose name contains the text
+//   --output   Also writes the results as JSON, to compare runs across commits
+//
+// Inputs are generated from fixed sizes and seeds, iteration counts are fixed, and each case reports
+// the median of several repetitions. Cases that need OpenGL (texture lookups fill the cache through
+// a GL upload, shader setters) run on an offscreen context and are skipped when none can be created.
+// Inputs use the GLFW null platform, no display is needed.
+
+#include <onion/renderer/model/model.hpp>
+#include <onion/renderer/structs/transform.hpp>
+#include <onion/renderer/transform_system/transform_system.hpp>
+#include <onion/renderer/inputs_manager/inputs_manager.hpp>
+#include <onion/renderer/asset_manager/asset_manager.hpp>
+#include <onion/renderer/shader/shader.hpp>
+#include <onion/renderer/offscreen_context/offscreen_context.hpp>
+#include <onion/core/allocation_tracker/allocation_tracker.hpp>
+#include <onion/core/async_file_io/async_file_io.hpp>
+#include <onion/core/ecs/ecs.hpp>
+#include <onion/core/job_system/job_system.hpp>
+#include <onion/core/pack_archive/pack_archive.hpp>
+#include <onion/core/virtual_file_system/virtual_file_system.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace Onion::Rendering;
+using namespace Onion::Controls;
+
+using Onion::Core::AllocationTracker;
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	struct Options {
+		bool Quick = false;
+		std::string Filter;
+		std::string OutputPath;
+	};
+
+	struct Result {
+		std::string Name;
+		uint64_t Ops = 0;
+		double NsPerOp = 0.0;
+		double AllocationsPerOp = 0.0; // Negative when the engine was built without allocation tracking
+		bool Skipped = false;
+	};
+
+	// Opaque to the optimizer, so the measured work is not folded away
+	volatile float g_Sink = 0.0f;
+
+	Options ParseOptions(int argc, char** argv) {
+		Options options;
+		for (int i = 1; i < argc; i++) {
+			if (std::strcmp(argv[i], "--quick") == 0) {
+				options.Quick = true;
+			}
+			else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+				options.Filter = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+				options.OutputPath = argv[++i];
+			}
+		}
+		return options;
+	}
+
+	class Bench {
+	public:
+		explicit Bench(const Options& options)
+			: m_Options(options), m_Repetitions(options.Quick ? 3 : 11) {
+		}
+
+		bool IsEnabled(const char* name) const {
+			return m_Options.Filter.empty() || std::string(name).find(m_Options.Filter) != std::string::npos;
+		}
+
+		// Calls 'op' ops times per repetition. The median repetition gives ns/op,
+		// allocations are counted over every repetition.
+		void Run(const char* name, uint64_t ops, const std::function<void()>& op) {
+			if (!IsEnabled(name)) {
+				return;
+			}
+			if (m_Options.Quick) {
+				ops = std::max<uint64_t>(1, ops / 20);
+			}
+
+			op(); // Warm caches and lazy initializations
+
+			std::vector<double> samples;
+			samples.reserve(static_cast<size_t>(m_Repetitions));
+			const uint64_t allocationsBefore = AllocationTracker::GetThreadCount();
+			for (int r = 0; r < m_Repetitions; r++) {
+				const auto start = Clock::now();
+				for (uint64_t i = 0; i < ops; i++) {
+					op();
+				}
+				samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+			}
+			const uint64_t allocations = AllocationTracker::GetThreadCount() - allocationsBefore;
+
+			std::sort(samples.begin(), samples.end());
+			Result result;
+			result.Name = name;
+			result.Ops = ops;
+			result.NsPerOp = samples[samples.size() / 2] / static_cast<double>(ops);
+			result.AllocationsPerOp = AllocationTracker::IsEnabled()
+				? static_cast<double>(allocations) / static_cast<double>(ops * static_cast<uint64_t>(m_Repetitions))
+				: -1.0;
+			Print(result);
+			m_Results.push_back(result);
+		}
+
+		void Skip(const char* name, const char* reason) {
+			if (!IsEnabled(name)) {
+				return;
+			}
+			std::printf("  %-40s skipped (%s)\n", name, reason);
+			Result result;
+			result.Name = name;
+			result.Skipped = true;
+			m_Results.push_back(result);
+		}
+
+		// A case whose results were wrong: not timed, and the run exits with 1
+		void Fail(const char* name, const std::string& reason) {
+			std::printf("  %-40s FAILED (%s)\n", name, reason.c_str());
+			m_Failures++;
+		}
+
+		bool HasFailures() const {
+			return m_Failures > 0;
+		}
+
+		bool WriteJson(const std::string& path) const {
+			std::ofstream out(path);
+			if (!out) {
+				std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+				return false;
+			}
+			out << "{\n  \"quick\": " << (m_Options.Quick ? "true" : "false") << ",\n  \"cases\": [";
+			for (size_t i = 0; i < m_Results.size(); i++) {
+				const Result& r = m_Results[i];
+				out << (i == 0 ? "\n" : ",\n") << "    { \"name\": \"" << r.Name << "\"";
+				if (r.Skipped) {
+					out << ", \"skipped\": true }";
+				}
+				else {
+					out << ", \"ops\": " << r.Ops << ", \"ns_per_op\": " << r.NsPerOp << ", \"allocations_per_op\": ";
+					if (r.AllocationsPerOp < 0.0) {
+						out << "null }";
+					}
+					else {
+						out << r.AllocationsPerOp << " }";
+					}
+				}
+			}
+			out << "\n  ]\n}\n";
+			return true;
+		}
+
+	private:
+		static void Print(const Result& result) {
+			if (result.AllocationsPerOp < 0.0) {
+				std::printf("  %-40s %12.1f ns/op %10s allocs/op\n", result.Name.c_str(), result.NsPerOp, "-");
+			}
+			else {
+				std::printf("  %-40s %12.1f ns/op %10.2f allocs/op\n", result.Name.c_str(), result.NsPerOp, result.AllocationsPerOp);
+			}
+		}
+
+		const Options& m_Options;
+		int m_Repetitions = 0;
+		int m_Failures = 0;
+		std::vector<Result> m_Results;
+	};
+
+	// ------------ FIXED INPUTS ------------
+
+	uint32_t NextRandom(uint32_t& state) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	float RandomFloat(uint32_t& state) {
+		return static_cast<float>(NextRandom(state) & 0xFFFF) / 65535.0f * 2.0f - 1.0f;
+	}
+
+	// side * side vertices grid, two triangles per cell, like a mid-sized imported mesh
+	void FillGridMesh(aiMesh& mesh, unsigned int side) {
+		uint32_t seed = 0x9E3779B9u;
+
+		mesh.mNumVertices = side * side;
+		mesh.mVertices = new aiVector3D[mesh.mNumVertices];
+		mesh.mNormals = new aiVector3D[mesh.mNumVertices];
+		mesh.mTextureCoords[0] = new aiVector3D[mesh.mNumVertices];
+		mesh.mNumUVComponents[0] = 2;
+		mesh.mTangents = new aiVector3D[mesh.mNumVertices];
+		mesh.mBitangents = new aiVector3D[mesh.mNumVertices];
+
+		for (unsigned int i = 0; i < mesh.mNumVertices; i++) {
+			const float x = static_cast<float>(i % side);
+			const float z = static_cast<float>(i / side);
+			mesh.mVertices[i] = aiVector3D(x, RandomFloat(seed), z);
+			mesh.mNormals[i] = aiVector3D(RandomFloat(seed), 1.0f, RandomFloat(seed));
+			mesh.mTextureCoords[0][i] = aiVector3D(x / static_cast<float>(side), z / static_cast<float>(side), 0.0f);
+			mesh.mTangents[i] = aiVector3D(1.0f, 0.0f, 0.0f);
+			mesh.mBitangents[i] = aiVector3D(0.0f, 0.0f, 1.0f);
+		}
+
+		const unsigned int cells = (side - 1) * (side - 1);
+		mesh.mNumFaces = cells * 2;
+		mesh.mFaces = new aiFace[mesh.mNumFaces];
+		for (unsigned int c = 0; c < cells; c++) {
+			const unsigned int i = (c / (side - 1)) * side + c % (side - 1);
+			const unsigned int quad[2][3] = { { i, i + side, i + 1 }, { i + 1, i + side, i + side + 1 } };
+			for (unsigned int t = 0; t < 2; t++) {
+				aiFace& face = mesh.mFaces[c * 2 + t];
+				face.mNumIndices = 3;
+				face.mIndices = new unsigned int[3]{ quad[t][0], quad[t][1], quad[t][2] };
+			}
+		}
+	}
+
+	// ------------ CASES ------------
+
+	void RunModelCases(Bench& bench) {
+		aiMesh mesh;
+		FillGridMesh(mesh, 128);
+
+		const char* name = "Model::ConvertMesh (16k vertices)";
+		bench.Run(name, 200, [&mesh]() {
+			// Fresh vectors, like Model::Import
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			Model::ConvertMesh(mesh, vertices, indices);
+			g_Sink = vertices.back().UV.x + static_cast<float>(indices.back());
+			});
+	}
+
+	std::vector<Transform> MakeTransforms(size_t count) {
+		std::vector<Transform> transforms(count);
+		uint32_t seed = 0x12345678u;
+		for (Transform& transform : transforms) {
+			transform.Position = glm::vec3(RandomFloat(seed), RandomFloat(seed), RandomFloat(seed)) * 100.0f;
+			transform.Rotation = glm::vec3(RandomFloat(seed), RandomFloat(seed), RandomFloat(seed)) * 180.0f;
+			transform.Scale = glm::vec3(1.0f + RandomFloat(seed) * 0.5f);
+		}
+		return transforms;
+	}
+
+	void RunTransformCases(Bench& bench) {
+		constexpr size_t COUNT = 1024;
+		const std::vector<Transform> transforms = MakeTransforms(COUNT);
+
+		size_t index = 0;
+		bench.Run("Transform::GetModelMatrix", 1'000'000, [&]() {
+			const glm::mat4 model = transforms[index++ & (COUNT - 1)].GetModelMatrix();
+			g_Sink = model[3][0];
+			});
+	}
+
+	// One op recomposes every matrix of the batch: per transform, then through TransformSystem
+	// (SIMD, then split across a job system). "clean" measures an update with nothing dirty.
+	struct TransformBatchCase {
+		size_t Count;
+		uint64_t Ops;
+		const char* PerTransformName;
+		const char* SimdName;
+		const char* ParallelName;
+		const char* CleanName;
+	};
+
+	void RunTransformBatchCases(Bench& bench, bool quick) {
+		const TransformBatchCase cases[] = {
+			{ 1'000, 2'000, "Transforms 1k: GetModelMatrix each", "Transforms 1k: UpdateMatrices", "Transforms 1k: UpdateMatrices (jobs)", "Transforms 1k: UpdateMatrices (clean)" },
+			{ 100'000, 20, "Transforms 100k: GetModelMatrix each", "Transforms 100k: UpdateMatrices", "Transforms 100k: UpdateMatrices (jobs)", "Transforms 100k: UpdateMatrices (clean)" },
+			{ 1'000'000, 20, "Transforms 1M: GetModelMatrix each", "Transforms 1M: UpdateMatrices", "Transforms 1M: UpdateMatrices (jobs)", "Transforms 1M: UpdateMatrices (clean)" },
+		};
+
+		std::printf("  Transform batches: %s kernels\n", TransformSystem::GetSimdPath());
+		Onion::Core::JobSystem jobSystem;
+
+		for (const TransformBatchCase& batch : cases) {
+			if (quick && batch.Count > 100'000) {
+				for (const char* name : { batch.PerTransformName, batch.SimdName, batch.ParallelName, batch.CleanName }) {
+					bench.Skip(name, "too large for --quick");
+				}
+				continue;
+			}
+
+			const std::vector<Transform> transforms = MakeTransforms(batch.Count);
+			std::vector<glm::mat4> matrices(batch.Count);
+			bench.Run(batch.PerTransformName, batch.Ops, [&]() {
+				for (size_t i = 0; i < transforms.size(); i++) {
+					matrices[i] = transforms[i].GetModelMatrix();
+				}
+				g_Sink = matrices.back()[3][0];
+				});
+
+			TransformSystem system;
+			system.Reserve(batch.Count);
+			for (const Transform& transform : transforms) {
+				system.Create(transform.Position, transform.GetOrientation(), transform.Scale);
+			}
+
+			bench.Run(batch.SimdName, batch.Ops, [&]() {
+				system.MarkAllDirty();
+				g_Sink = static_cast<float>(system.UpdateMatrices());
+				});
+			bench.Run(batch.ParallelName, batch.Ops, [&]() {
+				system.MarkAllDirty();
+				g_Sink = static_cast<float>(system.UpdateMatrices(jobSystem));
+				});
+			bench.Run(batch.CleanName, batch.Ops, [&]() {
+				g_Sink = static_cast<float>(system.UpdateMatrices());
+				});
+		}
+	}
+
+	// One op moves every entity: position += velocity * dt, 24 bytes read and 12 written per entity.
+	// A third of the entities have an extra component, so the query spans two archetypes.
+	struct EcsPosition {
+		glm::vec3 Value;
+	};
+	struct EcsVelocity {
+		glm::vec3 Value;
+	};
+	struct EcsTag {
+		uint32_t Value;
+	};
+
+	struct EcsCase {
+		size_t Count;
+		uint64_t Ops;
+		const char* EachName;
+		const char* ParallelName;
+	};
+
+	void RunEcsCases(Bench& bench, bool quick) {
+		const EcsCase cases[] = {
+			{ 100'000, 200, "World::Each 100k entities", "World::ParallelEach 100k entities" },
+			{ 1'000'000, 20, "World::Each 1M entities", "World::ParallelEach 1M entities" },
+		};
+
+		Onion::Core::JobSystem jobSystem;
+
+		for (const EcsCase& ecsCase : cases) {
+			if (!bench.IsEnabled(ecsCase.EachName) && !bench.IsEnabled(ecsCase.ParallelName)) {
+				continue;
+			}
+			if (quick && ecsCase.Count > 100'000) {
+				bench.Skip(ecsCase.EachName, "too large for --quick");
+				bench.Skip(ecsCase.ParallelName, "too large for --quick");
+				continue;
+			}
+
+			Onion::Core::World world;
+			uint32_t seed = 0x2545F491u;
+			for (size_t i = 0; i < ecsCase.Count; i++) {
+				const EcsPosition position{ glm::vec3(RandomFloat(seed), RandomFloat(seed), RandomFloat(seed)) };
+				const EcsVelocity velocity{ glm::vec3(RandomFloat(seed), RandomFloat(seed), RandomFloat(seed)) };
+				if (i % 3 == 0) {
+					world.Create(position, velocity, EcsTag{ static_cast<uint32_t>(i) });
+				}
+				else {
+					world.Create(position, velocity);
+				}
+			}
+
+			constexpr float DELTA_TIME = 1.0f / 60.0f;
+			bench.Run(ecsCase.EachName, ecsCase.Ops, [&]() {
+				world.Each<EcsPosition, const EcsVelocity>([](EcsPosition& position, const EcsVelocity& velocity) {
+					position.Value += velocity.Value * DELTA_TIME;
+					});
+				});
+			bench.Run(ecsCase.ParallelName, ecsCase.Ops, [&]() {
+				world.ParallelEach<EcsPosition, const EcsVelocity>(jobSystem, [](EcsPosition& position, const EcsVelocity& velocity) {
+					position.Value += velocity.Value * DELTA_TIME;
+					});
+				});
+		}
+	}
+
+	void RunInputsCases(Bench& bench) {
+		const char* name = "InputsManager::PoolInputs (32 keys)";
+		const char* readName = "InputsManager::GetInputsSnapshot (8 lookups)";
+		if (!bench.IsEnabled(name) && !bench.IsEnabled(readName)) {
+			return;
+		}
+
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+		if (!glfwInit()) {
+			bench.Skip(name, "GLFW null platform unavailable");
+			bench.Skip(readName, "GLFW null platform unavailable");
+			return;
+		}
+
+		glfwDefaultWindowHints();
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		GLFWwindow* window = glfwCreateWindow(800, 600, "Onion MicroBench", nullptr, nullptr);
+		if (!window) {
+			glfwTerminate();
+			bench.Skip(name, "no window on the null platform");
+			bench.Skip(readName, "no window on the null platform");
+			return;
+		}
+
+		{
+			InputsManager inputs;
+			inputs.Init(window);
+			inputs.SetMouseCaptureEnabled(false);
+			for (int key = 0; key < 32; key++) {
+				inputs.RegisterInput(static_cast<Key>(static_cast<int>(Key::A) + key % 26));
+			}
+
+			// Publishes the state built by the GLFW callbacks, as the render thread does every frame
+			bench.Run(name, 20'000, [&inputs]() {
+				inputs.PoolInputs();
+				g_Sink = static_cast<float>(inputs.GetInputsSnapshot().GetKeyState(32).IsPressed);
+				});
+
+			// What the simulation does every frame: copy the latest snapshot, then look keys up
+			bench.Run(readName, 200'000, [&inputs]() {
+				const InputsSnapshot snapshot = inputs.GetInputsSnapshot();
+				int pressed = 0;
+				for (int inputId = 1; inputId <= 8; inputId++) {
+					pressed += snapshot.GetKeyState(inputId).IsPressed ? 1 : 0;
+				}
+				g_Sink = static_cast<float>(pressed);
+				});
+		}
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+
+	void RunOpenGlCases(Bench& bench) {
+		const char* textureName = "AssetManager::LoadTexture (cached)";
+		const char* mat4Name = "Shader::setMat4";
+		const char* vec3Name = "Shader::setVec3";
+		const char* floatName = "Shader::setFloat";
+		if (!bench.IsEnabled(textureName) && !bench.IsEnabled(mat4Name) && !bench.IsEnabled(vec3Name) && !bench.IsEnabled(floatName)) {
+			return;
+		}
+
+		OffscreenContext context;
+		try {
+			context.Create(OffscreenContext::Settings{ OffscreenBackend::Auto, 64, 64 });
+		}
+		catch (const std::exception&) {
+			for (const char* name : { textureName, mat4Name, vec3Name, floatName }) {
+				bench.Skip(name, "no OpenGL context");
+			}
+			return;
+		}
+
+		// The textures shipped with the engine, loaded once: only the lookup is measured
+		const std::vector<std::string> paths = {
+			"assets/textures/container.jpg",
+			"assets/textures/skybox/right.bmp",
+			"assets/textures/skybox/left.bmp",
+			"assets/textures/skybox/top.bmp",
+			"assets/textures/skybox/bottom.bmp",
+			"assets/textures/skybox/front.bmp",
+			"assets/textures/skybox/back.bmp",
+		};
+
+		AssetManager assets;
+		bool texturesLoaded = true;
+		try {
+			for (const std::string& path : paths) {
+				assets.LoadTexture(path);
+			}
+		}
+		catch (const std::exception&) {
+			texturesLoaded = false;
+		}
+
+		if (texturesLoaded) {
+			size_t index = 0;
+			bench.Run(textureName, 200'000, [&]() {
+				const Texture* texture = assets.LoadTexture(paths[index++ % paths.size()]);
+				g_Sink = static_cast<float>(texture->GetWidth());
+				});
+		}
+		else {
+			bench.Skip(textureName, "assets not found next to the binary");
+		}
+
+		Shader shader;
+		try {
+			shader = Shader("assets/shaders/model.vert", "assets/shaders/model.frag");
+		}
+		catch (const std::exception&) {
+		}
+
+		if (shader.HasBeenCompiled()) {
+			shader.Use();
+			const glm::mat4 matrix(1.5f);
+			const glm::vec3 vector(0.5f, 0.25f, 1.0f);
+
+			bench.Run(mat4Name, 200'000, [&]() { shader.setMat4("uModel", matrix); });
+			bench.Run(vec3Name, 200'000, [&]() { shader.setVec3("uLightDir", vector); });
+			bench.Run(floatName, 200'000, [&]() { shader.setFloat("uSpecularStrength", 0.5f); });
+			glFinish();
+		}
+		else {
+			for (const char* name : { mat4Name, vec3Name, floatName }) {
+				bench.Skip(name, "model shader not compiled");
+			}
+		}
+
+		shader.Delete();
+		assets.FreeAllAssets();
+		context.Destroy();
+	}
+
+	void RunAssetFileCases(Bench& bench) {
+		const char* looseName = "VFS read, loose file (4 KB)";
+		const char* mappedName = "VFS read, .onionpak stored (4 KB)";
+		const char* compressedName = "VFS read, .onionpak compressed (4 KB)";
+		if (!bench.IsEnabled(looseName) && !bench.IsEnabled(mappedName) && !bench.IsEnabled(compressedName)) {
+			return;
+		}
+
+		// Shader-like text files, written once as loose files and packed twice
+		constexpr size_t FILE_COUNT = 256;
+		constexpr size_t FILE_SIZE = 4096;
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "onion_micro_bench_files";
+		std::filesystem::create_directories(directory);
+
+		Onion::Core::PackWriter stored;
+		Onion::Core::PackWriter::Settings settings;
+		settings.Compress = false;
+		stored.SetSettings(settings);
+		Onion::Core::PackWriter compressed;
+
+		std::vector<std::string> loosePaths;
+		std::vector<std::string> storedPaths;
+		std::vector<std::string> compressedPaths;
+		std::vector<std::string> fileContents(FILE_COUNT);
+		uint32_t seed = 0x68E31DA4u;
+		for (size_t i = 0; i < FILE_COUNT; i++) {
+			std::string& contents = fileContents[i];
+			while (contents.size() < FILE_SIZE) {
+				contents += "uniform vec3 uLight" + std::to_string(static_cast<int>(RandomFloat(seed) * 64.0f)) + ";\n";
+			}
+			contents.resize(FILE_SIZE);
+			const std::string name = "file_" + std::to_string(i) + ".glsl";
+
+			loosePaths.push_back((directory / name).generic_string());
+			std::ofstream(loosePaths.back(), std::ios::binary).write(contents.data(), static_cast<std::streamsize>(contents.size()));
+
+			storedPaths.push_back("stored/" + name);
+			compressedPaths.push_back("compressed/" + name);
+			stored.Add(storedPaths.back(), reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+			compressed.Add(compressedPaths.back(), reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+		}
+
+		const std::string storedArchive = (directory / "stored.onionpak").string();
+		const std::string compressedArchive = (directory / "compressed.onionpak").string();
+		stored.Write(storedArchive);
+		compressed.Write(compressedArchive);
+		Onion::Core::VirtualFileSystem::Mount(storedArchive);
+		Onion::Core::VirtualFileSystem::Mount(compressedArchive);
+
+		Onion::Core::FileData file;
+		const auto run = [&](const char* name, const std::vector<std::string>& paths) {
+			if (!bench.IsEnabled(name)) {
+				return;
+			}
+			// Every file read back once before timing, so a broken backend cannot time garbage
+			for (size_t i = 0; i < paths.size(); i++) {
+				if (!Onion::Core::VirtualFileSystem::ReadFile(paths[i], file)) {
+					bench.Fail(name, "cannot read " + paths[i]);
+					return;
+				}
+				if (file.GetSize() != fileContents[i].size() || std::memcmp(file.GetData(), fileContents[i].data(), file.GetSize()) != 0) {
+					bench.Fail(name, "wrong contents for " + paths[i]);
+					return;
+				}
+			}
+
+			size_t index = 0;
+			bool readFailed = false;
+			bench.Run(name, 20'000, [&]() {
+				if (!Onion::Core::VirtualFileSystem::ReadFile(paths[index++ % paths.size()], file)) {
+					readFailed = true;
+					return;
+				}
+				g_Sink = static_cast<float>(file.GetData()[file.GetSize() / 2]);
+				});
+			if (readFailed) {
+				bench.Fail(name, "a timed read failed");
+			}
+		};
+		run(looseName, loosePaths);
+		run(mappedName, storedPaths);
+		run(compressedName, compressedPaths);
+
+		Onion::Core::VirtualFileSystem::UnmountAll();
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+	}
+
+	void RunAsyncFileCases(Bench& bench) {
+		const char* syncName = "File batch, synchronous (16 x 256 KB)";
+		const char* uringName = "File batch, io_uring (16 x 256 KB)";
+		const char* poolName = "File batch, pread pool (16 x 256 KB)";
+		if (!bench.IsEnabled(syncName) && !bench.IsEnabled(uringName) && !bench.IsEnabled(poolName)) {
+			return;
+		}
+
+		// A texture set: one op reads every file, from the page cache after the first run
+		constexpr size_t FILE_COUNT = 16;
+		constexpr size_t FILE_SIZE = 256 * 1024;
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "onion_micro_bench_async";
+		std::filesystem::create_directories(directory);
+
+		std::vector<std::string> paths;
+		std::vector<std::vector<uint8_t>> fileContents(FILE_COUNT, std::vector<uint8_t>(FILE_SIZE));
+		uint32_t seed = 0x2C1B3C6Du;
+		for (size_t i = 0; i < FILE_COUNT; i++) {
+			for (uint8_t& byte : fileContents[i]) {
+				byte = static_cast<uint8_t>(NextRandom(seed));
+			}
+			paths.push_back((directory / ("texture_" + std::to_string(i) + ".bin")).string());
+			std::ofstream(paths.back(), std::ios::binary).write(reinterpret_cast<const char*>(fileContents[i].data()), static_cast<std::streamsize>(FILE_SIZE));
+		}
+
+		std::vector<std::vector<uint8_t>> buffers(FILE_COUNT);
+		Onion::Core::FileData file;
+		if (bench.IsEnabled(syncName)) {
+			bool readFailed = false;
+			for (size_t i = 0; i < FILE_COUNT && !readFailed; i++) {
+				readFailed = !Onion::Core::VirtualFileSystem::ReadFile(paths[i], file)
+					|| file.GetSize() != FILE_SIZE || std::memcmp(file.GetData(), fileContents[i].data(), FILE_SIZE) != 0;
+			}
+			if (readFailed) {
+				bench.Fail(syncName, "wrong contents read back");
+			}
+			else {
+				bench.Run(syncName, 200, [&]() {
+					for (const std::string& path : paths) {
+						if (!Onion::Core::VirtualFileSystem::ReadFile(path, file)) {
+							readFailed = true;
+							return;
+						}
+						g_Sink = static_cast<float>(file.GetData()[file.GetSize() / 2]);
+					}
+					});
+				if (readFailed) {
+					bench.Fail(syncName, "a timed read failed");
+				}
+			}
+		}
+
+		Onion::Core::JobSystem jobSystem;
+		const auto run = [&](const char* name, bool useIoUring) {
+			if (!bench.IsEnabled(name)) {
+				return;
+			}
+			Onion::Core::AsyncFileIO io(jobSystem);
+			Onion::Core::AsyncFileIO::Settings settings;
+			settings.UseIoUring = useIoUring;
+			io.SetSettings(settings);
+			if (useIoUring && io.GetBackend() != Onion::Core::AsyncFileIO::Backend::IoUring) {
+				bench.Skip(name, "io_uring unavailable");
+				return;
+			}
+
+			std::vector<Onion::Core::IoResult> results(FILE_COUNT);
+			const auto readAll = [&]() {
+				std::vector<Onion::Core::IoRequest> requests(FILE_COUNT);
+				for (size_t i = 0; i < FILE_COUNT; i++) {
+					requests[i].Path = paths[i];
+					requests[i].WholeFile = &buffers[i];
+					requests[i].Result = &results[i];
+				}
+				Onion::Core::JobCounter counter;
+				io.Submit(std::move(requests), counter);
+				jobSystem.Wait(counter);
+				return std::all_of(results.begin(), results.end(), [](const Onion::Core::IoResult& result) { return result.Succeeded(); });
+			};
+
+			// One batch checked before timing, the timed ones only for errors
+			if (!readAll() || buffers != fileContents) {
+				bench.Fail(name, "wrong contents read back");
+				return;
+			}
+			bool readFailed = false;
+			bench.Run(name, 200, [&]() {
+				readFailed |= !readAll();
+				g_Sink = static_cast<float>(buffers[FILE_COUNT / 2][FILE_SIZE / 2]);
+				});
+			if (readFailed) {
+				bench.Fail(name, "a timed read failed");
+			}
+		};
+		run(uringName, true);
+		run(poolName, false);
+
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+	}
+}
+
+int main(int argc, char** argv) {
+	const Options options = ParseOptions(argc, argv);
+	Bench bench(options);
+
+	std::printf("Engine microbenchmarks%s\n", options.Quick ? " (quick)" : "");
+
+	RunModelCases(bench);
+	RunTransformCases(bench);
+	RunTransformBatchCases(bench, options.Quick);
+	RunEcsCases(bench, options.Quick);
+	RunInputsCases(bench);
+	RunAssetFileCases(bench);
+	RunAsyncFileCases(bench);
+	RunOpenGlCases(bench);
+
+	if (!options.OutputPath.empty() && !bench.WriteJson(options.OutputPath)) {
+		return 1;
+	}
+
+	return bench.HasFailures() ? 1 : 0;
+}
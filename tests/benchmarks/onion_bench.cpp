@@ -0,0 +1,444 @@
+// End-to-end rendering benchmark, without a visible window: loads a scripted scene, renders it
+// offscreen along a deterministic camera path and writes machine-readable results.
+//
+// Usage: OnionBench [--frames N] [--warmup N] [--width W] [--height H] [--scene path]
+//                   [--backend auto|window|egl|osmesa] [--output path]
+//   --frames    Measured frames (default 600), the camera does its whole path over them
+//   --warmup    Frames rendered before measuring, at the first camera position (default 60)
+//   --scene     Scene script (default assets/bench/default_scene.txt, see the file for the commands)
+//   --backend   Offscreen context, auto tries a hidden window, then EGL, then OSMesa (llvmpipe)
+//   --output    JSON results (default onion_bench.json)
+//
+// Every frame ends with glFinish, so frame times include the GPU work and frames do not pile up
+// in the driver queue. The camera position only depends on the frame index, never on time:
+// two runs render exactly the same images.
+
+#include <onion/renderer/offscreen_context/offscreen_context.hpp>
+#include <onion/renderer/framebuffer/framebuffer.hpp>
+#include <onion/renderer/asset_manager/asset_manager.hpp>
+#include <onion/renderer/model/model.hpp>
+#include <onion/renderer/material_table/material_table.hpp>
+#include <onion/renderer/shader/shader.hpp>
+#include <onion/renderer/skybox/skybox.hpp>
+#include <onion/renderer/camera/camera.hpp>
+#include <onion/renderer/shadows/cascaded_shadow_map.hpp>
+#include <onion/renderer/gpu_profiler/gpu_profiler.hpp>
+#include <onion/renderer/structs/frame_snapshot.hpp>
+#include <onion/renderer/structs/render_stats.hpp>
+#include <onion/renderer/structs/transform.hpp>
+#include <onion/core/frame_stats/frame_stats.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Onion::Rendering;
+using Onion::Core::FrameStats;
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	struct Options {
+		int Frames = 600;
+		int Warmup = 60;
+		int Width = 1280;
+		int Height = 720;
+		std::string ScenePath = "assets/bench/default_scene.txt";
+		OffscreenBackend Backend = OffscreenBackend::Auto;
+		std::string OutputPath = "onion_bench.json";
+	};
+
+	struct BenchScene {
+		std::map<std::string, Model> Models; // Node based, DrawItem keeps pointers to the models
+		std::vector<DrawItem> DrawList;
+		DirectionalLight Light;
+		bool Skybox = true;
+
+		glm::vec3 OrbitCenter{ 0.0f };
+		float OrbitRadius = 3.0f;
+		float OrbitHeight = 1.0f;
+		float OrbitTurns = 1.0f;
+	};
+
+	double ElapsedMs(Clock::time_point start, Clock::time_point end) {
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	Options ParseOptions(int argc, char** argv) {
+		Options options;
+		for (int i = 1; i < argc; i++) {
+			const bool hasValue = i + 1 < argc;
+			if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+				options.Frames = std::max(1, std::atoi(argv[++i]));
+			}
+			else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+				options.Warmup = std::max(0, std::atoi(argv[++i]));
+			}
+			else if (std::strcmp(argv[i], "--width") == 0 && hasValue) {
+				options.Width = std::max(1, std::atoi(argv[++i]));
+			}
+			else if (std::strcmp(argv[i], "--height") == 0 && hasValue) {
+				options.Height = std::max(1, std::atoi(argv[++i]));
+			}
+			else if (std::strcmp(argv[i], "--scene") == 0 && hasValue) {
+				options.ScenePath = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--backend") == 0 && hasValue) {
+				if (!ParseOffscreenBackend(argv[++i], options.Backend)) {
+					std::fprintf(stderr, "Unknown backend '%s', using auto\n", argv[i]);
+				}
+			}
+			else if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+				options.OutputPath = argv[++i];
+			}
+		}
+		return options;
+	}
+
+	// Throws std::runtime_error with the line number on malformed commands
+	void LoadScene(const std::string& path, BenchScene& scene, AssetManager& assets) {
+		std::ifstream file(path);
+		if (!file) {
+			throw std::runtime_error("Cannot open scene " + path);
+		}
+
+		const auto findModel = [&scene](const std::string& name, int line) -> Model& {
+			auto it = scene.Models.find(name);
+			if (it == scene.Models.end()) {
+				throw std::runtime_error("Line " + std::to_string(line) + ": unknown model '" + name + "'");
+			}
+			return it->second;
+			};
+
+		const auto addInstance = [&scene](const Model& model, const glm::vec3& position, float scale) {
+			Transform transform;
+			transform.Position = position;
+			transform.Scale = glm::vec3(scale);
+			scene.DrawList.push_back(DrawItem{ &model, transform.GetModelMatrix(), true });
+			};
+
+		std::string text;
+		int line = 0;
+		while (std::getline(file, text)) {
+			line++;
+			std::istringstream stream(text.substr(0, text.find('#')));
+			std::string command;
+			if (!(stream >> command)) {
+				continue;
+			}
+
+			bool valid = true;
+			if (command == "model") {
+				std::string name, modelPath;
+				valid = static_cast<bool>(stream >> name >> modelPath);
+				if (valid) {
+					scene.Models.insert_or_assign(name, Model(modelPath));
+				}
+			}
+			else if (command == "material") {
+				std::string name, albedo, roughness;
+				valid = static_cast<bool>(stream >> name >> albedo >> roughness);
+				if (valid) {
+					Material* material = assets.CreateMaterial(name);
+					material->Albedo = assets.LoadTexture(albedo);
+					material->Roughness = assets.LoadTexture(roughness);
+					findModel(name, line).SetMaterial(material);
+				}
+			}
+			else if (command == "instance") {
+				std::string name;
+				glm::vec3 position{ 0.0f };
+				float scale = 1.0f;
+				valid = static_cast<bool>(stream >> name >> position.x >> position.y >> position.z);
+				stream >> scale;
+				if (valid) {
+					addInstance(findModel(name, line), position, scale);
+				}
+			}
+			else if (command == "grid") {
+				std::string name;
+				int countX = 0;
+				int countZ = 0;
+				float spacing = 1.0f;
+				float scale = 1.0f;
+				valid = static_cast<bool>(stream >> name >> countX >> countZ >> spacing);
+				stream >> scale;
+				if (valid) {
+					const Model& model = findModel(name, line);
+					const glm::vec2 origin = -0.5f * spacing * glm::vec2(static_cast<float>(countX - 1), static_cast<float>(countZ - 1));
+					for (int x = 0; x < countX; x++) {
+						for (int z = 0; z < countZ; z++) {
+							const glm::vec2 offset = spacing * glm::vec2(static_cast<float>(x), static_cast<float>(z));
+							addInstance(model, glm::vec3(origin.x + offset.x, 0.0f, origin.y + offset.y), scale);
+						}
+					}
+				}
+			}
+			else if (command == "camera_orbit") {
+				valid = static_cast<bool>(stream >> scene.OrbitCenter.x >> scene.OrbitCenter.y >> scene.OrbitCenter.z
+					>> scene.OrbitRadius >> scene.OrbitHeight >> scene.OrbitTurns);
+			}
+			else if (command == "light") {
+				glm::vec3 direction;
+				valid = static_cast<bool>(stream >> direction.x >> direction.y >> direction.z);
+				if (valid) {
+					scene.Light.Direction = glm::normalize(direction);
+				}
+			}
+			else if (command == "skybox") {
+				std::string value;
+				valid = static_cast<bool>(stream >> value) && (value == "on" || value == "off");
+				scene.Skybox = value == "on";
+			}
+			else {
+				throw std::runtime_error("Line " + std::to_string(line) + ": unknown command '" + command + "'");
+			}
+
+			if (!valid) {
+				throw std::runtime_error("Line " + std::to_string(line) + ": malformed '" + command + "'");
+			}
+		}
+
+		for (const DrawItem& item : scene.DrawList) {
+			if (!item.SourceModel->GetMaterial()) {
+				throw std::runtime_error("Scene " + path + ": a drawn model has no material");
+			}
+		}
+	}
+
+	// Orbit around the center, the position only depends on the frame index
+	void PlaceCamera(Camera& camera, const BenchScene& scene, int frame, int frameCount) {
+		const float angle = scene.OrbitTurns * glm::two_pi<float>() * static_cast<float>(frame) / static_cast<float>(frameCount);
+		const glm::vec3 position = scene.OrbitCenter + glm::vec3(scene.OrbitRadius * std::cos(angle), scene.OrbitHeight, scene.OrbitRadius * std::sin(angle));
+		camera.SetPosition(position);
+		camera.SetFront(glm::normalize(scene.OrbitCenter - position));
+	}
+
+	void WritePercentiles(std::ofstream& out, const char* name, const FrameStats::Percentiles& p) {
+		out << "  \"" << name << "\": { \"mean\": " << p.Mean << ", \"p50\": " << p.P50 << ", \"p95\": " << p.P95
+			<< ", \"p99\": " << p.P99 << ", \"max\": " << p.Max << " },\n";
+	}
+}
+
+int main(int argc, char** argv) {
+	const Options options = ParseOptions(argc, argv);
+
+	OffscreenContext context;
+	try {
+		context.Create(OffscreenContext::Settings{ options.Backend, options.Width, options.Height });
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	Framebuffer framebuffer;
+	AssetManager assets;
+	BenchScene scene;
+	Shader modelShader;
+	MaterialTable materials;
+	Skybox skybox;
+	CascadedShadowMap shadowMap;
+	GpuProfiler gpuProfiler;
+
+	// ------------ LOAD ------------
+	const auto loadStart = Clock::now();
+	try {
+		framebuffer.Create(options.Width, options.Height);
+
+		modelShader = Shader("assets/shaders/model.vert", "assets/shaders/model.frag");
+		MaterialTable::SetupShader(modelShader);
+		materials.Create();
+
+		LoadScene(options.ScenePath, scene, assets);
+		shadowMap.Init();
+		// Loaded by its first Render otherwise, which would land in the first warmup frame
+		if (scene.Skybox) {
+			skybox.InitSkybox();
+		}
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "Loading failed: %s\n", e.what());
+		skybox.Delete();
+		shadowMap.Delete();
+		gpuProfiler.Delete();
+		framebuffer.Delete();
+		modelShader.Delete();
+		materials.Delete();
+		assets.FreeAllAssets();
+		return 1;
+	}
+	const double loadMs = ElapsedMs(loadStart, Clock::now());
+
+	Camera camera(glm::vec3(0.0f), options.Width, options.Height);
+	camera.SetAspectRatio(static_cast<float>(options.Width) / static_cast<float>(options.Height));
+
+	FrameStats frameStats;
+	uint64_t drawCallSum = 0;
+	uint64_t triangleSum = 0;
+	uint64_t drawCallMax = 0;
+	uint64_t triangleMax = 0;
+	uint64_t textureBindSum = 0;
+	std::vector<uint32_t> blocks; // Per draw item, reused every frame
+
+	// ------------ FRAMES ------------
+	const int totalFrames = options.Warmup + options.Frames;
+	for (int frame = 0; frame < totalFrames; frame++) {
+		const bool measured = frame >= options.Warmup;
+		const int pathFrame = measured ? frame - options.Warmup : 0;
+
+		if (frame == options.Warmup) {
+			gpuProfiler.ResetStats();
+		}
+
+		const auto frameStart = Clock::now();
+		RenderStats::Reset();
+		gpuProfiler.BeginFrame();
+
+		PlaceCamera(camera, scene, pathFrame, options.Frames);
+		const glm::mat4 view = camera.GetViewMatrix();
+		const glm::mat4 projection = camera.GetProjectionMatrix();
+
+		// Static scene: the casters version never changes, cached cascades follow the camera only
+		shadowMap.Update(camera, scene.Light.Direction, 0);
+		framebuffer.Bind();
+		shadowMap.Render([&scene](const Shader& depthShader) {
+			for (const DrawItem& item : scene.DrawList) {
+				depthShader.setMat4("uModel", item.ModelMatrix);
+				item.SourceModel->Draw(depthShader);
+			}
+			});
+		for (const float gpuMs : shadowMap.GetCompletedRenderTimes()) {
+			gpuProfiler.RecordPassTime("Shadows", gpuMs);
+		}
+
+		glClearColor(0.1f, 0.1f, 0.12f, 1.f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		if (scene.Skybox) {
+			ScopedGpuPass gpuPass(gpuProfiler, "Skybox");
+			skybox.Render(view, projection);
+		}
+
+		{
+			ScopedGpuPass gpuPass(gpuProfiler, "Models");
+			modelShader.Use();
+			modelShader.setMat4("uView", view);
+			modelShader.setMat4("uProj", projection);
+			modelShader.setMat4("uViewProj", projection * view);
+			modelShader.setVec3("uLightDir", scene.Light.Direction);
+			modelShader.setVec3("uLightColor", scene.Light.Color);
+			modelShader.setVec3("uAmbient", scene.Light.Ambient);
+			modelShader.setVec3("uCameraPos", camera.GetPosition());
+			modelShader.setFloat("uSpecularStrength", scene.Light.SpecularStrength);
+			shadowMap.Bind(modelShader, static_cast<int>(MaterialSlot::Count));
+
+			// Scene order, unsorted: consecutive items sharing a material share a block
+			materials.Begin();
+			blocks.clear();
+			for (const DrawItem& item : scene.DrawList) {
+				blocks.push_back(materials.Add(*item.SourceModel->GetMaterial()));
+			}
+			materials.Upload();
+
+			for (size_t i = 0; i < scene.DrawList.size(); i++) {
+				const DrawItem& item = scene.DrawList[i];
+				materials.Bind(blocks[i]);
+
+				modelShader.setMat4("uModel", item.ModelMatrix);
+				item.SourceModel->Draw(modelShader);
+			}
+		}
+
+		gpuProfiler.EndFrame();
+		const auto submitted = Clock::now();
+		glFinish();
+		const auto finished = Clock::now();
+
+		if (!measured) {
+			continue;
+		}
+
+		// GPU times come back FRAME_LATENCY frames late, close enough on a static workload
+		frameStats.AddFrame(static_cast<float>(ElapsedMs(frameStart, finished)), static_cast<float>(ElapsedMs(frameStart, submitted)), gpuProfiler.GetFrameGpuMs());
+
+		const RenderStats& renderStats = RenderStats::Current();
+		drawCallSum += renderStats.DrawCalls;
+		triangleSum += renderStats.Triangles;
+		drawCallMax = std::max(drawCallMax, renderStats.DrawCalls);
+		triangleMax = std::max(triangleMax, renderStats.Triangles);
+		textureBindSum += renderStats.TextureBinds;
+	}
+
+	const FrameStats::Summary summary = frameStats.ComputeSessionSummary();
+	const std::vector<GpuPassStats> passes = gpuProfiler.GetPassStats();
+	const double frames = static_cast<double>(options.Frames);
+
+	// ------------ RESULTS ------------
+	std::ofstream out(options.OutputPath);
+	if (!out) {
+		std::fprintf(stderr, "Cannot write %s\n", options.OutputPath.c_str());
+	}
+	else {
+		out << "{\n";
+		out << "  \"scene\": \"" << options.ScenePath << "\",\n";
+		out << "  \"backend\": \"" << ToString(context.GetBackend()) << "\",\n";
+		out << "  \"gl_renderer\": \"" << context.GetRendererName() << "\",\n";
+		out << "  \"gl_version\": \"" << context.GetVersionString() << "\",\n";
+		out << "  \"width\": " << options.Width << ",\n";
+		out << "  \"height\": " << options.Height << ",\n";
+		out << "  \"frames\": " << options.Frames << ",\n";
+		out << "  \"warmup\": " << options.Warmup << ",\n";
+		out << "  \"load_ms\": " << loadMs << ",\n";
+		out << "  \"duration_s\": " << summary.DurationSeconds << ",\n";
+		out << "  \"hitches\": " << summary.HitchCount << ",\n";
+		WritePercentiles(out, "frame_ms", summary.FrameMs);
+		WritePercentiles(out, "cpu_ms", summary.CpuMs);
+		WritePercentiles(out, "gpu_ms", summary.GpuMs);
+		out << "  \"draw_calls\": { \"mean\": " << static_cast<double>(drawCallSum) / frames << ", \"max\": " << drawCallMax << " },\n";
+		out << "  \"triangles\": { \"mean\": " << static_cast<double>(triangleSum) / frames << ", \"max\": " << triangleMax << " },\n";
+		out << "  \"texture_binds\": { \"mean\": " << static_cast<double>(textureBindSum) / frames << " },\n";
+		out << "  \"gpu_passes\": [";
+		for (size_t i = 0; i < passes.size(); i++) {
+			out << (i == 0 ? "\n" : ",\n") << "    { \"name\": \"" << passes[i].Name << "\", \"average_ms\": " << passes[i].AverageMs
+				<< ", \"max_ms\": " << passes[i].MaxMs << " }";
+		}
+		out << "\n  ]\n}\n";
+	}
+
+	std::printf("OnionBench: %s, %s (%s)\n", options.ScenePath.c_str(), ToString(context.GetBackend()), context.GetRendererName().c_str());
+	std::printf("  load                      %10.1f ms\n", loadMs);
+	std::printf("  frame p50 / p95 / p99     %6.2f / %6.2f / %6.2f ms\n", summary.FrameMs.P50, summary.FrameMs.P95, summary.FrameMs.P99);
+	std::printf("  cpu   p50 / p95 / p99     %6.2f / %6.2f / %6.2f ms\n", summary.CpuMs.P50, summary.CpuMs.P95, summary.CpuMs.P99);
+	std::printf("  draw calls / triangles    %10.0f / %.0f per frame\n", static_cast<double>(drawCallSum) / frames, static_cast<double>(triangleSum) / frames);
+
+	skybox.Delete();
+	shadowMap.Delete();
+	gpuProfiler.Delete();
+	framebuffer.Delete();
+	modelShader.Delete();
+	materials.Delete();
+	assets.FreeAllAssets();
+	context.Destroy();
+
+	return out ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// CPU profiler overhead: cost of a zone outside and inside a capture, and Chrome trace export.
+//
+// Usage: OnionProfilerBench [--quick] [--trace path]
+//   --quick   Small iteration counts, used by ctest as a smoke test
+//   --trace   Where to write the exported trace (default onion_profiler_bench.json)
+//
+// The budget is 50 ns per recorded zone. Two timestamp reads are part of every zone and their cost
+// depends on the machine (a virtualized TSC can take 20+ ns), so the check is on the profiler's own
+// bookkeeping: zone cost minus two timestamps must stay under BOOKKEEPING_BUDGET_NS.
+
+#include <onion/core/profiler/profiler.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Onion::Core;
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	constexpr double ZONE_BUDGET_NS = 50.0;
+	constexpr double BOOKKEEPING_BUDGET_NS = 25.0;
+
+	struct Options {
+		bool Quick = false;
+		std::string TracePath = "onion_profiler_bench.json";
+	};
+
+	template<typename F>
+	double MedianNs(int repetitions, F&& run) {
+		std::vector<double> samples;
+		samples.reserve(static_cast<size_t>(repetitions));
+		for (int r = 0; r < repetitions; r++) {
+			samples.push_back(run());
+		}
+		std::sort(samples.begin(), samples.end());
+		return samples[samples.size() / 2];
+	}
+
+	// Opaque to the optimizer, so empty zones are not folded away. Per thread, the bench runs on several.
+	thread_local volatile int g_Sink = 0;
+
+	// Nested zones, like a real call tree: 'zoneCount' zones in total
+	double RunZones(size_t zoneCount) {
+		const auto start = Clock::now();
+		for (size_t i = 0; i < zoneCount / 2; i++) {
+			ProfileScope outer("Outer");
+			{
+				ProfileScope inner("Inner");
+				g_Sink = g_Sink + 1;
+			}
+		}
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	}
+
+	double RunTimestamps(size_t count) {
+		uint64_t sum = 0;
+		const auto start = Clock::now();
+		for (size_t i = 0; i < count; i++) {
+			sum += Profiler::GetTicks();
+		}
+		const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		g_Sink = static_cast<int>(sum & 1);
+		return ns;
+	}
+
+	double RunBaseline(size_t zoneCount) {
+		const auto start = Clock::now();
+		for (size_t i = 0; i < zoneCount / 2; i++) {
+			g_Sink = g_Sink + 1;
+		}
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	}
+
+	Options ParseOptions(int argc, char** argv) {
+		Options options;
+		for (int i = 1; i < argc; i++) {
+			if (std::strcmp(argv[i], "--quick") == 0) {
+				options.Quick = true;
+			}
+			else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+				options.TracePath = argv[++i];
+			}
+		}
+		return options;
+	}
+}
+
+int main(int argc, char** argv) {
+	const Options options = ParseOptions(argc, argv);
+
+	// Stays below the per-thread capacity, so no zone is dropped
+	const size_t zoneCount = options.Quick ? 20'000 : 60'000;
+	const int repetitions = options.Quick ? 5 : 15;
+
+	Profiler::SetThreadName("Main");
+
+	const double baselineNs = MedianNs(repetitions, [&]() { return RunBaseline(zoneCount); });
+	const double idleNs = MedianNs(repetitions, [&]() { return RunZones(zoneCount); });
+	const double recordingNs = MedianNs(repetitions, [&]() {
+		Profiler::BeginCapture();
+		const double ns = RunZones(zoneCount);
+		Profiler::EndCapture();
+		return ns;
+		});
+
+	const double timestampNs = MedianNs(repetitions, [&]() { return RunTimestamps(zoneCount); }) / static_cast<double>(zoneCount);
+
+	const double perZoneIdle = std::max(0.0, idleNs - baselineNs) / static_cast<double>(zoneCount);
+	const double perZoneRecording = std::max(0.0, recordingNs - baselineNs) / static_cast<double>(zoneCount);
+
+	std::printf("CPU profiler (%zu zones)\n", zoneCount);
+	std::printf("  zone, not capturing       %10.1f ns/zone\n", perZoneIdle);
+	std::printf("  zone, capturing           %10.1f ns/zone\n", perZoneRecording);
+	std::printf("  timestamp read            %10.1f ns\n", timestampNs);
+	if (perZoneRecording > ZONE_BUDGET_NS) {
+		std::printf("  warning: above the %.0f ns budget, timestamps alone take %.1f ns here\n", ZONE_BUDGET_NS, 2.0 * timestampNs);
+	}
+
+	// Several threads recording at once, then exported together
+	Profiler::BeginCapture();
+	{
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++) {
+			threads.emplace_back([t, zoneCount]() {
+				Profiler::SetThreadName("Bench " + std::to_string(t));
+				RunZones(zoneCount / 4);
+				});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+	Profiler::EndCapture();
+
+	const uint64_t recorded = Profiler::GetRecordedZoneCount();
+	const uint64_t expected = static_cast<uint64_t>(zoneCount / 8 * 2 * 4);
+	std::printf("  threaded capture          %10llu zones, %llu dropped\n",
+		static_cast<unsigned long long>(recorded), static_cast<unsigned long long>(Profiler::GetDroppedZoneCount()));
+
+	if (!Profiler::ExportChromeTrace(options.TracePath)) {
+		return 1;
+	}
+
+	std::ifstream trace(options.TracePath);
+	const std::string content((std::istreambuf_iterator<char>(trace)), std::istreambuf_iterator<char>());
+	if (content.find("\"traceEvents\"") == std::string::npos || content.find("Bench 3") == std::string::npos) {
+		std::fprintf(stderr, "Exported trace is missing events\n");
+		return 1;
+	}
+
+	if (recorded != expected) {
+		std::fprintf(stderr, "Recorded %llu zones, expected %llu\n", static_cast<unsigned long long>(recorded), static_cast<unsigned long long>(expected));
+		return 1;
+	}
+
+	const double bookkeepingNs = perZoneRecording - 2.0 * timestampNs;
+	if (bookkeepingNs > BOOKKEEPING_BUDGET_NS) {
+		std::fprintf(stderr, "Zone bookkeeping %.1f ns is above the %.0f ns budget\n", bookkeepingNs, BOOKKEEPING_BUDGET_NS);
+		return 1;
+	}
+
+	return 0;
+}
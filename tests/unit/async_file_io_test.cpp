@@ -0,0 +1,219 @@
+// Checks of AsyncFileIO on both backends: whole-file and in-place reads at offsets, contents,
+// missing files and shutdown with requests still queued. io_uring is skipped where the kernel refuses it.
+
+#include "checks.hpp"
+
+#include <onion/core/async_file_io/async_file_io.hpp>
+#include <onion/core/job_system/job_system.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using Onion::Core::AsyncFileIO;
+using Onion::Core::IoPriority;
+using Onion::Core::IoRequest;
+using Onion::Core::IoResult;
+using Onion::Core::JobCounter;
+using Onion::Core::JobSystem;
+using Onion::Tests::Check;
+
+namespace {
+
+	struct TestFile {
+		std::string Path;
+		std::vector<uint8_t> Contents;
+	};
+
+	std::vector<TestFile> WriteFiles(const std::filesystem::path& directory) {
+		// Empty, smaller than a chunk, several chunks with an odd tail
+		const size_t sizes[] = { 0, 1, 4095, 100'000, 3 * 65536 + 17 };
+		std::vector<TestFile> files;
+		uint32_t seed = 0x1F2E3D4Cu;
+		for (size_t i = 0; i < std::size(sizes); i++) {
+			TestFile& file = files.emplace_back();
+			file.Path = (directory / ("file_" + std::to_string(i) + ".bin")).string();
+			file.Contents.resize(sizes[i]);
+			for (uint8_t& byte : file.Contents) {
+				seed = seed * 1664525u + 1013904223u;
+				byte = static_cast<uint8_t>(seed >> 24);
+			}
+			std::ofstream(file.Path, std::ios::binary).write(reinterpret_cast<const char*>(file.Contents.data()), static_cast<std::streamsize>(file.Contents.size()));
+		}
+		return files;
+	}
+
+	AsyncFileIO::Settings MakeSettings(bool useIoUring) {
+		AsyncFileIO::Settings settings;
+		settings.UseIoUring = useIoUring;
+		// Small chunks so the larger files are split and reassembled
+		settings.ChunkSize = 65536;
+		settings.QueueDepth = 4;
+		settings.ThreadCount = 2;
+		return settings;
+	}
+
+	void CheckReads(JobSystem& jobSystem, const std::vector<TestFile>& files, bool useIoUring, const std::string& label) {
+		AsyncFileIO io(jobSystem);
+		io.SetSettings(MakeSettings(useIoUring));
+
+		// ------ Whole files, from the start and from an offset ------
+		std::vector<std::vector<uint8_t>> whole(files.size());
+		std::vector<std::vector<uint8_t>> wholeFromOffset(files.size());
+		std::vector<IoResult> wholeResults(files.size());
+		std::vector<IoResult> offsetResults(files.size());
+		std::atomic<int> completions{ 0 };
+		std::vector<IoRequest> requests;
+		for (size_t i = 0; i < files.size(); i++) {
+			IoRequest& request = requests.emplace_back();
+			request.Path = files[i].Path;
+			request.WholeFile = &whole[i];
+			request.Result = &wholeResults[i];
+			request.OnComplete = [&completions](const IoResult&) { completions++; };
+
+			IoRequest& offset = requests.emplace_back();
+			offset.Path = files[i].Path;
+			offset.Offset = files[i].Contents.size() / 3;
+			offset.WholeFile = &wholeFromOffset[i];
+			offset.Result = &offsetResults[i];
+			offset.Priority = i % 2 ? IoPriority::Low : IoPriority::High;
+		}
+
+		// ------ In place, into caller buffers ------
+		const TestFile& large = files.back();
+		const size_t inPlaceOffset = 70'001;
+		std::vector<uint8_t> buffer(large.Contents.size(), 0xCD);
+		IoResult bufferResult;
+		IoRequest& inPlace = requests.emplace_back();
+		inPlace.Path = large.Path;
+		inPlace.Offset = inPlaceOffset;
+		inPlace.Buffer = buffer.data();
+		inPlace.Size = 100'000;
+		inPlace.Result = &bufferResult;
+
+		// Past the end of the file: the read stops short
+		std::vector<uint8_t> tail(4096, 0xCD);
+		IoResult tailResult;
+		IoRequest& shortRead = requests.emplace_back();
+		shortRead.Path = large.Path;
+		shortRead.Offset = large.Contents.size() - 100;
+		shortRead.Buffer = tail.data();
+		shortRead.Size = tail.size();
+		shortRead.Result = &tailResult;
+
+		// ------ Missing file ------
+		std::vector<uint8_t> missingContents;
+		IoResult missingResult;
+		IoRequest& missing = requests.emplace_back();
+		missing.Path = large.Path + ".missing";
+		missing.WholeFile = &missingContents;
+		missing.Result = &missingResult;
+
+		JobCounter counter;
+		io.Submit(std::move(requests), counter);
+		jobSystem.Wait(counter);
+
+		Check(completions == static_cast<int>(files.size()), label + ": every OnComplete ran");
+		for (size_t i = 0; i < files.size(); i++) {
+			const std::string name = label + ": " + std::to_string(files[i].Contents.size()) + " bytes file";
+			Check(wholeResults[i].Succeeded() && wholeResults[i].BytesRead == files[i].Contents.size(), name + ", whole file result");
+			Check(whole[i] == files[i].Contents, name + ", whole file contents");
+
+			const size_t offset = files[i].Contents.size() / 3;
+			const std::vector<uint8_t> expected(files[i].Contents.begin() + static_cast<std::ptrdiff_t>(offset), files[i].Contents.end());
+			Check(offsetResults[i].Succeeded() && offsetResults[i].BytesRead == expected.size(), name + ", result from an offset");
+			Check(wholeFromOffset[i] == expected, name + ", contents from an offset");
+		}
+
+		Check(bufferResult.Succeeded() && bufferResult.BytesRead == 100'000, label + ": in place result");
+		Check(std::memcmp(buffer.data(), large.Contents.data() + inPlaceOffset, 100'000) == 0, label + ": in place contents");
+		Check(buffer[100'000] == 0xCD, label + ": in place read stays within its size");
+
+		Check(tailResult.Succeeded() && tailResult.BytesRead == 100, label + ": short read stops at the end of the file");
+		Check(std::memcmp(tail.data(), large.Contents.data() + large.Contents.size() - 100, 100) == 0, label + ": short read contents");
+		Check(tail[100] == 0xCD, label + ": short read stays within the file");
+
+		Check(missingResult.Error == ENOENT && missingResult.BytesRead == 0, label + ": missing file fails with ENOENT");
+		Check(missingContents.empty(), label + ": missing file leaves an empty buffer");
+
+		const AsyncFileIO::Stats stats = io.GetStats();
+		Check(stats.Failed == 1, label + ": one failed request in the stats");
+	}
+
+	void CheckShutdown(JobSystem& jobSystem, const std::vector<TestFile>& files, bool useIoUring, const std::string& label) {
+		// One reader and tiny chunks: most requests are still queued when the service is destroyed
+		constexpr size_t REQUEST_COUNT = 64;
+		const TestFile& large = files.back();
+		std::vector<std::vector<uint8_t>> contents(REQUEST_COUNT);
+		std::vector<IoResult> results(REQUEST_COUNT);
+		JobCounter counter;
+		{
+			AsyncFileIO io(jobSystem);
+			AsyncFileIO::Settings settings = MakeSettings(useIoUring);
+			settings.ChunkSize = 512;
+			settings.QueueDepth = 1;
+			settings.ThreadCount = 1;
+			io.SetSettings(settings);
+			if (useIoUring && io.GetBackend() != AsyncFileIO::Backend::IoUring) {
+				return;
+			}
+
+			std::vector<IoRequest> requests(REQUEST_COUNT);
+			for (size_t i = 0; i < REQUEST_COUNT; i++) {
+				requests[i].Path = large.Path;
+				requests[i].WholeFile = &contents[i];
+				requests[i].Result = &results[i];
+			}
+			io.Submit(std::move(requests), counter);
+		}
+		jobSystem.Wait(counter);
+
+		size_t cancelled = 0;
+		for (size_t i = 0; i < REQUEST_COUNT; i++) {
+			if (results[i].Error == ECANCELED) {
+				// io_uring also stops the request in the middle of its chunks, keeping what was read
+				cancelled += results[i].BytesRead == 0 ? 1 : 0;
+				Check(contents[i].size() == results[i].BytesRead
+					&& std::equal(contents[i].begin(), contents[i].end(), large.Contents.begin()), label + ": cancelled request keeps only what was read");
+			}
+			else {
+				// Started before the shutdown: finished in full
+				Check(results[i].Succeeded() && contents[i] == large.Contents, label + ": request finished before the shutdown");
+			}
+		}
+		Check(cancelled > 0, label + ": queued requests cancelled with ECANCELED before any read");
+	}
+}
+
+int main() {
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "onion_async_file_io_test";
+	std::filesystem::create_directories(directory);
+	const std::vector<TestFile> files = WriteFiles(directory);
+
+	JobSystem jobSystem;
+	for (bool useIoUring : { true, false }) {
+		const std::string label = useIoUring ? "io_uring" : "pread pool";
+		if (useIoUring) {
+			AsyncFileIO probe(jobSystem);
+			if (probe.GetBackend() != AsyncFileIO::Backend::IoUring) {
+				std::printf("io_uring unavailable, skipped\n");
+				continue;
+			}
+		}
+		std::printf("%s\n", label.c_str());
+		CheckReads(jobSystem, files, useIoUring, label);
+		CheckShutdown(jobSystem, files, useIoUring, label);
+	}
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+
+	return Onion::Tests::Finish();
+}
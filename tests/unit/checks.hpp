@@ -0,0 +1,25 @@
+#pragma once
+
+// Shared by the unit tests, self-checking executables run by ctest:
+// each failed Check is printed, main returns Finish(), 1 if any check failed.
+
+#include <cstdio>
+#include <string>
+
+namespace Onion::Tests {
+
+	inline int g_Failures = 0;
+
+	inline void Check(bool condition, const std::string& what) {
+		if (!condition) {
+			std::printf("  FAILED: %s\n", what.c_str());
+			g_Failures++;
+		}
+	}
+
+	inline int Finish() {
+		std::printf(g_Failures == 0 ? "All checks passed\n" : "%d checks failed\n", g_Failures);
+		return g_Failures == 0 ? 0 : 1;
+	}
+
+} // namespace Onion::Tests
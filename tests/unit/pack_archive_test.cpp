@@ -0,0 +1,280 @@
+// Checks of the .onionpak pipeline: BlockCompression round trips and corrupt block rejection,
+// PackWriter -> PackArchive contents, and Validate on damaged tables of contents.
+
+#include "checks.hpp"
+
+#include <onion/core/block_compression/block_compression.hpp>
+#include <onion/core/pack_archive/pack_archive.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Onion::Core::BlockCompression;
+using Onion::Core::PackArchive;
+using Onion::Core::PackEntry;
+using Onion::Core::PackHeader;
+using Onion::Core::PackWriter;
+using Onion::Tests::Check;
+
+namespace {
+
+	uint32_t NextRandom(uint32_t& seed) {
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	std::vector<uint8_t> Compress(const std::vector<uint8_t>& data) {
+		std::vector<uint8_t> block(BlockCompression::GetMaxCompressedSize(data.size()));
+		block.resize(BlockCompression::Compress(data.data(), data.size(), block.data(), block.size()));
+		return block;
+	}
+
+	bool Decompresses(const std::vector<uint8_t>& block, size_t size, std::vector<uint8_t>* contents = nullptr) {
+		// One byte more than asked: writing past 'size' would show there
+		std::vector<uint8_t> out(size + 1, 0xCD);
+		const bool ok = BlockCompression::Decompress(block.data(), block.size(), out.data(), size);
+		if (out[size] != 0xCD) {
+			Check(false, "Decompress wrote past the output size");
+		}
+		out.resize(size);
+		if (contents) {
+			*contents = std::move(out);
+		}
+		return ok;
+	}
+
+	// ------------ BLOCK COMPRESSION ------------
+
+	void CheckRoundTrip(const std::string& name, const std::vector<uint8_t>& data) {
+		const std::vector<uint8_t> block = Compress(data);
+		Check(!block.empty(), name + ": compressed");
+		Check(block.size() <= BlockCompression::GetMaxCompressedSize(data.size()), name + ": within the worst case size");
+
+		std::vector<uint8_t> contents;
+		Check(Decompresses(block, data.size(), &contents) && contents == data, name + ": round trip");
+		if (data.size() > 0) {
+			Check(!Decompresses(block, data.size() - 1), name + ": rejected with a smaller size");
+		}
+		Check(!Decompresses(block, data.size() + 1), name + ": rejected with a larger size");
+	}
+
+	void CheckBlockCompression() {
+		std::printf("Block compression\n");
+
+		uint32_t seed = 0x5EED1234u;
+		for (size_t size : { size_t(0), size_t(1), size_t(4), size_t(11), size_t(12), size_t(13), size_t(64) }) {
+			std::vector<uint8_t> data(size);
+			for (uint8_t& byte : data) {
+				byte = static_cast<uint8_t>(NextRandom(seed) & 3);
+			}
+			CheckRoundTrip("size " + std::to_string(size), data);
+		}
+
+		std::vector<uint8_t> noise(256 * 1024);
+		for (uint8_t& byte : noise) {
+			byte = static_cast<uint8_t>(NextRandom(seed));
+		}
+		CheckRoundTrip("incompressible", noise);
+
+		// Longer than the 15 + 255 * n length encodings, with overlapping matches (offset 1)
+		std::vector<uint8_t> run(300'000, 'a');
+		CheckRoundTrip("long run", run);
+		Check(Compress(run).size() < run.size() / 100, "long run: compresses");
+		Check(run.size() <= BlockCompression::GetMaxDecompressedSize(Compress(run).size()), "long run: within the expansion bound");
+
+		std::vector<uint8_t> text;
+		while (text.size() < 100'000) {
+			const std::string line = "uniform vec3 uLight" + std::to_string(NextRandom(seed) % 64) + ";\n";
+			text.insert(text.end(), line.begin(), line.end());
+		}
+		CheckRoundTrip("text", text);
+
+		std::vector<uint8_t> capacity(16);
+		Check(BlockCompression::Compress(text.data(), text.size(), capacity.data(), capacity.size()) == 0,
+			"Compress returns 0 below the worst case capacity");
+
+		// Corrupt blocks, built by hand: token (literals << 4 | match length - 4), literals, offset
+		Check(!Decompresses({ 0x10, 'a', 0x00, 0x00 }, 5), "corrupt: zero offset");
+		Check(!Decompresses({ 0x10, 'a', 0x02, 0x00 }, 5), "corrupt: offset before the start of the output");
+		Check(!Decompresses({ 0x50, 'a', 'b' }, 5), "corrupt: literals past the end of the block");
+		Check(!Decompresses({ 0xF0 }, 20), "corrupt: literal length past the end of the block");
+		Check(!Decompresses({ 0x10, 'a', 0x01 }, 5), "corrupt: truncated offset");
+		Check(!Decompresses({ 0x1F, 'a', 0x01, 0x00, 0xFF, 0xFF }, 5), "corrupt: match past the end of the output");
+
+		const std::vector<uint8_t> block = Compress(text);
+		for (size_t cut : { block.size() - 1, block.size() / 2, size_t(1) }) {
+			const std::vector<uint8_t> truncated(block.begin(), block.begin() + static_cast<std::ptrdiff_t>(cut));
+			Check(!Decompresses(truncated, text.size()), "truncated block (" + std::to_string(cut) + " bytes) rejected");
+		}
+	}
+
+	// ------------ ARCHIVE ------------
+
+	std::vector<uint8_t> ReadBytes(const std::filesystem::path& path) {
+		std::ifstream in(path, std::ios::binary);
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	void WriteBytes(const std::filesystem::path& path, const std::vector<uint8_t>& bytes) {
+		std::ofstream(path, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	bool OpenFails(const std::filesystem::path& path, const std::string& name) {
+		PackArchive archive;
+		try {
+			archive.Open(path.string());
+		}
+		catch (const std::runtime_error& e) {
+			std::printf("  %s: %s\n", name.c_str(), e.what());
+			return true;
+		}
+		return false;
+	}
+
+	void CheckArchive(const std::filesystem::path& directory) {
+		std::printf("Pack archive\n");
+
+		struct File {
+			std::string Name;
+			std::vector<uint8_t> Contents;
+		};
+		std::vector<File> files;
+		uint32_t seed = 0xA5C3E1F7u;
+		for (size_t i = 0; i < 40; i++) {
+			File& file = files.emplace_back();
+			file.Name = "assets/shaders/file_" + std::to_string(i) + (i % 2 ? ".glsl" : ".bin");
+			const size_t size = i == 0 ? 0 : (i * 997) % 20000;
+			file.Contents.resize(size);
+			for (uint8_t& byte : file.Contents) {
+				// Odd files compress, even ones are noise and stay stored
+				byte = static_cast<uint8_t>(i % 2 ? 'a' + NextRandom(seed) % 4 : NextRandom(seed));
+			}
+		}
+
+		for (bool compress : { false, true }) {
+			const std::string label = compress ? "compressed" : "stored";
+			const std::filesystem::path path = directory / (label + ".onionpak");
+
+			PackWriter writer;
+			PackWriter::Settings settings;
+			settings.Compress = compress;
+			writer.SetSettings(settings);
+			for (const File& file : files) {
+				writer.Add(file.Name, file.Contents.data(), file.Contents.size());
+			}
+			bool duplicateThrew = false;
+			try {
+				writer.Add(files[1].Name, files[1].Contents.data(), files[1].Contents.size());
+			}
+			catch (const std::runtime_error&) {
+				duplicateThrew = true;
+			}
+			Check(duplicateThrew, label + ": duplicate name rejected");
+			writer.Write(path.string());
+			Check(!compress || writer.GetStats().CompressedCount > 0, label + ": some entries compressed");
+
+			PackArchive archive;
+			archive.Open(path.string());
+			Check(archive.GetEntryCount() == files.size(), label + ": entry count");
+			for (const File& file : files) {
+				const PackEntry* entry = archive.Find(file.Name);
+				Check(entry != nullptr, label + ": finds " + file.Name);
+				if (!entry) {
+					continue;
+				}
+				Check(archive.GetName(*entry) == file.Name, label + ": name of " + file.Name);
+				Check(entry->Size == file.Contents.size(), label + ": size of " + file.Name);
+
+				std::vector<uint8_t> contents;
+				Check(archive.Extract(*entry, contents) && contents == file.Contents, label + ": contents of " + file.Name);
+				if (!PackArchive::IsCompressed(*entry) && !file.Contents.empty()) {
+					Check(std::memcmp(archive.GetStoredData(*entry), file.Contents.data(), file.Contents.size()) == 0,
+						label + ": stored bytes of " + file.Name);
+				}
+			}
+			Check(archive.Find("./assets/shaders/../shaders/file_3.glsl") == archive.Find("assets/shaders/file_3.glsl"), label + ": lookups normalize the path");
+			Check(archive.Find("assets/shaders/missing.glsl") == nullptr, label + ": missing file not found");
+		}
+
+		// ------ Damaged archives ------
+		const std::vector<uint8_t> bytes = ReadBytes(directory / "compressed.onionpak");
+		PackHeader header;
+		std::memcpy(&header, bytes.data(), sizeof(header));
+
+		const auto writeDamaged = [&](const std::string& name, std::vector<uint8_t> damaged) {
+			const std::filesystem::path path = directory / (name + ".onionpak");
+			WriteBytes(path, damaged);
+			return path;
+		};
+
+		// Cut inside the entries, the header still telling the full size
+		const size_t tocCut = static_cast<size_t>(header.EntriesOffset + sizeof(PackEntry) * 2);
+		std::vector<uint8_t> truncated(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(tocCut));
+		Check(OpenFails(writeDamaged("truncated", truncated), "truncated"), "truncated archive rejected");
+
+		// Same cut, with the header patched to the new size: the table of contents no longer fits
+		PackHeader patched = header;
+		patched.FileSize = truncated.size();
+		std::memcpy(truncated.data(), &patched, sizeof(patched));
+		Check(OpenFails(writeDamaged("truncated_toc", truncated), "truncated table of contents"), "truncated table of contents rejected");
+
+		Check(OpenFails(writeDamaged("header_only", std::vector<uint8_t>(bytes.begin(), bytes.begin() + 10)), "truncated header"),
+			"truncated header rejected");
+
+		std::vector<uint8_t> badMagic = bytes;
+		badMagic[0] = 'X';
+		Check(OpenFails(writeDamaged("bad_magic", badMagic), "bad magic"), "bad magic rejected");
+
+		std::vector<uint8_t> badEntry = bytes;
+		PackEntry entry;
+		std::memcpy(&entry, bytes.data() + header.EntriesOffset, sizeof(entry));
+		entry.Offset = bytes.size() - 1;
+		entry.StoredSize = 100;
+		std::memcpy(badEntry.data() + header.EntriesOffset, &entry, sizeof(entry));
+		Check(OpenFails(writeDamaged("bad_entry", badEntry), "entry out of the file"), "entry out of the file rejected");
+
+		// Decompressed size beyond what the stored block can expand to: rejected before Extract allocates it
+		for (uint32_t i = 0; i < header.EntryCount; i++) {
+			const size_t entryOffset = static_cast<size_t>(header.EntriesOffset + i * sizeof(PackEntry));
+			std::memcpy(&entry, bytes.data() + entryOffset, sizeof(entry));
+			if (!PackArchive::IsCompressed(entry)) {
+				continue;
+			}
+			std::vector<uint8_t> badSize = bytes;
+			entry.Size = uint64_t(1) << 62;
+			std::memcpy(badSize.data() + entryOffset, &entry, sizeof(entry));
+			Check(OpenFails(writeDamaged("bad_size", badSize), "absurd decompressed size"), "absurd decompressed size rejected");
+			break;
+		}
+
+		std::vector<uint8_t> badBuckets = bytes;
+		PackHeader buckets = header;
+		buckets.BucketCount = header.BucketCount * 1024;
+		std::memcpy(badBuckets.data(), &buckets, sizeof(buckets));
+		Check(OpenFails(writeDamaged("bad_buckets", badBuckets), "hash table out of the file"), "hash table out of the file rejected");
+	}
+}
+
+int main() {
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "onion_pack_archive_test";
+	std::filesystem::create_directories(directory);
+
+	try {
+		CheckBlockCompression();
+		CheckArchive(directory);
+	}
+	catch (const std::exception& e) {
+		Check(false, std::string("unexpected exception: ") + e.what());
+	}
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+
+	return Onion::Tests::Finish();
+}
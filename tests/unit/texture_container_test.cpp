@@ -0,0 +1,198 @@
+// Checks of the KTX2 and DDS parsers on files built in memory: valid layouts, then truncated files,
+// bad magic numbers and absurd counts, which must fail cleanly without allocating. No OpenGL needed.
+
+#include "checks.hpp"
+
+#include <onion/renderer/texture_container/texture_container.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using Onion::Rendering::TextureContainer;
+using Onion::Tests::Check;
+
+namespace {
+
+	template <typename T>
+	void Put(std::vector<uint8_t>& bytes, size_t offset, T value) {
+		if (bytes.size() < offset + sizeof(value)) {
+			bytes.resize(offset + sizeof(value));
+		}
+		std::memcpy(bytes.data() + offset, &value, sizeof(value));
+	}
+
+	bool Parses(const std::vector<uint8_t>& bytes, const std::string& name, TextureContainer* out = nullptr) {
+		TextureContainer container;
+		const bool parsed = container.Parse(bytes.data(), bytes.size(), name);
+		Check(parsed == container.IsLoaded(), name + ": IsLoaded matches Parse");
+		if (out) {
+			*out = std::move(container);
+		}
+		return parsed;
+	}
+
+	// ------------ KTX2 ------------
+
+	constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	constexpr uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+	constexpr uint32_t VK_FORMAT_BC1_RGBA_UNORM = 133;
+
+	// Header (80 bytes), level index (24 bytes per level), then the levels, the largest first
+	std::vector<uint8_t> MakeKtx2(uint32_t vkFormat, uint32_t blockBytes, uint32_t blockSize, uint32_t width, uint32_t height,
+		uint32_t layerCount, uint32_t faceCount, uint32_t levelCount) {
+		std::vector<uint8_t> bytes(80 + 24 * levelCount, 0);
+		std::memcpy(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+		Put<uint32_t>(bytes, 12, vkFormat);
+		Put<uint32_t>(bytes, 16, 1);
+		Put<uint32_t>(bytes, 20, width);
+		Put<uint32_t>(bytes, 24, height);
+		Put<uint32_t>(bytes, 32, layerCount);
+		Put<uint32_t>(bytes, 36, faceCount);
+		Put<uint32_t>(bytes, 40, levelCount);
+
+		const uint32_t images = std::max(layerCount, 1u) * faceCount;
+		for (uint32_t level = 0; level < levelCount; level++) {
+			const uint32_t w = std::max(width >> level, 1u);
+			const uint32_t h = std::max(height >> level, 1u);
+			const uint64_t length = uint64_t((w + blockSize - 1) / blockSize) * ((h + blockSize - 1) / blockSize) * blockBytes * images;
+			Put<uint64_t>(bytes, 80 + 24 * level, bytes.size());
+			Put<uint64_t>(bytes, 80 + 24 * level + 8, length);
+			Put<uint64_t>(bytes, 80 + 24 * level + 16, length);
+			bytes.resize(bytes.size() + length, static_cast<uint8_t>(level));
+		}
+		return bytes;
+	}
+
+	void CheckKtx2() {
+		std::printf("KTX2\n");
+
+		TextureContainer container;
+		const std::vector<uint8_t> rgba = MakeKtx2(VK_FORMAT_R8G8B8A8_UNORM, 4, 1, 16, 8, 0, 1, 5);
+		Check(Parses(rgba, "rgba 2D", &container), "2D texture parses");
+		Check(container.GetTarget() == TextureContainer::Target::Texture2D, "2D texture target");
+		Check(container.GetWidth() == 16 && container.GetHeight() == 8 && container.GetLevelCount() == 5, "2D texture dimensions");
+		Check(container.GetImages().size() == 5, "2D texture, one image per level");
+		if (container.GetImages().size() == 5) {
+			const TextureContainer::Image& last = container.GetImages().back();
+			Check(last.Width == 1 && last.Height == 1 && last.Size == 4 && rgba[last.Offset] == 4, "2D texture, last level located");
+		}
+
+		Check(Parses(MakeKtx2(VK_FORMAT_BC1_RGBA_UNORM, 8, 4, 64, 64, 0, 6, 7), "bc1 cubemap", &container), "BC1 cubemap parses");
+		Check(container.GetTarget() == TextureContainer::Target::Cubemap && container.GetImages().size() == 6 * 7, "BC1 cubemap images");
+
+		Check(Parses(MakeKtx2(VK_FORMAT_R8G8B8A8_UNORM, 4, 1, 8, 8, 3, 1, 1), "rgba array", &container), "array parses");
+		Check(container.GetTarget() == TextureContainer::Target::Array2D && container.GetLayerCount() == 3, "array layers");
+
+		// ------ Damaged files ------
+		for (size_t cut : { rgba.size() - 1, size_t(80 + 24 * 2), size_t(79), size_t(12) }) {
+			const std::vector<uint8_t> truncated(rgba.begin(), rgba.begin() + static_cast<std::ptrdiff_t>(cut));
+			Check(!Parses(truncated, "truncated ktx2"), "truncated at " + std::to_string(cut) + " bytes rejected");
+		}
+
+		std::vector<uint8_t> badMagic = rgba;
+		badMagic[5] = '3';
+		Check(!TextureContainer::IsContainer(badMagic.data(), badMagic.size()), "bad magic is not a container");
+		Check(!Parses(badMagic, "bad magic ktx2"), "bad magic rejected");
+
+		std::vector<uint8_t> layers = rgba;
+		Put<uint32_t>(layers, 32, 0xFFFFFFFFu);
+		Check(!Parses(layers, "absurd layer count ktx2"), "absurd layer count rejected");
+
+		std::vector<uint8_t> size = MakeKtx2(VK_FORMAT_R8G8B8A8_UNORM, 4, 1, 16, 8, 0, 1, 1);
+		Put<uint32_t>(size, 20, 0xFFFFFFFFu);
+		Put<uint32_t>(size, 24, 0xFFFFFFFFu);
+		Check(!Parses(size, "absurd size ktx2"), "absurd dimensions rejected");
+
+		std::vector<uint8_t> levels = rgba;
+		Put<uint32_t>(levels, 40, 9);
+		Check(!Parses(levels, "too many levels ktx2"), "more levels than the size allows rejected");
+
+		std::vector<uint8_t> shortLevel = rgba;
+		Put<uint64_t>(shortLevel, 80 + 8, 16);
+		Check(!Parses(shortLevel, "short level ktx2"), "level smaller than its images rejected");
+
+		std::vector<uint8_t> pastEnd = rgba;
+		Put<uint64_t>(pastEnd, 80, rgba.size() - 4);
+		Check(!Parses(pastEnd, "level past the end ktx2"), "level past the end of the file rejected");
+
+		std::vector<uint8_t> supercompressed = rgba;
+		Put<uint32_t>(supercompressed, 44, 2);
+		Check(!Parses(supercompressed, "zstd ktx2"), "supercompressed rejected");
+	}
+
+	// ------------ DDS ------------
+
+	constexpr uint32_t FourCC(char a, char b, char c, char d) {
+		return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+	}
+
+	// Magic (4 bytes), header (124 bytes), DX10 header (20 bytes), then each layer with its mip chain
+	std::vector<uint8_t> MakeDdsBc1(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t arraySize) {
+		std::vector<uint8_t> bytes(4 + 124 + 20, 0);
+		Put<uint32_t>(bytes, 0, FourCC('D', 'D', 'S', ' '));
+		Put<uint32_t>(bytes, 4, 124);
+		Put<uint32_t>(bytes, 4 + 8, height);
+		Put<uint32_t>(bytes, 4 + 12, width);
+		Put<uint32_t>(bytes, 4 + 24, mipCount);
+		Put<uint32_t>(bytes, 4 + 72, 32);
+		Put<uint32_t>(bytes, 4 + 76, 0x4);
+		Put<uint32_t>(bytes, 4 + 80, FourCC('D', 'X', '1', '0'));
+		Put<uint32_t>(bytes, 128, 71);		// DXGI_FORMAT_BC1_UNORM
+		Put<uint32_t>(bytes, 128 + 4, 3);	// Texture2D
+		Put<uint32_t>(bytes, 128 + 12, arraySize);
+
+		for (uint32_t layer = 0; layer < arraySize; layer++) {
+			for (uint32_t level = 0; level < mipCount; level++) {
+				const uint32_t blocks = ((std::max(width >> level, 1u) + 3) / 4) * ((std::max(height >> level, 1u) + 3) / 4);
+				bytes.resize(bytes.size() + blocks * 8, static_cast<uint8_t>(layer));
+			}
+		}
+		return bytes;
+	}
+
+	void CheckDds() {
+		std::printf("DDS\n");
+
+		TextureContainer container;
+		const std::vector<uint8_t> bc1 = MakeDdsBc1(32, 16, 6, 2);
+		Check(Parses(bc1, "bc1 array dds", &container), "BC1 array parses");
+		Check(container.GetTarget() == TextureContainer::Target::Array2D && container.GetImages().size() == 12, "BC1 array images");
+		if (container.GetImages().size() == 12) {
+			const TextureContainer::Image& second = container.GetImages()[6];
+			Check(second.Layer == 1 && second.Level == 0 && bc1[second.Offset] == 1, "BC1 array, second layer located");
+		}
+
+		for (size_t cut : { bc1.size() - 1, size_t(4 + 124 + 10), size_t(64) }) {
+			const std::vector<uint8_t> truncated(bc1.begin(), bc1.begin() + static_cast<std::ptrdiff_t>(cut));
+			Check(!Parses(truncated, "truncated dds"), "truncated at " + std::to_string(cut) + " bytes rejected");
+		}
+
+		std::vector<uint8_t> badMagic = bc1;
+		badMagic[0] = 'X';
+		Check(!Parses(badMagic, "bad magic dds"), "bad magic rejected");
+
+		std::vector<uint8_t> layers = bc1;
+		Put<uint32_t>(layers, 128 + 12, 0xFFFFFFFFu);
+		Check(!Parses(layers, "absurd array size dds"), "absurd array size rejected");
+
+		std::vector<uint8_t> size = MakeDdsBc1(4, 4, 1, 1);
+		Put<uint32_t>(size, 4 + 8, 0xFFFFFFFFu);
+		Put<uint32_t>(size, 4 + 12, 0xFFFFFFFFu);
+		Check(!Parses(size, "absurd size dds"), "absurd dimensions rejected");
+
+		std::vector<uint8_t> format = bc1;
+		Put<uint32_t>(format, 128, 1000);
+		Check(!Parses(format, "unknown format dds"), "unknown DXGI format rejected");
+	}
+}
+
+int main() {
+	CheckKtx2();
+	CheckDds();
+
+	return Onion::Tests::Finish();
+}